@@ -0,0 +1,134 @@
+#include "parser.h"
+#include "type_checker.h"
+#include "compiler.h"
+#include "register_compiler.h"
+#include "thread_pool.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+using namespace nust;
+
+namespace {
+
+// A large program of similar functions covering every statement and
+// expression kind; each function calls the one before it.
+std::string generate_program(int functions) {
+    std::string source;
+    for (int i = 0; i < functions; ++i) {
+        std::string n = std::to_string(i);
+        source += "// helper " + n + "\n";
+        source += "fn f" + n + "(a: i32, b: i32, flag: bool) -> i32 {\n";
+        source += "    let mut acc: i32 = a;\n";
+        source += "    let mut i: i32 = 0;\n";
+        source += "    let name: str = \"f" + n + "\";\n";
+        source += "    let r: &i32 = &acc;\n";
+        source += "    while (i < b) {\n";
+        source += "        if (acc > 1000 && !(i == 3) || flag) {\n";
+        source += "            acc = acc - b * 2;\n";
+        source += "        } else {\n";
+        source += "            acc = acc + i / 2 + " + n + ";\n";
+        source += "        }\n";
+        source += "        i = i + 1;\n";
+        source += "    }\n";
+        if (i > 0) {
+            source += "    acc = acc + f" + std::to_string(i - 1) + "(acc, -b, !flag);\n";
+        }
+        source += "    return acc;\n";
+        source += "}\n\n";
+    }
+    source += "fn main() -> i32 {\n    return f0(1, 2, false);\n}\n";
+    return source;
+}
+
+} // namespace
+
+int main() {
+    constexpr int functions = 2000;
+    constexpr int runs = 5;
+
+    std::string source = generate_program(functions);
+    double megabytes = source.size() / (1024.0 * 1024.0);
+    std::cout << "program: " << functions << " functions, "
+              << std::fixed << std::setprecision(1) << megabytes << " MB\n";
+    std::cout << std::left << std::setw(16) << "phase"
+              << std::right << std::setw(12) << "best ms"
+              << std::setw(12) << "MB/sec" << "\n";
+
+    auto report = [&](const char* phase, double best_ms) {
+        std::cout << std::left << std::setw(16) << phase
+                  << std::right << std::setw(12) << std::fixed << std::setprecision(2) << best_ms
+                  << std::setw(12) << std::fixed << std::setprecision(1)
+                  << megabytes / (best_ms / 1000.0) << "\n";
+    };
+
+    // Best-of-N wall time; `setup` runs untimed before each `phase`
+    auto time_runs = [](auto setup, auto phase) {
+        double best_ms = 0;
+        for (int run = 0; run < runs; ++run) {
+            auto state = setup();
+            auto start = std::chrono::steady_clock::now();
+            phase(state);
+            auto end = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            if (run == 0 || ms < best_ms) {
+                best_ms = ms;
+            }
+        }
+        return best_ms;
+    };
+
+    auto parse = [&] { return Parser(source).parse(); };
+    auto nothing = [] { return 0; };
+
+    report("parse", time_runs(nothing, [&](int) { parse(); }));
+
+    report("type check", time_runs(parse, [](std::unique_ptr<Program>& program) {
+        TypeChecker type_checker;
+        if (!type_checker.check_program(*program)) {
+            std::cerr << "type checking failed\n";
+            std::exit(1);
+        }
+    }));
+
+    // The compilers read the types the checker attached to the tree
+    auto checked = [&] {
+        auto program = parse();
+        TypeChecker().check_program(*program);
+        return program;
+    };
+
+    report("compile", time_runs(checked, [](std::unique_ptr<Program>& program) {
+        Compiler().compile(*program);
+    }));
+
+    report("register", time_runs(checked, [](std::unique_ptr<Program>& program) {
+        RegisterCompiler().compile(*program);
+    }));
+
+    // The same two phases with functions spread over every core
+    ThreadPool pool;
+    std::cout << "(parallel: " << pool.size() << " threads)\n";
+
+    report("type check par", time_runs(parse, [&pool](std::unique_ptr<Program>& program) {
+        TypeChecker type_checker;
+        type_checker.set_thread_pool(&pool);
+        type_checker.check_program(*program);
+    }));
+
+    report("compile par", time_runs(checked, [&pool](std::unique_ptr<Program>& program) {
+        Compiler compiler;
+        compiler.set_thread_pool(&pool);
+        compiler.compile(*program);
+    }));
+
+    report("end to end", time_runs(nothing, [&](int) {
+        auto program = parse();
+        TypeChecker type_checker;
+        type_checker.check_program(*program);
+        Compiler().compile(*program, type_checker.signatures());
+    }));
+    return 0;
+}
@@ -0,0 +1,250 @@
+#include "parser.h"
+#include "type_checker.h"
+#include "compiler.h"
+#include "vm.h"
+#include "register_compiler.h"
+#include "register_vm.h"
+#include "peephole.h"
+#include "superinstructions.h"
+#include "isolate.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+using namespace nust;
+
+namespace {
+
+struct BenchProgram {
+    const char* name;
+    const char* source;
+};
+
+// Loop- and call-heavy programs; each keeps its arithmetic inside i32 range.
+const BenchProgram programs[] = {
+    {"count", R"(
+        fn main() -> i32 {
+            let mut i: i32 = 0;
+            while (i < 3000000) {
+                i = i + 1;
+            }
+            return i;
+        }
+    )"},
+    {"nested", R"(
+        fn main() -> i32 {
+            let mut i: i32 = 0;
+            let mut acc: i32 = 0;
+            while (i < 1000) {
+                let mut j: i32 = 0;
+                while (j < 1000) {
+                    acc = acc + 1;
+                    j = j + 1;
+                }
+                i = i + 1;
+            }
+            return acc;
+        }
+    )"},
+    {"arith", R"(
+        fn main() -> i32 {
+            let mut i: i32 = 0;
+            let mut a: i32 = 0;
+            while (i < 300000) {
+                a = a + i / 7 - i / 9;
+                i = i + 1;
+            }
+            return a;
+        }
+    )"},
+    {"fib", R"(
+        fn fib(n: i32) -> i32 {
+            if (n < 2) {
+                return n;
+            }
+            return fib(n - 1) + fib(n - 2);
+        }
+
+        fn main() -> i32 {
+            return fib(30);
+        }
+    )"},
+};
+
+} // namespace
+
+int main() {
+#ifdef NUST_SWITCH_DISPATCH
+    const char* mode = "switch";
+#else
+    const char* mode = "threaded";
+#endif
+    constexpr int runs = 5;
+
+    std::cout << "dispatch: " << mode << "\n";
+    std::cout << std::left << std::setw(10) << "program"
+              << std::setw(12) << "backend"
+              << std::right << std::setw(14) << "instructions"
+              << std::setw(12) << "best ms"
+              << std::setw(16) << "Mops/sec" << "\n";
+
+    auto report = [](const char* name, const char* backend, uint64_t executed, double best_ms) {
+        std::cout << std::left << std::setw(10) << name
+                  << std::setw(12) << backend
+                  << std::right << std::setw(14) << executed
+                  << std::setw(12) << std::fixed << std::setprecision(2) << best_ms
+                  << std::setw(16) << std::fixed << std::setprecision(1)
+                  << (executed / best_ms) / 1000.0 << "\n";
+    };
+
+    // Best-of-N wall time for one fresh VM per run
+    auto time_runs = [](auto make_vm, uint64_t& executed) {
+        double best_ms = 0;
+        for (int run = 0; run < runs; ++run) {
+            auto vm = make_vm();
+            auto start = std::chrono::steady_clock::now();
+            vm.run();
+            auto end = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            if (run == 0 || ms < best_ms) {
+                best_ms = ms;
+            }
+            executed = vm.instructions_executed();
+        }
+        return best_ms;
+    };
+
+    for (const auto& bench : programs) {
+        Parser parser(bench.source);
+        auto program = parser.parse();
+        TypeChecker type_checker;
+        if (!type_checker.check_program(*program)) {
+            std::cerr << bench.name << ": type checking failed\n";
+            return 1;
+        }
+        std::vector<Value> constants;
+        uint64_t executed = 0;
+
+        Compiler compiler;
+        auto instructions = compiler.compile(*program);
+        double ms = time_runs([&] {
+            return VirtualMachine(compiler.get_function_table(), constants, instructions);
+        }, executed);
+        report(bench.name, "stack", executed, ms);
+
+        Compiler optimizing_compiler;
+        optimizing_compiler.add_pass(std::make_unique<PeepholeOptimizer>());
+        optimizing_compiler.add_pass(std::make_unique<SuperinstructionPass>());
+        auto optimized = optimizing_compiler.compile(*program);
+        ms = time_runs([&] {
+            return VirtualMachine(optimizing_compiler.get_function_table(), constants, optimized);
+        }, executed);
+        report(bench.name, "stack+opt", executed, ms);
+
+        ms = time_runs([&] {
+            VirtualMachine vm(optimizing_compiler.get_function_table(), constants, optimized);
+            vm.verify();
+            return vm;
+        }, executed);
+        report(bench.name, "opt+verify", executed, ms);
+
+        ms = time_runs([&] {
+            VirtualMachine vm(optimizing_compiler.get_function_table(), constants, optimized);
+            vm.verify();
+            vm.enable_jit();
+            return vm;
+        }, executed);
+        report(bench.name, "opt+jit", executed, ms);
+
+        RegisterCompiler register_compiler;
+        auto register_instructions = register_compiler.compile(*program);
+        ms = time_runs([&] {
+            return RegisterVM(register_compiler.get_function_table(), constants, register_instructions);
+        }, executed);
+        report(bench.name, "register", executed, ms);
+    }
+
+    // Many short invocations, as an embedding host makes them: a VM built
+    // (code packed and verified) for every call, against calls on one
+    // Isolate over a shared Module
+    const char* script = R"(
+        fn main() -> i32 {
+            return score(3, 4);
+        }
+
+        fn score(a: i32, b: i32) -> i32 {
+            let mut i: i32 = 0;
+            let mut total: i32 = 0;
+            while (i < 20) {
+                total = total + a * i - b;
+                i = i + 1;
+            }
+            return total;
+        }
+    )";
+    constexpr int calls = 20000;
+    auto report_calls = [](const char* backend, double best_ms) {
+        std::cout << std::left << std::setw(22) << backend
+                  << std::right << std::setw(12) << std::fixed << std::setprecision(2) << best_ms
+                  << std::setw(16) << std::fixed << std::setprecision(0)
+                  << calls / (best_ms / 1000.0) << "\n";
+    };
+    auto best_of = [](auto body) {
+        double best_ms = 0;
+        for (int run = 0; run < runs; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            auto end = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            if (run == 0 || ms < best_ms) {
+                best_ms = ms;
+            }
+        }
+        return best_ms;
+    };
+
+    std::cout << "\n" << std::left << std::setw(22) << "invocations"
+              << std::right << std::setw(12) << "best ms"
+              << std::setw(16) << "calls/sec" << "\n";
+
+    Parser parser(script);
+    auto program = parser.parse();
+    TypeChecker type_checker;
+    type_checker.check_program(*program);
+    Compiler compiler;
+    compiler.add_pass(std::make_unique<PeepholeOptimizer>());
+    compiler.add_pass(std::make_unique<SuperinstructionPass>());
+    auto instructions = compiler.compile(*program);
+    std::vector<Value> constants;
+    double ms = best_of([&] {
+        for (int i = 0; i < calls; ++i) {
+            VirtualMachine vm(compiler.get_function_table(), constants, instructions);
+            vm.verify();
+            vm.run();
+        }
+    });
+    report_calls("vm per call", ms);
+
+    auto module = Module::create(compiler.get_function_table(), compiler.string_constants, instructions);
+    size_t score = module->function_index("score");
+    IsolateConfig config;
+    config.jit = false;
+    Isolate isolate(module, config);
+    ms = best_of([&] {
+        for (int i = 0; i < calls; ++i) {
+            isolate.call(score, {Value(3), Value(4)});
+        }
+    });
+    report_calls("isolate", ms);
+
+    Isolate jitted(module);
+    ms = best_of([&] {
+        for (int i = 0; i < calls; ++i) {
+            jitted.call(score, {Value(3), Value(4)});
+        }
+    });
+    report_calls("isolate+jit", ms);
+    return 0;
+}
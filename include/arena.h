@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nust {
+
+// Fixed-size array whose storage lives in an Arena. Elements are trivially
+// copyable (node pointers), so the array itself is just a view.
+template <typename T>
+class ArenaArray {
+public:
+    ArenaArray() = default;
+    ArenaArray(T* data, size_t size) : data_(data), size_(size) {}
+
+    T* begin() const { return data_; }
+    T* end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T& operator[](size_t i) const { return data_[i]; }
+    T& back() const { return data_[size_ - 1]; }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Bump allocator that owns every node of a parsed Program. Objects are
+// carved out of large blocks and the blocks are released all at once with
+// the arena. Objects with non-trivial destructors (nodes holding strings or
+// vectors) are recorded as they are made and destroyed in reverse order
+// first.
+class Arena {
+public:
+    Arena() = default;
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Raw storage, suitably aligned; lives as long as the arena
+    void* allocate(size_t size, size_t align);
+
+    // Construct a T in the arena
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            finalizers_.push_back({object, [](void* p) { static_cast<T*>(p)->~T(); }});
+        }
+        return object;
+    }
+
+    // Copy `count` elements starting at `items` into an arena array
+    template <typename T>
+    ArenaArray<T> copy_array(const T* items, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                      "arena arrays hold plain values");
+        if (count == 0) {
+            return {};
+        }
+        T* data = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; i < count; i++) {
+            data[i] = items[i];
+        }
+        return ArenaArray<T>(data, count);
+    }
+
+    // Bytes handed out so far, and bytes reserved from the system
+    size_t bytes_used() const { return used_; }
+    size_t bytes_reserved() const { return reserved_; }
+
+    // Objects whose destructors will run when the arena goes away
+    size_t finalizer_count() const { return finalizers_.size(); }
+
+private:
+    struct Finalizer {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    static constexpr size_t min_block_size = 64 * 1024;
+
+    std::vector<char*> blocks_;
+    std::vector<Finalizer> finalizers_;
+    char* cursor_ = nullptr;
+    char* limit_ = nullptr;
+    size_t next_block_size_ = min_block_size;
+    size_t used_ = 0;
+    size_t reserved_ = 0;
+};
+
+} // namespace nust
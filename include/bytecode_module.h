@@ -0,0 +1,124 @@
+#pragma once
+
+#include "instruction.h"
+#include "packed_code.h"
+#include "function_table.h"
+#include "value.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace nust {
+
+// Thrown when a bytecode module is malformed or has an unsupported version
+class BytecodeError : public std::runtime_error {
+public:
+    explicit BytecodeError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// Binary module format (.no files). All integers are little-endian and
+// every section starts on an 8-byte boundary:
+//
+//   header        ModuleHeader
+//   functions     function_count x FunctionRecord
+//   constants     constant_count x u64, file offset of each constant's string
+//   strings       string records, deduplicated: u32 length, u32 reserved,
+//                 characters, NUL, zero padding to 8 bytes (the layout of
+//                 StringObject, so values can point straight at them)
+//   code          code_size bytes of packed code (see PackedCode), then
+//                 packed_code_padding zero bytes
+//
+// Function names and signatures are stored as string records too. A
+// signature is the return type followed by each parameter type, encoded as
+// 'i' (i32), 'b' (bool), 's' (str), '&' / 'm' (immutable / mutable
+// reference, followed by the referenced type).
+struct ModuleHeader {
+    uint32_t magic;              // "NUST"
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t function_count;
+    uint32_t constant_count;
+    uint64_t instruction_count;
+    uint64_t functions_offset;
+    uint64_t constants_offset;
+    uint64_t strings_offset;
+    uint64_t code_offset;
+    uint64_t code_size;          // Bytes of packed code, excluding padding
+    uint64_t file_size;
+};
+
+struct FunctionRecord {
+    uint64_t entry_point;
+    uint32_t num_params;
+    uint32_t num_locals;
+    uint64_t name_offset;        // String record holding the function name
+    uint64_t signature_offset;   // String record holding the signature
+    uint64_t entry_offset;       // Byte offset of entry_point in the code
+};
+
+constexpr uint32_t module_magic = 0x5453554E;  // "NUST" read as little-endian
+constexpr uint16_t module_version = 3;
+
+// Serialize a compiled program
+void write_module(std::ostream& out, const FunctionTable& function_table,
+                  const std::vector<std::string>& string_constants,
+                  const std::vector<Instruction>& instructions);
+
+// A program loaded from a module file, ready to hand to a VirtualMachine.
+// String constants point into the module's bytes, so they live as long as
+// the module does.
+//
+// A module is either read into a private buffer (load) or memory-mapped
+// read-only (map). Either way the VM executes the packed code section in
+// place, so nothing is decoded or copied per instruction, and processes
+// mapping the same file share its pages.
+class BytecodeModule {
+public:
+    // Constants point into the buffer, so modules move but don't copy
+    BytecodeModule(BytecodeModule&&) = default;
+    BytecodeModule& operator=(BytecodeModule&&) = default;
+    BytecodeModule(const BytecodeModule&) = delete;
+    BytecodeModule& operator=(const BytecodeModule&) = delete;
+
+    // Read and validate a module file; throws BytecodeError
+    static BytecodeModule load(const std::string& path);
+
+    // Map a module file and validate its header, functions and constants;
+    // throws BytecodeError. The code isn't scanned; the VM rejects unknown
+    // opcodes as it dispatches.
+    static BytecodeModule map(const std::string& path);
+
+    // Validate a module held in memory; throws BytecodeError
+    static BytecodeModule from_bytes(const void* data, size_t size);
+
+    const FunctionTable& function_table() const { return function_table_; }
+    const std::vector<Value>& constants() const { return constants_; }
+    const PackedCode& code() const { return code_; }
+
+    // Whether the module's bytes are a file mapping
+    bool is_mapped() const { return mapping_ != nullptr; }
+
+private:
+    // Unmaps the file on destruction
+    struct Mapping {
+        void* address;
+        size_t size;
+        ~Mapping();
+    };
+
+    BytecodeModule() = default;
+    void parse(bool validate_code);
+
+    std::vector<uint64_t> buffer_;        // Private copy of the file, 8-byte aligned
+    std::unique_ptr<Mapping> mapping_;    // Or the mapped file
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    FunctionTable function_table_;
+    std::vector<Value> constants_;
+    PackedCode code_;                     // View of the code section
+};
+
+} // namespace nust
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "instruction.h"
+#include "function_table.h"
+#include <vector>
+
+namespace nust {
+
+// A transformation over compiled bytecode, run by Compiler after code
+// generation. Passes may insert, remove or rewrite instructions as long as
+// they leave jump operands and function entry points pointing at the right
+// instructions.
+class BytecodePass {
+public:
+    virtual ~BytecodePass() = default;
+
+    // Short name for diagnostics
+    virtual const char* name() const = 0;
+
+    // Transform the program in place
+    virtual void run(std::vector<Instruction>& instructions, FunctionTable& function_table) = 0;
+};
+
+} // namespace nust
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "parser.h"
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace nust {
+
+// Thrown when a program uses something the C backend can't express
+class CEmitError : public std::runtime_error {
+public:
+    explicit CEmitError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// Ahead-of-time backend that translates a type-checked program AST into a
+// standalone C99 translation unit, to be built with the system compiler.
+// Each function becomes a C function over int32_t, bool and const char*, and
+// the generated main() prints main's result the way `nust` does.
+//
+// The output follows the VM's semantics: i32 arithmetic wraps, && and ||
+// evaluate both operands, and division by zero exits with the VM's error.
+// Each let becomes its own C variable, named after its Resolver binding, so
+// shadowing works as in the VM. C leaves the order of operands and
+// arguments unspecified, so operands that have to run in order are
+// evaluated into temporaries before the statement, left to right, as in
+// the VM. References are not supported.
+class CEmitter {
+public:
+    // Emit C source for a type-checked program
+    std::string emit(const Program& program);
+
+private:
+    void emit_function(const FunctionDecl* func);
+    void collect_locals(const Stmt* stmt);
+    void emit_statement(const Stmt* stmt, int depth);
+    std::string expression(const Expr* expr);
+    std::vector<std::string> operands(const std::vector<const Expr*>& exprs);
+    void emit_hoisted(int depth);
+    const Type* expression_type(const Expr* expr) const;
+
+    // Helper functions
+    std::string signature(const FunctionDecl* func) const;
+    std::string local_name(Symbol name, uint32_t binding) const;
+    std::string c_type(const Type* type) const;
+    std::string default_value(const Type* type) const;
+    void indent(int depth);
+
+    // State
+    std::ostringstream out_;
+    std::vector<const FunctionDecl*> functions_;
+    std::vector<const LetStmt*> locals_;     // Every let of the function, in order
+    std::vector<std::string> hoisted_;       // Temporaries the current statement needs first
+    uint32_t temp_count_ = 0;
+    const FunctionDecl* current_function_ = nullptr;
+};
+
+} // namespace nust
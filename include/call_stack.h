@@ -0,0 +1,105 @@
+#pragma once
+
+#include "value.h"
+#include "function_table.h"
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+namespace nust {
+
+// Thrown when a call would exceed the call stack's configured limits. The
+// message includes the chain of active calls.
+class StackOverflowError : public std::runtime_error {
+public:
+    explicit StackOverflowError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// "main -> fib (x3)": the functions at `function_indices`, outermost
+// first, with runs of the same function collapsed
+std::string format_call_chain(const FunctionTable& function_table,
+                              const std::vector<size_t>& function_indices);
+
+// Limits for a VM's call stack
+struct CallStackConfig {
+    size_t initial_slots = 1024;      // Value slots reserved up front
+    size_t max_slots = 1 << 22;       // Total slots the stack may grow to
+    size_t max_depth = 100000;        // Maximum number of nested calls
+};
+
+// Contiguous storage shared by the frames of every active call and the
+// operand stack. Each frame's operands sit directly above its locals, and a
+// call's arguments, left on the operand stack by the caller, become the
+// callee's first slots in place (sliding-window frames). Pushing a frame or
+// an operand never allocates except when the array itself has to grow,
+// which is amortized by doubling.
+class CallStack {
+public:
+    struct Frame {
+        size_t function_index;  // Function executing in this frame
+        size_t return_pc;       // Caller instruction to resume at
+        size_t base;            // Index of the frame's first slot
+        size_t stack_base;      // Index of the frame's first operand
+    };
+
+    explicit CallStack(const FunctionTable& function_table,
+                       CallStackConfig config = CallStackConfig());
+
+    // Push a frame whose first `num_params` slots are the values currently on
+    // top of the operand stack, extended with zeroed slots to `num_slots`.
+    // Returns the frame base. Throws StackOverflowError if a limit would be
+    // exceeded.
+    size_t push_frame(size_t function_index, size_t return_pc,
+                      size_t num_params, size_t num_slots);
+
+    // Pop the current frame, discarding its slots and operands, and return
+    // its record
+    Frame pop_frame();
+
+    // Drop every frame and operand, keeping the storage for the next run
+    void clear() {
+        frames_.clear();
+        top_ = 0;
+    }
+
+    // Current frame record
+    const Frame& current() const { return frames_.back(); }
+
+    // Number of active frames
+    size_t depth() const { return frames_.size(); }
+
+    // Number of slots in use across all frames and operands
+    size_t size() const { return top_; }
+
+    // Operand stack of the current frame. pop() and top() expect at least one
+    // operand; callers check operand_count() first.
+    void push(Value value) {
+        if (top_ == slots_.size()) {
+            grow_for_push();
+        }
+        slots_[top_++] = value;
+    }
+    Value pop() { return slots_[--top_]; }
+    Value& top() { return slots_[top_ - 1]; }
+    size_t operand_count() const { return top_ - frames_.back().stack_base; }
+
+    // Slot access by absolute index
+    Value& operator[](size_t index) { return slots_[index]; }
+    const Value& operator[](size_t index) const { return slots_[index]; }
+
+    // Human-readable chain of active calls, outermost first
+    std::string call_chain() const;
+
+private:
+    void grow(size_t required);
+    void grow_for_push();
+    [[noreturn]] void overflow(size_t function_index, const std::string& reason) const;
+
+    const FunctionTable& function_table_;
+    CallStackConfig config_;
+    std::vector<Value> slots_;
+    std::vector<Frame> frames_;
+    size_t top_;
+};
+
+} // namespace nust
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "instruction.h"
+#include "parser.h"
+#include "signature_index.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace nust {
+
+// Stack bytecode for one function before linking: jump targets count from
+// the function's first instruction and PUSH_STR operands index its own
+// string constants. Calls already name functions by table index.
+struct FunctionCode {
+    std::vector<Instruction> instructions;
+    std::vector<std::string> string_constants;
+};
+
+// On-disk cache of each function's FunctionCode, so re-running an edited
+// program only checks and compiles the functions that changed. A program's
+// entries live in one file, read once up front and rewritten by save().
+//
+// A function's key hashes its source text together with everything outside
+// it that the generated code depends on: for each name the Resolver bound
+// to a function (FunctionDecl::functions_used), that function's table index
+// and signature. Editing a function, renumbering or retyping a
+// function it calls, or declaring a function named like one of its
+// variables all change the key. `options` folds in front end settings that
+// change code generation (e.g. constant folding), and the cache format
+// version is hashed too.
+//
+// Keys are computed and entries loaded in the constructor, from the
+// signatures of the program as parsed, before any pass rewrites it. A missing, stale or
+// damaged file just means every function misses. File layout
+// (little-endian):
+//
+//   u32 magic "NFC1", u32 entry count
+//   per entry: u64 key, u32 byte size of the rest of the entry,
+//              u32 instruction count, u32 string count,
+//              instruction count x (u8 opcode, u64 operand),
+//              per string u32 length and its bytes
+class CodeCache {
+public:
+    CodeCache(std::string path, std::string_view source,
+              const SignatureIndex& signatures, uint64_t options = 0);
+
+    // Cached code for `func`, or nullptr if it has to be compiled
+    const FunctionCode* find(const FunctionDecl& func) const;
+
+    // Keep freshly compiled code for `func`, to be written by save()
+    void store(const FunctionDecl& func, const FunctionCode& code);
+
+    // Rewrite the file with an entry for every function of the program,
+    // if anything was stored. Entries for functions that no longer exist
+    // are dropped. Returns false if the file couldn't be written; the next
+    // run then just misses again.
+    bool save() const;
+
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+
+    // The key `func` is cached under
+    static uint64_t function_key(const FunctionDecl& func, std::string_view source,
+                                 const SignatureIndex& signatures, uint64_t options);
+
+private:
+    void load();
+
+    struct Entry {
+        uint64_t key;
+        bool hit = false;
+        FunctionCode code;
+    };
+
+    std::string path_;
+    std::vector<Entry> entries_;  // In signature order
+    std::unordered_map<const FunctionDecl*, size_t> index_;
+    bool dirty_ = false;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+};
+
+} // namespace nust
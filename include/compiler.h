@@ -3,8 +3,11 @@
 #include "parser.h"
 #include "instruction.h"
 #include "function_table.h"
+#include "signature_index.h"
+#include "thread_pool.h"
+#include "code_cache.h"
+#include "bytecode_pass.h"
 #include <vector>
-#include <unordered_map>
 #include <memory>
 
 namespace nust {
@@ -16,6 +19,23 @@ public:
     // Compile a program AST to bytecode
     std::vector<Instruction> compile(const Program& program);
     
+    // Same, reusing signatures already built for the program, e.g. by the
+    // TypeChecker
+    std::vector<Instruction> compile(const Program& program, const SignatureIndex& signatures);
+    
+    // Add a pass to run over the bytecode after code generation; passes run
+    // in the order they were added
+    void add_pass(std::unique_ptr<BytecodePass> pass) { passes.push_back(std::move(pass)); }
+    
+    // Generate each function's code in parallel on `pool` (nullptr for
+    // serially), then link the pieces in order. The output is identical to
+    // the serial path's.
+    void set_thread_pool(ThreadPool* pool) { pool_ = pool; }
+    
+    // Reuse functions' code from `cache` and save the code of the ones
+    // that had to be compiled (nullptr for no cache)
+    void set_code_cache(CodeCache* cache) { cache_ = cache; }
+    
     // Get the function table after compilation
     const FunctionTable& get_function_table() const { return function_table; }
     
@@ -25,6 +45,8 @@ public:
 private:
     // Function compilation
     void compile_function(const FunctionDecl* func);
+    void compile_separately(const SignatureIndex& signatures);
+    void link(const std::vector<FunctionCode>& pieces, const SignatureIndex& signatures);
     void compile_params(const std::vector<FunctionDecl::Param>& params);
     void compile_statement(const Stmt* stmt);
     void compile_expression(const Expr* expr);
@@ -48,13 +70,15 @@ private:
     void emit(Instruction instr);
     size_t emit_instruction(Opcode opcode, size_t operand = 0);
     size_t add_constant(const std::string& str);
-    size_t get_local_index(const std::string& name);
+    size_t get_local_index(const Identifier* ident);
     
     // State
     std::vector<Instruction> instructions;
-    std::unordered_map<std::string, size_t> local_vars;
-    size_t next_local_index;
     FunctionTable function_table;
+    std::vector<std::unique_ptr<BytecodePass>> passes;
+    const SignatureIndex* signatures_ = nullptr;  // Callees of the program being compiled
+    ThreadPool* pool_ = nullptr;
+    CodeCache* cache_ = nullptr;
 };
 
 } // namespace nust 
\ No newline at end of file
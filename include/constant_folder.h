@@ -0,0 +1,54 @@
+#pragma once
+
+#include "parser.h"
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nust {
+
+// Folds integer and boolean expressions whose operands are all constants
+// into literals, and propagates immutable `let` bindings initialized with a
+// constant into later uses. Runs on a type-checked program, before code
+// generation.
+//
+// Only operations that behave exactly as they would at runtime are folded:
+// i32 arithmetic wraps around like the VM's, INT_MIN / -1 included.
+// Anything that fails at runtime is left in place so it still fails when
+// executed. That covers division by zero, and == and != on bools, which the
+// VM rejects.
+class ConstantFolder {
+public:
+    ConstantFolder() = default;
+
+    // Fold the whole program in place
+    void fold_program(Program& program);
+
+    // Number of expressions replaced by a literal in the last run
+    size_t folded() const { return folded_; }
+
+private:
+    struct Constant {
+        bool is_bool;
+        int32_t value;
+    };
+
+    void fold_function(FunctionDecl& func);
+    void fold_statement(Stmt& stmt);
+    void fold_expression(Expr*& expr);
+
+    // The constant value of an expression, if it is a literal
+    static std::optional<Constant> constant_of(const Expr& expr);
+    static std::optional<Constant> evaluate(BinaryExpr::Op op, Constant lhs, Constant rhs);
+    static std::optional<Constant> evaluate(UnaryExpr::Op op, Constant operand);
+    void replace(Expr*& expr, Constant value);
+
+    // Value of each binding in the function, by the Resolver's binding
+    // number; nullopt unless it is an immutable constant
+    std::vector<std::optional<Constant>> constants_;
+
+    Arena* arena_ = nullptr;  // The program's, for new literals
+    size_t folded_ = 0;
+};
+
+} // namespace nust
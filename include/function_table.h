@@ -1,6 +1,8 @@
 #pragma once
 
 #include "parser.h"
+#include "signature_index.h"
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -11,8 +13,8 @@ struct FunctionInfo {
     size_t entry_point;      // Instruction pointer where function starts
     size_t num_params;       // Number of parameters
     size_t num_locals;       // Number of local variables
-    std::unique_ptr<Type> return_type;  // Function's return type
-    std::vector<std::unique_ptr<Type>> param_types;  // Types of parameters
+    const Type* return_type;  // Function's return type
+    std::vector<const Type*> param_types;  // Types of parameters
     std::string name;        // Function name for debugging
 };
 
@@ -20,21 +22,35 @@ class FunctionTable {
 public:
     FunctionTable();
     
+    // One function per signature, in the index's order, with entry points
+    // to be set as each function is compiled
+    explicit FunctionTable(const SignatureIndex& signatures);
+    
     // Add a function to the table
     size_t add_function(const FunctionDecl& func, size_t entry_point);
+    size_t add_function(const FunctionSignature& signature, size_t entry_point);
+    
+    // Add a function described directly, e.g. by a loaded bytecode module
+    size_t add_function(FunctionInfo info);
     
     // Get function info by index
     const FunctionInfo& get_function(size_t index) const;
     
+    // Move a function's entry point, e.g. after a pass rewrote the code
+    void set_entry_point(size_t index, size_t entry_point);
+    
+    // Record a function's frame size once it has been compiled
+    void set_num_locals(size_t index, size_t num_locals);
+    
     // Get function index by name
-    size_t get_function_index(const std::string& name) const;
+    size_t get_function_index(Symbol name) const;
     
     // Get total number of functions
     size_t size() const;
     
 private:
     std::vector<FunctionInfo> functions;
-    std::unordered_map<std::string, size_t> name_to_index;
+    std::unordered_map<Symbol, size_t> name_to_index;
 };
 
 } // namespace nust 
\ No newline at end of file
@@ -54,9 +54,51 @@ enum class Opcode : uint8_t {
     BORROW,     // Create immutable reference
     BORROW_MUT, // Create mutable reference
     DEREF,      // Dereference reference
-    DEREF_MUT   // Dereference mutable reference
+    DEREF_MUT,  // Dereference mutable reference
+
+    // Superinstructions, selected by SuperinstructionPass. Two-operand forms
+    // pack their operands with pack_operands().
+    LOAD_LOAD,          // Load locals a and b
+    LOAD_LOAD_ADD,      // Push local a + local b
+    LOAD_PUSH_I32,      // Load local a, then push integer constant b
+    INC_LOCAL,          // Add integer constant b to local a in place
+    CMP_EQ_JMP_IF_NOT,  // Compare two integers, jump if the comparison is false
+    CMP_NE_JMP_IF_NOT,
+    CMP_LT_JMP_IF_NOT,
+    CMP_GT_JMP_IF_NOT,
+    CMP_LE_JMP_IF_NOT,
+    CMP_GE_JMP_IF_NOT
 };
 
+// Number of opcodes; every Opcode value is below this
+constexpr size_t opcode_count = static_cast<size_t>(Opcode::CMP_GE_JMP_IF_NOT) + 1;
+
+// Pack two 32-bit operands of a superinstruction into one operand
+inline size_t pack_operands(uint32_t a, uint32_t b) {
+    return static_cast<size_t>(a) | (static_cast<size_t>(b) << 32);
+}
+
+inline uint32_t operand_a(size_t operand) { return static_cast<uint32_t>(operand); }
+inline uint32_t operand_b(size_t operand) { return static_cast<uint32_t>(operand >> 32); }
+
+// Whether the operand of this opcode is an instruction index
+inline bool is_jump(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::JMP:
+        case Opcode::JMP_IF:
+        case Opcode::JMP_IF_NOT:
+        case Opcode::CMP_EQ_JMP_IF_NOT:
+        case Opcode::CMP_NE_JMP_IF_NOT:
+        case Opcode::CMP_LT_JMP_IF_NOT:
+        case Opcode::CMP_GT_JMP_IF_NOT:
+        case Opcode::CMP_LE_JMP_IF_NOT:
+        case Opcode::CMP_GE_JMP_IF_NOT:
+            return true;
+        default:
+            return false;
+    }
+}
+
 // Convert opcode to string representation
 inline std::string opcode_to_string(Opcode opcode) {
     switch (opcode) {
@@ -108,6 +150,18 @@ inline std::string opcode_to_string(Opcode opcode) {
         case Opcode::DEREF:     return "DEREF";
         case Opcode::DEREF_MUT: return "DEREF_MUT";
         
+        // Superinstructions
+        case Opcode::LOAD_LOAD:     return "LOAD_LOAD";
+        case Opcode::LOAD_LOAD_ADD: return "LOAD_LOAD_ADD";
+        case Opcode::LOAD_PUSH_I32: return "LOAD_PUSH_I32";
+        case Opcode::INC_LOCAL:     return "INC_LOCAL";
+        case Opcode::CMP_EQ_JMP_IF_NOT: return "CMP_EQ_JMP_IF_NOT";
+        case Opcode::CMP_NE_JMP_IF_NOT: return "CMP_NE_JMP_IF_NOT";
+        case Opcode::CMP_LT_JMP_IF_NOT: return "CMP_LT_JMP_IF_NOT";
+        case Opcode::CMP_GT_JMP_IF_NOT: return "CMP_GT_JMP_IF_NOT";
+        case Opcode::CMP_LE_JMP_IF_NOT: return "CMP_LE_JMP_IF_NOT";
+        case Opcode::CMP_GE_JMP_IF_NOT: return "CMP_GE_JMP_IF_NOT";
+        
         default:
             return "UNKNOWN_OPCODE";
     }
@@ -134,6 +188,16 @@ struct Instruction {
             case Opcode::JMP_IF:
             case Opcode::JMP_IF_NOT:
             case Opcode::CALL:
+            case Opcode::LOAD_LOAD:
+            case Opcode::LOAD_LOAD_ADD:
+            case Opcode::LOAD_PUSH_I32:
+            case Opcode::INC_LOCAL:
+            case Opcode::CMP_EQ_JMP_IF_NOT:
+            case Opcode::CMP_NE_JMP_IF_NOT:
+            case Opcode::CMP_LT_JMP_IF_NOT:
+            case Opcode::CMP_GT_JMP_IF_NOT:
+            case Opcode::CMP_LE_JMP_IF_NOT:
+            case Opcode::CMP_GE_JMP_IF_NOT:
                 return true;
             default:
                 return false;
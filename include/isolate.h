@@ -0,0 +1,57 @@
+#pragma once
+
+#include "module.h"
+#include "vm.h"
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace nust {
+
+struct IsolateConfig {
+    CallStackConfig stack;
+    bool jit = true;                  // Compile hot functions (see VirtualMachine::enable_jit)
+    uint32_t jit_threshold = 1000;
+};
+
+// One execution context over a shared Module: a VM with its own call
+// stack, borrow boxes and string arguments. Creating an isolate compiles
+// and verifies nothing, and calls reuse its storage, so a host can keep
+// isolates around and run invocation after invocation on them. Functions
+// the JIT compiled stay compiled for the isolate's lifetime.
+//
+// An isolate is used by one thread at a time; isolates sharing a module
+// can run on different threads.
+class Isolate {
+public:
+    explicit Isolate(std::shared_ptr<const Module> module, IsolateConfig config = IsolateConfig());
+
+    // Call the function named `name`, or at `index` (see
+    // Module::function_index), with `args` and return its result. Each call
+    // starts from an empty stack. Arguments must match the function's
+    // parameter types: ints for i32, bools for bool and strings for str;
+    // functions taking references can't be called from outside. Throws
+    // std::runtime_error for a mismatch and for runtime errors.
+    Value call(std::string_view name, const std::vector<Value>& args = {});
+    Value call(size_t index, const std::vector<Value>& args = {});
+
+    // A str argument, valid until reset()
+    Value string(std::string_view str);
+
+    // Release the string arguments and whatever the last call left behind
+    void reset();
+
+    const Module& module() const { return *module_; }
+
+    // Instructions the last call dispatched
+    uint64_t instructions_executed() const { return vm_.instructions_executed(); }
+
+private:
+    void check_arguments(const FunctionInfo& func_info, const std::vector<Value>& args) const;
+
+    std::shared_ptr<const Module> module_;
+    VirtualMachine vm_;
+    StringHeap strings_;
+};
+
+} // namespace nust
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "packed_code.h"
+#include "function_table.h"
+#include "value.h"
+#include <cstdint>
+#include <vector>
+
+// Native code generation needs x86-64 and executable memory from mmap
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define NUST_HAVE_JIT
+#endif
+
+namespace nust {
+
+// Baseline JIT for verified stack bytecode. Each instruction is translated
+// by a fixed x86-64 template: the operand stack lives on the native stack,
+// locals are rbp-relative slots, and values keep the VM's tagged encoding,
+// so results drop straight back into the interpreter.
+//
+// A function is compiled only if it takes and returns i32/bool values,
+// returns with RET_VAL, and uses no strings or references, and only if the
+// same holds for every function it can call. Such functions have no side
+// effects, so when native code bails out (division by zero, or the native
+// stack budget running out) the interpreter simply redoes the call and
+// reports any error itself.
+//
+// The code must have passed BytecodeVerifier: the templates rely on stack
+// depths and operand types being consistent.
+class JitCompiler {
+public:
+    JitCompiler(const FunctionTable& function_table, const PackedCode& code);
+    ~JitCompiler();
+    JitCompiler(const JitCompiler&) = delete;
+    JitCompiler& operator=(const JitCompiler&) = delete;
+
+    // Whether this build can generate native code at all
+    static bool available();
+
+    // Compile function `index` and every function it can call, unless
+    // that's been done. Returns false if any of them is unsupported.
+    bool compile(size_t index);
+
+    // Run compiled function `index` with `args` (its parameters, first
+    // first). Returns false, leaving `result` alone, if the native code
+    // bailed out; the function is then not entered natively again.
+    bool call(size_t index, const Value* args, Value& result);
+
+    // Number of functions compiled so far
+    size_t compiled_count() const;
+
+private:
+    enum class State : uint8_t { Pending, Compiled, Unsupported };
+
+    // Executable memory, unmapped on destruction
+    struct Region {
+        void* address;
+        size_t size;
+    };
+
+    struct Decoded {
+        std::vector<Instruction> instructions;  // Jump operands are byte offsets
+        std::vector<size_t> offsets;
+    };
+
+    bool decode(size_t index, Decoded& decoded) const;
+    const void* install(const std::vector<uint8_t>& code);
+
+    const FunctionTable& function_table_;
+    const uint8_t* code_;
+    std::vector<size_t> entry_offsets_;
+    std::vector<size_t> end_offsets_;       // Where each function's bytes end
+    std::vector<State> states_;
+    std::vector<const void*> entries_;      // Native entry points; fixed size, compiled code calls through it
+    std::vector<Region> regions_;
+    const void* thunk_ = nullptr;           // Enters native code from C++
+};
+
+} // namespace nust
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "symbol.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nust {
+
+enum class TokenKind : uint8_t {
+    // Literals and names
+    Identifier, Integer, String,
+
+    // Keywords
+    Fn, Let, Mut, If, Else, While, Return, True, False,
+
+    // Punctuation
+    LeftParen, RightParen, LeftBrace, RightBrace,
+    Comma, Colon, Semicolon, Arrow,
+
+    // Operators
+    Plus, Minus, Star, Slash,
+    Bang, Amp, AndAnd, OrOr,
+    Assign, EqEq, BangEq, Lt, Le, Gt, Ge,
+
+    End
+};
+
+// How a token kind is spelled in error messages, e.g. "'('" or "identifier"
+const char* token_kind_name(TokenKind kind);
+
+// One lexed token. `payload` depends on the kind: the index into
+// TokenBuffer::names for identifiers, the index into TokenBuffer::strings for string literals, and
+// the value (as unsigned bits) for integer literals.
+struct Token {
+    TokenKind kind;
+    uint32_t payload;
+    uint32_t start;   // Byte offsets into the source
+    uint32_t end;
+};
+
+// The whole source as one flat token array
+struct TokenBuffer {
+    std::vector<Token> tokens;           // Always ends with an End token
+    std::vector<Symbol> names;           // Distinct identifiers, by Token::payload
+    std::vector<std::string> strings;    // String literal contents, escapes as written
+};
+
+// Line and column (both 1-based) of a byte offset
+struct SourceLocation {
+    size_t line;
+    size_t column;
+};
+
+// Start offset of every line, found in one vectorized pass over the source.
+// Built on demand to turn byte offsets (token and Span positions) into
+// line/column pairs, so nothing tracks lines while lexing or parsing.
+class LineTable {
+public:
+    explicit LineTable(const std::string& source);
+
+    SourceLocation locate(size_t offset) const;
+    size_t line_count() const { return line_starts_.size(); }
+
+private:
+    std::vector<size_t> line_starts_;
+};
+
+// Splits Nust source into tokens in a single pass, skipping whitespace and
+// `//` comments. Keywords are only recognized as whole words. Runs of
+// whitespace, identifier characters, comment text and string contents are
+// classified 16 (SSE2) or 32 (AVX2) bytes at a time where the build allows,
+// with a scalar fallback; define NUST_NO_SIMD to force the fallback.
+class Lexer {
+public:
+    explicit Lexer(const std::string& source) : source_(source) {}
+
+    // Tokenize the entire source. Throws std::runtime_error on characters
+    // that can't start a token, unterminated strings and integer literals
+    // that don't fit in an i32.
+    TokenBuffer tokenize();
+
+private:
+    [[noreturn]] void error(const std::string& message, size_t offset) const;
+
+    const std::string& source_;
+};
+
+} // namespace nust
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "bytecode_module.h"
+#include "function_table.h"
+#include "instruction.h"
+#include "packed_code.h"
+#include "value.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nust {
+
+// A compiled program, ready to run: the function table, string constants
+// and packed code, verified once when the module is built instead of by
+// every VM. Modules are immutable and handed out as shared pointers, so
+// any number of VMs (see Isolate), on any threads, can run one module
+// while it stays alive.
+class Module {
+public:
+    Module(const Module&) = delete;
+    Module& operator=(const Module&) = delete;
+
+    // Parse, check and compile `source` as the command line does by
+    // default: constant folding, peephole and superinstructions. Throws
+    // std::runtime_error with the type errors if the program doesn't check.
+    static std::shared_ptr<const Module> compile(std::string_view source);
+
+    // Package a compiler's output
+    static std::shared_ptr<const Module> create(const FunctionTable& function_table,
+                                                const std::vector<std::string>& string_constants,
+                                                const std::vector<Instruction>& instructions);
+
+    // Map a compiled module file (.no); throws BytecodeError
+    static std::shared_ptr<const Module> load(const std::string& path);
+
+    const FunctionTable& function_table() const;
+    const std::vector<Value>& constants() const;
+    const PackedCode& code() const;
+
+    // Whether the code passed BytecodeVerifier, so VMs can run it without
+    // their per-instruction checks
+    bool is_verified() const { return verified_; }
+
+    // Index of the function called `name`, for calling it repeatedly
+    // without looking it up each time. Throws std::runtime_error if there
+    // is none.
+    size_t function_index(std::string_view name) const;
+
+private:
+    Module() = default;
+    void verify();
+
+    // Compiled in process
+    FunctionTable function_table_;
+    StringHeap strings_;
+    std::vector<Value> constants_;
+    PackedCode code_;
+
+    // Or loaded from a file, which owns all of the above
+    std::optional<BytecodeModule> bytecode_;
+
+    bool verified_ = false;
+};
+
+} // namespace nust
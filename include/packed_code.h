@@ -0,0 +1,149 @@
+#pragma once
+
+#include "instruction.h"
+#include "function_table.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace nust {
+
+// How an opcode's operand is stored in packed code
+enum class OperandEncoding : uint8_t {
+    None,      // No operand
+    Unsigned,  // ULEB128
+    Signed,    // SLEB128 of the operand as a signed 64-bit value (PUSH_I32)
+    Target,    // Fixed 4-byte little-endian byte offset (jumps)
+    Pair       // ULEB128 of operand_a, then SLEB128 of operand_b as int32
+};
+
+inline OperandEncoding operand_encoding(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::PUSH_I32:
+            return OperandEncoding::Signed;
+        case Opcode::LOAD_LOAD:
+        case Opcode::LOAD_LOAD_ADD:
+        case Opcode::LOAD_PUSH_I32:
+        case Opcode::INC_LOCAL:
+            return OperandEncoding::Pair;
+        default:
+            break;
+    }
+    if (is_jump(opcode)) {
+        return OperandEncoding::Target;
+    }
+    return Instruction(opcode).has_operand() ? OperandEncoding::Unsigned : OperandEncoding::None;
+}
+
+// Longest encoded instruction: the opcode and a Pair whose LEB128 halves
+// each run to the 10 bytes the decoders read at most
+constexpr size_t max_leb128_size = 10;
+constexpr size_t max_instruction_size = 1 + 2 * max_leb128_size;
+
+// Readable zero bytes that follow every packed code buffer, so an operand
+// decoder that starts anywhere inside the code never reads past the end,
+// whatever the bytes it decodes
+constexpr size_t packed_code_padding = 32;
+static_assert(packed_code_padding >= max_instruction_size - 1,
+              "an instruction starting at the last code byte must end inside the padding");
+
+// Operand decoders. Each reads from code[pc] and advances pc past the
+// operand.
+inline size_t read_unsigned(const uint8_t* code, size_t& pc) {
+    uint8_t byte = code[pc++];
+    if (byte < 0x80) {
+        return byte;
+    }
+    size_t result = byte & 0x7f;
+    unsigned shift = 7;
+    do {
+        byte = code[pc++];
+        result |= static_cast<size_t>(byte & 0x7f) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && shift < 64);
+    return result;
+}
+
+inline int64_t read_signed(const uint8_t* code, size_t& pc) {
+    uint64_t result = 0;
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+        byte = code[pc++];
+        result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && shift < 64);
+    if (shift < 64 && (byte & 0x40)) {
+        result |= ~uint64_t(0) << shift;
+    }
+    return static_cast<int64_t>(result);
+}
+
+inline size_t read_target(const uint8_t* code, size_t& pc) {
+    const uint8_t* p = code + pc;
+    pc += 4;
+    return static_cast<size_t>(p[0]) | (static_cast<size_t>(p[1]) << 8) |
+           (static_cast<size_t>(p[2]) << 16) | (static_cast<size_t>(p[3]) << 24);
+}
+
+inline size_t read_pair(const uint8_t* code, size_t& pc) {
+    uint32_t a = static_cast<uint32_t>(read_unsigned(code, pc));
+    uint32_t b = static_cast<uint32_t>(read_signed(code, pc));
+    return pack_operands(a, b);
+}
+
+// Decode the instruction at code[pc] and advance pc past it. Jump operands
+// stay byte offsets.
+inline Instruction read_instruction(const uint8_t* code, size_t& pc) {
+    Opcode opcode = static_cast<Opcode>(code[pc++]);
+    if (static_cast<size_t>(opcode) >= opcode_count) {
+        return Instruction(opcode);
+    }
+    switch (operand_encoding(opcode)) {
+        case OperandEncoding::Unsigned: return Instruction(opcode, read_unsigned(code, pc));
+        case OperandEncoding::Signed: return Instruction(opcode, static_cast<size_t>(read_signed(code, pc)));
+        case OperandEncoding::Target: return Instruction(opcode, read_target(code, pc));
+        case OperandEncoding::Pair: return Instruction(opcode, read_pair(code, pc));
+        case OperandEncoding::None: break;
+    }
+    return Instruction(opcode);
+}
+
+// The VM's execution format: a byte stream of 1-byte opcodes followed by
+// their operands (see OperandEncoding). Operand-less instructions take one
+// byte and most others two or three, against 16 bytes for Instruction.
+// Jump operands and entry points are byte offsets into the stream.
+//
+// Packed code either owns its bytes (encode) or views bytes owned by
+// someone else, such as a mapped module (view).
+class PackedCode {
+public:
+    PackedCode() = default;
+
+    // Encode instructions; jump operands and the function table's entry
+    // points (instruction indices) are translated to byte offsets
+    static PackedCode encode(const std::vector<Instruction>& instructions,
+                             const FunctionTable& function_table);
+
+    // View `size` bytes of packed code followed by packed_code_padding
+    // readable bytes; the bytes must outlive the view
+    static PackedCode view(const uint8_t* data, size_t size, std::vector<size_t> entry_offsets);
+
+    // Decode back to instructions, with jump operands as instruction
+    // indices again
+    std::vector<Instruction> decode() const;
+
+    const uint8_t* data() const { return storage_.empty() ? view_ : storage_.data(); }
+    size_t size() const { return size_; }
+
+    // Byte offset of each function's first instruction
+    const std::vector<size_t>& entry_offsets() const { return entry_offsets_; }
+
+private:
+    std::vector<uint8_t> storage_;
+    const uint8_t* view_ = nullptr;
+    size_t size_ = 0;
+    std::vector<size_t> entry_offsets_;
+};
+
+} // namespace nust
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
 #include <optional>
 #include <stdexcept>
+#include "lexer.h"
+#include "arena.h"
+#include "symbol.h"
+#include "type.h"
 
 namespace nust {
 
@@ -22,7 +27,6 @@ class Program;
 class FunctionDecl;
 class Stmt;
 class Expr;
-class Type;
 
 // Precedence levels for binary operators
 enum class Precedence {
@@ -39,155 +43,213 @@ enum class Precedence {
     Primary
 };
 
-// AST Node types
+// Concrete type of an AST node. Every node stores its kind, so passes
+// dispatch with a switch (and downcast with node_cast) instead of RTTI.
+enum class NodeKind : uint8_t {
+    Program, FunctionDecl,
+
+    // Statements
+    LetStmt, ExprStmt, IfStmt, WhileStmt, BlockStmt, ReturnStmt,
+
+    // Expressions
+    IntLiteral, BoolLiteral, StringLiteral, Identifier,
+    BinaryExpr, UnaryExpr, BorrowExpr, CallExpr
+};
+
+// AST Node types. Nodes are allocated in their Program's Arena and refer to
+// each other by raw pointer; the arena frees the whole tree at once. Nodes
+// are never deleted through a base pointer, so the destructors aren't
+// virtual, and nodes without strings or vectors need no destructor call.
 class ASTNode {
 public:
-    virtual ~ASTNode() = default;
+    NodeKind kind;
     Span span;
 protected:
-    ASTNode(Span span) : span(span) {}
+    ASTNode(NodeKind kind, Span span) : kind(kind), span(span) {}
+    ~ASTNode() = default;
 };
 
+// Downcast by kind tag; nullptr if `node` is null or not a T
+template <typename T>
+T* node_cast(ASTNode* node) {
+    return node && node->kind == T::node_kind ? static_cast<T*>(node) : nullptr;
+}
+
+template <typename T>
+const T* node_cast(const ASTNode* node) {
+    return node && node->kind == T::node_kind ? static_cast<const T*>(node) : nullptr;
+}
+
 class Program : public ASTNode {
 public:
-    std::vector<std::unique_ptr<ASTNode>> items;
-    Program(Span span, std::vector<std::unique_ptr<ASTNode>> items) 
-        : ASTNode(span), items(std::move(items)) {}
+    static constexpr NodeKind node_kind = NodeKind::Program;
+    ArenaArray<ASTNode*> items;
+    Program(Span span, std::unique_ptr<Arena> arena, ArenaArray<ASTNode*> items) 
+        : ASTNode(node_kind, span), items(items), arena_(std::move(arena)) {}
+    
+    // Owns every node reachable from `items`
+    Arena& arena() { return *arena_; }
+
+private:
+    std::unique_ptr<Arena> arena_;
 };
 
 class FunctionDecl : public ASTNode {
 public:
+    static constexpr NodeKind node_kind = NodeKind::FunctionDecl;
     struct Param {
         bool is_mut;
-        std::string name;
-        std::unique_ptr<Type> type;
+        Symbol name;
+        const Type* type;
         Span span;
+        mutable bool redeclares = false;  // Set by the Resolver for a repeated name
         
-        Param(bool is_mut, std::string name, std::unique_ptr<Type> type, Span span)
-            : is_mut(is_mut), name(std::move(name)), type(std::move(type)), span(span) {}
+        Param(bool is_mut, Symbol name, const Type* type, Span span)
+            : is_mut(is_mut), name(name), type(type), span(span) {}
     };
     
-    std::string name;
+    Symbol name;
     std::vector<Param> params;
-    std::unique_ptr<Type> return_type;  // Added return type
-    std::unique_ptr<Stmt> body;
+    const Type* return_type;
+    Stmt* body;
     
-    FunctionDecl(Span span, std::string name, std::vector<Param> params, 
-                std::unique_ptr<Type> return_type, std::unique_ptr<Stmt> body)
-        : ASTNode(span), name(std::move(name)), params(std::move(params)),
-          return_type(std::move(return_type)), body(std::move(body)) {}
-};
-
-// Represents a lexical scope for borrow checking
-class Scope {
-public:
-    std::weak_ptr<Scope> parent;
-    std::vector<std::string> declarations;  // Variables declared in this scope
+    // Filled in by the Resolver: declarations (parameters first, then lets)
+    // and the frame slots they occupy, and the names in the body that refer
+    // to functions, in source order
+    mutable uint32_t num_bindings = 0;
+    mutable uint32_t num_slots = 0;
+    mutable std::vector<Symbol> functions_used;
     
-    explicit Scope(std::weak_ptr<Scope> parent = {}) : parent(parent) {}
+    FunctionDecl(Span span, Symbol name, std::vector<Param> params, 
+                const Type* return_type, Stmt* body)
+        : ASTNode(node_kind, span), name(name), params(std::move(params)),
+          return_type(return_type), body(body) {}
 };
 
 class Stmt : public ASTNode {
-public:
-    std::shared_ptr<Scope> scope;  // Each statement has access to its enclosing scope
-    virtual ~Stmt() = default;
 protected:
-    Stmt(Span span, std::shared_ptr<Scope> scope) : ASTNode(span), scope(scope) {}
+    Stmt(NodeKind kind, Span span) : ASTNode(kind, span) {}
 };
 
 class LetStmt : public Stmt {
 public:
+    static constexpr NodeKind node_kind = NodeKind::LetStmt;
     bool is_mut;  // Added mutability flag for let bindings
-    std::string name;
-    std::unique_ptr<Type> type;
-    std::unique_ptr<Expr> init;
+    Symbol name;
+    const Type* type;
+    Expr* init;
     
-    LetStmt(Span span, std::shared_ptr<Scope> scope, bool is_mut, std::string name, 
-            std::unique_ptr<Type> type, std::unique_ptr<Expr> init)
-        : Stmt(span, scope), is_mut(is_mut), name(std::move(name)), 
-          type(std::move(type)), init(std::move(init)) {}
+    // Filled in by the Resolver
+    mutable uint32_t binding = 0;     // Declaration number within the function
+    mutable uint32_t slot = 0;        // Frame slot
+    mutable bool redeclares = false;  // Name already declared in the same scope
+    
+    LetStmt(Span span, bool is_mut, Symbol name, 
+            const Type* type, Expr* init)
+        : Stmt(node_kind, span), is_mut(is_mut), name(name), 
+          type(type), init(init) {}
 };
 
 class ExprStmt : public Stmt {
 public:
-    std::unique_ptr<Expr> expr;
-    ExprStmt(Span span, std::shared_ptr<Scope> scope, std::unique_ptr<Expr> expr)
-        : Stmt(span, scope), expr(std::move(expr)) {}
+    static constexpr NodeKind node_kind = NodeKind::ExprStmt;
+    Expr* expr;
+    ExprStmt(Span span, Expr* expr)
+        : Stmt(node_kind, span), expr(expr) {}
 };
 
 class IfStmt : public Stmt {
 public:
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Stmt> then_branch;
-    std::unique_ptr<Stmt> else_branch;
+    static constexpr NodeKind node_kind = NodeKind::IfStmt;
+    Expr* condition;
+    Stmt* then_branch;
+    Stmt* else_branch;
     
-    IfStmt(Span span, std::shared_ptr<Scope> scope, std::unique_ptr<Expr> condition,
-           std::unique_ptr<Stmt> then_branch, std::unique_ptr<Stmt> else_branch)
-        : Stmt(span, scope), condition(std::move(condition)),
-          then_branch(std::move(then_branch)), else_branch(std::move(else_branch)) {}
+    IfStmt(Span span, Expr* condition, Stmt* then_branch, Stmt* else_branch)
+        : Stmt(node_kind, span), condition(condition),
+          then_branch(then_branch), else_branch(else_branch) {}
 };
 
 class WhileStmt : public Stmt {
 public:
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Stmt> body;
+    static constexpr NodeKind node_kind = NodeKind::WhileStmt;
+    Expr* condition;
+    Stmt* body;
     
-    WhileStmt(Span span, std::shared_ptr<Scope> scope, std::unique_ptr<Expr> condition,
-              std::unique_ptr<Stmt> body)
-        : Stmt(span, scope), condition(std::move(condition)), body(std::move(body)) {}
+    WhileStmt(Span span, Expr* condition, Stmt* body)
+        : Stmt(node_kind, span), condition(condition), body(body) {}
 };
 
 class BlockStmt : public Stmt {
 public:
-    std::vector<std::unique_ptr<Stmt>> statements;
-    BlockStmt(Span span, std::shared_ptr<Scope> scope, std::vector<std::unique_ptr<Stmt>> statements)
-        : Stmt(span, scope), statements(std::move(statements)) {}
+    static constexpr NodeKind node_kind = NodeKind::BlockStmt;
+    ArenaArray<Stmt*> statements;
+    BlockStmt(Span span, ArenaArray<Stmt*> statements)
+        : Stmt(node_kind, span), statements(statements) {}
 };
 
 class ReturnStmt : public Stmt {
 public:
-    std::unique_ptr<Expr> value;  // Optional return value
+    static constexpr NodeKind node_kind = NodeKind::ReturnStmt;
+    Expr* value;  // Optional return value
     
-    ReturnStmt(Span span, std::shared_ptr<Scope> scope, std::unique_ptr<Expr> value = nullptr)
-        : Stmt(span, scope), value(std::move(value)) {}
+    ReturnStmt(Span span, Expr* value = nullptr)
+        : Stmt(node_kind, span), value(value) {}
 };
 
 class Expr : public ASTNode {
 public:
-    mutable std::unique_ptr<Type> type;  // Type of the expression, filled in by type checker
-    virtual ~Expr() = default;
+    mutable const Type* type = nullptr;  // Type of the expression, filled in by type checker
 protected:
-    Expr(Span span) : ASTNode(span) {}
+    Expr(NodeKind kind, Span span) : ASTNode(kind, span) {}
 };
 
 class IntLiteral : public Expr {
 public:
+    static constexpr NodeKind node_kind = NodeKind::IntLiteral;
     int value;
-    IntLiteral(Span span, int value) : Expr(span), value(value) {}
+    IntLiteral(Span span, int value) : Expr(node_kind, span), value(value) {}
 };
 
 class BoolLiteral : public Expr {
 public:
+    static constexpr NodeKind node_kind = NodeKind::BoolLiteral;
     bool value;
-    BoolLiteral(Span span, bool value) : Expr(span), value(value) {}
+    BoolLiteral(Span span, bool value) : Expr(node_kind, span), value(value) {}
 };
 
 class StringLiteral : public Expr {
 public:
+    static constexpr NodeKind node_kind = NodeKind::StringLiteral;
     std::string value;
-    StringLiteral(Span span, std::string value) : Expr(span), value(std::move(value)) {}
+    StringLiteral(Span span, std::string value) : Expr(node_kind, span), value(std::move(value)) {}
+};
+
+// What an Identifier names, as decided by the Resolver
+enum class Resolution : uint8_t {
+    Unresolved,  // Not declared where it is used
+    Local,       // A parameter or let binding
+    Function     // A top-level function
 };
 
 class Identifier : public Expr {
 public:
-    std::string name;
-    mutable bool is_mut_binding;  // Whether this identifier refers to a mutable binding
-    Identifier(Span span, std::string name)
-        : Expr(span), name(std::move(name)), is_mut_binding(false) {}
+    static constexpr NodeKind node_kind = NodeKind::Identifier;
+    Symbol name;
+    
+    // Filled in by the Resolver
+    mutable Resolution resolution = Resolution::Unresolved;
+    mutable uint32_t binding = 0;  // For locals: the declaration's number within the function
+    mutable uint32_t slot = 0;     // For locals: its frame slot
+    mutable bool is_mut_binding;   // Whether this identifier refers to a mutable binding
+    
+    Identifier(Span span, Symbol name)
+        : Expr(node_kind, span), name(name), is_mut_binding(false) {}
 };
 
 class BinaryExpr : public Expr {
 public:
+    static constexpr NodeKind node_kind = NodeKind::BinaryExpr;
     enum class Op {
         Add, Sub, Mul, Div,
         Eq, Ne, Lt, Gt, Le, Ge,
@@ -195,119 +257,104 @@ public:
         Assignment  // =
     };
     Op op;
-    std::unique_ptr<Expr> left;
-    std::unique_ptr<Expr> right;
+    Expr* left;
+    Expr* right;
     
-    BinaryExpr(Span span, Op op, std::unique_ptr<Expr> left, std::unique_ptr<Expr> right)
-        : Expr(span), op(op), left(std::move(left)), right(std::move(right)) {}
+    BinaryExpr(Span span, Op op, Expr* left, Expr* right)
+        : Expr(node_kind, span), op(op), left(left), right(right) {}
 };
 
 class UnaryExpr : public Expr {
 public:
+    static constexpr NodeKind node_kind = NodeKind::UnaryExpr;
     enum class Op { Neg, Not };
     Op op;
-    std::unique_ptr<Expr> expr;
+    Expr* expr;
     
-    UnaryExpr(Span span, Op op, std::unique_ptr<Expr> expr)
-        : Expr(span), op(op), expr(std::move(expr)) {}
+    UnaryExpr(Span span, Op op, Expr* expr)
+        : Expr(node_kind, span), op(op), expr(expr) {}
 };
 
 class BorrowExpr : public Expr {
 public:
+    static constexpr NodeKind node_kind = NodeKind::BorrowExpr;
     bool is_mut;
-    std::unique_ptr<Expr> expr;
+    Expr* expr;
     
-    BorrowExpr(Span span, bool is_mut, std::unique_ptr<Expr> expr)
-        : Expr(span), is_mut(is_mut), expr(std::move(expr)) {}
+    BorrowExpr(Span span, bool is_mut, Expr* expr)
+        : Expr(node_kind, span), is_mut(is_mut), expr(expr) {}
 };
 
 class CallExpr : public Expr {
 public:
-    std::unique_ptr<Expr> callee;
-    std::vector<std::unique_ptr<Expr>> args;
+    static constexpr NodeKind node_kind = NodeKind::CallExpr;
+    Expr* callee;
+    ArenaArray<Expr*> args;
     
-    CallExpr(Span span, std::unique_ptr<Expr> callee, std::vector<std::unique_ptr<Expr>> args)
-        : Expr(span), callee(std::move(callee)), args(std::move(args)) {}
+    CallExpr(Span span, Expr* callee, ArenaArray<Expr*> args)
+        : Expr(node_kind, span), callee(callee), args(args) {}
 };
 
-class Type {
-public:
-    enum class Kind {
-        I32, Bool, Str,
-        Ref, MutRef
-    };
-    Kind kind;
-    std::unique_ptr<Type> base_type; // For Ref and MutRef
-    Span span;
-    
-    Type(Kind kind, Span span) : kind(kind), span(span) {}
-    Type(Kind kind, std::unique_ptr<Type> base_type, Span span)
-        : kind(kind), base_type(std::move(base_type)), span(span) {}
-    
-    // Check if this type is a reference type
-    bool is_reference() const {
-        return kind == Kind::Ref || kind == Kind::MutRef;
-    }
-    
-    // Clone method for deep copying
-    std::unique_ptr<Type> clone() const {
-        if (base_type) {
-            return std::make_unique<Type>(kind, base_type->clone(), span);
-        } else {
-            return std::make_unique<Type>(kind, span);
-        }
-    }
-};
+// Whether `expr` assigns to a variable anywhere inside it. Calls don't
+// count: a callee can't reach its caller's variables.
+bool contains_assignment(const Expr* expr);
+
+// Whether evaluating `expr` does more than compute a value: it assigns to a
+// variable or calls a function, which may fail
+bool has_side_effects(const Expr* expr);
 
 class Parser {
 public:
     Parser(std::string source);
+    // Parse the whole source; the returned program's names are already
+    // resolved (see Resolver)
     std::unique_ptr<Program> parse();
 
 private:
-    // Helper functions
-    bool match(const std::string& expected);
-    bool peek(const std::string& expected);
-    void expect(const std::string& expected);
-    void advance(size_t count = 1);
-    std::string consume_identifier();
-    int consume_integer();
-    std::string consume_string();
-    void skip_whitespace();
-    bool at_end();
-    void error(const std::string& message);
-    Span make_span(size_t start) const { return Span(start, pos); }
+    // Token helpers
+    const Token& current() const { return tokens.tokens[pos]; }
+    bool check(TokenKind kind) const { return current().kind == kind; }
+    bool match(TokenKind kind);
+    const Token& expect(TokenKind kind);
+    Symbol consume_identifier();
+    bool at_end() const { return check(TokenKind::End); }
+    [[noreturn]] void error(const std::string& message);
+    size_t start_offset() const { return current().start; }
+    Span make_span(size_t start) const { return Span(start, pos > 0 ? tokens.tokens[pos - 1].end : start); }
     
-    // Scope management
-    std::shared_ptr<Scope> current_scope;
-    std::shared_ptr<Scope> enter_scope();
-    void exit_scope();
+    // Node allocation
+    template <typename T, typename... Args>
+    T* make(Args&&... args) { return arena->make<T>(std::forward<Args>(args)...); }
     
     // Parsing functions
-    std::unique_ptr<FunctionDecl> parse_function();
+    FunctionDecl* parse_function();
     std::vector<FunctionDecl::Param> parse_params();
-    std::unique_ptr<Type> parse_type();
-    std::unique_ptr<Stmt> parse_statement();
-    std::unique_ptr<LetStmt> parse_let();
-    std::unique_ptr<IfStmt> parse_if();
-    std::unique_ptr<WhileStmt> parse_while();
-    std::unique_ptr<BlockStmt> parse_block();
-    std::unique_ptr<Expr> parse_expr();
-    std::unique_ptr<Expr> parse_equality();
-    std::unique_ptr<Expr> parse_comparison();
-    std::unique_ptr<Expr> parse_term();
-    std::unique_ptr<Expr> parse_factor();
-    std::unique_ptr<Expr> parse_unary();
-    std::unique_ptr<Expr> parse_call();
-    std::unique_ptr<Expr> parse_primary();
-    std::unique_ptr<Expr> parse_or();
-    std::unique_ptr<Expr> parse_and();
-    std::unique_ptr<Expr> parse_assignment();
+    const Type* parse_type();
+    Stmt* parse_statement();
+    LetStmt* parse_let();
+    IfStmt* parse_if();
+    WhileStmt* parse_while();
+    BlockStmt* parse_block();
+    Expr* parse_expr();
+    Expr* parse_equality();
+    Expr* parse_comparison();
+    Expr* parse_term();
+    Expr* parse_factor();
+    Expr* parse_unary();
+    Expr* parse_call();
+    Expr* parse_primary();
+    Expr* parse_or();
+    Expr* parse_and();
+    Expr* parse_assignment();
     
+    std::unique_ptr<Arena> arena;   // Handed to the Program at the end
+    // Statements and call arguments of the lists being parsed, innermost
+    // last; each list is copied into the arena when it closes
+    std::vector<Stmt*> pending_statements;
+    std::vector<Expr*> pending_args;
     std::string source;
-    size_t pos = 0;
-    size_t line = 1;      // Current line number (1-based)
-    size_t column = 1;    // Current column number (1-based)
+    TokenBuffer tokens;
+    size_t pos = 0;       // Index of the current token
 };
 
 } // namespace nust 
\ No newline at end of file
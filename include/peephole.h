@@ -0,0 +1,56 @@
+#pragma once
+
+#include "bytecode_pass.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace nust {
+
+// Rewrites short instruction sequences into cheaper equivalents, threads
+// jumps and removes unreachable code, then re-patches jump operands and
+// function entry points. Rules are pluggable; the default set is installed
+// by the constructor.
+class PeepholeOptimizer : public BytecodePass {
+public:
+    // A rule looks at `window`, the `size` instructions starting at the
+    // current position up to (not including) the next jump target. On a
+    // match it sets `consumed` to the number of instructions to replace and
+    // fills `replacement` (possibly empty).
+    struct Rule {
+        std::string name;
+        std::function<bool(const Instruction* window, size_t size,
+                           size_t& consumed, std::vector<Instruction>& replacement)> apply;
+    };
+
+    // Instruction counts and rule hits from the last run
+    struct Stats {
+        size_t before = 0;
+        size_t after = 0;
+        std::vector<std::pair<std::string, size_t>> rule_hits;
+    };
+
+    PeepholeOptimizer();
+
+    // Add a rule; rules are tried in the order they were added
+    void add_rule(Rule rule);
+
+    // Remove all rules, including the defaults
+    void clear_rules() { rules_.clear(); }
+
+    const char* name() const override { return "peephole"; }
+    void run(std::vector<Instruction>& instructions, FunctionTable& function_table) override;
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    bool apply_rules(std::vector<Instruction>& instructions, FunctionTable& function_table);
+    bool thread_jumps(std::vector<Instruction>& instructions);
+    bool remove_dead_code(std::vector<Instruction>& instructions, FunctionTable& function_table);
+    void record_hit(const std::string& rule);
+
+    std::vector<Rule> rules_;
+    Stats stats_;
+};
+
+} // namespace nust
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "parser.h"
+#include "register_instruction.h"
+#include "function_table.h"
+#include "signature_index.h"
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <string>
+
+namespace nust {
+
+// Alternative backend that compiles a program AST to three-address register
+// bytecode for RegisterVM. Function table layout matches Compiler (main
+// first); num_locals holds the full frame size, locals plus temporaries.
+class RegisterCompiler {
+public:
+    RegisterCompiler();
+
+    // Compile a program AST to register bytecode
+    std::vector<RegInstruction> compile(const Program& program);
+
+    // Same, reusing signatures already built for the program
+    std::vector<RegInstruction> compile(const Program& program, const SignatureIndex& signatures);
+
+    // Get the function table after compilation
+    const FunctionTable& get_function_table() const { return function_table; }
+
+    // State
+    std::vector<std::string> string_constants;
+
+private:
+    // Function compilation
+    void compile_function(const FunctionDecl* func, size_t func_index);
+    void collect_registers(const Stmt* stmt);
+    void collect_registers(const Expr* expr);
+    void compile_statement(const Stmt* stmt);
+
+    // Control flow
+    void compile_if(const IfStmt* stmt);
+    void compile_while(const WhileStmt* stmt);
+
+    // Expression compilation. Each returns the register holding the result;
+    // when `target` is given the result is computed directly into it where
+    // possible. compile_into guarantees the result ends up in `dst`.
+    uint32_t compile_expression(const Expr* expr, const uint32_t* target = nullptr);
+    uint32_t compile_binary(const BinaryExpr* expr, const uint32_t* target);
+    uint32_t compile_unary(const UnaryExpr* expr, const uint32_t* target);
+    uint32_t compile_call(const CallExpr* expr, const uint32_t* target);
+    void compile_into(const Expr* expr, uint32_t dst);
+
+    // Helper functions
+    size_t emit(RegOpcode opcode, uint32_t dst = 0, uint32_t a = 0, uint32_t b = 0);
+    uint32_t alloc_temp();
+    uint32_t result_register(const uint32_t* target);
+    uint32_t get_local_index(const Identifier* ident);
+
+    // State
+    std::vector<RegInstruction> instructions;
+    std::vector<uint32_t> slot_registers;  // Register of each Resolver slot
+    static constexpr uint32_t unassigned = UINT32_MAX;
+    std::map<int, uint32_t> constant_registers;
+    uint32_t num_locals;
+    uint32_t next_temp;
+    uint32_t max_registers;
+    FunctionTable function_table;
+};
+
+} // namespace nust
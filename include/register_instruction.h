@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace nust {
+
+// Opcodes for the register virtual machine. Operands name frame slots
+// ("registers") directly: locals occupy the low slots of a frame and
+// expression temporaries are allocated above them.
+enum class RegOpcode : uint8_t {
+    // Constants and moves
+    LOADK_I32,  // dst = a (a holds the i32 bits)
+    LOADK_BOOL, // dst = a != 0
+    LOADK_STR,  // dst = constants[a]
+    MOVE,       // dst = a
+
+    // Arithmetic operations
+    ADD_I32,    // dst = a + b
+    SUB_I32,    // dst = a - b
+    MUL_I32,    // dst = a * b
+    DIV_I32,    // dst = a / b
+    NEG_I32,    // dst = -a
+
+    // Comparison operations
+    EQ_I32,     // dst = a == b
+    NE_I32,     // dst = a != b
+    LT_I32,     // dst = a < b
+    GT_I32,     // dst = a > b
+    LE_I32,     // dst = a <= b
+    GE_I32,     // dst = a >= b
+
+    // Logical operations
+    AND,        // dst = a && b
+    OR,         // dst = a || b
+    NOT,        // dst = !a
+
+    // Control flow
+    JMP,        // pc = a
+    JMP_IF,     // if a: pc = b
+    JMP_IF_NOT, // if !a: pc = b
+    CALL,       // dst = function a, arguments in registers b, b+1, ...
+    RET,        // Return from function (no value)
+    RET_VAL,    // Return register a
+
+    // Reference operations
+    BORROW,     // dst = &a
+    BORROW_MUT, // dst = &mut a
+    DEREF       // dst = *a
+};
+
+// Convert register opcode to string representation
+inline std::string reg_opcode_to_string(RegOpcode opcode) {
+    switch (opcode) {
+        case RegOpcode::LOADK_I32:  return "LOADK_I32";
+        case RegOpcode::LOADK_BOOL: return "LOADK_BOOL";
+        case RegOpcode::LOADK_STR:  return "LOADK_STR";
+        case RegOpcode::MOVE:       return "MOVE";
+        case RegOpcode::ADD_I32:    return "ADD_I32";
+        case RegOpcode::SUB_I32:    return "SUB_I32";
+        case RegOpcode::MUL_I32:    return "MUL_I32";
+        case RegOpcode::DIV_I32:    return "DIV_I32";
+        case RegOpcode::NEG_I32:    return "NEG_I32";
+        case RegOpcode::EQ_I32:     return "EQ_I32";
+        case RegOpcode::NE_I32:     return "NE_I32";
+        case RegOpcode::LT_I32:     return "LT_I32";
+        case RegOpcode::GT_I32:     return "GT_I32";
+        case RegOpcode::LE_I32:     return "LE_I32";
+        case RegOpcode::GE_I32:     return "GE_I32";
+        case RegOpcode::AND:        return "AND";
+        case RegOpcode::OR:         return "OR";
+        case RegOpcode::NOT:        return "NOT";
+        case RegOpcode::JMP:        return "JMP";
+        case RegOpcode::JMP_IF:     return "JMP_IF";
+        case RegOpcode::JMP_IF_NOT: return "JMP_IF_NOT";
+        case RegOpcode::CALL:       return "CALL";
+        case RegOpcode::RET:        return "RET";
+        case RegOpcode::RET_VAL:    return "RET_VAL";
+        case RegOpcode::BORROW:     return "BORROW";
+        case RegOpcode::BORROW_MUT: return "BORROW_MUT";
+        case RegOpcode::DEREF:      return "DEREF";
+        default:
+            return "UNKNOWN_OPCODE";
+    }
+}
+
+// Three-address instruction. Unused operands are zero.
+struct RegInstruction {
+    RegOpcode opcode;
+    uint32_t dst;
+    uint32_t a;
+    uint32_t b;
+
+    RegInstruction(RegOpcode opcode, uint32_t dst = 0, uint32_t a = 0, uint32_t b = 0)
+        : opcode(opcode), dst(dst), a(a), b(b) {}
+};
+
+} // namespace nust
@@ -0,0 +1,68 @@
+#ifndef NUST_REGISTER_VM_H
+#define NUST_REGISTER_VM_H
+
+#include "value.h"
+#include "register_instruction.h"
+#include "function_table.h"
+#include "call_stack.h"
+#include <vector>
+#include <deque>
+#include <stdexcept>
+
+namespace nust {
+
+// Interpreter for RegisterCompiler output. Registers are slots in a single
+// contiguous register file; a CALL's argument registers become the callee's
+// first locals, so frames slide over the caller's temporaries.
+//
+// Handlers check their operands' tags like the stack VM's checked mode and
+// report mismatches with the same messages. Calls are bounded by the same
+// CallStackConfig limits: nesting deeper than max_depth, or a register
+// file needing more than max_slots, throws StackOverflowError.
+class RegisterVM {
+public:
+    RegisterVM(const FunctionTable& function_table,
+               const std::vector<Value>& constants,
+               const std::vector<RegInstruction>& instructions,
+               CallStackConfig stack_config = CallStackConfig());
+
+    // Run the VM
+    void run();
+
+    // Get the result of execution
+    Value get_result() const;
+
+    // Number of instructions dispatched so far
+    uint64_t instructions_executed() const;
+
+private:
+    struct Frame {
+        size_t function;    // Caller's function index
+        size_t return_pc;   // Instruction to resume at in the caller
+        size_t base;        // Caller's frame base
+        uint32_t dst;       // Caller register receiving the return value
+        size_t boxes;       // ref_heap_ size at the call
+    };
+
+    const FunctionTable& function_table_;
+    const std::vector<Value>& constants_;
+    const std::vector<RegInstruction>& instructions_;
+    CallStackConfig config_;
+
+    std::vector<Value> registers_;   // Register file shared by all frames
+    std::vector<Frame> frames_;      // Saved caller state
+    std::deque<Value> ref_heap_;     // Boxes created by borrows, freed when their frame returns
+    size_t function_;                // Current function index
+    size_t base_;                    // Current frame base
+    size_t pc_;                      // Program counter
+    Value result_;                   // Result of execution
+    uint64_t executed_;              // Instructions dispatched
+
+    void ensure_registers(size_t count);
+    [[noreturn]] void overflow(size_t function_index, const std::string& reason) const;
+    Value::RefType box(const Value& value);
+};
+
+} // namespace nust
+
+#endif // NUST_REGISTER_VM_H
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "parser.h"
+#include <cstdint>
+#include <vector>
+
+namespace nust {
+
+// Name resolution. Binds every Identifier in a program to the function or
+// local declaration it refers to, once, so the type checker, constant folder
+// and compilers work with numbers instead of looking names up. Parser::parse
+// runs it on every program it returns.
+//
+// Scoping follows the type checker's rules: parameters live in the
+// function's scope, every block (and every if/while body) opens a new one,
+// a let is visible from the statement after it, and function names win over
+// variables except as assignment targets.
+//
+// Each declaration gets a binding number, unique within its function
+// (parameters first), and a frame slot of its own, so a shadowing let never
+// overwrites the variable it hides. Parameter i is slot i. A scope's slots
+// are handed out again once it closes: every let stores its initializer,
+// so nothing reads what an earlier block left in a slot.
+//
+// Nothing is reported here. Undeclared names are left Unresolved and
+// repeated declarations are flagged, for the type checker to report when it
+// reaches them.
+class Resolver {
+public:
+    // Annotate the whole program
+    void resolve(const Program& program);
+
+private:
+    void resolve_function(const FunctionDecl& func);
+    void resolve_statement(const Stmt* stmt);
+    void resolve_expression(const Expr* expr);
+    void resolve_local(const Identifier* ident);
+
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct Binding {
+        uint32_t slot;
+        bool is_mut;
+        uint32_t depth;  // Scope it was declared in
+    };
+
+    // Declare `name` in the innermost scope, in the next free slot, and
+    // return its binding number; sets `redeclares` if that scope already
+    // has the name
+    uint32_t declare(Symbol name, bool is_mut, bool& redeclares);
+    void enter_scope();
+    void exit_scope();
+
+    // Per-name tables are indexed by symbol id, which is dense, so lookups
+    // are array reads. Each grows to the largest id seen.
+    static uint32_t& entry(std::vector<uint32_t>& table, Symbol name);
+
+    // Where an open scope started: its first entry in hidden_ and the first
+    // slot it could use
+    struct Scope {
+        size_t hidden_start;
+        uint32_t slot_start;
+    };
+
+    // A declaration that hid `name`'s previous binding, restored when its
+    // scope closes
+    struct Hidden {
+        Symbol name;
+        uint32_t previous;
+    };
+
+    std::vector<uint8_t> is_function_;   // By symbol id
+    std::vector<uint32_t> visible_;      // By symbol id: binding number, or none
+    std::vector<Binding> bindings_;      // By binding number, for the function
+    std::vector<Hidden> hidden_;
+    std::vector<Scope> scopes_;          // Open scopes, innermost last
+    uint32_t next_slot_ = 0;             // First slot no open scope uses
+    uint32_t num_slots_ = 0;             // Slots the function needs so far
+    const FunctionDecl* function_ = nullptr;  // Being resolved
+};
+
+} // namespace nust
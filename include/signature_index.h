@@ -0,0 +1,52 @@
+#pragma once
+
+#include "parser.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace nust {
+
+// What a caller needs to know about a function: where it is declared and the
+// types it takes and returns.
+struct FunctionSignature {
+    Symbol name;
+    const FunctionDecl* decl;
+    std::vector<const Type*> param_types;
+    const Type* return_type;
+};
+
+// Every function of a program, built in one pass over its items so looking a
+// callee up by name doesn't scan the program. Entries are in compilation
+// order: main, if there is one, then the other functions in source order.
+// That is also the order of the compilers' FunctionTable, so an entry's
+// position is the function index its calls use.
+//
+// If a name is declared twice, find() returns its first declaration.
+class SignatureIndex {
+public:
+    SignatureIndex() = default;
+    explicit SignatureIndex(const Program& program);
+
+    // Signature of the function called `name`, or nullptr if there is none
+    const FunctionSignature* find(Symbol name) const;
+
+    // Position of an entry returned by find()
+    size_t index_of(const FunctionSignature& signature) const {
+        return static_cast<size_t>(&signature - signatures_.data());
+    }
+
+    const FunctionSignature& operator[](size_t index) const { return signatures_[index]; }
+    size_t size() const { return signatures_.size(); }
+    bool has_main() const { return has_main_; }
+
+    std::vector<FunctionSignature>::const_iterator begin() const { return signatures_.begin(); }
+    std::vector<FunctionSignature>::const_iterator end() const { return signatures_.end(); }
+
+private:
+    std::vector<FunctionSignature> signatures_;
+    std::unordered_map<Symbol, uint32_t> by_name_;
+    bool has_main_ = false;
+};
+
+} // namespace nust
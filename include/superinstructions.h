@@ -0,0 +1,33 @@
+#pragma once
+
+#include "peephole.h"
+
+namespace nust {
+
+// Fuses common instruction sequences into single superinstructions so the
+// VM dispatches fewer instructions:
+//
+//   LOAD n; PUSH_I32 k; ADD_I32; STORE n   =>  INC_LOCAL n|k
+//   LOAD a; LOAD b; ADD_I32                =>  LOAD_LOAD_ADD a|b
+//   LOAD a; LOAD b                         =>  LOAD_LOAD a|b
+//   LOAD n; PUSH_I32 k                     =>  LOAD_PUSH_I32 n|k
+//   <cmp>_I32; JMP_IF_NOT t                =>  CMP_<cmp>_JMP_IF_NOT t
+//
+// Uses the peephole engine, so fusions never span a jump target. Runs best
+// after PeepholeOptimizer, which removes the STORE/LOAD/POP noise that
+// would otherwise split these sequences.
+class SuperinstructionPass : public BytecodePass {
+public:
+    SuperinstructionPass();
+
+    const char* name() const override { return "superinstructions"; }
+    void run(std::vector<Instruction>& instructions, FunctionTable& function_table) override;
+
+    // Instruction counts and how often each fusion fired in the last run
+    const PeepholeOptimizer::Stats& stats() const { return engine_.stats(); }
+
+private:
+    PeepholeOptimizer engine_;
+};
+
+} // namespace nust
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace nust {
+
+// An interned identifier. Every distinct spelling gets one small integer id
+// from a process-wide table, so symbols compare and hash as integers and the
+// same name maps to the same id in every program, pass and thread. The
+// lexer interns each distinct name once; the parser, type checker and
+// compilers only ever see ids. The empty string is id 0, which is also what
+// a default-constructed Symbol holds.
+class Symbol {
+public:
+    Symbol() = default;
+
+    // Intern `name`. Implicit so that literal names ("main") can be passed
+    // where a Symbol is expected; this takes the table lock, so hot paths
+    // should intern once and keep the Symbol.
+    Symbol(std::string_view name);
+    Symbol(const char* name) : Symbol(std::string_view(name)) {}
+    Symbol(const std::string& name) : Symbol(std::string_view(name)) {}
+
+    // The interned spelling; the reference stays valid for the whole process
+    const std::string& str() const;
+
+    uint32_t id() const { return id_; }
+
+    bool operator==(Symbol other) const { return id_ == other.id_; }
+    bool operator!=(Symbol other) const { return id_ != other.id_; }
+
+    // Compare spellings, mostly for tests
+    bool operator==(std::string_view name) const { return str() == name; }
+    bool operator!=(std::string_view name) const { return str() != name; }
+    bool operator==(const char* name) const { return str() == name; }
+    bool operator!=(const char* name) const { return str() != name; }
+    bool operator==(const std::string& name) const { return str() == name; }
+    bool operator!=(const std::string& name) const { return str() != name; }
+
+private:
+    uint32_t id_ = 0;
+};
+
+inline std::ostream& operator<<(std::ostream& out, Symbol symbol) {
+    return out << symbol.str();
+}
+
+} // namespace nust
+
+template <>
+struct std::hash<nust::Symbol> {
+    size_t operator()(nust::Symbol symbol) const noexcept { return symbol.id(); }
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nust {
+
+// A fixed set of worker threads for fanning independent work out across
+// cores, such as checking or compiling each function of a program. The
+// calling thread works too, so a pool of size 1 runs everything inline.
+class ThreadPool {
+public:
+    // `threads` counts the caller; 0 means one per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads that run work, including the caller
+    size_t size() const { return workers_.size() + 1; }
+
+    // Split [0, count) into contiguous chunks and call body(begin, end) for
+    // each, in no particular order, returning once all of them are done.
+    // Callers that need deterministic results write them by index. If a
+    // chunk throws, the first exception caught is rethrown here after the
+    // rest have finished. Jobs run one at a time; a body must not start
+    // another job on the same pool.
+    void parallel_for(size_t count, const std::function<void(size_t begin, size_t end)>& body);
+
+private:
+    void worker_loop();
+    void run_chunks();
+
+    std::vector<std::thread> workers_;
+    std::mutex job_mutex_;  // Held by the caller for a whole parallel_for
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    bool stopping_ = false;
+    size_t generation_ = 0;  // Bumped for every job
+    size_t active_ = 0;      // Workers that haven't finished the current job
+
+    // The current job
+    const std::function<void(size_t, size_t)>* body_ = nullptr;
+    size_t count_ = 0;
+    size_t chunk_size_ = 0;
+    size_t num_chunks_ = 0;
+    std::atomic<size_t> next_chunk_{0};
+    std::exception_ptr error_;
+};
+
+} // namespace nust
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace nust {
+
+// A nust type. Types are hash-consed: every distinct type has exactly one
+// immutable Type object, owned by a process-wide table and never freed, so a
+// `const Type*` is a handle that can be copied freely and compared by
+// pointer. Types are built from the three base types by adding reference
+// levels; each Type keeps its own reference types, so interning one is a
+// pointer read once it exists.
+class Type {
+public:
+    enum class Kind {
+        I32, Bool, Str,
+        Ref, MutRef
+    };
+    const Kind kind;
+    const Type* const base_type; // For Ref and MutRef
+
+    // The canonical type of `kind`; references need their base type
+    static const Type* get(Kind kind, const Type* base_type = nullptr);
+    static const Type* reference(const Type* base_type, bool is_mut) {
+        return get(is_mut ? Kind::MutRef : Kind::Ref, base_type);
+    }
+
+    // Check if this type is a reference type
+    bool is_reference() const {
+        return kind == Kind::Ref || kind == Kind::MutRef;
+    }
+
+    // The same type with every `&mut` replaced by `&`. Two types are
+    // comparable exactly when their shared types are the same.
+    const Type* shared() const { return shared_; }
+
+    // Whether a value of `source` can be stored where this type is
+    // expected: the same shape, where a `&mut` may stand in for a `&` at any
+    // level but not the other way round
+    bool is_assignable_from(const Type* source) const;
+
+    Type(const Type&) = delete;
+    Type& operator=(const Type&) = delete;
+
+private:
+    Type(Kind kind, const Type* base_type, const Type* shared);
+
+    const Type* shared_;
+    uint32_t depth_ = 0;          // Reference levels above the base type
+    uint64_t mut_levels_ = 0;     // Bit i set if level i (outermost is 0) is &mut
+
+    // Interned `&this` and `&mut this`, created on first use
+    mutable std::atomic<const Type*> references_[2] = {};
+};
+
+} // namespace nust
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "parser.h"
+#include "signature_index.h"
+#include "thread_pool.h"
+#include "code_cache.h"
 #include <unordered_map>
 #include <string>
 #include <memory>
@@ -17,10 +20,22 @@ public:
     // Main entry point for type checking
     bool check_program(const Program& program);
     
+    // Check functions in parallel on `pool` (nullptr to check serially).
+    // Errors and the result are the same either way: functions are reported
+    // in order, stopping at the first that fails.
+    void set_thread_pool(ThreadPool* pool) { pool_ = pool; }
+    
+    // Skip functions whose code `cache` already has: they checked before,
+    // against the same signatures
+    void set_code_cache(const CodeCache* cache) { cache_ = cache; }
+    
     // Error reporting
     void error(const std::string& message, const Span& span);
     bool has_errors() const { return !errors_.empty(); }
     const std::vector<std::string>& errors() const { return errors_; }
+    
+    // Signatures of the last program checked, for the compilers to reuse
+    const SignatureIndex& signatures() const { return signatures_; }
 
 private:
     // Type checking methods for different AST nodes
@@ -28,28 +43,48 @@ private:
     bool check_statement(const Stmt& stmt);
     bool check_expression(const Expr& expr);
     bool check_type(const Type& type);
+
+    // Statements and expressions, dispatched on NodeKind
+    bool check_let(const LetStmt& let);
+    bool check_if(const IfStmt& if_stmt);
+    bool check_while(const WhileStmt& while_stmt);
+    bool check_block(const BlockStmt& block);
+    bool check_identifier(const Identifier& ident);
+    bool check_binary(const BinaryExpr& binary);
+    bool check_unary(const UnaryExpr& unary);
+    bool check_borrow(const BorrowExpr& borrow);
+    bool check_call(const CallExpr& call);
     
     // Helper methods for type checking
-    bool is_assignable(const Type& target, const Type& source);
-    bool is_compatible(const Type& lhs, const Type& rhs);
+    // Types are interned, so both of these are a few pointer and bit
+    // comparisons
+    bool is_assignable(const Type* target, const Type* source);
+    bool is_compatible(const Type* lhs, const Type* rhs);
     bool is_mutable_reference(const Type& type) const;
     bool is_reference(const Type& type) const;
     
-    // Scope management
+    // Variables of the function being checked, by the binding number the
+    // Resolver gave their declaration
     struct VariableInfo {
-        std::unique_ptr<Type> type;
+        const Type* type;
         bool is_mut;
     };
     
-    std::vector<std::unordered_map<std::string, VariableInfo>> scopes_;
-    void enter_scope();
-    void exit_scope();
-    bool declare_variable(const std::string& name, std::unique_ptr<Type> type, bool is_mut);
-    std::optional<VariableInfo> lookup_variable(const std::string& name);
+    std::vector<VariableInfo> variables_;
+    VariableInfo* lookup_variable(const Identifier& ident);
     
     // Error tracking
     std::vector<std::string> errors_;
-    const Program* program_ = nullptr;
+    
+    // Callee lookup, built once per program. Workers checking functions in
+    // parallel share the checker's index through callees_.
+    SignatureIndex signatures_;
+    const SignatureIndex* callees_ = &signatures_;
+    ThreadPool* pool_ = nullptr;
+    const CodeCache* cache_ = nullptr;
+    bool echo_errors_ = true;  // Workers leave printing to the merge, in order
+    
+    bool check_functions_in_parallel(const std::vector<const FunctionDecl*>& functions);
 };
 
 } // namespace nust 
\ No newline at end of file
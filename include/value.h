@@ -1,44 +1,98 @@
 #ifndef NUST_VALUE_H
 #define NUST_VALUE_H
 
-#include <variant>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <memory>
-#include <sstream>
+#include <vector>
 
 namespace nust {
 
+// Header of a length-prefixed string record. String values point at one of
+// these; the characters follow the header directly and are NUL-terminated.
+struct StringObject {
+    uint32_t length;
+    uint32_t reserved;
+
+    const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+    std::string_view view() const { return std::string_view(data(), length); }
+};
+
+// Owns string records. Records are never moved, so values pointing at them
+// stay valid for the lifetime of the heap.
+class StringHeap {
+public:
+    const StringObject* allocate(std::string_view str) {
+        // Header + characters + NUL, rounded up to whole 8-byte words
+        size_t words = (sizeof(StringObject) + str.size() + 1 + 7) / 8;
+        auto block = std::make_unique<uint64_t[]>(words);
+        auto* object = reinterpret_cast<StringObject*>(block.get());
+        object->length = static_cast<uint32_t>(str.size());
+        object->reserved = 0;
+        std::memcpy(object + 1, str.data(), str.size());
+        blocks_.push_back(std::move(block));
+        return object;
+    }
+
+    // Free every record; values pointing at them dangle afterwards
+    void clear() { blocks_.clear(); }
+
+private:
+    std::vector<std::unique_ptr<uint64_t[]>> blocks_;
+};
+
+// An 8-byte tagged value. The low three bits hold the tag; integers and
+// booleans keep their payload in the high 32 bits, strings and references
+// are 8-byte aligned pointers into heaps owned by the VM (or whoever built
+// the constant pool). Values are trivially copyable and never own memory.
 class Value {
 public:
     // Supported value types
     using IntType = int32_t;
     using BoolType = bool;
-    using StringType = std::string;
-    using RefType = std::shared_ptr<Value>;
+    using StringType = const StringObject*;
+    using RefType = Value*;
 
-    // Variant to hold any of our supported types
-    using ValueType = std::variant<IntType, BoolType, StringType, RefType>;
+    enum Tag : uint64_t {
+        IntTag = 0,
+        BoolTag = 1,
+        StringTag = 2,
+        RefTag = 3
+    };
 
     // Default constructor - initializes to integer 0
-    Value() : data_(IntType(0)) {}
+    Value() : bits_(IntTag) {}
 
     // Constructors for each type
-    Value(IntType value) : data_(value) {}
-    Value(BoolType value) : data_(value) {}
-    Value(StringType value) : data_(value) {}
-    Value(RefType value) : data_(value) {}
+    Value(IntType value) : bits_(encode_payload(static_cast<uint32_t>(value), IntTag)) {}
+    Value(BoolType value) : bits_(encode_payload(value ? 1 : 0, BoolTag)) {}
+    Value(StringType value) : bits_(reinterpret_cast<uintptr_t>(value) | StringTag) {}
+    Value(RefType value) : bits_(reinterpret_cast<uintptr_t>(value) | RefTag) {}
 
     // Type checking
-    bool is_int() const { return std::holds_alternative<IntType>(data_); }
-    bool is_bool() const { return std::holds_alternative<BoolType>(data_); }
-    bool is_string() const { return std::holds_alternative<StringType>(data_); }
-    bool is_ref() const { return std::holds_alternative<RefType>(data_); }
+    Tag tag() const { return static_cast<Tag>(bits_ & tag_mask); }
+    bool is_int() const { return tag() == IntTag; }
+    bool is_bool() const { return tag() == BoolTag; }
+    bool is_string() const { return tag() == StringTag; }
+    bool is_ref() const { return tag() == RefTag; }
 
-    // Value getters with type checking
-    IntType as_int() const { return std::get<IntType>(data_); }
-    BoolType as_bool() const { return std::get<BoolType>(data_); }
-    StringType as_string() const { return std::get<StringType>(data_); }
-    RefType as_ref() const { return std::get<RefType>(data_); }
+    // Value getters; callers check the tag first
+    IntType as_int() const { return static_cast<IntType>(bits_ >> 32); }
+    BoolType as_bool() const { return (bits_ >> 32) != 0; }
+    std::string_view as_string() const { return string_object()->view(); }
+    RefType as_ref() const { return reinterpret_cast<RefType>(bits_ & ~tag_mask); }
+
+    // Raw encoding, for code that moves values around without looking at them
+    uint64_t bits() const { return bits_; }
+
+    // The value whose raw encoding is `bits`
+    static Value from_bits(uint64_t bits) {
+        Value value;
+        value.bits_ = bits;
+        return value;
+    }
 
     // Convert value to string representation
     std::string to_string() const {
@@ -47,7 +101,7 @@ public:
         } else if (is_bool()) {
             return as_bool() ? "true" : "false";
         } else if (is_string()) {
-            return as_string();
+            return std::string(as_string());
         } else if (is_ref()) {
             return "ref(" + as_ref()->to_string() + ")";
         }
@@ -55,9 +109,50 @@ public:
     }
 
 private:
-    ValueType data_;
+    static constexpr uint64_t tag_mask = 0x7;
+
+    static constexpr uint64_t encode_payload(uint32_t payload, Tag tag) {
+        return (static_cast<uint64_t>(payload) << 32) | tag;
+    }
+
+    StringType string_object() const {
+        return reinterpret_cast<StringType>(bits_ & ~tag_mask);
+    }
+
+    uint64_t bits_;
 };
 
+// i32 arithmetic as every backend does it: results wrap on overflow, so
+// the work is done in uint32_t, where overflow is defined
+inline Value::IntType add_i32(Value::IntType a, Value::IntType b) {
+    return static_cast<Value::IntType>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b));
+}
+
+inline Value::IntType sub_i32(Value::IntType a, Value::IntType b) {
+    return static_cast<Value::IntType>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b));
+}
+
+inline Value::IntType mul_i32(Value::IntType a, Value::IntType b) {
+    return static_cast<Value::IntType>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b));
+}
+
+inline Value::IntType neg_i32(Value::IntType a) {
+    return static_cast<Value::IntType>(0u - static_cast<uint32_t>(a));
+}
+
+// INT_MIN / -1 wraps to INT_MIN too, instead of trapping. `b` must not be
+// zero.
+inline Value::IntType divide_i32(Value::IntType a, Value::IntType b) {
+    if (b == -1) {
+        return neg_i32(a);
+    }
+    return a / b;
+}
+
+static_assert(sizeof(Value) == 8, "Value must stay a single machine word");
+static_assert(alignof(StringObject) <= 8 && alignof(Value) <= 8,
+              "heap objects must leave the low tag bits free");
+
 } // namespace nust
 
-#endif // NUST_VALUE_H 
\ No newline at end of file
+#endif // NUST_VALUE_H
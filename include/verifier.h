@@ -0,0 +1,47 @@
+#pragma once
+
+#include "packed_code.h"
+#include "function_table.h"
+#include <stdexcept>
+#include <string>
+
+namespace nust {
+
+// Thrown when bytecode fails verification. The message names the function
+// and the byte offset of the offending instruction.
+class VerifyError : public std::runtime_error {
+public:
+    explicit VerifyError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// Load-time bytecode verifier. For every instruction reachable from a
+// function's entry point it proves what the VM's handlers otherwise check
+// as they execute:
+//
+//   - the operand stack has the same depth on every path into a basic
+//     block and never underflows
+//   - operands have the types their instructions expect: i32 for
+//     arithmetic and comparisons, bool for logic and conditional jumps,
+//     references for STORE_REF and DEREF
+//   - jumps land on instruction boundaries inside their own function, and
+//     control never runs off the end of a function
+//   - local slots, string constants and function indices are in range, and
+//     calls pass the callee's parameters with their declared types
+//
+// Types are inferred per slot by dataflow over each function's basic
+// blocks; a call leaves whatever its callee's RET_VALs return, found by
+// iterating over all functions to a fixed point. Unreachable code is
+// decoded but not checked.
+class BytecodeVerifier {
+public:
+    BytecodeVerifier(const FunctionTable& function_table, size_t constant_count);
+
+    // Verify every function in the table; throws VerifyError
+    void verify(const PackedCode& code) const;
+
+private:
+    const FunctionTable& function_table_;
+    size_t constant_count_;
+};
+
+} // namespace nust
@@ -3,8 +3,13 @@
 
 #include "value.h"
 #include "instruction.h"
+#include "packed_code.h"
+#include "jit.h"
 #include "function_table.h"
+#include "call_stack.h"
+#include "module.h"
 #include <vector>
+#include <deque>
 #include <stack>
 #include <memory>
 #include <stdexcept>
@@ -16,72 +21,152 @@ public:
     // Constructor
     VirtualMachine(const FunctionTable& function_table, 
                   const std::vector<Value>& constants,
-                  const std::vector<Instruction>& instructions);
+                  const std::vector<Instruction>& instructions,
+                  CallStackConfig stack_config = CallStackConfig());
+
+    // Run packed code directly, such as a view of a mapped module. The
+    // vector constructor packs its instructions first.
+    VirtualMachine(const FunctionTable& function_table,
+                  const std::vector<Value>& constants,
+                  PackedCode code,
+                  CallStackConfig stack_config = CallStackConfig());
+
+    // Run functions of a shared module with call(); nothing is entered
+    // until then. The VM views the module's code rather than copying it,
+    // and starts in verified mode if the module passed verification.
+    explicit VirtualMachine(std::shared_ptr<const Module> module,
+                            CallStackConfig stack_config = CallStackConfig());
+
+    // Verify the code (see BytecodeVerifier) and, if it passes, run it in
+    // verified mode: handlers skip the stack, type and bounds checks the
+    // verifier has proven redundant. Throws VerifyError and stays in checked
+    // mode otherwise.
+    void verify();
+
+    // Whether run() uses the verified handlers
+    bool is_verified() const { return verified_; }
+
+    // Compile functions to native code once they have been called
+    // `threshold` times (see JitCompiler). Takes effect only in verified
+    // mode and where JitCompiler::available(). Instructions run natively
+    // are not counted by instructions_executed().
+    void enable_jit(uint32_t threshold = 1000);
+
+    // Number of functions compiled to native code so far
+    size_t jit_compiled_functions() const;
 
     // Run the VM
     void run();
 
+    // Run function `index` with `args` as its parameters, from a fresh
+    // state (see reset()), and return its result. Only the argument count
+    // is checked: verified code relies on the argument types matching the
+    // function's parameters.
+    Value call(size_t index, const std::vector<Value>& args);
+
+    // Drop every frame, operand and borrowed box, keeping their storage,
+    // so the VM can run again. Native code and the JIT's call counts are
+    // kept.
+    void reset();
+
     // Get the result of execution
     Value get_result() const;
 
+    // Number of instructions dispatched since construction or reset()
+    uint64_t instructions_executed() const;
+
+    // Borrow boxes currently alive
+    size_t live_boxes() const { return ref_heap_.size(); }
+
 private:
     // VM state
     const FunctionTable& function_table_;
     const std::vector<Value>& constants_;
-    const std::vector<Instruction>& instructions_;
+    PackedCode code_;            // Execution format; pc_ is a byte offset into it
     
     // Runtime state
-    std::vector<Value> memory_;  // Contiguous memory for all runtime data
-    std::vector<Value> stack_;    // Operand stack
+    CallStack call_stack_;       // Frames, local slots and operand stack
+    std::deque<Value> ref_heap_;  // Boxes created by borrows, freed when their frame returns
+    std::vector<size_t> box_marks_;  // ref_heap_ size at each active CALL
     size_t pc_;                  // Program counter
-    size_t fp_;                  // Frame pointer
+    size_t fp_;                  // Base slot of the current frame
     Value result_;               // Result of execution
     bool running_;               // Whether the VM is running
-    bool returned_from_main_;     // Whether the main function has returned
+    bool returned_from_main_;     // Whether the bottom frame (main, or call()'s function) has returned
+    bool verified_;              // Whether the code passed verification
+    uint64_t executed_;          // Instructions dispatched
+    std::unique_ptr<JitCompiler> jit_;  // Set by enable_jit
+    uint32_t jit_threshold_;
+    std::vector<uint32_t> call_counts_;  // Per function, until it reaches jit_threshold_
+    std::shared_ptr<const Module> module_;  // Keeps a shared module's tables and code alive
+
+    // Dispatch loops. Verified instantiations drop the per-instruction
+    // checks, including the end-of-code and opcode range checks.
+    template <bool Verified> void run_switch();
+    template <bool Verified> void run_threaded();
 
     // Helper methods
-    void execute_instruction(const Instruction& instr);
-    void push(const Value& value);
-    Value pop();
-    Value& top();
+    template <bool Verified> void execute_instruction(const Instruction& instr);
+    void push(Value value);
     void check_stack_size(size_t required) const;
     void check_memory_bounds(size_t index) const;
+    Value::RefType box(const Value& value);
+    void release_boxes(const Value& ret_val);
+    bool call_native(size_t index);
+    static size_t frame_size(const FunctionInfo& func_info);
+
+    // Checks that verified handlers compile out
+    template <bool Verified> void require_operands(size_t count) const;
+    template <bool Verified> Value& local(size_t index);
+    template <bool Verified> static void require_int(const Value& a);
+    template <bool Verified> static void require_ints(const Value& a, const Value& b);
+    template <bool Verified> static void require_bool(const Value& a);
+    template <bool Verified> static void require_bools(const Value& a, const Value& b);
+    template <bool Verified> static void require_ref(const Value& a);
     
     // Instruction handlers
     void handle_push_i32(size_t operand);
     void handle_push_bool(size_t operand);
-    void handle_push_str(size_t operand);
-    void handle_pop();
-    void handle_dup();
-    void handle_swap();
-    void handle_load(size_t operand);
-    void handle_store(size_t operand);
-    void handle_load_ref(size_t operand);
-    void handle_store_ref();
-    void handle_add_i32();
-    void handle_sub_i32();
-    void handle_mul_i32();
-    void handle_div_i32();
-    void handle_neg_i32();
-    void handle_eq_i32();
-    void handle_ne_i32();
-    void handle_lt_i32();
-    void handle_gt_i32();
-    void handle_le_i32();
-    void handle_ge_i32();
-    void handle_and();
-    void handle_or();
-    void handle_not();
+    template <bool Verified> void handle_push_str(size_t operand);
+    template <bool Verified> void handle_pop();
+    template <bool Verified> void handle_dup();
+    template <bool Verified> void handle_swap();
+    template <bool Verified> void handle_load(size_t operand);
+    template <bool Verified> void handle_store(size_t operand);
+    template <bool Verified> void handle_load_ref(size_t operand);
+    template <bool Verified> void handle_store_ref();
+    template <bool Verified> void handle_add_i32();
+    template <bool Verified> void handle_sub_i32();
+    template <bool Verified> void handle_mul_i32();
+    template <bool Verified> void handle_div_i32();
+    template <bool Verified> void handle_neg_i32();
+    template <bool Verified> void handle_eq_i32();
+    template <bool Verified> void handle_ne_i32();
+    template <bool Verified> void handle_lt_i32();
+    template <bool Verified> void handle_gt_i32();
+    template <bool Verified> void handle_le_i32();
+    template <bool Verified> void handle_ge_i32();
+    template <bool Verified> void handle_and();
+    template <bool Verified> void handle_or();
+    template <bool Verified> void handle_not();
     void handle_jmp(size_t operand);
-    void handle_jmp_if(size_t operand);
-    void handle_jmp_if_not(size_t operand);
-    void handle_call(size_t operand);
+    template <bool Verified> void handle_jmp_if(size_t operand);
+    template <bool Verified> void handle_jmp_if_not(size_t operand);
+    template <bool Verified> void handle_call(size_t operand);
     void handle_ret();
-    void handle_ret_val();
-    void handle_borrow();
-    void handle_borrow_mut();
-    void handle_deref();
-    void handle_deref_mut();
+    template <bool Verified> void handle_ret_val();
+    template <bool Verified> void handle_borrow();
+    template <bool Verified> void handle_borrow_mut();
+    template <bool Verified> void handle_deref();
+    template <bool Verified> void handle_deref_mut();
+
+    // Superinstruction handlers
+    template <bool Verified> void handle_load_load(size_t operand);
+    template <bool Verified> void handle_load_load_add(size_t operand);
+    template <bool Verified> void handle_load_push_i32(size_t operand);
+    template <bool Verified> void handle_inc_local(size_t operand);
+    template <bool Verified, typename Compare>
+    void handle_cmp_jmp_if_not(size_t operand, Compare compare);
 };
 
 } // namespace nust
@@ -0,0 +1,36 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace nust {
+
+Arena::~Arena() {
+    for (auto it = finalizers_.rbegin(); it != finalizers_.rend(); ++it) {
+        it->destroy(it->object);
+    }
+    for (char* block : blocks_) {
+        ::operator delete(block);
+    }
+}
+
+void* Arena::allocate(size_t size, size_t align) {
+    uintptr_t cursor = reinterpret_cast<uintptr_t>(cursor_);
+    uintptr_t aligned = (cursor + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    if (!cursor_ || aligned + size > reinterpret_cast<uintptr_t>(limit_)) {
+        // Blocks double in size, so a big program needs only a few of them
+        size_t block_size = std::max(next_block_size_, size + align);
+        char* block = static_cast<char*>(::operator new(block_size));
+        blocks_.push_back(block);
+        reserved_ += block_size;
+        next_block_size_ = std::min(next_block_size_ * 2, size_t{16} * 1024 * 1024);
+        cursor_ = block;
+        limit_ = block + block_size;
+        cursor = reinterpret_cast<uintptr_t>(cursor_);
+        aligned = (cursor + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    }
+    cursor_ = reinterpret_cast<char*>(aligned + size);
+    used_ += size;
+    return reinterpret_cast<void*>(aligned);
+}
+
+} // namespace nust
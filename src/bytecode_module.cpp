@@ -0,0 +1,354 @@
+#include "bytecode_module.h"
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define NUST_HAVE_MMAP
+#endif
+
+namespace nust {
+
+namespace {
+
+constexpr size_t header_size = 72;
+constexpr size_t function_record_size = 40;
+
+size_t align8(size_t offset) {
+    return (offset + 7) & ~size_t(7);
+}
+
+void put_u16(std::vector<uint8_t>& out, size_t at, uint16_t value) {
+    for (size_t i = 0; i < 2; ++i) out[at + i] = static_cast<uint8_t>(value >> (i * 8));
+}
+
+void put_u32(std::vector<uint8_t>& out, size_t at, uint32_t value) {
+    for (size_t i = 0; i < 4; ++i) out[at + i] = static_cast<uint8_t>(value >> (i * 8));
+}
+
+void put_u64(std::vector<uint8_t>& out, size_t at, uint64_t value) {
+    for (size_t i = 0; i < 8; ++i) out[at + i] = static_cast<uint8_t>(value >> (i * 8));
+}
+
+uint16_t get_u16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t get_u32(const uint8_t* p) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i) value |= static_cast<uint32_t>(p[i]) << (i * 8);
+    return value;
+}
+
+uint64_t get_u64(const uint8_t* p) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i) value |= static_cast<uint64_t>(p[i]) << (i * 8);
+    return value;
+}
+
+void encode_type(const Type& type, std::string& out) {
+    switch (type.kind) {
+        case Type::Kind::I32: out += 'i'; break;
+        case Type::Kind::Bool: out += 'b'; break;
+        case Type::Kind::Str: out += 's'; break;
+        case Type::Kind::Ref: out += '&'; encode_type(*type.base_type, out); break;
+        case Type::Kind::MutRef: out += 'm'; encode_type(*type.base_type, out); break;
+    }
+}
+
+const Type* decode_type(std::string_view signature, size_t& pos) {
+    if (pos >= signature.size()) {
+        throw BytecodeError("Truncated function signature");
+    }
+    switch (signature[pos++]) {
+        case 'i': return Type::get(Type::Kind::I32);
+        case 'b': return Type::get(Type::Kind::Bool);
+        case 's': return Type::get(Type::Kind::Str);
+        case '&': return Type::reference(decode_type(signature, pos), false);
+        case 'm': return Type::reference(decode_type(signature, pos), true);
+        default: throw BytecodeError("Invalid type in function signature");
+    }
+}
+
+// Lays out deduplicated string records
+class StringPool {
+public:
+    // Offset of the record relative to the start of the pool
+    size_t intern(const std::string& str) {
+        auto it = offsets_.find(str);
+        if (it != offsets_.end()) {
+            return it->second;
+        }
+        size_t offset = size_;
+        offsets_.emplace(str, offset);
+        order_.push_back(&offsets_.find(str)->first);
+        size_ += align8(sizeof(StringObject) + str.size() + 1);
+        return offset;
+    }
+
+    size_t size() const { return size_; }
+
+    void write(std::vector<uint8_t>& out, size_t base) const {
+        for (const std::string* str : order_) {
+            size_t at = base + offsets_.at(*str);
+            put_u32(out, at, static_cast<uint32_t>(str->size()));
+            put_u32(out, at + 4, 0);
+            std::memcpy(&out[at + sizeof(StringObject)], str->data(), str->size());
+            // NUL and padding are already zero
+        }
+    }
+
+private:
+    std::unordered_map<std::string, size_t> offsets_;
+    std::vector<const std::string*> order_;
+    size_t size_ = 0;
+};
+
+} // namespace
+
+void write_module(std::ostream& out, const FunctionTable& function_table,
+                  const std::vector<std::string>& string_constants,
+                  const std::vector<Instruction>& instructions) {
+    StringPool pool;
+    std::vector<std::pair<size_t, size_t>> function_strings;
+    for (size_t i = 0; i < function_table.size(); ++i) {
+        const auto& func = function_table.get_function(i);
+        std::string signature;
+        encode_type(*func.return_type, signature);
+        for (const auto& param : func.param_types) {
+            encode_type(*param, signature);
+        }
+        function_strings.emplace_back(pool.intern(func.name), pool.intern(signature));
+    }
+    std::vector<size_t> constant_strings;
+    for (const auto& str : string_constants) {
+        constant_strings.push_back(pool.intern(str));
+    }
+    PackedCode code = PackedCode::encode(instructions, function_table);
+
+    // Section layout
+    size_t functions_offset = header_size;
+    size_t constants_offset = functions_offset + function_table.size() * function_record_size;
+    size_t strings_offset = constants_offset + string_constants.size() * 8;
+    size_t code_offset = align8(strings_offset + pool.size());
+    size_t file_size = code_offset + code.size() + packed_code_padding;
+
+    std::vector<uint8_t> bytes(file_size, 0);
+
+    put_u32(bytes, 0, module_magic);
+    put_u16(bytes, 4, module_version);
+    put_u16(bytes, 6, 0);
+    put_u32(bytes, 8, static_cast<uint32_t>(function_table.size()));
+    put_u32(bytes, 12, static_cast<uint32_t>(string_constants.size()));
+    put_u64(bytes, 16, instructions.size());
+    put_u64(bytes, 24, functions_offset);
+    put_u64(bytes, 32, constants_offset);
+    put_u64(bytes, 40, strings_offset);
+    put_u64(bytes, 48, code_offset);
+    put_u64(bytes, 56, code.size());
+    put_u64(bytes, 64, file_size);
+
+    for (size_t i = 0; i < function_table.size(); ++i) {
+        const auto& func = function_table.get_function(i);
+        size_t at = functions_offset + i * function_record_size;
+        put_u64(bytes, at, func.entry_point);
+        put_u32(bytes, at + 8, static_cast<uint32_t>(func.num_params));
+        put_u32(bytes, at + 12, static_cast<uint32_t>(func.num_locals));
+        put_u64(bytes, at + 16, strings_offset + function_strings[i].first);
+        put_u64(bytes, at + 24, strings_offset + function_strings[i].second);
+        put_u64(bytes, at + 32, code.entry_offsets()[i]);
+    }
+
+    for (size_t i = 0; i < constant_strings.size(); ++i) {
+        put_u64(bytes, constants_offset + i * 8, strings_offset + constant_strings[i]);
+    }
+
+    pool.write(bytes, strings_offset);
+
+    // Padding after the code is already zero
+    std::memcpy(&bytes[code_offset], code.data(), code.size());
+
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if (!out) {
+        throw std::runtime_error("Failed to write bytecode module");
+    }
+}
+
+BytecodeModule BytecodeModule::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw BytecodeError("Failed to open bytecode module: " + path);
+    }
+    std::streamsize size = file.tellg();
+    file.seekg(0);
+
+    BytecodeModule module;
+    module.size_ = static_cast<size_t>(size);
+    module.buffer_.resize((module.size_ + 7) / 8);
+    if (!file.read(reinterpret_cast<char*>(module.buffer_.data()), size)) {
+        throw BytecodeError("Failed to read bytecode module: " + path);
+    }
+    module.data_ = reinterpret_cast<const uint8_t*>(module.buffer_.data());
+    module.parse(true);
+    return module;
+}
+
+BytecodeModule BytecodeModule::map(const std::string& path) {
+#ifdef NUST_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw BytecodeError("Failed to open bytecode module: " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(header_size)) {
+        ::close(fd);
+        throw BytecodeError("Not a nust bytecode module");
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        throw BytecodeError("Failed to map bytecode module: " + path);
+    }
+
+    BytecodeModule module;
+    module.mapping_.reset(new Mapping{address, size});
+    module.data_ = static_cast<const uint8_t*>(address);
+    module.size_ = size;
+    module.parse(false);
+    return module;
+#else
+    return load(path);
+#endif
+}
+
+BytecodeModule::Mapping::~Mapping() {
+#ifdef NUST_HAVE_MMAP
+    ::munmap(address, size);
+#endif
+}
+
+BytecodeModule BytecodeModule::from_bytes(const void* data, size_t size) {
+    BytecodeModule module;
+    module.size_ = size;
+    module.buffer_.resize((size + 7) / 8);
+    if (size > 0) {
+        std::memcpy(module.buffer_.data(), data, size);
+    }
+    module.data_ = reinterpret_cast<const uint8_t*>(module.buffer_.data());
+    module.parse(true);
+    return module;
+}
+
+void BytecodeModule::parse(bool validate_code) {
+    const uint8_t* base = data_;
+
+    if (size_ < header_size || get_u32(base) != module_magic) {
+        throw BytecodeError("Not a nust bytecode module");
+    }
+    uint16_t version = get_u16(base + 4);
+    if (version != module_version) {
+        throw BytecodeError("Unsupported bytecode module version " + std::to_string(version));
+    }
+
+    ModuleHeader header;
+    header.function_count = get_u32(base + 8);
+    header.constant_count = get_u32(base + 12);
+    header.instruction_count = get_u64(base + 16);
+    header.functions_offset = get_u64(base + 24);
+    header.constants_offset = get_u64(base + 32);
+    header.strings_offset = get_u64(base + 40);
+    header.code_offset = get_u64(base + 48);
+    header.code_size = get_u64(base + 56);
+    header.file_size = get_u64(base + 64);
+
+    if (header.file_size != size_) {
+        throw BytecodeError("Bytecode module is truncated");
+    }
+
+    // Every section must be aligned and lie inside the file
+    auto check_section = [&](uint64_t offset, uint64_t count, uint64_t record_size, const char* name) {
+        if (offset % 8 != 0 || offset > size_ || count > (size_ - offset) / record_size) {
+            throw BytecodeError(std::string("Invalid ") + name + " section");
+        }
+    };
+    check_section(header.functions_offset, header.function_count, function_record_size, "function");
+    check_section(header.constants_offset, header.constant_count, 8, "constant");
+    // The code must be followed by its padding, so decoding an operand
+    // never runs off the end of the file
+    if (header.code_offset % 8 != 0 || header.code_offset > size_ ||
+        size_ - header.code_offset < packed_code_padding ||
+        header.code_size > size_ - header.code_offset - packed_code_padding) {
+        throw BytecodeError("Invalid code section");
+    }
+
+    auto string_at = [&](uint64_t offset) -> const StringObject* {
+        if (offset % 8 != 0 || offset > size_ || size_ - offset < sizeof(StringObject)) {
+            throw BytecodeError("Invalid string offset");
+        }
+        uint32_t length = get_u32(base + offset);
+        if (size_ - offset - sizeof(StringObject) < uint64_t(length) + 1 ||
+            base[offset + sizeof(StringObject) + length] != 0) {
+            throw BytecodeError("Invalid string record");
+        }
+        return reinterpret_cast<const StringObject*>(base + offset);
+    };
+
+    const uint8_t* code = base + header.code_offset;
+    if (validate_code) {
+        uint64_t count = 0;
+        size_t pc = 0;
+        while (pc < header.code_size) {
+            if (code[pc] >= opcode_count) {
+                throw BytecodeError("Invalid opcode at byte " + std::to_string(pc));
+            }
+            read_instruction(code, pc);
+            count++;
+        }
+        if (pc != header.code_size || count != header.instruction_count) {
+            throw BytecodeError("Code section does not match its instruction count");
+        }
+    }
+
+    // Function table
+    function_table_ = FunctionTable();
+    std::vector<size_t> entry_offsets;
+    for (uint32_t i = 0; i < header.function_count; ++i) {
+        const uint8_t* record = base + header.functions_offset + i * function_record_size;
+        FunctionInfo info;
+        info.entry_point = get_u64(record);
+        info.num_params = get_u32(record + 8);
+        info.num_locals = get_u32(record + 12);
+        info.name = std::string(string_at(get_u64(record + 16))->view());
+        uint64_t entry_offset = get_u64(record + 32);
+        if (info.entry_point >= header.instruction_count || entry_offset >= header.code_size) {
+            throw BytecodeError("Entry point of " + info.name + " is out of range");
+        }
+        entry_offsets.push_back(entry_offset);
+
+        std::string_view signature = string_at(get_u64(record + 24))->view();
+        size_t pos = 0;
+        info.return_type = decode_type(signature, pos);
+        while (pos < signature.size()) {
+            info.param_types.push_back(decode_type(signature, pos));
+        }
+        if (info.param_types.size() != info.num_params) {
+            throw BytecodeError("Signature of " + info.name + " does not match its parameter count");
+        }
+        function_table_.add_function(std::move(info));
+    }
+
+    // String constants point straight at their records
+    constants_.clear();
+    for (uint32_t i = 0; i < header.constant_count; ++i) {
+        constants_.push_back(Value(string_at(get_u64(base + header.constants_offset + i * 8))));
+    }
+
+    code_ = PackedCode::view(code, header.code_size, std::move(entry_offsets));
+}
+
+} // namespace nust
@@ -0,0 +1,391 @@
+#include "c_emitter.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace nust {
+
+namespace {
+
+// Runtime support shared by every translation unit. Arithmetic goes
+// through unsigned ints so overflow wraps instead of being undefined.
+const char* const prelude = R"(#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static inline int32_t nust_add(int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }
+static inline int32_t nust_sub(int32_t a, int32_t b) { return (int32_t)((uint32_t)a - (uint32_t)b); }
+static inline int32_t nust_mul(int32_t a, int32_t b) { return (int32_t)((uint32_t)a * (uint32_t)b); }
+static inline int32_t nust_neg(int32_t a) { return (int32_t)(0u - (uint32_t)a); }
+
+static inline int32_t nust_div(int32_t a, int32_t b)
+{
+    if (b == 0) {
+        fputs("Runtime error: Division by zero\n", stderr);
+        exit(1);
+    }
+    return b == -1 ? nust_neg(a) : a / b;
+}
+)";
+
+// Generated names are prefixed so Nust identifiers can't collide with C
+// keywords, the C library or the runtime helpers above
+std::string function_name(Symbol name) { return "fn_" + name.str(); }
+std::string variable_name(Symbol name) { return "v_" + name.str(); }
+
+std::string string_literal(const std::string& value) {
+    // The VM prints string constants byte for byte, escapes included
+    std::string result = "\"";
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += static_cast<char>(c);
+        } else if (c < 0x20 || c >= 0x7f) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\%03o", c);
+            result += escape;
+        } else {
+            result += static_cast<char>(c);
+        }
+    }
+    return result + "\"";
+}
+
+} // namespace
+
+std::string CEmitter::emit(const Program& program) {
+    out_.str("");
+    out_.clear();
+
+    functions_.clear();
+    const FunctionDecl* main_func = nullptr;
+    const Symbol main_name("main");
+    for (const auto& item : program.items) {
+        if (auto func = node_cast<FunctionDecl>(item)) {
+            functions_.push_back(func);
+            if (func->name == main_name) {
+                main_func = func;
+            }
+        }
+    }
+    if (!main_func) {
+        throw std::runtime_error("No main() function found");
+    }
+
+    out_ << "/* Generated by nust */\n" << prelude << "\n";
+
+    // Prototypes, so functions can call each other in any order
+    for (const auto* func : functions_) {
+        out_ << signature(func) << ";\n";
+    }
+
+    for (const auto* func : functions_) {
+        out_ << "\n";
+        emit_function(func);
+    }
+
+    // Print main's result like Value::to_string
+    out_ << "\nint main(void)\n{\n";
+    switch (main_func->return_type->kind) {
+        case Type::Kind::I32:
+            out_ << "    printf(\"%d\", (int)fn_main());\n";
+            break;
+        case Type::Kind::Bool:
+            out_ << "    fputs(fn_main() ? \"true\" : \"false\", stdout);\n";
+            break;
+        default:
+            out_ << "    fputs(fn_main(), stdout);\n";
+            break;
+    }
+    out_ << "    return 0;\n}\n";
+    return out_.str();
+}
+
+void CEmitter::emit_function(const FunctionDecl* func) {
+    current_function_ = func;
+    locals_.clear();
+    temp_count_ = 0;
+    collect_locals(func->body);
+
+    out_ << signature(func) << "\n{\n";
+
+    // Every let is its own variable, declared up front
+    for (const LetStmt* let : locals_) {
+        const Type* type = let->type;
+        out_ << "    " << c_type(type) << " " << local_name(let->name, let->binding) << " = "
+             << default_value(type) << ";\n";
+    }
+
+    emit_statement(func->body, 1);
+
+    // Falling off the end returns the type's zero value
+    out_ << "    return " << default_value(func->return_type) << ";\n}\n";
+}
+
+void CEmitter::collect_locals(const Stmt* stmt) {
+    if (auto let = node_cast<LetStmt>(stmt)) {
+        locals_.push_back(let);
+    } else if (auto if_stmt = node_cast<IfStmt>(stmt)) {
+        collect_locals(if_stmt->then_branch);
+        if (if_stmt->else_branch) {
+            collect_locals(if_stmt->else_branch);
+        }
+    } else if (auto while_stmt = node_cast<WhileStmt>(stmt)) {
+        collect_locals(while_stmt->body);
+    } else if (auto block = node_cast<BlockStmt>(stmt)) {
+        for (const auto& s : block->statements) {
+            collect_locals(s);
+        }
+    }
+}
+
+void CEmitter::emit_statement(const Stmt* stmt, int depth) {
+    if (auto let = node_cast<LetStmt>(stmt)) {
+        std::string value = expression(let->init);
+        emit_hoisted(depth);
+        indent(depth);
+        out_ << local_name(let->name, let->binding) << " = " << value << ";\n";
+    } else if (auto if_stmt = node_cast<IfStmt>(stmt)) {
+        std::string condition = expression(if_stmt->condition);
+        emit_hoisted(depth);
+        indent(depth);
+        out_ << "if (" << condition << ") {\n";
+        emit_statement(if_stmt->then_branch, depth + 1);
+        if (if_stmt->else_branch) {
+            indent(depth);
+            out_ << "} else {\n";
+            emit_statement(if_stmt->else_branch, depth + 1);
+        }
+        indent(depth);
+        out_ << "}\n";
+    } else if (auto while_stmt = node_cast<WhileStmt>(stmt)) {
+        std::string condition = expression(while_stmt->condition);
+        indent(depth);
+        if (hoisted_.empty()) {
+            out_ << "while (" << condition << ") {\n";
+        } else {
+            // The condition's temporaries are recomputed on every iteration
+            out_ << "while (1) {\n";
+            emit_hoisted(depth + 1);
+            indent(depth + 1);
+            out_ << "if (!(" << condition << ")) break;\n";
+        }
+        emit_statement(while_stmt->body, depth + 1);
+        indent(depth);
+        out_ << "}\n";
+    } else if (auto block = node_cast<BlockStmt>(stmt)) {
+        // Braces come from the enclosing construct; locals are function-wide
+        for (const auto& s : block->statements) {
+            emit_statement(s, depth);
+        }
+    } else if (auto expr = node_cast<ExprStmt>(stmt)) {
+        std::string value = expression(expr->expr);
+        emit_hoisted(depth);
+        indent(depth);
+        out_ << "(void)" << value << ";\n";
+    } else if (auto ret = node_cast<ReturnStmt>(stmt)) {
+        if (ret->value) {
+            std::string value = expression(ret->value);
+            emit_hoisted(depth);
+            indent(depth);
+            out_ << "return " << value << ";\n";
+        } else {
+            indent(depth);
+            out_ << "return " << default_value(current_function_->return_type) << ";\n";
+        }
+    } else {
+        throw CEmitError("Unsupported statement type");
+    }
+}
+
+std::string CEmitter::expression(const Expr* expr) {
+    if (auto lit = node_cast<IntLiteral>(expr)) {
+        if (lit->value == INT32_MIN) {
+            return "INT32_MIN";
+        }
+        return lit->value < 0 ? "(" + std::to_string(lit->value) + ")" : std::to_string(lit->value);
+    } else if (auto lit = node_cast<BoolLiteral>(expr)) {
+        return lit->value ? "true" : "false";
+    } else if (auto lit = node_cast<StringLiteral>(expr)) {
+        return string_literal(lit->value);
+    } else if (auto ident = node_cast<Identifier>(expr)) {
+        if (ident->resolution != Resolution::Local) {
+            throw std::runtime_error("Undefined variable: " + ident->name.str());
+        }
+        return local_name(ident->name, ident->binding);
+    } else if (auto binary = node_cast<BinaryExpr>(expr)) {
+        if (binary->op == BinaryExpr::Op::Assignment) {
+            auto* target = node_cast<Identifier>(binary->left);
+            if (!target) {
+                throw std::runtime_error("Assignment target must be an identifier");
+            }
+            return "(" + expression(target) + " = " + expression(binary->right) + ")";
+        }
+
+        const Type* operand_type = binary->left->type;
+        if (operand_type && (operand_type->kind == Type::Kind::Str || operand_type->is_reference())) {
+            throw CEmitError("Only i32 and bool operands are supported");
+        }
+        std::vector<std::string> values = operands({binary->left, binary->right});
+        const std::string& left = values[0];
+        const std::string& right = values[1];
+        switch (binary->op) {
+            case BinaryExpr::Op::Add: return "nust_add(" + left + ", " + right + ")";
+            case BinaryExpr::Op::Sub: return "nust_sub(" + left + ", " + right + ")";
+            case BinaryExpr::Op::Mul: return "nust_mul(" + left + ", " + right + ")";
+            case BinaryExpr::Op::Div: return "nust_div(" + left + ", " + right + ")";
+            case BinaryExpr::Op::Eq: return "(" + left + " == " + right + ")";
+            case BinaryExpr::Op::Ne: return "(" + left + " != " + right + ")";
+            case BinaryExpr::Op::Lt: return "(" + left + " < " + right + ")";
+            case BinaryExpr::Op::Gt: return "(" + left + " > " + right + ")";
+            case BinaryExpr::Op::Le: return "(" + left + " <= " + right + ")";
+            case BinaryExpr::Op::Ge: return "(" + left + " >= " + right + ")";
+            // Both operands are evaluated, as in the VM
+            case BinaryExpr::Op::And: return "(bool)(" + left + " & " + right + ")";
+            case BinaryExpr::Op::Or: return "(bool)(" + left + " | " + right + ")";
+            default:
+                throw CEmitError("Unsupported binary operator");
+        }
+    } else if (auto unary = node_cast<UnaryExpr>(expr)) {
+        std::string operand = expression(unary->expr);
+        if (unary->op == UnaryExpr::Op::Neg) {
+            return "nust_neg(" + operand + ")";
+        }
+        return "!" + operand;
+    } else if (node_cast<BorrowExpr>(expr)) {
+        throw CEmitError("References are not supported by the C backend");
+    } else if (auto call = node_cast<CallExpr>(expr)) {
+        auto* callee = node_cast<Identifier>(call->callee);
+        if (!callee) {
+            throw std::runtime_error("Function call target must be an identifier");
+        }
+        std::vector<std::string> args = operands(std::vector<const Expr*>(call->args.begin(), call->args.end()));
+        std::string result = function_name(callee->name) + "(";
+        for (size_t i = 0; i < args.size(); i++) {
+            if (i > 0) result += ", ";
+            result += args[i];
+        }
+        return result + ")";
+    }
+    throw CEmitError("Unsupported expression type");
+}
+
+std::vector<std::string> CEmitter::operands(const std::vector<const Expr*>& exprs) {
+    // Everything up to the last operand with side effects is evaluated into
+    // a temporary, in order; what follows only reads variables
+    size_t ordered = 0;
+    for (size_t i = 0; i < exprs.size(); i++) {
+        if (has_side_effects(exprs[i])) {
+            ordered = i + 1;
+        }
+    }
+    std::vector<std::string> values;
+    for (size_t i = 0; i < exprs.size(); i++) {
+        std::string value = expression(exprs[i]);
+        bool literal = node_cast<IntLiteral>(exprs[i]) || node_cast<BoolLiteral>(exprs[i]) ||
+                       node_cast<StringLiteral>(exprs[i]);
+        if (i < ordered && !literal) {
+            std::string temp = "t_" + std::to_string(temp_count_++);
+            hoisted_.push_back(c_type(expression_type(exprs[i])) + " " + temp + " = " + value + ";");
+            value = temp;
+        }
+        values.push_back(value);
+    }
+    return values;
+}
+
+const Type* CEmitter::expression_type(const Expr* expr) const {
+    // The checker doesn't annotate every expression (return values, for
+    // one), so fall back to what the node itself says
+    if (expr->type) {
+        return expr->type;
+    }
+    if (node_cast<IntLiteral>(expr)) {
+        return Type::get(Type::Kind::I32);
+    } else if (node_cast<BoolLiteral>(expr)) {
+        return Type::get(Type::Kind::Bool);
+    } else if (node_cast<StringLiteral>(expr)) {
+        return Type::get(Type::Kind::Str);
+    } else if (auto ident = node_cast<Identifier>(expr)) {
+        if (ident->binding < current_function_->params.size()) {
+            return current_function_->params[ident->binding].type;
+        }
+        for (const LetStmt* let : locals_) {
+            if (let->binding == ident->binding) {
+                return let->type;
+            }
+        }
+    } else if (auto binary = node_cast<BinaryExpr>(expr)) {
+        switch (binary->op) {
+            case BinaryExpr::Op::Assignment: return expression_type(binary->left);
+            case BinaryExpr::Op::Add:
+            case BinaryExpr::Op::Sub:
+            case BinaryExpr::Op::Mul:
+            case BinaryExpr::Op::Div: return Type::get(Type::Kind::I32);
+            default: return Type::get(Type::Kind::Bool);
+        }
+    } else if (auto unary = node_cast<UnaryExpr>(expr)) {
+        return Type::get(unary->op == UnaryExpr::Op::Neg ? Type::Kind::I32 : Type::Kind::Bool);
+    } else if (auto call = node_cast<CallExpr>(expr)) {
+        if (auto* callee = node_cast<Identifier>(call->callee)) {
+            for (const FunctionDecl* func : functions_) {
+                if (func->name == callee->name) {
+                    return func->return_type;
+                }
+            }
+        }
+    }
+    throw CEmitError("Unsupported expression type");
+}
+
+void CEmitter::emit_hoisted(int depth) {
+    for (const auto& line : hoisted_) {
+        indent(depth);
+        out_ << line << "\n";
+    }
+    hoisted_.clear();
+}
+
+std::string CEmitter::c_type(const Type* type) const {
+    switch (type->kind) {
+        case Type::Kind::I32: return "int32_t";
+        case Type::Kind::Bool: return "bool";
+        case Type::Kind::Str: return "const char*";
+        default:
+            throw CEmitError("References are not supported by the C backend");
+    }
+}
+
+std::string CEmitter::default_value(const Type* type) const {
+    switch (type->kind) {
+        case Type::Kind::I32: return "0";
+        case Type::Kind::Bool: return "false";
+        case Type::Kind::Str: return "\"\"";
+        default:
+            throw CEmitError("References are not supported by the C backend");
+    }
+}
+
+std::string CEmitter::signature(const FunctionDecl* func) const {
+    std::string result = "static " + c_type(func->return_type) + " " + function_name(func->name) + "(";
+    for (size_t i = 0; i < func->params.size(); i++) {
+        if (i > 0) result += ", ";
+        result += c_type(func->params[i].type) + " " + variable_name(func->params[i].name);
+    }
+    return result + (func->params.empty() ? "void)" : ")");
+}
+
+std::string CEmitter::local_name(Symbol name, uint32_t binding) const {
+    // Parameters are the function's first bindings
+    if (binding < current_function_->params.size()) {
+        return variable_name(name);
+    }
+    return variable_name(name) + "_" + std::to_string(binding);
+}
+
+void CEmitter::indent(int depth) {
+    out_ << std::string(depth * 4, ' ');
+}
+
+} // namespace nust
@@ -0,0 +1,100 @@
+#include "call_stack.h"
+#include <algorithm>
+#include <sstream>
+
+namespace nust {
+
+CallStack::CallStack(const FunctionTable& function_table, CallStackConfig config)
+    : function_table_(function_table)
+    , config_(config)
+    , slots_(std::min(config.initial_slots, config.max_slots))
+    , top_(0)
+{
+    frames_.reserve(64);
+}
+
+size_t CallStack::push_frame(size_t function_index, size_t return_pc,
+                             size_t num_params, size_t num_slots) {
+    if (frames_.size() >= config_.max_depth) {
+        overflow(function_index, "call depth limit of " + std::to_string(config_.max_depth) + " reached");
+    }
+
+    size_t base = top_ - num_params;
+    size_t required = base + num_slots;
+    if (required > slots_.size()) {
+        grow(required);
+        if (required > slots_.size()) {
+            overflow(function_index, "stack size limit of " + std::to_string(config_.max_slots) + " slots reached");
+        }
+    }
+
+    // Arguments are already in place; only the remaining locals are cleared
+    if (required > top_) {
+        std::fill(slots_.begin() + top_, slots_.begin() + required, Value());
+    }
+    frames_.push_back(Frame{function_index, return_pc, base, required});
+    top_ = required;
+    return base;
+}
+
+CallStack::Frame CallStack::pop_frame() {
+    Frame frame = frames_.back();
+    frames_.pop_back();
+    top_ = frame.base;
+    return frame;
+}
+
+std::string format_call_chain(const FunctionTable& function_table,
+                              const std::vector<size_t>& function_indices) {
+    // Collapse runs of the same function so deep recursion stays readable
+    std::stringstream ss;
+    for (size_t i = 0; i < function_indices.size();) {
+        size_t run = 1;
+        while (i + run < function_indices.size() &&
+               function_indices[i + run] == function_indices[i]) {
+            run++;
+        }
+        if (i > 0) {
+            ss << " -> ";
+        }
+        ss << function_table.get_function(function_indices[i]).name;
+        if (run > 1) {
+            ss << " (x" << run << ")";
+        }
+        i += run;
+    }
+    return ss.str();
+}
+
+std::string CallStack::call_chain() const {
+    std::vector<size_t> function_indices;
+    function_indices.reserve(frames_.size());
+    for (const auto& frame : frames_) {
+        function_indices.push_back(frame.function_index);
+    }
+    return format_call_chain(function_table_, function_indices);
+}
+
+void CallStack::grow(size_t required) {
+    size_t new_size = std::max(required, slots_.size() * 2);
+    new_size = std::min(new_size, config_.max_slots);
+    if (new_size > slots_.size()) {
+        slots_.resize(new_size);
+    }
+}
+
+void CallStack::grow_for_push() {
+    grow(top_ + 1);
+    if (top_ == slots_.size()) {
+        overflow(frames_.back().function_index, "stack size limit of " + std::to_string(config_.max_slots) + " slots reached");
+    }
+}
+
+void CallStack::overflow(size_t function_index, const std::string& reason) const {
+    std::stringstream ss;
+    ss << "Stack overflow calling " << function_table_.get_function(function_index).name
+       << ": " << reason << "\nCall chain: " << call_chain();
+    throw StackOverflowError(ss.str());
+}
+
+} // namespace nust
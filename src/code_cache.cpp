@@ -0,0 +1,312 @@
+#include "code_cache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace nust {
+
+namespace {
+
+constexpr uint32_t cache_magic = 0x3143464e;  // "NFC1"
+
+// Bump when the compiler's output for the same source changes
+constexpr uint64_t cache_version = 2;
+
+// FNV-1a style, but folding in a word at a time: keys are computed for
+// every function on every run, so this has to keep up with the parser
+class Hasher {
+public:
+    void u64(uint64_t value) {
+        hash_ = (hash_ ^ value) * 0x100000001b3ull;
+        hash_ ^= hash_ >> 32;
+    }
+    void text(std::string_view text) {
+        u64(text.size());
+        size_t i = 0;
+        for (; i + 8 <= text.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, text.data() + i, 8);
+            u64(word);
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, text.data() + i, text.size() - i);
+        u64(tail);
+    }
+    void type(const Type* type) {
+        for (; type; type = type->base_type) {
+            u64(static_cast<uint64_t>(type->kind));
+        }
+    }
+    uint64_t value() const { return hash_; }
+
+private:
+    uint64_t hash_ = 0xcbf29ce484222325ull;
+};
+
+void put_u32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out += static_cast<char>(value >> (i * 8));
+}
+
+void put_u64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out += static_cast<char>(value >> (i * 8));
+}
+
+// Reads little-endian fields, failing once it would run past the end
+class Reader {
+public:
+    explicit Reader(const std::string& data) : data_(data) {}
+
+    bool u32(uint32_t& value) {
+        uint64_t wide;
+        if (!read(4, wide)) return false;
+        value = static_cast<uint32_t>(wide);
+        return true;
+    }
+    bool u64(uint64_t& value) { return read(8, value); }
+    bool text(size_t size, std::string& value) {
+        if (size > data_.size() - pos_) return false;
+        value.assign(data_, pos_, size);
+        pos_ += size;
+        return true;
+    }
+    bool skip(size_t size) {
+        if (size > data_.size() - pos_) return false;
+        pos_ += size;
+        return true;
+    }
+    // The next `size` bytes, or nullptr if there aren't that many
+    const char* take(size_t size) {
+        if (size > data_.size() - pos_) return nullptr;
+        const char* p = data_.data() + pos_;
+        pos_ += size;
+        return p;
+    }
+    bool at_end() const { return pos_ == data_.size(); }
+    size_t position() const { return pos_; }
+
+private:
+    bool read(size_t size, uint64_t& value) {
+        if (size > data_.size() - pos_) return false;
+        value = 0;
+        for (size_t i = 0; i < size; i++) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(data_[pos_ + i])) << (i * 8);
+        }
+        pos_ += size;
+        return true;
+    }
+
+    const std::string& data_;
+    size_t pos_ = 0;
+};
+
+} // namespace
+
+CodeCache::CodeCache(std::string path, std::string_view source,
+                     const SignatureIndex& signatures, uint64_t options)
+    : path_(std::move(path)) {
+    entries_.reserve(signatures.size());
+    for (const auto& signature : signatures) {
+        index_.emplace(signature.decl, entries_.size());
+        entries_.push_back(Entry{function_key(*signature.decl, source, signatures, options), false, FunctionCode()});
+    }
+    load();
+    for (const auto& entry : entries_) {
+        if (entry.hit) {
+            hits_++;
+        } else {
+            misses_++;
+        }
+    }
+}
+
+const FunctionCode* CodeCache::find(const FunctionDecl& func) const {
+    auto it = index_.find(&func);
+    return it != index_.end() && entries_[it->second].hit ? &entries_[it->second].code : nullptr;
+}
+
+uint64_t CodeCache::function_key(const FunctionDecl& func, std::string_view source,
+                                 const SignatureIndex& signatures, uint64_t options) {
+    Hasher hasher;
+    hasher.u64(cache_version);
+    hasher.u64(options);
+    hasher.text(source.substr(func.span.start, func.span.end - func.span.start));
+    // Given the text, which names are functions settles how every
+    // identifier resolved; each of those functions' index and signature
+    // settles the code for calling it
+    hasher.u64(func.functions_used.size());
+    for (Symbol name : func.functions_used) {
+        const FunctionSignature* signature = signatures.find(name);
+        if (!signature) {
+            hasher.u64(0);
+            continue;
+        }
+        hasher.u64(signatures.index_of(*signature));
+        hasher.type(signature->return_type);
+        hasher.u64(signature->param_types.size());
+        for (const Type* param : signature->param_types) {
+            hasher.type(param);
+        }
+    }
+    return hasher.value();
+}
+
+void CodeCache::store(const FunctionDecl& func, const FunctionCode& code) {
+    auto it = index_.find(&func);
+    if (it == index_.end()) {
+        return;
+    }
+    Entry& entry = entries_[it->second];
+    entry.code = code;
+    entry.hit = true;
+    dirty_ = true;
+}
+
+bool CodeCache::save() const {
+    if (!dirty_) {
+        return true;
+    }
+
+    std::string bytes;
+    put_u32(bytes, cache_magic);
+    size_t count_at = bytes.size();
+    put_u32(bytes, 0);
+    uint32_t count = 0;
+    for (const auto& entry : entries_) {
+        if (!entry.hit) {
+            continue;
+        }
+        const FunctionCode& code = entry.code;
+        put_u64(bytes, entry.key);
+        size_t size_at = bytes.size();
+        put_u32(bytes, 0);
+        size_t start = bytes.size();
+        put_u32(bytes, static_cast<uint32_t>(code.instructions.size()));
+        put_u32(bytes, static_cast<uint32_t>(code.string_constants.size()));
+        for (const auto& instr : code.instructions) {
+            bytes += static_cast<char>(instr.opcode);
+            put_u64(bytes, instr.operand);
+        }
+        for (const auto& str : code.string_constants) {
+            put_u32(bytes, static_cast<uint32_t>(str.size()));
+            bytes += str;
+        }
+        std::string size;
+        put_u32(size, static_cast<uint32_t>(bytes.size() - start));
+        bytes.replace(size_at, 4, size);
+        count++;
+    }
+    std::string encoded_count;
+    put_u32(encoded_count, count);
+    bytes.replace(count_at, 4, encoded_count);
+
+    // Write aside and rename, so a concurrent or interrupted run never
+    // reads half a file
+    std::string temp = path_ + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.write(bytes.data(), bytes.size())) {
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temp, path_, error);
+    return !error;
+}
+
+void CodeCache::load() {
+    std::ifstream in(path_, std::ios::binary);
+    if (!in) {
+        return;
+    }
+    std::string data;
+    in.seekg(0, std::ios::end);
+    data.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    if (!in.read(data.data(), data.size())) {
+        return;
+    }
+
+    std::unordered_map<uint64_t, size_t> wanted;
+    for (size_t i = 0; i < entries_.size(); i++) {
+        wanted.emplace(entries_[i].key, i);
+    }
+
+    // Only entries this program needs are decoded. Anything malformed
+    // discards the whole file.
+    auto fail = [this] {
+        for (auto& entry : entries_) {
+            entry.hit = false;
+            entry.code = FunctionCode();
+        }
+    };
+    Reader reader(data);
+    uint32_t magic, count;
+    if (!reader.u32(magic) || magic != cache_magic || !reader.u32(count)) {
+        return fail();
+    }
+    for (uint32_t e = 0; e < count; e++) {
+        uint64_t key;
+        uint32_t size;
+        if (!reader.u64(key) || !reader.u32(size)) {
+            return fail();
+        }
+        auto it = wanted.find(key);
+        if (it == wanted.end()) {
+            if (!reader.skip(size)) {
+                return fail();
+            }
+            continue;
+        }
+        // Several identical functions share a key; fill the first now and
+        // copy into the others below
+        FunctionCode& code = entries_[it->second].code;
+        size_t start = reader.position();
+        uint32_t instruction_count, string_count;
+        if (!reader.u32(instruction_count) || !reader.u32(string_count)) {
+            return fail();
+        }
+        const char* p = reader.take(static_cast<size_t>(instruction_count) * 9);
+        if (!p) {
+            return fail();
+        }
+        code.instructions.clear();
+        code.instructions.reserve(instruction_count);
+        for (uint32_t i = 0; i < instruction_count; i++) {
+            uint8_t opcode = static_cast<uint8_t>(*p);
+            if (opcode >= opcode_count) {
+                return fail();
+            }
+            uint64_t operand = 0;
+            for (int b = 0; b < 8; b++) {
+                operand |= static_cast<uint64_t>(static_cast<uint8_t>(p[1 + b])) << (b * 8);
+            }
+            code.instructions.emplace_back(static_cast<Opcode>(opcode), static_cast<size_t>(operand));
+            p += 9;
+        }
+        code.string_constants.clear();
+        for (uint32_t i = 0; i < string_count; i++) {
+            uint32_t length;
+            std::string str;
+            if (!reader.u32(length) || !reader.text(length, str)) {
+                return fail();
+            }
+            code.string_constants.push_back(std::move(str));
+        }
+        if (reader.position() - start != size) {
+            return fail();
+        }
+        entries_[it->second].hit = true;
+    }
+    if (!reader.at_end()) {
+        return fail();
+    }
+    for (auto& entry : entries_) {
+        size_t first = wanted[entry.key];
+        if (!entry.hit && entries_[first].hit) {
+            entry.code = entries_[first].code;
+            entry.hit = true;
+        }
+    }
+}
+
+} // namespace nust
@@ -5,213 +5,297 @@
 
 namespace nust {
 
-Compiler::Compiler() : next_local_index(0) {}
+Compiler::Compiler() {}
 
 std::vector<Instruction> Compiler::compile(const Program& program) {
+    return compile(program, SignatureIndex(program));
+}
+
+std::vector<Instruction> Compiler::compile(const Program&, const SignatureIndex& signatures) {
     // Reset state
     instructions.clear();
     string_constants.clear();
-    local_vars.clear();
-    next_local_index = 0;
-    function_table = FunctionTable();
-    
-    // First pass: find main and other functions
-    const FunctionDecl* main_func = nullptr;
-    std::vector<const FunctionDecl*> other_funcs;
-    
-    for (const auto& item : program.items) {
-        if (auto func = dynamic_cast<const FunctionDecl*>(item.get())) {
-            if (func->name == "main") {
-                main_func = func;
-            } else {
-                other_funcs.push_back(func);
-            }
-        }
-    }
     
-    if (!main_func) {
+    if (!signatures.has_main()) {
         throw std::runtime_error("No main() function found");
     }
     
-    // Second pass: add functions to table in compilation order (main first)
-    function_table.add_function(*main_func, 0); // Main will be at index 0
-    for (const auto* func : other_funcs) {
-        function_table.add_function(*func, 0); // Other functions follow
-    }
+    // The table follows the index: main at 0, other functions after it
+    function_table = FunctionTable(signatures);
+    signatures_ = &signatures;
     
-    // Third pass: compile functions in the same order
-    size_t main_entry = instructions.size();
-    compile_function(main_func);
-    const_cast<FunctionInfo&>(function_table.get_function(0)).entry_point = main_entry;
+    // Compile functions in the same order
+    if (cache_ || (pool_ && pool_->size() > 1)) {
+        compile_separately(signatures);
+    } else {
+        for (size_t i = 0; i < signatures.size(); i++) {
+            size_t entry_point = instructions.size();
+            compile_function(signatures[i].decl);
+            function_table.set_entry_point(i, entry_point);
+            function_table.set_num_locals(i, signatures[i].decl->num_slots);
+        }
+    }
     
-    for (size_t i = 0; i < other_funcs.size(); i++) {
-        size_t entry_point = instructions.size();
-        compile_function(other_funcs[i]);
-        const_cast<FunctionInfo&>(function_table.get_function(i + 1)).entry_point = entry_point;
+    // Optimization passes
+    for (auto& pass : passes) {
+        pass->run(instructions, function_table);
     }
     
     return instructions;
 }
 
 void Compiler::compile_function(const FunctionDecl* func) {
-    // Reset local variables for new function
-    local_vars.clear();
-    next_local_index = 0;
-    
-    // Add parameters to local variables
-    for (const auto& param : func->params) {
-        local_vars[param.name] = next_local_index++;
-    }
+    // Parameters and locals already have slots from the Resolver
+    size_t entry_point = instructions.size();
     
     // Compile function body
-    compile_statement(func->body.get());
+    compile_statement(func->body);
     
     // If function has no explicit return, add one
-    if (instructions.empty() || instructions.back().opcode != Opcode::RET_VAL) {
+    if (instructions.size() == entry_point || instructions.back().opcode != Opcode::RET_VAL) {
         emit(Instruction{Opcode::RET});
     }
+}
+
+void Compiler::compile_separately(const SignatureIndex& signatures) {
+    // Each function is generated on its own, as if it started at instruction
+    // 0 with no string constants before it, or taken from the cache
+    std::vector<FunctionCode> pieces(signatures.size());
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < signatures.size(); i++) {
+        const FunctionCode* cached = cache_ ? cache_->find(*signatures[i].decl) : nullptr;
+        if (cached) {
+            pieces[i] = *cached;
+        } else {
+            missing.push_back(i);
+        }
+    }
+    
+    std::vector<std::exception_ptr> errors(signatures.size());
+    auto generate = [&](size_t begin, size_t end) {
+        Compiler worker;
+        worker.signatures_ = &signatures;
+        for (size_t m = begin; m < end; m++) {
+            size_t i = missing[m];
+            try {
+                worker.compile_function(signatures[i].decl);
+            } catch (...) {
+                errors[i] = std::current_exception();
+                return;
+            }
+            pieces[i].instructions = std::move(worker.instructions);
+            pieces[i].string_constants = std::move(worker.string_constants);
+            worker.instructions.clear();
+            worker.string_constants.clear();
+        }
+    };
+    if (pool_) {
+        pool_->parallel_for(missing.size(), generate);
+    } else {
+        generate(0, missing.size());
+    }
     
-    // Update number of locals in function table
-    const_cast<FunctionInfo&>(function_table.get_function(
-        function_table.get_function_index(func->name)
-    )).num_locals = next_local_index;
+    // An error surfaces from the first function the serial loop would have
+    // failed on
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    if (cache_) {
+        for (size_t i : missing) {
+            cache_->store(*signatures[i].decl, pieces[i]);
+        }
+    }
+    link(pieces, signatures);
+}
+
+void Compiler::link(const std::vector<FunctionCode>& pieces, const SignatureIndex& signatures) {
+    // Lay functions out in table order: jump targets move by where the
+    // function lands and string operands by the constants before it. Calls
+    // name functions by index, so they stay as they are.
+    size_t total = 0;
+    for (const auto& piece : pieces) {
+        total += piece.instructions.size();
+    }
+    instructions.reserve(total);
+    for (size_t i = 0; i < pieces.size(); i++) {
+        size_t entry_point = instructions.size();
+        size_t first_constant = string_constants.size();
+        for (Instruction instr : pieces[i].instructions) {
+            if (is_jump(instr.opcode)) {
+                instr.operand += entry_point;
+            } else if (instr.opcode == Opcode::PUSH_STR) {
+                instr.operand += first_constant;
+            }
+            instructions.push_back(instr);
+        }
+        string_constants.insert(string_constants.end(), pieces[i].string_constants.begin(),
+                                pieces[i].string_constants.end());
+        function_table.set_entry_point(i, entry_point);
+        function_table.set_num_locals(i, signatures[i].decl->num_slots);
+    }
 }
 
 void Compiler::compile_statement(const Stmt* stmt) {
-    if (auto let = dynamic_cast<const LetStmt*>(stmt)) {
-        compile_let(let);
-    } else if (auto if_stmt = dynamic_cast<const IfStmt*>(stmt)) {
-        compile_if(if_stmt);
-    } else if (auto while_stmt = dynamic_cast<const WhileStmt*>(stmt)) {
-        compile_while(while_stmt);
-    } else if (auto block = dynamic_cast<const BlockStmt*>(stmt)) {
-        compile_block(block);
-    } else if (auto expr = dynamic_cast<const ExprStmt*>(stmt)) {
-        compile_expression(expr->expr.get());
-        // Pop the result if it's not used
-        emit(Instruction{Opcode::POP});
-    } else if (auto ret = dynamic_cast<const ReturnStmt*>(stmt)) {
-        if (ret->value) {
-            // Compile the return value expression
-            compile_expression(ret->value.get());
-            // Return with the value on top of the stack
-            emit(Instruction{Opcode::RET_VAL});
-        } else {
-            // Empty return statement
-            emit(Instruction{Opcode::RET});
+    switch (stmt->kind) {
+        case NodeKind::LetStmt:
+            compile_let(static_cast<const LetStmt*>(stmt));
+            break;
+        case NodeKind::IfStmt:
+            compile_if(static_cast<const IfStmt*>(stmt));
+            break;
+        case NodeKind::WhileStmt:
+            compile_while(static_cast<const WhileStmt*>(stmt));
+            break;
+        case NodeKind::BlockStmt:
+            compile_block(static_cast<const BlockStmt*>(stmt));
+            break;
+        case NodeKind::ExprStmt:
+            compile_expression(static_cast<const ExprStmt*>(stmt)->expr);
+            // Pop the result if it's not used
+            emit(Instruction{Opcode::POP});
+            break;
+        case NodeKind::ReturnStmt: {
+            auto* ret = static_cast<const ReturnStmt*>(stmt);
+            if (ret->value) {
+                // Compile the return value expression
+                compile_expression(ret->value);
+                // Return with the value on top of the stack
+                emit(Instruction{Opcode::RET_VAL});
+            } else {
+                // Empty return statement
+                emit(Instruction{Opcode::RET});
+            }
+            break;
         }
+        default:
+            break;
     }
 }
 
 void Compiler::compile_let(const LetStmt* stmt) {
     // Compile initializer expression
-    compile_expression(stmt->init.get());
-    
-    // Add variable to local variables if not already present
-    if (local_vars.find(stmt->name) == local_vars.end()) {
-        local_vars[stmt->name] = next_local_index++;
-    }
+    compile_expression(stmt->init);
     
     // Store in local variable
-    size_t index = get_local_index(stmt->name);
-    emit(Instruction{Opcode::STORE, index});
+    emit(Instruction{Opcode::STORE, stmt->slot});
 }
 
 void Compiler::compile_expression(const Expr* expr) {
-    if (auto binary = dynamic_cast<const BinaryExpr*>(expr)) {
+    switch (expr->kind) {
+        case NodeKind::BinaryExpr:
+            compile_binary(static_cast<const BinaryExpr*>(expr));
+            break;
+        case NodeKind::UnaryExpr:
+            compile_unary(static_cast<const UnaryExpr*>(expr));
+            break;
+        case NodeKind::IntLiteral:
+            emit(Instruction{Opcode::PUSH_I32, static_cast<size_t>(static_cast<const IntLiteral*>(expr)->value)});
+            break;
+        case NodeKind::BoolLiteral:
+            emit(Instruction{Opcode::PUSH_BOOL, static_cast<size_t>(static_cast<const BoolLiteral*>(expr)->value)});
+            break;
+        case NodeKind::StringLiteral: {
+            size_t index = string_constants.size();
+            string_constants.push_back(static_cast<const StringLiteral*>(expr)->value);
+            emit(Instruction{Opcode::PUSH_STR, index});
+            break;
+        }
+        case NodeKind::Identifier:
+            compile_identifier(static_cast<const Identifier*>(expr));
+            break;
+        case NodeKind::CallExpr:
+            compile_call(static_cast<const CallExpr*>(expr));
+            break;
+        case NodeKind::BorrowExpr:
+            compile_borrow(static_cast<const BorrowExpr*>(expr));
+            break;
+        default:
+            break;
+    }
+}
+
+void Compiler::compile_binary(const BinaryExpr* expr) {
+    // Handle assignment
+    if (expr->op == BinaryExpr::Op::Assignment) {
+        // Compile the right-hand side first
+        compile_expression(expr->right);
         
-        // Handle assignment
-        if (binary->op == BinaryExpr::Op::Assignment) {
-            // Compile the right-hand side first
-            compile_expression(binary->right.get());
-            
-            // Get the target variable
-            auto* target = dynamic_cast<const Identifier*>(binary->left.get());
-            if (!target) {
-                throw std::runtime_error("Assignment target must be an identifier");
-            }
-            
-            // Store in the target variable
-            size_t index = get_local_index(target->name);
-            emit(Instruction{Opcode::STORE, index});
-            
-            // Load the value back for use in expressions
-            emit(Instruction{Opcode::LOAD, index});
-            return;
+        // Get the target variable
+        auto* target = node_cast<Identifier>(expr->left);
+        if (!target) {
+            throw std::runtime_error("Assignment target must be an identifier");
         }
         
-        compile_expression(binary->left.get());
-        compile_expression(binary->right.get());
+        // Store in the target variable
+        size_t index = get_local_index(target);
+        emit(Instruction{Opcode::STORE, index});
         
-        switch (binary->op) {
-            case BinaryExpr::Op::Add:
-                emit(Instruction{Opcode::ADD_I32});
-                break;
-            case BinaryExpr::Op::Sub:
-                emit(Instruction{Opcode::SUB_I32});
-                break;
-            case BinaryExpr::Op::Mul:
-                emit(Instruction{Opcode::MUL_I32});
-                break;
-            case BinaryExpr::Op::Div:
-                emit(Instruction{Opcode::DIV_I32});
-                break;
-            case BinaryExpr::Op::Eq:
-                emit(Instruction{Opcode::EQ_I32});
-                break;
-            case BinaryExpr::Op::Ne:
-                emit(Instruction{Opcode::NE_I32});
-                break;
-            case BinaryExpr::Op::Lt:
-                emit(Instruction{Opcode::LT_I32});
-                break;
-            case BinaryExpr::Op::Gt:
-                emit(Instruction{Opcode::GT_I32});
-                break;
-            case BinaryExpr::Op::Le:
-                emit(Instruction{Opcode::LE_I32});
-                break;
-            case BinaryExpr::Op::Ge:
-                emit(Instruction{Opcode::GE_I32});
-                break;
-            case BinaryExpr::Op::And:
-                emit(Instruction{Opcode::AND});
-                break;
-            case BinaryExpr::Op::Or:
-                emit(Instruction{Opcode::OR});
-                break;
-            default:
-                throw std::runtime_error("Unknown binary operator");
-        }
-    } else if (auto unary = dynamic_cast<const UnaryExpr*>(expr)) {
-        compile_expression(unary->expr.get());
-        switch (unary->op) {
-            case UnaryExpr::Op::Neg:
-                emit(Instruction{Opcode::NEG_I32});
-                break;
-            case UnaryExpr::Op::Not:
-                emit(Instruction{Opcode::NOT});
-                break;
-        }
-    } else if (auto int_lit = dynamic_cast<const IntLiteral*>(expr)) {
-        emit(Instruction{Opcode::PUSH_I32, static_cast<size_t>(int_lit->value)});
-    } else if (auto bool_lit = dynamic_cast<const BoolLiteral*>(expr)) {
-        emit(Instruction{Opcode::PUSH_BOOL, static_cast<size_t>(bool_lit->value)});
-    } else if (auto str_lit = dynamic_cast<const StringLiteral*>(expr)) {
-        size_t index = string_constants.size();
-        string_constants.push_back(str_lit->value);
-        emit(Instruction{Opcode::PUSH_STR, index});
-    } else if (auto ident = dynamic_cast<const Identifier*>(expr)) {
-        compile_identifier(ident);
-    } else if (auto call = dynamic_cast<const CallExpr*>(expr)) {
-        compile_call(call);
-    } else if (auto borrow = dynamic_cast<const BorrowExpr*>(expr)) {
-        compile_borrow(borrow);
+        // Load the value back for use in expressions
+        emit(Instruction{Opcode::LOAD, index});
+        return;
+    }
+    
+    compile_expression(expr->left);
+    compile_expression(expr->right);
+    
+    switch (expr->op) {
+        case BinaryExpr::Op::Add:
+            emit(Instruction{Opcode::ADD_I32});
+            break;
+        case BinaryExpr::Op::Sub:
+            emit(Instruction{Opcode::SUB_I32});
+            break;
+        case BinaryExpr::Op::Mul:
+            emit(Instruction{Opcode::MUL_I32});
+            break;
+        case BinaryExpr::Op::Div:
+            emit(Instruction{Opcode::DIV_I32});
+            break;
+        case BinaryExpr::Op::Eq:
+            emit(Instruction{Opcode::EQ_I32});
+            break;
+        case BinaryExpr::Op::Ne:
+            emit(Instruction{Opcode::NE_I32});
+            break;
+        case BinaryExpr::Op::Lt:
+            emit(Instruction{Opcode::LT_I32});
+            break;
+        case BinaryExpr::Op::Gt:
+            emit(Instruction{Opcode::GT_I32});
+            break;
+        case BinaryExpr::Op::Le:
+            emit(Instruction{Opcode::LE_I32});
+            break;
+        case BinaryExpr::Op::Ge:
+            emit(Instruction{Opcode::GE_I32});
+            break;
+        case BinaryExpr::Op::And:
+            emit(Instruction{Opcode::AND});
+            break;
+        case BinaryExpr::Op::Or:
+            emit(Instruction{Opcode::OR});
+            break;
+        default:
+            throw std::runtime_error("Unknown binary operator");
+    }
+}
+
+void Compiler::compile_unary(const UnaryExpr* expr) {
+    compile_expression(expr->expr);
+    switch (expr->op) {
+        case UnaryExpr::Op::Neg:
+            emit(Instruction{Opcode::NEG_I32});
+            break;
+        case UnaryExpr::Op::Not:
+            emit(Instruction{Opcode::NOT});
+            break;
     }
 }
 
 void Compiler::compile_identifier(const Identifier* ident) {
-    size_t index = get_local_index(ident->name);
+    size_t index = get_local_index(ident);
     emit(Instruction{Opcode::LOAD, index});
     
     // If the identifier is a reference, automatically dereference it
@@ -221,24 +305,28 @@ void Compiler::compile_identifier(const Identifier* ident) {
 }
 
 void Compiler::compile_call(const CallExpr* expr) {
-    // Compile arguments in reverse order
-    for (auto it = expr->args.rbegin(); it != expr->args.rend(); ++it) {
-        compile_expression((*it).get());
+    // Compile arguments left to right; they become the callee's parameter
+    // slots in the order they were pushed
+    for (const auto& arg : expr->args) {
+        compile_expression(arg);
     }
     
-    // Get function index from the function table
-    auto* callee = dynamic_cast<const Identifier*>(expr->callee.get());
+    // Functions are numbered in signature order, as in the function table
+    auto* callee = node_cast<Identifier>(expr->callee);
     if (!callee) {
         throw std::runtime_error("Function callee must be an identifier");
     }
-    size_t func_index = function_table.get_function_index(callee->name);
+    const FunctionSignature* signature = signatures_->find(callee->name);
+    if (!signature) {
+        throw std::runtime_error("Function not found: " + callee->name.str());
+    }
     
     // Call function
-    emit(Instruction{Opcode::CALL, func_index});
+    emit(Instruction{Opcode::CALL, signatures_->index_of(*signature)});
 }
 
 void Compiler::compile_borrow(const BorrowExpr* expr) {
-    compile_expression(expr->expr.get());
+    compile_expression(expr->expr);
     
     if (expr->is_mut) {
         emit(Instruction{Opcode::BORROW_MUT});
@@ -249,13 +337,13 @@ void Compiler::compile_borrow(const BorrowExpr* expr) {
 
 void Compiler::compile_if(const IfStmt* if_stmt) {
     // Compile condition
-    compile_expression(if_stmt->condition.get());
+    compile_expression(if_stmt->condition);
     
     // Emit conditional jump
     size_t else_jump = emit_instruction(Opcode::JMP_IF_NOT, 0);
     
     // Compile then branch
-    compile_statement(if_stmt->then_branch.get());
+    compile_statement(if_stmt->then_branch);
     
     // If there's an else branch, emit jump to skip it
     size_t end_jump = 0;
@@ -268,7 +356,7 @@ void Compiler::compile_if(const IfStmt* if_stmt) {
     
     // Compile else branch if present
     if (if_stmt->else_branch) {
-        compile_statement(if_stmt->else_branch.get());
+        compile_statement(if_stmt->else_branch);
         // Update end jump offset
         instructions[end_jump].operand = instructions.size();
     }
@@ -279,14 +367,14 @@ void Compiler::compile_while(const WhileStmt* while_stmt) {
     size_t loop_start = instructions.size();
     
     // Compile condition
-    compile_expression(while_stmt->condition.get());
+    compile_expression(while_stmt->condition);
     
     // Emit conditional jump
     size_t exit_jump = emit_instruction(Opcode::JMP_IF_NOT, 0);
     
     
     // Compile body
-    compile_statement(while_stmt->body.get());
+    compile_statement(while_stmt->body);
     
     // Emit jump back to condition
     emit_instruction(Opcode::JMP, loop_start);
@@ -297,7 +385,7 @@ void Compiler::compile_while(const WhileStmt* while_stmt) {
 
 void Compiler::compile_block(const BlockStmt* block) {
     for (const auto& stmt : block->statements) {
-        compile_statement(stmt.get());
+        compile_statement(stmt);
     }
 }
 
@@ -316,12 +404,11 @@ size_t Compiler::add_constant(const std::string& str) {
     return string_constants.size() - 1;
 }
 
-size_t Compiler::get_local_index(const std::string& name) {
-    auto it = local_vars.find(name);
-    if (it == local_vars.end()) {
-        throw std::runtime_error("Undefined variable: " + name);
+size_t Compiler::get_local_index(const Identifier* ident) {
+    if (ident->resolution != Resolution::Local) {
+        throw std::runtime_error("Undefined variable: " + ident->name.str());
     }
-    return it->second;
+    return ident->slot;
 }
 
 } // namespace nust 
\ No newline at end of file
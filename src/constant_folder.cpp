@@ -0,0 +1,188 @@
+#include "constant_folder.h"
+#include "value.h"
+#include <cstdint>
+
+namespace nust {
+
+void ConstantFolder::fold_program(Program& program) {
+    folded_ = 0;
+    arena_ = &program.arena();
+    for (auto& item : program.items) {
+        if (auto func = node_cast<FunctionDecl>(item)) {
+            fold_function(*func);
+        }
+    }
+}
+
+void ConstantFolder::fold_function(FunctionDecl& func) {
+    // Parameters are never constant
+    constants_.assign(func.num_bindings, std::nullopt);
+    if (func.body) {
+        fold_statement(*func.body);
+    }
+}
+
+void ConstantFolder::fold_statement(Stmt& stmt) {
+    if (auto let = node_cast<LetStmt>(&stmt)) {
+        if (let->init) {
+            fold_expression(let->init);
+        }
+        // Only immutable bindings of a plain value can be propagated
+        std::optional<Constant> value;
+        if (!let->is_mut && let->init && !let->type->is_reference()) {
+            value = constant_of(*let->init);
+        }
+        constants_[let->binding] = value;
+    }
+    else if (auto expr_stmt = node_cast<ExprStmt>(&stmt)) {
+        fold_expression(expr_stmt->expr);
+    }
+    else if (auto ret = node_cast<ReturnStmt>(&stmt)) {
+        if (ret->value) {
+            fold_expression(ret->value);
+        }
+    }
+    else if (auto if_stmt = node_cast<IfStmt>(&stmt)) {
+        fold_expression(if_stmt->condition);
+        fold_statement(*if_stmt->then_branch);
+        if (if_stmt->else_branch) {
+            fold_statement(*if_stmt->else_branch);
+        }
+    }
+    else if (auto while_stmt = node_cast<WhileStmt>(&stmt)) {
+        fold_expression(while_stmt->condition);
+        fold_statement(*while_stmt->body);
+    }
+    else if (auto block = node_cast<BlockStmt>(&stmt)) {
+        for (auto& inner : block->statements) {
+            fold_statement(*inner);
+        }
+    }
+}
+
+void ConstantFolder::fold_expression(Expr*& expr) {
+    if (auto ident = node_cast<Identifier>(expr)) {
+        if (ident->resolution == Resolution::Local) {
+            if (auto value = constants_[ident->binding]) {
+                replace(expr, *value);
+            }
+        }
+    }
+    else if (auto binary = node_cast<BinaryExpr>(expr)) {
+        if (binary->op == BinaryExpr::Op::Assignment) {
+            // The target stays a variable
+            fold_expression(binary->right);
+            return;
+        }
+        fold_expression(binary->left);
+        fold_expression(binary->right);
+        auto lhs = constant_of(*binary->left);
+        auto rhs = constant_of(*binary->right);
+        if (lhs && rhs) {
+            if (auto value = evaluate(binary->op, *lhs, *rhs)) {
+                replace(expr, *value);
+            }
+        }
+    }
+    else if (auto unary = node_cast<UnaryExpr>(expr)) {
+        fold_expression(unary->expr);
+        if (auto operand = constant_of(*unary->expr)) {
+            if (auto value = evaluate(unary->op, *operand)) {
+                replace(expr, *value);
+            }
+        }
+    }
+    else if (auto call = node_cast<CallExpr>(expr)) {
+        for (auto& arg : call->args) {
+            fold_expression(arg);
+        }
+    }
+    else if (auto borrow = node_cast<BorrowExpr>(expr)) {
+        // A borrowed variable must stay a variable
+        if (!node_cast<Identifier>(borrow->expr)) {
+            fold_expression(borrow->expr);
+        }
+    }
+}
+
+std::optional<ConstantFolder::Constant> ConstantFolder::constant_of(const Expr& expr) {
+    if (auto int_lit = node_cast<IntLiteral>(&expr)) {
+        return Constant{false, static_cast<int32_t>(int_lit->value)};
+    }
+    if (auto bool_lit = node_cast<BoolLiteral>(&expr)) {
+        return Constant{true, bool_lit->value ? 1 : 0};
+    }
+    return std::nullopt;
+}
+
+std::optional<ConstantFolder::Constant> ConstantFolder::evaluate(BinaryExpr::Op op, Constant lhs,
+                                                                 Constant rhs) {
+    // Arithmetic wraps exactly as it does at runtime
+    auto integer = [](int32_t v) { return Constant{false, v}; };
+    auto boolean = [](bool v) { return Constant{true, v ? 1 : 0}; };
+
+    if (lhs.is_bool != rhs.is_bool) {
+        return std::nullopt;
+    }
+    if (lhs.is_bool) {
+        switch (op) {
+            case BinaryExpr::Op::And: return boolean(lhs.value && rhs.value);
+            case BinaryExpr::Op::Or: return boolean(lhs.value || rhs.value);
+            // == and != compile to the integer comparisons, which reject
+            // bools at runtime
+            default: return std::nullopt;
+        }
+    }
+
+    switch (op) {
+        case BinaryExpr::Op::Add: return integer(add_i32(lhs.value, rhs.value));
+        case BinaryExpr::Op::Sub: return integer(sub_i32(lhs.value, rhs.value));
+        case BinaryExpr::Op::Mul: return integer(mul_i32(lhs.value, rhs.value));
+        case BinaryExpr::Op::Div:
+            // Leave runtime errors to the runtime
+            if (rhs.value == 0) {
+                return std::nullopt;
+            }
+            return integer(divide_i32(lhs.value, rhs.value));
+        case BinaryExpr::Op::Eq: return boolean(lhs.value == rhs.value);
+        case BinaryExpr::Op::Ne: return boolean(lhs.value != rhs.value);
+        case BinaryExpr::Op::Lt: return boolean(lhs.value < rhs.value);
+        case BinaryExpr::Op::Gt: return boolean(lhs.value > rhs.value);
+        case BinaryExpr::Op::Le: return boolean(lhs.value <= rhs.value);
+        case BinaryExpr::Op::Ge: return boolean(lhs.value >= rhs.value);
+        default: return std::nullopt;
+    }
+}
+
+std::optional<ConstantFolder::Constant> ConstantFolder::evaluate(UnaryExpr::Op op, Constant operand) {
+    switch (op) {
+        case UnaryExpr::Op::Neg:
+            if (operand.is_bool) {
+                return std::nullopt;
+            }
+            return Constant{false, neg_i32(operand.value)};
+        case UnaryExpr::Op::Not:
+            if (!operand.is_bool) {
+                return std::nullopt;
+            }
+            return Constant{true, operand.value ? 0 : 1};
+    }
+    return std::nullopt;
+}
+
+void ConstantFolder::replace(Expr*& expr, Constant value) {
+    Expr* literal;
+    if (value.is_bool) {
+        literal = arena_->make<BoolLiteral>(expr->span, value.value != 0);
+    } else {
+        literal = arena_->make<IntLiteral>(expr->span, value.value);
+    }
+    // Keep the type the checker assigned, for later passes
+    if (expr->type) {
+        literal->type = expr->type;
+    }
+    expr = literal;
+    folded_++;
+}
+
+} // namespace nust
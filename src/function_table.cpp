@@ -5,22 +5,42 @@ namespace nust {
 
 FunctionTable::FunctionTable() {}
 
+FunctionTable::FunctionTable(const SignatureIndex& signatures) {
+    functions.reserve(signatures.size());
+    name_to_index.reserve(signatures.size());
+    for (const auto& signature : signatures) {
+        add_function(signature, 0);
+    }
+}
+
 size_t FunctionTable::add_function(const FunctionDecl& func, size_t entry_point) {
+    std::vector<const Type*> param_types;
+    for (const auto& param : func.params) {
+        param_types.push_back(param.type);
+    }
+    return add_function(FunctionSignature{func.name, &func, std::move(param_types), func.return_type},
+                        entry_point);
+}
+
+size_t FunctionTable::add_function(const FunctionSignature& signature, size_t entry_point) {
     FunctionInfo info;
     info.entry_point = entry_point;
-    info.num_params = func.params.size();
+    info.num_params = signature.param_types.size();
     info.num_locals = 0; // Will be updated during compilation
-    info.return_type = func.return_type->clone();
-    info.name = func.name;
-    
-    // Copy parameter types
-    for (const auto& param : func.params) {
-        info.param_types.push_back(param.type->clone());
-    }
+    info.return_type = signature.return_type;
+    info.name = signature.name.str();
+    info.param_types = signature.param_types;
     
     size_t index = functions.size();
     functions.push_back(std::move(info));
-    name_to_index[func.name] = index;
+    name_to_index[signature.name] = index;
+    return index;
+}
+
+size_t FunctionTable::add_function(FunctionInfo info) {
+    size_t index = functions.size();
+    name_to_index[info.name] = index;
+    functions.push_back(std::move(info));
     return index;
 }
 
@@ -31,10 +51,24 @@ const FunctionInfo& FunctionTable::get_function(size_t index) const {
     return functions[index];
 }
 
-size_t FunctionTable::get_function_index(const std::string& name) const {
+void FunctionTable::set_entry_point(size_t index, size_t entry_point) {
+    if (index >= functions.size()) {
+        throw std::runtime_error("Invalid function index");
+    }
+    functions[index].entry_point = entry_point;
+}
+
+void FunctionTable::set_num_locals(size_t index, size_t num_locals) {
+    if (index >= functions.size()) {
+        throw std::runtime_error("Invalid function index");
+    }
+    functions[index].num_locals = num_locals;
+}
+
+size_t FunctionTable::get_function_index(Symbol name) const {
     auto it = name_to_index.find(name);
     if (it == name_to_index.end()) {
-        throw std::runtime_error("Function not found: " + name);
+        throw std::runtime_error("Function not found: " + name.str());
     }
     return it->second;
 }
@@ -0,0 +1,66 @@
+#include "isolate.h"
+#include <stdexcept>
+
+namespace nust {
+
+Isolate::Isolate(std::shared_ptr<const Module> module, IsolateConfig config)
+    : module_(module)
+    , vm_(std::move(module), config.stack)
+{
+    if (config.jit) {
+        vm_.enable_jit(config.jit_threshold);
+    }
+}
+
+Value Isolate::call(std::string_view name, const std::vector<Value>& args) {
+    return call(module_->function_index(name), args);
+}
+
+Value Isolate::call(size_t index, const std::vector<Value>& args) {
+    check_arguments(module_->function_table().get_function(index), args);
+    return vm_.call(index, args);
+}
+
+Value Isolate::string(std::string_view str) {
+    return Value(strings_.allocate(str));
+}
+
+void Isolate::reset() {
+    vm_.reset();
+    strings_.clear();
+}
+
+void Isolate::check_arguments(const FunctionInfo& func_info, const std::vector<Value>& args) const {
+    if (args.size() != func_info.num_params) {
+        throw std::runtime_error(func_info.name + " takes " + std::to_string(func_info.num_params) +
+                                 " arguments, got " + std::to_string(args.size()));
+    }
+    // Verified code trusts its parameters' types, so they're checked here
+    for (size_t i = 0; i < args.size(); i++) {
+        bool matches = false;
+        const char* expected = "";
+        switch (func_info.param_types[i]->kind) {
+            case Type::Kind::I32:
+                matches = args[i].is_int();
+                expected = "i32";
+                break;
+            case Type::Kind::Bool:
+                matches = args[i].is_bool();
+                expected = "bool";
+                break;
+            case Type::Kind::Str:
+                matches = args[i].is_string();
+                expected = "str";
+                break;
+            case Type::Kind::Ref:
+            case Type::Kind::MutRef:
+                throw std::runtime_error(func_info.name + " takes a reference and can't be called from outside");
+        }
+        if (!matches) {
+            throw std::runtime_error("Argument " + std::to_string(i + 1) + " of " + func_info.name +
+                                     " should be " + expected);
+        }
+    }
+}
+
+} // namespace nust
@@ -0,0 +1,509 @@
+#include "jit.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef NUST_HAVE_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace nust {
+
+namespace {
+
+// Native stack the compiled code may use below the frame of call();
+// deeper recursion bails out to the interpreter
+constexpr uintptr_t native_stack_budget = 256 * 1024;
+
+// Enters native code: args (rdi), arg count (rsi), function (rdx), result
+// (rcx), stack limit (r8). Returns 0, or 1 if the code bailed out.
+using Thunk = uint32_t (*)(const uint64_t* args, size_t count, const void* function,
+                           uint64_t* result, uintptr_t stack_limit);
+
+// Appends x86-64 machine code
+class Assembler {
+public:
+    void emit(std::initializer_list<uint8_t> bytes) {
+        code_.insert(code_.end(), bytes);
+    }
+
+    void emit32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            code_.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    void emit64(uint64_t value) {
+        emit32(static_cast<uint32_t>(value));
+        emit32(static_cast<uint32_t>(value >> 32));
+    }
+
+    // Point the rel32 field at `at` to `target`
+    void patch(size_t at, size_t target) {
+        uint32_t rel = static_cast<uint32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+        for (int i = 0; i < 4; ++i) {
+            code_[at + i] = static_cast<uint8_t>(rel >> (i * 8));
+        }
+    }
+
+    // Emit a jump or jcc opcode with a rel32 field to patch later; returns
+    // the field's position
+    size_t jump(std::initializer_list<uint8_t> opcode) {
+        emit(opcode);
+        size_t at = code_.size();
+        emit32(0);
+        return at;
+    }
+
+    size_t size() const { return code_.size(); }
+    const std::vector<uint8_t>& code() const { return code_; }
+
+private:
+    std::vector<uint8_t> code_;
+};
+
+// Restores the thunk's stack and callee-saved registers and returns to C++
+void emit_thunk_exit(Assembler& as) {
+    as.emit({0x4C, 0x89, 0xE4});        // mov rsp, r12
+    as.emit({0x41, 0x5E});              // pop r14
+    as.emit({0x41, 0x5D});              // pop r13
+    as.emit({0x41, 0x5C});              // pop r12
+    as.emit({0x5D});                    // pop rbp
+    as.emit({0xC3});                    // ret
+}
+
+// Compiled code keeps r12 (the thunk's stack pointer), r13 (result
+// pointer) and r14 (stack limit) intact and only uses rax, rcx and rdx
+std::vector<uint8_t> assemble_thunk() {
+    Assembler as;
+    as.emit({0x55});                    // push rbp
+    as.emit({0x48, 0x89, 0xE5});        // mov rbp, rsp
+    as.emit({0x41, 0x54});              // push r12
+    as.emit({0x41, 0x55});              // push r13
+    as.emit({0x41, 0x56});              // push r14
+    as.emit({0x49, 0x89, 0xE4});        // mov r12, rsp
+    as.emit({0x49, 0x89, 0xCD});        // mov r13, rcx
+    as.emit({0x4D, 0x89, 0xC6});        // mov r14, r8
+    as.emit({0x31, 0xC0});              // xor eax, eax
+    // Push the arguments, first one first
+    as.emit({0x48, 0x39, 0xF0});        // loop: cmp rax, rsi
+    as.emit({0x73, 0x08});              // jae call
+    as.emit({0xFF, 0x34, 0xC7});        // push qword [rdi + rax*8]
+    as.emit({0x48, 0xFF, 0xC0});        // inc rax
+    as.emit({0xEB, 0xF3});              // jmp loop
+    as.emit({0xFF, 0xD2});              // call: call rdx
+    as.emit({0x49, 0x89, 0x45, 0x00});  // mov [r13], rax
+    as.emit({0x31, 0xC0});              // xor eax, eax
+    emit_thunk_exit(as);
+    return as.code();
+}
+
+bool is_scalar(const Type* type) {
+    return type && (type->kind == Type::Kind::I32 || type->kind == Type::Kind::Bool);
+}
+
+uint64_t int_bits(uint32_t value) {
+    return Value(static_cast<Value::IntType>(value)).bits();
+}
+
+// rbp-relative displacement of a local slot. Parameters are the caller's
+// pushed arguments above the return address; other locals are pushed by
+// the prologue below rbp.
+int32_t slot_displacement(size_t slot, size_t num_params) {
+    if (slot < num_params) {
+        return static_cast<int32_t>(16 + 8 * (num_params - 1 - slot));
+    }
+    return -static_cast<int32_t>(8 * (slot - num_params + 1));
+}
+
+// Condition code (low nibble of setcc/jcc) of a comparison opcode, or of
+// the comparison fused into a CMP_*_JMP_IF_NOT
+uint8_t condition(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::EQ_I32: case Opcode::CMP_EQ_JMP_IF_NOT: return 0x4;  // e
+        case Opcode::NE_I32: case Opcode::CMP_NE_JMP_IF_NOT: return 0x5;  // ne
+        case Opcode::LT_I32: case Opcode::CMP_LT_JMP_IF_NOT: return 0xC;  // l
+        case Opcode::GE_I32: case Opcode::CMP_GE_JMP_IF_NOT: return 0xD;  // ge
+        case Opcode::LE_I32: case Opcode::CMP_LE_JMP_IF_NOT: return 0xE;  // le
+        case Opcode::GT_I32: case Opcode::CMP_GT_JMP_IF_NOT: return 0xF;  // g
+        default: return 0;
+    }
+}
+
+} // namespace
+
+JitCompiler::JitCompiler(const FunctionTable& function_table, const PackedCode& code)
+    : function_table_(function_table)
+    , code_(code.data())
+    , entry_offsets_(code.entry_offsets())
+    , states_(function_table.size(), State::Pending)
+    , entries_(function_table.size(), nullptr)
+{
+    // Each function owns the bytes from its entry point up to the next one
+    std::vector<size_t> starts(entry_offsets_);
+    std::sort(starts.begin(), starts.end());
+    for (size_t entry : entry_offsets_) {
+        auto next = std::upper_bound(starts.begin(), starts.end(), entry);
+        end_offsets_.push_back(next == starts.end() ? code.size() : *next);
+    }
+    if (available()) {
+        thunk_ = install(assemble_thunk());
+    }
+}
+
+JitCompiler::~JitCompiler() {
+#ifdef NUST_HAVE_JIT
+    for (const auto& region : regions_) {
+        ::munmap(region.address, region.size);
+    }
+#endif
+}
+
+bool JitCompiler::available() {
+#ifdef NUST_HAVE_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t JitCompiler::compiled_count() const {
+    return std::count(states_.begin(), states_.end(), State::Compiled);
+}
+
+const void* JitCompiler::install(const std::vector<uint8_t>& code) {
+#ifdef NUST_HAVE_JIT
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t size = (code.size() + page - 1) / page * page;
+    void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(address, code.data(), code.size());
+    if (::mprotect(address, size, PROT_READ | PROT_EXEC) != 0) {
+        ::munmap(address, size);
+        return nullptr;
+    }
+    regions_.push_back({address, size});
+    return address;
+#else
+    (void)code;
+    return nullptr;
+#endif
+}
+
+// Decode a function and check that the JIT supports it
+bool JitCompiler::decode(size_t index, Decoded& decoded) const {
+    const auto& func = function_table_.get_function(index);
+    if (!is_scalar(func.return_type)) {
+        return false;
+    }
+    for (const auto& type : func.param_types) {
+        if (!is_scalar(type)) {
+            return false;
+        }
+    }
+    if (func.param_types.size() != func.num_params) {
+        return false;
+    }
+
+    bool returns_value = false;
+    size_t pc = entry_offsets_[index];
+    const size_t end = end_offsets_[index];
+    while (pc < end) {
+        if (code_[pc] >= opcode_count) {
+            return false;
+        }
+        decoded.offsets.push_back(pc);
+        Instruction instr = read_instruction(code_, pc);
+        switch (instr.opcode) {
+            case Opcode::PUSH_STR:
+            case Opcode::LOAD_REF:
+            case Opcode::STORE_REF:
+            case Opcode::BORROW:
+            case Opcode::BORROW_MUT:
+            case Opcode::DEREF:
+            case Opcode::DEREF_MUT:
+            case Opcode::RET:
+                return false;
+            case Opcode::CALL:
+                if (instr.operand >= function_table_.size()) {
+                    return false;
+                }
+                break;
+            case Opcode::RET_VAL:
+                returns_value = true;
+                break;
+            default:
+                break;
+        }
+        decoded.instructions.push_back(instr);
+    }
+    return returns_value && pc == end;
+}
+
+bool JitCompiler::compile(size_t index) {
+    if (states_[index] != State::Pending) {
+        return states_[index] == State::Compiled;
+    }
+    if (!thunk_) {
+        states_[index] = State::Unsupported;
+        return false;
+    }
+
+    // Gather the pending functions reachable from this one; a single
+    // unsupported function rules out the caller
+    std::vector<size_t> group;
+    std::unordered_map<size_t, Decoded> decoded;
+    std::vector<size_t> worklist = {index};
+    while (!worklist.empty()) {
+        size_t f = worklist.back();
+        worklist.pop_back();
+        if (decoded.count(f) || states_[f] == State::Compiled) {
+            continue;
+        }
+        if (states_[f] == State::Unsupported || !decode(f, decoded[f])) {
+            states_[f] = State::Unsupported;
+            states_[index] = State::Unsupported;
+            return false;
+        }
+        group.push_back(f);
+        for (const auto& instr : decoded[f].instructions) {
+            if (instr.opcode == Opcode::CALL) {
+                worklist.push_back(instr.operand);
+            }
+        }
+    }
+
+    Assembler as;
+    std::vector<size_t> starts;
+    std::vector<size_t> bail_sites;
+    for (size_t f : group) {
+        const auto& func = function_table_.get_function(f);
+        const Decoded& body = decoded[f];
+        const size_t num_params = func.num_params;
+        auto local = [&](size_t slot) {
+            return static_cast<uint32_t>(slot_displacement(slot, num_params));
+        };
+        starts.push_back(as.size());
+
+        // Prologue: bail out if the native stack budget is used up, then
+        // zero the locals that aren't parameters
+        as.emit({0x55});                                // push rbp
+        as.emit({0x48, 0x89, 0xE5});                    // mov rbp, rsp
+        as.emit({0x4C, 0x39, 0xF4});                    // cmp rsp, r14
+        bail_sites.push_back(as.jump({0x0F, 0x82}));    // jb bail
+        for (size_t i = num_params; i < std::max(func.num_locals, num_params); ++i) {
+            as.emit({0x6A, 0x00});                      // push 0
+        }
+
+        std::unordered_map<size_t, size_t> labels;      // Byte offset -> native position
+        std::vector<std::pair<size_t, size_t>> jumps;   // rel32 field, target byte offset
+        for (size_t i = 0; i < body.instructions.size(); ++i) {
+            const Instruction& instr = body.instructions[i];
+            labels[body.offsets[i]] = as.size();
+            switch (instr.opcode) {
+                case Opcode::PUSH_I32:
+                    as.emit({0x48, 0xB8});              // mov rax, imm64
+                    as.emit64(int_bits(static_cast<uint32_t>(instr.operand)));
+                    as.emit({0x50});                    // push rax
+                    break;
+                case Opcode::PUSH_BOOL:
+                    as.emit({0x48, 0xB8});              // mov rax, imm64
+                    as.emit64(Value(instr.operand != 0).bits());
+                    as.emit({0x50});                    // push rax
+                    break;
+                case Opcode::POP:
+                    as.emit({0x48, 0x83, 0xC4, 0x08});  // add rsp, 8
+                    break;
+                case Opcode::DUP:
+                    as.emit({0xFF, 0x34, 0x24});        // push qword [rsp]
+                    break;
+                case Opcode::SWAP:
+                    as.emit({0x58, 0x59, 0x50, 0x51});  // pop rax; pop rcx; push rax; push rcx
+                    break;
+                case Opcode::LOAD:
+                    as.emit({0xFF, 0xB5});              // push qword [rbp + disp32]
+                    as.emit32(local(instr.operand));
+                    break;
+                case Opcode::STORE:
+                    as.emit({0x8F, 0x85});              // pop qword [rbp + disp32]
+                    as.emit32(local(instr.operand));
+                    break;
+                // Integer payloads sit in the high 32 bits over a zero tag,
+                // so 64-bit add, sub and neg wrap exactly like i32
+                case Opcode::ADD_I32:
+                    as.emit({0x59});                    // pop rcx
+                    as.emit({0x48, 0x01, 0x0C, 0x24});  // add [rsp], rcx
+                    break;
+                case Opcode::SUB_I32:
+                    as.emit({0x59});                    // pop rcx
+                    as.emit({0x48, 0x29, 0x0C, 0x24});  // sub [rsp], rcx
+                    break;
+                case Opcode::MUL_I32:
+                    as.emit({0x59, 0x58});              // pop rcx; pop rax
+                    as.emit({0x48, 0xC1, 0xF8, 0x20});  // sar rax, 32
+                    as.emit({0x48, 0x0F, 0xAF, 0xC1});  // imul rax, rcx
+                    as.emit({0x50});                    // push rax
+                    break;
+                case Opcode::DIV_I32:
+                    // 64-bit division, so INT_MIN / -1 doesn't trap
+                    as.emit({0x59, 0x58});              // pop rcx; pop rax
+                    as.emit({0x48, 0xC1, 0xF9, 0x20});  // sar rcx, 32
+                    as.emit({0x48, 0x85, 0xC9});        // test rcx, rcx
+                    bail_sites.push_back(as.jump({0x0F, 0x84}));  // jz bail
+                    as.emit({0x48, 0xC1, 0xF8, 0x20});  // sar rax, 32
+                    as.emit({0x48, 0x99});              // cqo
+                    as.emit({0x48, 0xF7, 0xF9});        // idiv rcx
+                    as.emit({0x48, 0xC1, 0xE0, 0x20});  // shl rax, 32
+                    as.emit({0x50});                    // push rax
+                    break;
+                case Opcode::NEG_I32:
+                    as.emit({0x48, 0xF7, 0x1C, 0x24});  // neg qword [rsp]
+                    break;
+                case Opcode::EQ_I32:
+                case Opcode::NE_I32:
+                case Opcode::LT_I32:
+                case Opcode::GT_I32:
+                case Opcode::LE_I32:
+                case Opcode::GE_I32:
+                    as.emit({0x59, 0x58});              // pop rcx; pop rax
+                    as.emit({0x48, 0x39, 0xC8});        // cmp rax, rcx
+                    as.emit({0x0F, static_cast<uint8_t>(0x90 | condition(instr.opcode)), 0xC0});  // setcc al
+                    as.emit({0x0F, 0xB6, 0xC0});        // movzx eax, al
+                    as.emit({0x48, 0xC1, 0xE0, 0x20});  // shl rax, 32
+                    as.emit({0x48, 0x83, 0xC8, 0x01});  // or rax, 1 (bool tag)
+                    as.emit({0x50});                    // push rax
+                    break;
+                // Booleans are 0 or 1 over the same tag
+                case Opcode::AND:
+                    as.emit({0x59});                    // pop rcx
+                    as.emit({0x48, 0x21, 0x0C, 0x24});  // and [rsp], rcx
+                    break;
+                case Opcode::OR:
+                    as.emit({0x59});                    // pop rcx
+                    as.emit({0x48, 0x09, 0x0C, 0x24});  // or [rsp], rcx
+                    break;
+                case Opcode::NOT:
+                    as.emit({0x48, 0xB8});              // mov rax, imm64
+                    as.emit64(uint64_t(1) << 32);
+                    as.emit({0x48, 0x31, 0x04, 0x24});  // xor [rsp], rax
+                    break;
+                case Opcode::JMP:
+                    jumps.emplace_back(as.jump({0xE9}), instr.operand);
+                    break;
+                case Opcode::JMP_IF:
+                case Opcode::JMP_IF_NOT:
+                    // false is exactly the bool tag with a zero payload
+                    as.emit({0x58});                    // pop rax
+                    as.emit({0x48, 0x83, 0xF8, 0x01});  // cmp rax, 1
+                    jumps.emplace_back(as.jump({0x0F, static_cast<uint8_t>(
+                        instr.opcode == Opcode::JMP_IF ? 0x85 : 0x84)}), instr.operand);  // jne / je
+                    break;
+                case Opcode::CALL: {
+                    size_t callee_params = function_table_.get_function(instr.operand).num_params;
+                    as.emit({0x48, 0xB8});              // mov rax, &entries_[callee]
+                    as.emit64(reinterpret_cast<uint64_t>(&entries_[instr.operand]));
+                    as.emit({0xFF, 0x10});              // call [rax]
+                    if (callee_params > 0) {
+                        as.emit({0x48, 0x81, 0xC4});    // add rsp, imm32
+                        as.emit32(static_cast<uint32_t>(8 * callee_params));
+                    }
+                    as.emit({0x50});                    // push rax
+                    break;
+                }
+                case Opcode::RET_VAL:
+                    as.emit({0x58});                    // pop rax
+                    as.emit({0xC9});                    // leave
+                    as.emit({0xC3});                    // ret
+                    break;
+                case Opcode::LOAD_LOAD:
+                    as.emit({0xFF, 0xB5});              // push qword [rbp + disp32]
+                    as.emit32(local(operand_a(instr.operand)));
+                    as.emit({0xFF, 0xB5});
+                    as.emit32(local(operand_b(instr.operand)));
+                    break;
+                case Opcode::LOAD_LOAD_ADD:
+                    as.emit({0x48, 0x8B, 0x85});        // mov rax, [rbp + disp32]
+                    as.emit32(local(operand_a(instr.operand)));
+                    as.emit({0x48, 0x03, 0x85});        // add rax, [rbp + disp32]
+                    as.emit32(local(operand_b(instr.operand)));
+                    as.emit({0x50});                    // push rax
+                    break;
+                case Opcode::LOAD_PUSH_I32:
+                    as.emit({0xFF, 0xB5});              // push qword [rbp + disp32]
+                    as.emit32(local(operand_a(instr.operand)));
+                    as.emit({0x48, 0xB8});              // mov rax, imm64
+                    as.emit64(int_bits(operand_b(instr.operand)));
+                    as.emit({0x50});                    // push rax
+                    break;
+                case Opcode::INC_LOCAL:
+                    as.emit({0x48, 0xB8});              // mov rax, imm64
+                    as.emit64(int_bits(operand_b(instr.operand)));
+                    as.emit({0x48, 0x01, 0x85});        // add [rbp + disp32], rax
+                    as.emit32(local(operand_a(instr.operand)));
+                    break;
+                case Opcode::CMP_EQ_JMP_IF_NOT:
+                case Opcode::CMP_NE_JMP_IF_NOT:
+                case Opcode::CMP_LT_JMP_IF_NOT:
+                case Opcode::CMP_GT_JMP_IF_NOT:
+                case Opcode::CMP_LE_JMP_IF_NOT:
+                case Opcode::CMP_GE_JMP_IF_NOT:
+                    as.emit({0x59, 0x58});              // pop rcx; pop rax
+                    as.emit({0x48, 0x39, 0xC8});        // cmp rax, rcx
+                    // Inverting the low bit of a condition code negates it
+                    jumps.emplace_back(as.jump({0x0F, static_cast<uint8_t>(
+                        0x80 | (condition(instr.opcode) ^ 1))}), instr.operand);
+                    break;
+                default:
+                    // decode() only lets the opcodes above through
+                    break;
+            }
+        }
+        for (const auto& [at, target] : jumps) {
+            as.patch(at, labels.at(target));
+        }
+    }
+
+    // Shared bail-out: report failure to call() from the thunk's frame
+    size_t bail = as.size();
+    as.emit({0xB8, 0x01, 0x00, 0x00, 0x00});    // mov eax, 1
+    emit_thunk_exit(as);
+    for (size_t at : bail_sites) {
+        as.patch(at, bail);
+    }
+
+    const uint8_t* base = static_cast<const uint8_t*>(install(as.code()));
+    if (!base) {
+        states_[index] = State::Unsupported;
+        return false;
+    }
+    for (size_t i = 0; i < group.size(); ++i) {
+        entries_[group[i]] = base + starts[i];
+        states_[group[i]] = State::Compiled;
+    }
+    return true;
+}
+
+bool JitCompiler::call(size_t index, const Value* args, Value& result) {
+#ifdef NUST_HAVE_JIT
+    uintptr_t stack_limit = reinterpret_cast<uintptr_t>(__builtin_frame_address(0)) - native_stack_budget;
+    uint64_t bits = 0;
+    auto thunk = reinterpret_cast<Thunk>(const_cast<void*>(thunk_));
+    if (thunk(reinterpret_cast<const uint64_t*>(args), function_table_.get_function(index).num_params,
+              entries_[index], &bits, stack_limit) != 0) {
+        states_[index] = State::Unsupported;
+        return false;
+    }
+    result = Value::from_bits(bits);
+    return true;
+#else
+    (void)index;
+    (void)args;
+    (void)result;
+    return false;
+#endif
+}
+
+} // namespace nust
@@ -0,0 +1,406 @@
+#include "lexer.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+#if !defined(NUST_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define NUST_SIMD_WIDTH 32
+#elif !defined(NUST_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define NUST_SIMD_WIDTH 16
+#endif
+
+namespace nust {
+
+namespace {
+
+enum CharClass : uint8_t {
+    Space = 1,
+    Digit = 2,
+    Alpha = 4,   // Letters and '_'
+};
+
+struct CharTable {
+    uint8_t classes[256] = {};
+
+    CharTable() {
+        for (unsigned char c : {' ', '\t', '\n', '\r', '\v', '\f'}) classes[c] = Space;
+        for (int c = '0'; c <= '9'; c++) classes[c] = Digit;
+        for (int c = 'a'; c <= 'z'; c++) classes[c] = Alpha;
+        for (int c = 'A'; c <= 'Z'; c++) classes[c] = Alpha;
+        classes[static_cast<unsigned char>('_')] = Alpha;
+    }
+
+    bool is(char c, uint8_t mask) const {
+        return classes[static_cast<unsigned char>(c)] & mask;
+    }
+};
+
+const CharTable char_table;
+
+#ifdef NUST_SIMD_WIDTH
+
+// Thin layer over the widest available vectors, so each scanner below is
+// written once. Comparisons set matching bytes to 0xff; mask() packs them
+// into one bit per byte, lowest address first.
+#if NUST_SIMD_WIDTH == 32
+using Bytes = __m256i;
+inline Bytes load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline Bytes splat(char c) { return _mm256_set1_epi8(c); }
+inline Bytes eq(Bytes a, Bytes b) { return _mm256_cmpeq_epi8(a, b); }
+inline Bytes gt(Bytes a, Bytes b) { return _mm256_cmpgt_epi8(a, b); }
+inline Bytes either(Bytes a, Bytes b) { return _mm256_or_si256(a, b); }
+inline Bytes both(Bytes a, Bytes b) { return _mm256_and_si256(a, b); }
+inline uint32_t mask(Bytes a) { return static_cast<uint32_t>(_mm256_movemask_epi8(a)); }
+#else
+using Bytes = __m128i;
+inline Bytes load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline Bytes splat(char c) { return _mm_set1_epi8(c); }
+inline Bytes eq(Bytes a, Bytes b) { return _mm_cmpeq_epi8(a, b); }
+inline Bytes gt(Bytes a, Bytes b) { return _mm_cmpgt_epi8(a, b); }
+inline Bytes either(Bytes a, Bytes b) { return _mm_or_si128(a, b); }
+inline Bytes both(Bytes a, Bytes b) { return _mm_and_si128(a, b); }
+inline uint32_t mask(Bytes a) { return static_cast<uint32_t>(_mm_movemask_epi8(a)); }
+#endif
+
+constexpr size_t simd_width = NUST_SIMD_WIDTH;
+constexpr uint32_t all_bytes = simd_width == 32 ? 0xffffffffu : 0xffffu;
+
+// Bytes in [lo, hi]. The compares are signed, which is fine for ASCII
+// ranges: bytes >= 0x80 are negative and never match.
+inline Bytes in_range(Bytes v, char lo, char hi) {
+    return both(gt(v, splat(static_cast<char>(lo - 1))), gt(splat(static_cast<char>(hi + 1)), v));
+}
+
+inline Bytes is_space(Bytes v) {
+    return either(either(eq(v, splat(' ')), eq(v, splat('\n'))), either(eq(v, splat('\t')), eq(v, splat('\r'))));
+}
+
+inline Bytes is_word(Bytes v) {
+    return either(either(in_range(v, 'a', 'z'), in_range(v, 'A', 'Z')), either(in_range(v, '0', '9'), eq(v, splat('_'))));
+}
+
+#endif
+
+// Each scanner returns the first position at or after `pos` whose byte
+// doesn't belong to the run, or `length`. Most runs are a few bytes long
+// (single spaces, short names), so the first `scalar_prefix` bytes are
+// checked one at a time; longer runs (indentation, comments, long names and
+// strings) continue a whole vector at a time, with the tail finished byte
+// by byte.
+constexpr size_t scalar_prefix = 8;
+
+inline bool space_byte(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+inline bool word_byte(char c) {
+    return char_table.is(c, Alpha | Digit);
+}
+
+// Spaces, tabs and line breaks. The rarer \v and \f are left to the caller.
+size_t skip_spaces(const char* text, size_t pos, size_t length) {
+    for (size_t end = std::min(pos + scalar_prefix, length); pos < end; pos++) {
+        if (!space_byte(text[pos])) return pos;
+    }
+#ifdef NUST_SIMD_WIDTH
+    for (; pos + simd_width <= length; pos += simd_width) {
+        uint32_t stop = ~mask(is_space(load(text + pos))) & all_bytes;
+        if (stop) return pos + __builtin_ctz(stop);
+    }
+#endif
+    while (pos < length && space_byte(text[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+// Letters, digits and '_'
+size_t skip_word(const char* text, size_t pos, size_t length) {
+    for (size_t end = std::min(pos + scalar_prefix, length); pos < end; pos++) {
+        if (!word_byte(text[pos])) return pos;
+    }
+#ifdef NUST_SIMD_WIDTH
+    for (; pos + simd_width <= length; pos += simd_width) {
+        uint32_t stop = ~mask(is_word(load(text + pos))) & all_bytes;
+        if (stop) return pos + __builtin_ctz(stop);
+    }
+#endif
+    while (pos < length && word_byte(text[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+// Anything but `a` and `b`
+size_t skip_until(const char* text, size_t pos, size_t length, char a, char b) {
+    for (size_t end = std::min(pos + scalar_prefix, length); pos < end; pos++) {
+        if (text[pos] == a || text[pos] == b) return pos;
+    }
+#ifdef NUST_SIMD_WIDTH
+    const Bytes va = splat(a);
+    const Bytes vb = splat(b);
+    for (; pos + simd_width <= length; pos += simd_width) {
+        Bytes v = load(text + pos);
+        uint32_t stop = mask(either(eq(v, va), eq(v, vb)));
+        if (stop) return pos + __builtin_ctz(stop);
+    }
+#endif
+    while (pos < length && text[pos] != a && text[pos] != b) {
+        pos++;
+    }
+    return pos;
+}
+
+// Keywords by length, checked with a single compare against the candidate
+TokenKind keyword_kind(std::string_view word) {
+    switch (word.size()) {
+        case 2:
+            if (word == "fn") return TokenKind::Fn;
+            if (word == "if") return TokenKind::If;
+            break;
+        case 3:
+            if (word == "let") return TokenKind::Let;
+            if (word == "mut") return TokenKind::Mut;
+            break;
+        case 4:
+            if (word == "else") return TokenKind::Else;
+            if (word == "true") return TokenKind::True;
+            break;
+        case 5:
+            if (word == "while") return TokenKind::While;
+            if (word == "false") return TokenKind::False;
+            break;
+        case 6:
+            if (word == "return") return TokenKind::Return;
+            break;
+    }
+    return TokenKind::Identifier;
+}
+
+} // namespace
+
+const char* token_kind_name(TokenKind kind) {
+    switch (kind) {
+        case TokenKind::Identifier: return "identifier";
+        case TokenKind::Integer: return "integer";
+        case TokenKind::String: return "string";
+        case TokenKind::Fn: return "'fn'";
+        case TokenKind::Let: return "'let'";
+        case TokenKind::Mut: return "'mut'";
+        case TokenKind::If: return "'if'";
+        case TokenKind::Else: return "'else'";
+        case TokenKind::While: return "'while'";
+        case TokenKind::Return: return "'return'";
+        case TokenKind::True: return "'true'";
+        case TokenKind::False: return "'false'";
+        case TokenKind::LeftParen: return "'('";
+        case TokenKind::RightParen: return "')'";
+        case TokenKind::LeftBrace: return "'{'";
+        case TokenKind::RightBrace: return "'}'";
+        case TokenKind::Comma: return "','";
+        case TokenKind::Colon: return "':'";
+        case TokenKind::Semicolon: return "';'";
+        case TokenKind::Arrow: return "'->'";
+        case TokenKind::Plus: return "'+'";
+        case TokenKind::Minus: return "'-'";
+        case TokenKind::Star: return "'*'";
+        case TokenKind::Slash: return "'/'";
+        case TokenKind::Bang: return "'!'";
+        case TokenKind::Amp: return "'&'";
+        case TokenKind::AndAnd: return "'&&'";
+        case TokenKind::OrOr: return "'||'";
+        case TokenKind::Assign: return "'='";
+        case TokenKind::EqEq: return "'=='";
+        case TokenKind::BangEq: return "'!='";
+        case TokenKind::Lt: return "'<'";
+        case TokenKind::Le: return "'<='";
+        case TokenKind::Gt: return "'>'";
+        case TokenKind::Ge: return "'>='";
+        case TokenKind::End: return "end of input";
+    }
+    return "unknown";
+}
+
+LineTable::LineTable(const std::string& source) {
+    const char* text = source.data();
+    const size_t length = source.size();
+    line_starts_.push_back(0);
+    size_t pos = 0;
+#ifdef NUST_SIMD_WIDTH
+    const Bytes newline = splat('\n');
+    for (; pos + simd_width <= length; pos += simd_width) {
+        uint32_t lines = mask(eq(load(text + pos), newline));
+        while (lines) {
+            line_starts_.push_back(pos + __builtin_ctz(lines) + 1);
+            lines &= lines - 1;
+        }
+    }
+#endif
+    for (; pos < length; pos++) {
+        if (text[pos] == '\n') {
+            line_starts_.push_back(pos + 1);
+        }
+    }
+}
+
+SourceLocation LineTable::locate(size_t offset) const {
+    // The last line starting at or before `offset`
+    auto it = std::upper_bound(line_starts_.begin(), line_starts_.end(), offset);
+    size_t line = static_cast<size_t>(it - line_starts_.begin());
+    return SourceLocation{line, offset - line_starts_[line - 1] + 1};
+}
+
+TokenBuffer Lexer::tokenize() {
+    if (source_.size() > UINT32_MAX) {
+        throw std::runtime_error("Source too large");
+    }
+
+    TokenBuffer buffer;
+    // Real code averages well over four bytes per token
+    buffer.tokens.reserve(source_.size() / 4 + 1);
+    std::unordered_map<std::string_view, uint32_t> interned;
+
+    const char* text = source_.data();
+    const size_t length = source_.size();
+    size_t pos = 0;
+
+    auto push = [&](TokenKind kind, size_t start, uint32_t payload = 0) {
+        buffer.tokens.push_back(Token{kind, payload, static_cast<uint32_t>(start), static_cast<uint32_t>(pos)});
+    };
+
+    while (true) {
+        // Whitespace and comments
+        while (true) {
+            pos = skip_spaces(text, pos, length);
+            if (pos >= length) {
+                break;
+            }
+            if (text[pos] == '/' && pos + 1 < length && text[pos + 1] == '/') {
+                pos = skip_until(text, pos + 2, length, '\n', '\r');
+            } else if (char_table.is(text[pos], Space)) {
+                pos++;
+            } else {
+                break;
+            }
+        }
+        if (pos >= length) {
+            break;
+        }
+
+        size_t start = pos;
+        char c = text[pos];
+
+        if (char_table.is(c, Alpha)) {
+            pos = skip_word(text, pos + 1, length);
+            std::string_view word(text + start, pos - start);
+            TokenKind kind = keyword_kind(word);
+            if (kind != TokenKind::Identifier) {
+                push(kind, start);
+                continue;
+            }
+            auto [it, inserted] = interned.try_emplace(word, static_cast<uint32_t>(buffer.names.size()));
+            if (inserted) {
+                buffer.names.emplace_back(word);
+            }
+            push(TokenKind::Identifier, start, it->second);
+            continue;
+        }
+
+        if (char_table.is(c, Digit)) {
+            uint64_t value = 0;
+            while (pos < length && char_table.is(text[pos], Digit)) {
+                value = value * 10 + static_cast<uint64_t>(text[pos] - '0');
+                if (value > INT32_MAX) {
+                    error("Integer literal out of range", start);
+                }
+                pos++;
+            }
+            push(TokenKind::Integer, start, static_cast<uint32_t>(value));
+            continue;
+        }
+
+        if (c == '"') {
+            pos++;
+            size_t content = pos;
+            while ((pos = skip_until(text, pos, length, '"', '\\')) < length && text[pos] == '\\') {
+                // The escaped character can't end the string
+                pos += 2;
+            }
+            if (pos >= length) {
+                error("Unterminated string", start);
+            }
+            uint32_t index = static_cast<uint32_t>(buffer.strings.size());
+            buffer.strings.emplace_back(text + content, pos - content);
+            pos++;
+            push(TokenKind::String, start, index);
+            continue;
+        }
+
+        // Operators and punctuation, longest match first
+        char next = pos + 1 < length ? text[pos + 1] : '\0';
+        TokenKind kind;
+        size_t width = 1;
+        switch (c) {
+            case '(': kind = TokenKind::LeftParen; break;
+            case ')': kind = TokenKind::RightParen; break;
+            case '{': kind = TokenKind::LeftBrace; break;
+            case '}': kind = TokenKind::RightBrace; break;
+            case ',': kind = TokenKind::Comma; break;
+            case ':': kind = TokenKind::Colon; break;
+            case ';': kind = TokenKind::Semicolon; break;
+            case '+': kind = TokenKind::Plus; break;
+            case '*': kind = TokenKind::Star; break;
+            case '/': kind = TokenKind::Slash; break;
+            case '-':
+                if (next == '>') { kind = TokenKind::Arrow; width = 2; }
+                else kind = TokenKind::Minus;
+                break;
+            case '!':
+                if (next == '=') { kind = TokenKind::BangEq; width = 2; }
+                else kind = TokenKind::Bang;
+                break;
+            case '&':
+                if (next == '&') { kind = TokenKind::AndAnd; width = 2; }
+                else kind = TokenKind::Amp;
+                break;
+            case '|':
+                if (next != '|') error("Unexpected character '|'", start);
+                kind = TokenKind::OrOr;
+                width = 2;
+                break;
+            case '=':
+                if (next == '=') { kind = TokenKind::EqEq; width = 2; }
+                else kind = TokenKind::Assign;
+                break;
+            case '<':
+                if (next == '=') { kind = TokenKind::Le; width = 2; }
+                else kind = TokenKind::Lt;
+                break;
+            case '>':
+                if (next == '=') { kind = TokenKind::Ge; width = 2; }
+                else kind = TokenKind::Gt;
+                break;
+            default:
+                error(std::string("Unexpected character '") + c + "'", start);
+        }
+        pos += width;
+        push(kind, start);
+    }
+
+    push(TokenKind::End, pos);
+    return buffer;
+}
+
+void Lexer::error(const std::string& message, size_t offset) const {
+    SourceLocation location = LineTable(source_).locate(offset);
+    std::stringstream ss;
+    ss << "Error at line " << location.line << ", column " << location.column
+       << " (position " << offset << "): " << message;
+    throw std::runtime_error(ss.str());
+}
+
+} // namespace nust
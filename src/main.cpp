@@ -1,21 +1,126 @@
 #include <iostream>
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
+#include <optional>
 #include "parser.h"
 #include "type_checker.h"
 #include "compiler.h"
 #include "vm.h"
+#include "register_compiler.h"
+#include "register_vm.h"
+#include "peephole.h"
+#include "superinstructions.h"
+#include "constant_folder.h"
+#include "bytecode_module.h"
+#include "verifier.h"
+#include "c_emitter.h"
+#include "thread_pool.h"
+#include "code_cache.h"
+
+// Switch the VM to verified mode when its code passes the verifier. Code
+// that doesn't still runs, with the handlers' own checks.
+static void verify_if_possible(nust::VirtualMachine& vm) {
+    try {
+        vm.verify();
+    } catch (const nust::VerifyError&) {
+    }
+}
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <source_file>\n";
+    // Parse command line flags
+    bool use_register_vm = false;
+    bool use_peephole = true;
+    bool print_peephole_stats = false;
+    bool use_superinstructions = true;
+    bool use_constant_folding = true;
+    bool use_verifier = true;
+    bool use_jit = true;
+    bool emit_c = false;
+    size_t jobs = 1;
+    bool use_cache = false;
+    bool print_cache_stats = false;
+    const char* source_path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--register") {
+            use_register_vm = true;
+        } else if (arg == "--no-peephole") {
+            use_peephole = false;
+        } else if (arg == "--no-superinstructions") {
+            use_superinstructions = false;
+        } else if (arg == "--no-fold") {
+            use_constant_folding = false;
+        } else if (arg == "--no-jit") {
+            use_jit = false;
+        } else if (arg == "--emit-c") {
+            emit_c = true;
+        } else if (arg == "--no-verify") {
+            use_verifier = false;
+        } else if (arg == "--peephole-stats") {
+            print_peephole_stats = true;
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            jobs = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--cache") {
+            use_cache = true;
+        } else if (arg == "--cache-stats") {
+            print_cache_stats = true;
+        } else if (!source_path && arg.rfind("--", 0) != 0) {
+            source_path = argv[i];
+        } else {
+            source_path = nullptr;
+            break;
+        }
+    }
+    if (!source_path) {
+        std::cerr << "Usage: " << argv[0] << " [options] <source_file | module.no>\n"
+                  << "Options:\n"
+                  << "  --register              Run on the register VM\n"
+                  << "  --emit-c                Write the program as C to <source>.c instead of running it\n"
+                  << "  --no-fold               Disable constant folding\n"
+                  << "  --no-peephole           Disable the peephole optimizer\n"
+                  << "  --no-superinstructions  Disable superinstruction fusion\n"
+                  << "  --no-verify             Keep the VM's per-instruction checks\n"
+                  << "  --no-jit                Don't compile hot functions to native code\n"
+                  << "  --peephole-stats        Print peephole statistics to stderr\n"
+                  << "  --jobs <n>              Check and compile functions on n threads (0: one per core)\n"
+                  << "  --cache                 Keep compiled functions in <source>.nfc and reuse unchanged ones\n"
+                  << "  --cache-stats           Print how many functions were reused from the cache, counted\n"
+                  << "                          when it is loaded, and how many need compiling, to stderr\n";
         return 1;
     }
     
+    // A compiled module runs directly, skipping the front end
+    std::string path = source_path;
+    if (path.size() > 3 && path.compare(path.size() - 3, 3, ".no") == 0) {
+        std::optional<nust::BytecodeModule> module;
+        try {
+            module.emplace(nust::BytecodeModule::map(path));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        try {
+            nust::VirtualMachine vm(module->function_table(), module->constants(), module->code());
+            if (use_verifier) {
+                verify_if_possible(vm);
+            }
+            if (use_jit) {
+                vm.enable_jit();
+            }
+            vm.run();
+            std::cout << vm.get_result().to_string();
+        } catch (const std::exception& e) {
+            std::cerr << "Runtime error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    
     // Read source file
-    std::ifstream file(argv[1]);
+    std::ifstream file(source_path);
     if (!file.is_open()) {
-        std::cerr << "Failed to open file: " << argv[1] << "\n";
+        std::cerr << "Failed to open file: " << source_path << "\n";
         return 1;
     }
     
@@ -23,27 +128,115 @@ int main(int argc, char* argv[]) {
     buffer << file.rdbuf();
     std::string source = buffer.str();
     
+    // get the filename without the extension
+    std::string filename = source_path;
+    size_t dot_pos = filename.find_last_of('.');
+    if (dot_pos != std::string::npos) {
+        filename = filename.substr(0, dot_pos);
+    }
+    
     try {
         // Parse source code
         nust::Parser parser(source);
         auto program = parser.parse();
         
+        // Functions are checked and compiled independently, so the front end
+        // can spread them over threads; the output doesn't depend on it
+        std::optional<nust::ThreadPool> pool;
+        if (jobs != 1) {
+            pool.emplace(jobs);
+        }
+        
+        // Functions unchanged since a previous run keep their bytecode and
+        // skip checking. Only the stack VM backend reads the cache; the
+        // others need every function checked.
+        std::optional<nust::CodeCache> cache;
+        if (use_cache && !use_register_vm && !emit_c) {
+            uint64_t options = use_constant_folding ? 1 : 0;
+            cache.emplace(filename + ".nfc", source, nust::SignatureIndex(*program), options);
+            if (print_cache_stats) {
+                std::cerr << "cache: " << cache->hits() << " hits, " << cache->misses() << " misses\n";
+            }
+        }
+        
         // Type check
         nust::TypeChecker type_checker;
+        type_checker.set_thread_pool(pool ? &*pool : nullptr);
+        type_checker.set_code_cache(cache ? &*cache : nullptr);
         if (!type_checker.check_program(*program)) {
             std::cerr << "Type checking failed\n";
             return 1;
         }
         
+        // Fold constant expressions before either backend sees the program
+        if (use_constant_folding) {
+            nust::ConstantFolder folder;
+            folder.fold_program(*program);
+        }
+        
+        // Optionally translate to C for the system compiler instead of running
+        if (emit_c) {
+            std::string c_path = source_path;
+            size_t dot_pos = c_path.find_last_of('.');
+            if (dot_pos != std::string::npos) {
+                c_path = c_path.substr(0, dot_pos);
+            }
+            c_path += ".c";
+            nust::CEmitter emitter;
+            std::string c_source = emitter.emit(*program);
+            std::ofstream output_c_file(c_path);
+            if (!output_c_file.is_open()) {
+                std::cerr << "Failed to open output file: " << c_path << "\n";
+                return 1;
+            }
+            output_c_file << c_source;
+            return 0;
+        }
+
+        // Optionally run on the register VM instead of the stack VM
+        if (use_register_vm) {
+            nust::RegisterCompiler register_compiler;
+            auto register_instructions = register_compiler.compile(*program, type_checker.signatures());
+            nust::StringHeap string_heap;
+            std::vector<nust::Value> constants;
+            for (const auto& str : register_compiler.string_constants) {
+                constants.push_back(nust::Value(string_heap.allocate(str)));
+            }
+            nust::RegisterVM vm(register_compiler.get_function_table(), constants, register_instructions);
+            try {
+                vm.run();
+                std::cout << vm.get_result().to_string();
+            } catch (const std::exception& e) {
+                std::cerr << "Runtime error: " << e.what() << "\n";
+                return 1;
+            }
+            return 0;
+        }
+
         // Compile to bytecode
         nust::Compiler compiler;
-        auto instructions = compiler.compile(*program);
+        compiler.set_thread_pool(pool ? &*pool : nullptr);
+        compiler.set_code_cache(cache ? &*cache : nullptr);
+        nust::PeepholeOptimizer* peephole = nullptr;
+        if (use_peephole) {
+            auto pass = std::make_unique<nust::PeepholeOptimizer>();
+            peephole = pass.get();
+            compiler.add_pass(std::move(pass));
+        }
+        if (use_superinstructions) {
+            compiler.add_pass(std::make_unique<nust::SuperinstructionPass>());
+        }
+        auto instructions = compiler.compile(*program, type_checker.signatures());
+        if (cache && !cache->save()) {
+            std::cerr << "Failed to write cache: " << filename << ".nfc\n";
+        }
 
-        // get the filename without the extension
-        std::string filename = argv[1];
-        size_t dot_pos = filename.find_last_of('.');
-        if (dot_pos != std::string::npos) {
-            filename = filename.substr(0, dot_pos);
+        if (peephole && print_peephole_stats) {
+            const auto& stats = peephole->stats();
+            std::cerr << "peephole: " << stats.before << " -> " << stats.after << " instructions\n";
+            for (const auto& [rule, hits] : stats.rule_hits) {
+                std::cerr << "  " << rule << ": " << hits << "\n";
+            }
         }
 
         // Output instructions as assembly to *.ns file
@@ -54,38 +247,41 @@ int main(int argc, char* argv[]) {
         }
         for (const auto& instr : instructions) {
             output_asm_file << nust::opcode_to_string(instr.opcode);
-            if (instr.has_operand()) {
+            if (nust::operand_encoding(instr.opcode) == nust::OperandEncoding::Pair) {
+                // Fused instructions carry a slot and a slot or i32 constant
+                output_asm_file << " " << nust::operand_a(instr.operand)
+                                << " " << static_cast<int32_t>(nust::operand_b(instr.operand));
+            } else if (instr.has_operand()) {
                 output_asm_file << " " << instr.operand;
             }
             output_asm_file << "\n";
         }
         
 
-        // Output bytecode to *.no file
-        std::ofstream output_bytecode_file(filename + std::string(".no"));
+        // Output the compiled module to *.no file
+        std::ofstream output_bytecode_file(filename + std::string(".no"), std::ios::binary);
         if (!output_bytecode_file.is_open()) {
             std::cerr << "Failed to open output file: " << filename + std::string(".no") << "\n";
             return 1;
         }
-        
-        for (const auto& instr : instructions) {
-            output_bytecode_file << static_cast<uint8_t>(instr.opcode);
-            if (instr.has_operand()) {
-                // Encode operand as little-endian
-                for (size_t i = 0; i < sizeof(size_t); ++i) {
-                    output_bytecode_file << static_cast<uint8_t>((instr.operand >> (i * 8)) & 0xFF);
-                }
-            }
-        }
+        nust::write_module(output_bytecode_file, compiler.get_function_table(),
+                           compiler.string_constants, instructions);
 
         // Convert string constants to Value objects
+        nust::StringHeap string_heap;
         std::vector<nust::Value> constants;
         for (const auto& str : compiler.string_constants) {
-            constants.push_back(nust::Value(str));
+            constants.push_back(nust::Value(string_heap.allocate(str)));
         }
 
         // Execute the program on the VM
         nust::VirtualMachine vm(compiler.get_function_table(), constants, instructions);
+        if (use_verifier) {
+            verify_if_possible(vm);
+        }
+        if (use_jit) {
+            vm.enable_jit();
+        }
         try {
             vm.run();
             // Print the result
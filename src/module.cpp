@@ -0,0 +1,82 @@
+#include "module.h"
+#include "parser.h"
+#include "type_checker.h"
+#include "constant_folder.h"
+#include "compiler.h"
+#include "peephole.h"
+#include "superinstructions.h"
+#include "verifier.h"
+#include <stdexcept>
+
+namespace nust {
+
+std::shared_ptr<const Module> Module::compile(std::string_view source) {
+    Parser parser{std::string(source)};
+    auto program = parser.parse();
+
+    TypeChecker type_checker;
+    if (!type_checker.check_program(*program)) {
+        std::string message = "Type checking failed";
+        for (const auto& error : type_checker.errors()) {
+            message += "\n" + error;
+        }
+        throw std::runtime_error(message);
+    }
+
+    ConstantFolder folder;
+    folder.fold_program(*program);
+
+    Compiler compiler;
+    compiler.add_pass(std::make_unique<PeepholeOptimizer>());
+    compiler.add_pass(std::make_unique<SuperinstructionPass>());
+    auto instructions = compiler.compile(*program, type_checker.signatures());
+    return create(compiler.get_function_table(), compiler.string_constants, instructions);
+}
+
+std::shared_ptr<const Module> Module::create(const FunctionTable& function_table,
+                                             const std::vector<std::string>& string_constants,
+                                             const std::vector<Instruction>& instructions) {
+    std::shared_ptr<Module> module(new Module());
+    module->function_table_ = function_table;
+    for (const auto& str : string_constants) {
+        module->constants_.push_back(Value(module->strings_.allocate(str)));
+    }
+    module->code_ = PackedCode::encode(instructions, function_table);
+    module->verify();
+    return module;
+}
+
+std::shared_ptr<const Module> Module::load(const std::string& path) {
+    std::shared_ptr<Module> module(new Module());
+    module->bytecode_.emplace(BytecodeModule::map(path));
+    module->verify();
+    return module;
+}
+
+void Module::verify() {
+    // Code that fails still runs, with the VM's own checks
+    try {
+        BytecodeVerifier(function_table(), constants().size()).verify(code());
+        verified_ = true;
+    } catch (const VerifyError&) {
+        verified_ = false;
+    }
+}
+
+const FunctionTable& Module::function_table() const {
+    return bytecode_ ? bytecode_->function_table() : function_table_;
+}
+
+const std::vector<Value>& Module::constants() const {
+    return bytecode_ ? bytecode_->constants() : constants_;
+}
+
+const PackedCode& Module::code() const {
+    return bytecode_ ? bytecode_->code() : code_;
+}
+
+size_t Module::function_index(std::string_view name) const {
+    return function_table().get_function_index(Symbol(name));
+}
+
+} // namespace nust
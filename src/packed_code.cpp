@@ -0,0 +1,125 @@
+#include "packed_code.h"
+#include <stdexcept>
+#include <unordered_map>
+
+namespace nust {
+
+namespace {
+
+void write_unsigned(std::vector<uint8_t>& out, uint64_t value) {
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if (value != 0) {
+            byte |= 0x80;
+        }
+        out.push_back(byte);
+    } while (value != 0);
+}
+
+void write_signed(std::vector<uint8_t>& out, int64_t value) {
+    bool more = true;
+    while (more) {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;  // Arithmetic shift
+        if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40))) {
+            more = false;
+        } else {
+            byte |= 0x80;
+        }
+        out.push_back(byte);
+    }
+}
+
+void write_target(std::vector<uint8_t>& out, size_t at, size_t target) {
+    if (target > UINT32_MAX) {
+        throw std::runtime_error("Jump target out of range for packed code");
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        out[at + i] = static_cast<uint8_t>(target >> (i * 8));
+    }
+}
+
+} // namespace
+
+PackedCode PackedCode::encode(const std::vector<Instruction>& instructions,
+                              const FunctionTable& function_table) {
+    PackedCode code;
+    std::vector<size_t> offsets(instructions.size() + 1);
+    std::vector<std::pair<size_t, size_t>> jumps;  // Operand position, target index
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        const Instruction& instr = instructions[i];
+        offsets[i] = code.storage_.size();
+        code.storage_.push_back(static_cast<uint8_t>(instr.opcode));
+        switch (operand_encoding(instr.opcode)) {
+            case OperandEncoding::None:
+                break;
+            case OperandEncoding::Unsigned:
+                write_unsigned(code.storage_, instr.operand);
+                break;
+            case OperandEncoding::Signed:
+                write_signed(code.storage_, static_cast<int64_t>(instr.operand));
+                break;
+            case OperandEncoding::Target:
+                jumps.emplace_back(code.storage_.size(), instr.operand);
+                code.storage_.resize(code.storage_.size() + 4);
+                break;
+            case OperandEncoding::Pair:
+                write_unsigned(code.storage_, operand_a(instr.operand));
+                write_signed(code.storage_, static_cast<int32_t>(operand_b(instr.operand)));
+                break;
+        }
+    }
+    offsets[instructions.size()] = code.storage_.size();
+
+    // Targets past the end keep their distance from it
+    auto offset_of = [&](size_t index) {
+        return index < offsets.size() ? offsets[index]
+                                      : code.storage_.size() + (index - instructions.size());
+    };
+    for (const auto& [at, target] : jumps) {
+        write_target(code.storage_, at, offset_of(target));
+    }
+    for (size_t i = 0; i < function_table.size(); ++i) {
+        code.entry_offsets_.push_back(offset_of(function_table.get_function(i).entry_point));
+    }
+
+    code.size_ = code.storage_.size();
+    code.storage_.resize(code.size_ + packed_code_padding, 0);
+    return code;
+}
+
+PackedCode PackedCode::view(const uint8_t* data, size_t size, std::vector<size_t> entry_offsets) {
+    PackedCode code;
+    code.view_ = data;
+    code.size_ = size;
+    code.entry_offsets_ = std::move(entry_offsets);
+    return code;
+}
+
+std::vector<Instruction> PackedCode::decode() const {
+    const uint8_t* bytes = data();
+    std::vector<Instruction> instructions;
+    std::unordered_map<size_t, size_t> index_of;
+
+    size_t pc = 0;
+    while (pc < size_) {
+        index_of[pc] = instructions.size();
+        instructions.push_back(read_instruction(bytes, pc));
+    }
+    index_of[size_] = instructions.size();
+
+    for (auto& instr : instructions) {
+        if (is_jump(instr.opcode)) {
+            auto it = index_of.find(instr.operand);
+            if (it == index_of.end()) {
+                throw std::runtime_error("Jump target is not an instruction boundary");
+            }
+            instr.operand = it->second;
+        }
+    }
+    return instructions;
+}
+
+} // namespace nust
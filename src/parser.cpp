@@ -1,669 +1,543 @@
 #include "parser.h"
-#include <cctype>
+#include "resolver.h"
 #include <sstream>
 #include <stdexcept>
-#include <iostream>
 
 namespace nust {
 
 Parser::Parser(std::string source) 
-    : source(source), current_scope(std::make_shared<Scope>()) {}
+    : arena(std::make_unique<Arena>()), source(std::move(source)) {
+    tokens = Lexer(this->source).tokenize();
+}
 
 std::unique_ptr<Program> Parser::parse() {
-    std::vector<std::unique_ptr<ASTNode>> items;
-    size_t start = pos;
+    std::vector<ASTNode*> items;
+    size_t start = start_offset();
     
-    skip_whitespace();
     while (!at_end()) {
         items.push_back(parse_function());
-        skip_whitespace();
     }
 
-    return std::make_unique<Program>(make_span(start), std::move(items));
+    auto nodes = arena->copy_array(items.data(), items.size());
+    auto program = std::make_unique<Program>(make_span(start), std::move(arena), nodes);
+    Resolver().resolve(*program);
+    return program;
 }
 
-std::unique_ptr<FunctionDecl> Parser::parse_function() {
-    size_t start = pos;
-    expect("fn");
-    skip_whitespace();
+FunctionDecl* Parser::parse_function() {
+    size_t start = start_offset();
+    expect(TokenKind::Fn);
     
-    std::string name = consume_identifier();
-    skip_whitespace();
+    Symbol name = consume_identifier();
     
-    expect("(");
+    expect(TokenKind::LeftParen);
     auto params = parse_params();
-    expect(")");
-    skip_whitespace();
+    expect(TokenKind::RightParen);
     
     // Parse return type if present
-    std::unique_ptr<Type> return_type;
-    if (match("->")) {
-        skip_whitespace();
+    const Type* return_type;
+    if (match(TokenKind::Arrow)) {
         return_type = parse_type();
-        skip_whitespace();
     } else {
         // Default return type is unit/void
-        return_type = std::make_unique<Type>(Type::Kind::I32, make_span(pos));
-    }
-    
-    // Create new scope for function body
-    auto function_scope = enter_scope();
-    
-    // Add parameters to scope
-    for (const auto& param : params) {
-        function_scope->declarations.push_back(param.name);
+        return_type = Type::get(Type::Kind::I32);
     }
     
     auto body = parse_block();
     
-    exit_scope();
-    
-    return std::make_unique<FunctionDecl>(
+    return make<FunctionDecl>(
         make_span(start),
-        std::move(name),
+        name,
         std::move(params),
-        std::move(return_type),
-        std::move(body)
+        return_type,
+        body
     );
 }
 
 std::vector<FunctionDecl::Param> Parser::parse_params() {
     std::vector<FunctionDecl::Param> params;
     
-    skip_whitespace();
-    if (peek(")")) return params;
+    if (check(TokenKind::RightParen)) return params;
     
     do {
-        size_t param_start = pos;
-        skip_whitespace();
-        bool is_mut = match("mut");
-        if (is_mut) skip_whitespace();
+        size_t param_start = start_offset();
+        bool is_mut = match(TokenKind::Mut);
         
-        std::string name = consume_identifier();
-        skip_whitespace();
+        Symbol name = consume_identifier();
         
-        expect(":");
-        skip_whitespace();
+        expect(TokenKind::Colon);
         
         auto type = parse_type();
         
         params.push_back(FunctionDecl::Param{
             is_mut,
-            std::move(name),
-            std::move(type),
+            name,
+            type,
             make_span(param_start)
         });
-        
-        skip_whitespace();
-    } while (match(","));
+    } while (match(TokenKind::Comma));
     
     return params;
 }
 
-std::unique_ptr<Type> Parser::parse_type() {
-    size_t start = pos;
-    
-    if (match("&")) {
-        bool is_mut = match("mut");
-        if (is_mut) skip_whitespace();
-        auto inner = parse_type();
-        return std::make_unique<Type>(
-            is_mut ? Type::Kind::MutRef : Type::Kind::Ref,
-            std::move(inner),
-            make_span(start)
-        );
+const Type* Parser::parse_type() {
+    // The lexer reads `&&` as one token; here it's two references
+    bool doubled = check(TokenKind::AndAnd);
+    if (doubled || match(TokenKind::Amp)) {
+        if (doubled) pos++;
+        bool is_mut = match(TokenKind::Mut);
+        const Type* type = Type::reference(parse_type(), is_mut);
+        if (doubled) {
+            type = Type::reference(type, false);
+        }
+        return type;
+    }
+    
+    // Type names aren't keywords, so they can still be used as identifiers
+    if (check(TokenKind::Identifier)) {
+        static const Symbol i32_name("i32"), bool_name("bool"), str_name("str");
+        Symbol name = tokens.names[current().payload];
+        std::optional<Type::Kind> kind;
+        if (name == i32_name) kind = Type::Kind::I32;
+        else if (name == bool_name) kind = Type::Kind::Bool;
+        else if (name == str_name) kind = Type::Kind::Str;
+        if (kind) {
+            pos++;
+            return Type::get(*kind);
+        }
     }
     
-    if (match("i32")) return std::make_unique<Type>(Type::Kind::I32, make_span(start));
-    if (match("bool")) return std::make_unique<Type>(Type::Kind::Bool, make_span(start));
-    if (match("str")) return std::make_unique<Type>(Type::Kind::Str, make_span(start));
-    
     error("Expected type");
-    return nullptr;
 }
 
-std::unique_ptr<Stmt> Parser::parse_statement() {
-    skip_whitespace();
-    
-    if (match("let")) return parse_let();
-    if (match("if")) return parse_if();
-    if (match("while")) return parse_while();
-    if (peek("{")) return parse_block();
-    if (match("return")) {
-        size_t start = pos - 6;  // Account for "return" keyword
-        skip_whitespace();
+Stmt* Parser::parse_statement() {
+    if (match(TokenKind::Let)) return parse_let();
+    if (match(TokenKind::If)) return parse_if();
+    if (match(TokenKind::While)) return parse_while();
+    if (check(TokenKind::LeftBrace)) return parse_block();
+    if (check(TokenKind::Return)) {
+        size_t start = start_offset();
+        pos++;
         
         // Parse return value if present (before semicolon)
-        std::unique_ptr<Expr> value;
-        if (!peek(";")) {
+        Expr* value = nullptr;
+        if (!check(TokenKind::Semicolon)) {
             value = parse_expr();
         }
         
-        skip_whitespace();
-        expect(";");
+        expect(TokenKind::Semicolon);
         
-        return std::make_unique<ReturnStmt>(make_span(start), current_scope, std::move(value));
+        return make<ReturnStmt>(make_span(start), value);
     }
     
     // Expression statement
-    size_t start = pos;
+    size_t start = start_offset();
     auto expr = parse_expr();
-    skip_whitespace();
     
     // If we're at the end of a block or at EOF, allow missing semicolon
-    if (!peek("}") && !at_end()) {
-        expect(";");
+    if (!check(TokenKind::RightBrace) && !at_end()) {
+        expect(TokenKind::Semicolon);
     }
     
-    return std::make_unique<ExprStmt>(make_span(start), current_scope, std::move(expr));
+    return make<ExprStmt>(make_span(start), expr);
 }
 
-std::unique_ptr<LetStmt> Parser::parse_let() {
-    size_t start = pos;
-    skip_whitespace();
-    bool is_mut = match("mut");
-    if (is_mut) skip_whitespace();
+LetStmt* Parser::parse_let() {
+    size_t start = start_offset();
+    bool is_mut = match(TokenKind::Mut);
     
-    std::string name = consume_identifier();
-    skip_whitespace();
+    Symbol name = consume_identifier();
     
-    expect(":");
-    skip_whitespace();
+    expect(TokenKind::Colon);
     
     auto type = parse_type();
-    skip_whitespace();
     
-    expect("=");
-    skip_whitespace();
+    expect(TokenKind::Assign);
     
     auto init = parse_expr();
-    skip_whitespace();
-    expect(";");
-    
-    // Add variable to current scope
-    current_scope->declarations.push_back(name);
+    expect(TokenKind::Semicolon);
     
-    return std::make_unique<LetStmt>(
+    return make<LetStmt>(
         make_span(start),
-        current_scope,
         is_mut,
-        std::move(name),
-        std::move(type),
-        std::move(init)
+        name,
+        type,
+        init
     );
 }
 
-std::unique_ptr<IfStmt> Parser::parse_if() {
-    size_t start = pos;
-    skip_whitespace();
+IfStmt* Parser::parse_if() {
+    size_t start = start_offset();
     
     auto condition = parse_expr();
-    skip_whitespace();
     
-    auto then_scope = enter_scope();
     auto then_branch = parse_block();
-    exit_scope();
-    
-    skip_whitespace();
     
-    std::unique_ptr<Stmt> else_branch;
-    if (match("else")) {
-        skip_whitespace();
-        auto else_scope = enter_scope();
-        if (match("if")) {
+    Stmt* else_branch = nullptr;
+    if (match(TokenKind::Else)) {
+        if (match(TokenKind::If)) {
             else_branch = parse_if();
         } else {
             else_branch = parse_block();
         }
-        exit_scope();
     }
     
-    return std::make_unique<IfStmt>(
+    return make<IfStmt>(
         make_span(start),
-        current_scope,
-        std::move(condition),
-        std::move(then_branch),
-        std::move(else_branch)
+        condition,
+        then_branch,
+        else_branch
     );
 }
 
-std::unique_ptr<WhileStmt> Parser::parse_while() {
-    size_t start = pos;
-    skip_whitespace();
+WhileStmt* Parser::parse_while() {
+    size_t start = start_offset();
     
     auto condition = parse_expr();
-    skip_whitespace();
     
-    auto body_scope = enter_scope();
     auto body = parse_block();
-    exit_scope();
     
-    return std::make_unique<WhileStmt>(
+    return make<WhileStmt>(
         make_span(start),
-        current_scope,
-        std::move(condition),
-        std::move(body)
+        condition,
+        body
     );
 }
 
-std::unique_ptr<BlockStmt> Parser::parse_block() {
-    size_t start = pos;
-    expect("{");
+BlockStmt* Parser::parse_block() {
+    size_t start = start_offset();
+    expect(TokenKind::LeftBrace);
     
-    auto block_scope = enter_scope();
-    std::vector<std::unique_ptr<Stmt>> statements;
+    size_t first = pending_statements.size();
     
-    skip_whitespace();
-    while (!at_end() && !peek("}")) {
-        statements.push_back(parse_statement());
-        skip_whitespace();
+    while (!at_end() && !check(TokenKind::RightBrace)) {
+        Stmt* statement = parse_statement();
+        pending_statements.push_back(statement);
     }
     
-    expect("}");
+    expect(TokenKind::RightBrace);
     
-    auto block = std::make_unique<BlockStmt>(
+    auto statements = arena->copy_array(pending_statements.data() + first, pending_statements.size() - first);
+    pending_statements.resize(first);
+    return make<BlockStmt>(
         make_span(start),
-        block_scope,
-        std::move(statements)
+        statements
     );
-    
-    exit_scope();
-    return block;
 }
 
-std::unique_ptr<Expr> Parser::parse_expr() {
+Expr* Parser::parse_expr() {
     return parse_assignment();
 }
 
-std::unique_ptr<Expr> Parser::parse_assignment() {
+Expr* Parser::parse_assignment() {
     auto lhs = parse_or();
     
-    if (match("=")) {
-        skip_whitespace();
+    if (match(TokenKind::Assign)) {
         // Validate that left side is an identifier
-        if (dynamic_cast<Identifier*>(lhs.get()) == nullptr) {
+        if (node_cast<Identifier>(lhs) == nullptr) {
             throw std::runtime_error("Invalid assignment target");
         }
         auto rhs = parse_assignment();  // Right-associative
-        return std::make_unique<BinaryExpr>(
+        return make<BinaryExpr>(
             make_span(lhs->span.start),
             BinaryExpr::Op::Assignment,
-            std::move(lhs),
-            std::move(rhs)
+            lhs,
+            rhs
         );
     }
     
     return lhs;
 }
 
-std::unique_ptr<Expr> Parser::parse_or() {
+Expr* Parser::parse_or() {
     auto expr = parse_and();
     
-    while (match("||")) {
-        skip_whitespace();
+    while (match(TokenKind::OrOr)) {
         auto right = parse_and();
-        expr = std::make_unique<BinaryExpr>(
+        expr = make<BinaryExpr>(
             make_span(expr->span.start),
             BinaryExpr::Op::Or,
-            std::move(expr),
-            std::move(right)
+            expr,
+            right
         );
     }
     
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::parse_and() {
+Expr* Parser::parse_and() {
     auto expr = parse_equality();
     
-    while (match("&&")) {
-        skip_whitespace();
+    while (match(TokenKind::AndAnd)) {
         auto right = parse_equality();
-        expr = std::make_unique<BinaryExpr>(
+        expr = make<BinaryExpr>(
             make_span(expr->span.start),
             BinaryExpr::Op::And,
-            std::move(expr),
-            std::move(right)
+            expr,
+            right
         );
     }
     
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::parse_equality() {
+Expr* Parser::parse_equality() {
     auto expr = parse_comparison();
     
     while (true) {
-        if (match("==")) {
-            skip_whitespace();
-            auto right = parse_comparison();
-            expr = std::make_unique<BinaryExpr>(
-                make_span(expr->span.start),
-                BinaryExpr::Op::Eq,
-                std::move(expr),
-                std::move(right)
-            );
-        } else if (match("!=")) {
-            skip_whitespace();
-            auto right = parse_comparison();
-            expr = std::make_unique<BinaryExpr>(
-                make_span(expr->span.start),
-                BinaryExpr::Op::Ne,
-                std::move(expr),
-                std::move(right)
-            );
-        } else {
-            break;
-        }
+        BinaryExpr::Op op;
+        if (match(TokenKind::EqEq)) op = BinaryExpr::Op::Eq;
+        else if (match(TokenKind::BangEq)) op = BinaryExpr::Op::Ne;
+        else break;
+        
+        auto right = parse_comparison();
+        expr = make<BinaryExpr>(
+            make_span(expr->span.start),
+            op,
+            expr,
+            right
+        );
     }
     
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::parse_comparison() {
-    size_t start = pos;
+Expr* Parser::parse_comparison() {
+    size_t start = start_offset();
     auto expr = parse_term();
     
     while (true) {
-        skip_whitespace();
         BinaryExpr::Op op;
-        if (match("<")) op = BinaryExpr::Op::Lt;
-        else if (match("<=")) op = BinaryExpr::Op::Le;
-        else if (match(">")) op = BinaryExpr::Op::Gt;
-        else if (match(">=")) op = BinaryExpr::Op::Ge;
+        if (match(TokenKind::Lt)) op = BinaryExpr::Op::Lt;
+        else if (match(TokenKind::Le)) op = BinaryExpr::Op::Le;
+        else if (match(TokenKind::Gt)) op = BinaryExpr::Op::Gt;
+        else if (match(TokenKind::Ge)) op = BinaryExpr::Op::Ge;
         else break;
         
-        skip_whitespace();
         auto right = parse_term();
-        expr = std::make_unique<BinaryExpr>(
+        expr = make<BinaryExpr>(
             make_span(start),
             op,
-            std::move(expr),
-            std::move(right)
+            expr,
+            right
         );
     }
     
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::parse_term() {
-    size_t start = pos;
+Expr* Parser::parse_term() {
+    size_t start = start_offset();
     auto expr = parse_factor();
     
     while (true) {
-        skip_whitespace();
         BinaryExpr::Op op;
-        if (match("+")) op = BinaryExpr::Op::Add;
-        else if (match("-")) op = BinaryExpr::Op::Sub;
+        if (match(TokenKind::Plus)) op = BinaryExpr::Op::Add;
+        else if (match(TokenKind::Minus)) op = BinaryExpr::Op::Sub;
         else break;
         
-        skip_whitespace();
         auto right = parse_factor();
-        expr = std::make_unique<BinaryExpr>(
+        expr = make<BinaryExpr>(
             make_span(start),
             op,
-            std::move(expr),
-            std::move(right)
+            expr,
+            right
         );
     }
     
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::parse_factor() {
-    size_t start = pos;
+Expr* Parser::parse_factor() {
+    size_t start = start_offset();
     auto expr = parse_unary();
     
     while (true) {
-        skip_whitespace();
         BinaryExpr::Op op;
-        if (match("*")) op = BinaryExpr::Op::Mul;
-        else if (match("/")) op = BinaryExpr::Op::Div;
+        if (match(TokenKind::Star)) op = BinaryExpr::Op::Mul;
+        else if (match(TokenKind::Slash)) op = BinaryExpr::Op::Div;
         else break;
         
-        skip_whitespace();
         auto right = parse_unary();
-        expr = std::make_unique<BinaryExpr>(
+        expr = make<BinaryExpr>(
             make_span(start),
             op,
-            std::move(expr),
-            std::move(right)
+            expr,
+            right
         );
     }
     
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::parse_unary() {
-    size_t start = pos;
-    skip_whitespace();
+Expr* Parser::parse_unary() {
+    size_t start = start_offset();
     
-    if (match("-")) {
+    if (match(TokenKind::Minus)) {
         auto operand = parse_unary();
-        return std::make_unique<UnaryExpr>(
+        return make<UnaryExpr>(
             make_span(start),
             UnaryExpr::Op::Neg,
-            std::move(operand)
+            operand
         );
     }
     
-    if (match("!")) {
+    if (match(TokenKind::Bang)) {
         auto operand = parse_unary();
-        return std::make_unique<UnaryExpr>(
+        return make<UnaryExpr>(
             make_span(start),
             UnaryExpr::Op::Not,
-            std::move(operand)
+            operand
         );
     }
     
-    if (match("&")) {
-        bool is_mut = match("mut");
-        if (is_mut) skip_whitespace();
+    // As in types, `&&` is two borrows
+    bool doubled = check(TokenKind::AndAnd);
+    if (doubled || match(TokenKind::Amp)) {
+        if (doubled) pos++;
+        bool is_mut = match(TokenKind::Mut);
         auto expr = parse_unary();
-        return std::make_unique<BorrowExpr>(
+        expr = make<BorrowExpr>(
             make_span(start),
             is_mut,
-            std::move(expr)
+            expr
         );
+        if (doubled) {
+            expr = make<BorrowExpr>(make_span(start), false, expr);
+        }
+        return expr;
     }
     
     return parse_call();
 }
 
-std::unique_ptr<Expr> Parser::parse_call() {
-    size_t start = pos;
+Expr* Parser::parse_call() {
+    size_t start = start_offset();
     auto expr = parse_primary();
     
-    while (true) {
-        skip_whitespace();
-        if (match("(")) {
-            std::vector<std::unique_ptr<Expr>> args;
-            
-            skip_whitespace();
-            if (!peek(")")) {
-                do {
-                    args.push_back(parse_expr());
-                    skip_whitespace();
-                } while (match(","));
-            }
-            
-            expect(")");
-            expr = std::make_unique<CallExpr>(
-                make_span(start),
-                std::move(expr),
-                std::move(args)
-            );
-        } else {
-            break;
+    while (match(TokenKind::LeftParen)) {
+        size_t first = pending_args.size();
+        
+        if (!check(TokenKind::RightParen)) {
+            do {
+                Expr* arg = parse_expr();
+                pending_args.push_back(arg);
+            } while (match(TokenKind::Comma));
         }
+        
+        expect(TokenKind::RightParen);
+        auto args = arena->copy_array(pending_args.data() + first, pending_args.size() - first);
+        pending_args.resize(first);
+        expr = make<CallExpr>(
+            make_span(start),
+            expr,
+            args
+        );
     }
     
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::parse_primary() {
-    size_t start = pos;
-    skip_whitespace();
-    
-    if (std::isdigit(source[pos])) {
-        return std::make_unique<IntLiteral>(make_span(start), consume_integer());
-    }
-    
-    if (match("true")) {
-        return std::make_unique<BoolLiteral>(make_span(start), true);
-    }
-    
-    if (match("false")) {
-        return std::make_unique<BoolLiteral>(make_span(start), false);
-    }
-    
-    if (source[pos] == '"') {
-        return std::make_unique<StringLiteral>(make_span(start), consume_string());
-    }
-    
-    if (std::isalpha(source[pos]) || source[pos] == '_') {
-        auto ident = std::make_unique<Identifier>(make_span(start), consume_identifier());
-        // Check if identifier is mutable in current scope
-        // This will be used by the type checker
-        return ident;
-    }
-    
-    if (match("(")) {
-        auto expr = parse_expr();
-        expect(")");
-        return expr;
+Expr* Parser::parse_primary() {
+    size_t start = start_offset();
+    const Token& token = current();
+    
+    switch (token.kind) {
+        case TokenKind::Integer:
+            pos++;
+            return make<IntLiteral>(make_span(start), static_cast<int>(token.payload));
+        case TokenKind::True:
+            pos++;
+            return make<BoolLiteral>(make_span(start), true);
+        case TokenKind::False:
+            pos++;
+            return make<BoolLiteral>(make_span(start), false);
+        case TokenKind::String:
+            pos++;
+            return make<StringLiteral>(make_span(start), tokens.strings[token.payload]);
+        case TokenKind::Identifier:
+            // Mutability of the binding is filled in by the type checker
+            return make<Identifier>(make_span(start), consume_identifier());
+        case TokenKind::LeftParen: {
+            pos++;
+            auto expr = parse_expr();
+            expect(TokenKind::RightParen);
+            return expr;
+        }
+        default:
+            error("Expected expression");
     }
-    
-    error("Expected expression");
-    return nullptr;
 }
 
-bool Parser::match(const std::string& expected) {
-    if (source.compare(pos, expected.length(), expected) == 0) {
-        advance(expected.length());
+bool Parser::match(TokenKind kind) {
+    if (check(kind)) {
+        pos++;
         return true;
     }
     return false;
 }
 
-bool Parser::peek(const std::string& expected) {
-    return source.compare(pos, expected.length(), expected) == 0;
-}
-
-void Parser::expect(const std::string& expected) {
-    if (!match(expected)) {
+const Token& Parser::expect(TokenKind kind) {
+    if (!check(kind)) {
         std::stringstream ss;
-        ss << "Expected '" << expected << "'";
+        ss << "Expected " << token_kind_name(kind);
         error(ss.str());
     }
+    return tokens.tokens[pos++];
 }
 
-std::string Parser::consume_identifier() {
-    size_t start = pos;
-    
-    if (!std::isalpha(source[pos]) && source[pos] != '_') {
-        error("Expected identifier");
-    }
-    
-    while (pos < source.length() && 
-           (std::isalnum(source[pos]) || source[pos] == '_')) {
-        advance();
-    }
-    
-    return source.substr(start, pos - start);
+Symbol Parser::consume_identifier() {
+    return tokens.names[expect(TokenKind::Identifier).payload];
 }
 
-int Parser::consume_integer() {
-    size_t start = pos;
-    
-    while (pos < source.length() && std::isdigit(source[pos])) {
-        advance();
-    }
-    
-    return std::stoi(source.substr(start, pos - start));
+void Parser::error(const std::string& message) {
+    size_t offset = start_offset();
+    SourceLocation location = LineTable(source).locate(offset);
+    std::stringstream ss;
+    ss << "Error at line " << location.line << ", column " << location.column
+       << " (position " << offset << "): " << message;
+    throw std::runtime_error(ss.str());
 }
 
-std::string Parser::consume_string() {
-    if (source[pos] != '"') {
-        error("Expected string");
-    }
-    advance(); // Skip opening quote
-    
-    size_t start = pos;
-    while (pos < source.length() && source[pos] != '"') {
-        if (source[pos] == '\\') {
-            advance(); // Skip escape character
-            if (pos >= source.length()) {
-                error("Unterminated string");
-            }
-        }
-        advance();
-    }
-    
-    if (pos >= source.length()) {
-        error("Unterminated string");
-    }
-    
-    std::string value = source.substr(start, pos - start);
-    advance(); // Skip closing quote
-    return value;
-}
+namespace {
 
-void Parser::skip_whitespace() {
-    while (pos < source.length()) {
-        // Skip whitespace characters
-        if (std::isspace(source[pos]) || source[pos] == '\n' || source[pos] == '\r') {
-            advance();
-            continue;
+bool contains_effect(const Expr* expr, bool calls) {
+    if (!expr) {
+        return false;
+    }
+    switch (expr->kind) {
+        case NodeKind::BinaryExpr: {
+            auto binary = static_cast<const BinaryExpr*>(expr);
+            return binary->op == BinaryExpr::Op::Assignment ||
+                   contains_effect(binary->left, calls) || contains_effect(binary->right, calls);
         }
-        
-        // Handle comments
-        if (pos + 1 < source.length() && source[pos] == '/' && source[pos + 1] == '/') {
-            // Skip until we find a newline or reach the end
-            advance(); // Skip first '/'
-            advance(); // Skip second '/'
-            while (pos < source.length() && source[pos] != '\n' && source[pos] != '\r') {
-                advance();
+        case NodeKind::UnaryExpr:
+            return contains_effect(static_cast<const UnaryExpr*>(expr)->expr, calls);
+        case NodeKind::BorrowExpr:
+            return contains_effect(static_cast<const BorrowExpr*>(expr)->expr, calls);
+        case NodeKind::CallExpr:
+            if (calls) {
+                return true;
             }
-            continue;
-        }
-        
-        break;
+            for (const Expr* arg : static_cast<const CallExpr*>(expr)->args) {
+                if (contains_effect(arg, calls)) {
+                    return true;
+                }
+            }
+            return false;
+        default:
+            return false;
     }
 }
 
-bool Parser::at_end() {
-    return pos >= source.length();
-}
+} // namespace
 
-void Parser::error(const std::string& message) {
-    std::stringstream ss;
-    ss << "Error at line " << line << ", column " << column << " (position " << pos << "): " << message;
-    throw std::runtime_error(ss.str());
-}
-
-std::shared_ptr<Scope> Parser::enter_scope() {
-    auto new_scope = std::make_shared<Scope>(current_scope);
-    current_scope = new_scope;
-    return new_scope;
-}
-
-void Parser::exit_scope() {
-    if (auto parent = current_scope->parent.lock()) {
-        current_scope = parent;
-    }
+bool contains_assignment(const Expr* expr) {
+    return contains_effect(expr, false);
 }
 
-void Parser::advance(size_t count) {
-    for (size_t i = 0; i < count && pos < source.length(); i++) {
-        if (source[pos] == '\n') {
-            line++;
-            column = 1;
-        } else {
-            column++;
-        }
-        pos++;
-    }
+bool has_side_effects(const Expr* expr) {
+    return contains_effect(expr, true);
 }
 
 } // namespace nust
\ No newline at end of file
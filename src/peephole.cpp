@@ -0,0 +1,280 @@
+#include "peephole.h"
+
+namespace nust {
+
+namespace {
+
+bool pushes_without_side_effects(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::PUSH_I32:
+        case Opcode::PUSH_BOOL:
+        case Opcode::PUSH_STR:
+        case Opcode::LOAD:
+        case Opcode::DUP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Mark every instruction that control can arrive at other than by falling
+// through: jump targets and function entry points. The extra last element
+// stands for the end of the code.
+std::vector<bool> find_targets(const std::vector<Instruction>& instructions,
+                               const FunctionTable& function_table) {
+    std::vector<bool> targets(instructions.size() + 1, false);
+    for (const auto& instr : instructions) {
+        if (is_jump(instr.opcode) && instr.operand < targets.size()) {
+            targets[instr.operand] = true;
+        }
+    }
+    for (size_t i = 0; i < function_table.size(); ++i) {
+        size_t entry = function_table.get_function(i).entry_point;
+        if (entry < targets.size()) {
+            targets[entry] = true;
+        }
+    }
+    return targets;
+}
+
+// Replace `instructions` with `out`, where new_index maps every old position
+// (plus the end) to its position in `out`, and re-patch jumps and entry
+// points to match.
+void relocate(std::vector<Instruction>& instructions, std::vector<Instruction>& out,
+              const std::vector<size_t>& new_index, FunctionTable& function_table) {
+    size_t old_size = instructions.size();
+    auto remap = [&](size_t target) {
+        // Targets past the end keep their distance from it
+        return target <= old_size ? new_index[target] : target - old_size + out.size();
+    };
+
+    for (auto& instr : out) {
+        if (is_jump(instr.opcode)) {
+            instr.operand = remap(instr.operand);
+        }
+    }
+    for (size_t i = 0; i < function_table.size(); ++i) {
+        function_table.set_entry_point(i, remap(function_table.get_function(i).entry_point));
+    }
+    instructions = std::move(out);
+}
+
+// Drop instructions whose keep flag is false
+void compact(std::vector<Instruction>& instructions, const std::vector<bool>& keep,
+             FunctionTable& function_table) {
+    std::vector<Instruction> out;
+    std::vector<size_t> new_index(instructions.size() + 1);
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        new_index[i] = out.size();
+        if (keep[i]) {
+            out.push_back(instructions[i]);
+        }
+    }
+    new_index[instructions.size()] = out.size();
+    relocate(instructions, out, new_index, function_table);
+}
+
+} // namespace
+
+PeepholeOptimizer::PeepholeOptimizer() {
+    // Assignment used as a statement: STORE n; LOAD n; POP => STORE n
+    add_rule({"store_load_pop", [](const Instruction* w, size_t size, size_t& consumed,
+                                   std::vector<Instruction>& replacement) {
+        if (size >= 3 && w[0].opcode == Opcode::STORE && w[1].opcode == Opcode::LOAD &&
+            w[0].operand == w[1].operand && w[2].opcode == Opcode::POP) {
+            consumed = 3;
+            replacement = {w[0]};
+            return true;
+        }
+        return false;
+    }});
+
+    // Value computed only to be discarded: PUSH x; POP => (nothing)
+    add_rule({"push_pop", [](const Instruction* w, size_t size, size_t& consumed,
+                             std::vector<Instruction>&) {
+        if (size >= 2 && pushes_without_side_effects(w[0].opcode) && w[1].opcode == Opcode::POP) {
+            consumed = 2;
+            return true;
+        }
+        return false;
+    }});
+
+    // Negated branch: NOT; JMP_IF_NOT t => JMP_IF t (and vice versa)
+    add_rule({"not_branch", [](const Instruction* w, size_t size, size_t& consumed,
+                               std::vector<Instruction>& replacement) {
+        if (size >= 2 && w[0].opcode == Opcode::NOT &&
+            (w[1].opcode == Opcode::JMP_IF || w[1].opcode == Opcode::JMP_IF_NOT)) {
+            consumed = 2;
+            Opcode flipped = w[1].opcode == Opcode::JMP_IF ? Opcode::JMP_IF_NOT : Opcode::JMP_IF;
+            replacement = {Instruction{flipped, w[1].operand}};
+            return true;
+        }
+        return false;
+    }});
+
+    // Double negation: NEG; NEG or NOT; NOT => (nothing)
+    add_rule({"double_negation", [](const Instruction* w, size_t size, size_t& consumed,
+                                    std::vector<Instruction>&) {
+        if (size >= 2 && w[0].opcode == w[1].opcode &&
+            (w[0].opcode == Opcode::NEG_I32 || w[0].opcode == Opcode::NOT)) {
+            consumed = 2;
+            return true;
+        }
+        return false;
+    }});
+}
+
+void PeepholeOptimizer::add_rule(Rule rule) {
+    rules_.push_back(std::move(rule));
+}
+
+void PeepholeOptimizer::run(std::vector<Instruction>& instructions, FunctionTable& function_table) {
+    stats_ = Stats();
+    stats_.before = instructions.size();
+
+    // Each transformation can expose more work for the others
+    constexpr int max_iterations = 16;
+    for (int i = 0; i < max_iterations; ++i) {
+        bool changed = thread_jumps(instructions);
+        changed |= remove_dead_code(instructions, function_table);
+        changed |= apply_rules(instructions, function_table);
+        if (!changed) {
+            break;
+        }
+    }
+
+    stats_.after = instructions.size();
+}
+
+bool PeepholeOptimizer::apply_rules(std::vector<Instruction>& instructions,
+                                    FunctionTable& function_table) {
+    size_t n = instructions.size();
+    std::vector<bool> targets = find_targets(instructions, function_table);
+
+    // A window may start at a jump target but must not run into the next one
+    std::vector<size_t> next_target(n + 1, n);
+    for (size_t i = n; i-- > 0;) {
+        next_target[i] = (i + 1 < n && targets[i + 1]) ? i + 1 : next_target[i + 1];
+    }
+
+    std::vector<Instruction> out;
+    std::vector<size_t> new_index(n + 1);
+    bool changed = false;
+
+    size_t i = 0;
+    while (i < n) {
+        size_t window = next_target[i] - i;
+        bool matched = false;
+        for (const auto& rule : rules_) {
+            size_t consumed = 0;
+            std::vector<Instruction> replacement;
+            if (rule.apply(&instructions[i], window, consumed, replacement) &&
+                consumed > 0 && consumed <= window) {
+                for (size_t k = i; k < i + consumed; ++k) {
+                    new_index[k] = out.size();
+                }
+                out.insert(out.end(), replacement.begin(), replacement.end());
+                record_hit(rule.name);
+                i += consumed;
+                matched = true;
+                changed = true;
+                break;
+            }
+        }
+        if (!matched) {
+            new_index[i] = out.size();
+            out.push_back(instructions[i]);
+            i++;
+        }
+    }
+    new_index[n] = out.size();
+
+    if (changed) {
+        relocate(instructions, out, new_index, function_table);
+    }
+    return changed;
+}
+
+bool PeepholeOptimizer::thread_jumps(std::vector<Instruction>& instructions) {
+    size_t n = instructions.size();
+    bool changed = false;
+
+    for (size_t i = 0; i < n; ++i) {
+        Instruction& instr = instructions[i];
+        if (!is_jump(instr.opcode)) {
+            continue;
+        }
+
+        // Follow chains of unconditional jumps to their final destination
+        size_t target = instr.operand;
+        for (size_t hops = 0; hops < n && target < n &&
+             instructions[target].opcode == Opcode::JMP &&
+             instructions[target].operand != target; ++hops) {
+            target = instructions[target].operand;
+        }
+        if (target != instr.operand) {
+            instr.operand = target;
+            record_hit("jump_threading");
+            changed = true;
+        }
+
+        // A conditional jump to the next instruction only has to drop its
+        // condition
+        if ((instr.opcode == Opcode::JMP_IF || instr.opcode == Opcode::JMP_IF_NOT) &&
+            instr.operand == i + 1) {
+            instr = Instruction{Opcode::POP};
+            record_hit("jump_to_next");
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool PeepholeOptimizer::remove_dead_code(std::vector<Instruction>& instructions,
+                                         FunctionTable& function_table) {
+    size_t n = instructions.size();
+    std::vector<bool> targets = find_targets(instructions, function_table);
+    std::vector<bool> keep(n, true);
+    bool changed = false;
+
+    for (size_t i = 0; i < n; ++i) {
+        Opcode opcode = instructions[i].opcode;
+        if (opcode == Opcode::JMP && instructions[i].operand == i + 1) {
+            // Unconditional jump to the next instruction
+            keep[i] = false;
+            record_hit("jump_to_next");
+            changed = true;
+            continue;
+        }
+        if (opcode != Opcode::JMP && opcode != Opcode::RET && opcode != Opcode::RET_VAL) {
+            continue;
+        }
+        // Nothing after an unconditional transfer is reachable until the
+        // next instruction that something jumps to
+        size_t j = i + 1;
+        while (j < n && !targets[j]) {
+            keep[j] = false;
+            record_hit("dead_code");
+            changed = true;
+            j++;
+        }
+        i = j - 1;
+    }
+
+    if (changed) {
+        compact(instructions, keep, function_table);
+    }
+    return changed;
+}
+
+void PeepholeOptimizer::record_hit(const std::string& rule) {
+    for (auto& [name, count] : stats_.rule_hits) {
+        if (name == rule) {
+            count++;
+            return;
+        }
+    }
+    stats_.rule_hits.emplace_back(rule, 1);
+}
+
+} // namespace nust
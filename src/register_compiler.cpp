@@ -0,0 +1,312 @@
+#include "register_compiler.h"
+#include <stdexcept>
+#include <algorithm>
+
+namespace nust {
+
+RegisterCompiler::RegisterCompiler() : num_locals(0), next_temp(0), max_registers(0) {}
+
+std::vector<RegInstruction> RegisterCompiler::compile(const Program& program) {
+    return compile(program, SignatureIndex(program));
+}
+
+std::vector<RegInstruction> RegisterCompiler::compile(const Program&, const SignatureIndex& signatures) {
+    // Reset state
+    instructions.clear();
+    string_constants.clear();
+
+    if (!signatures.has_main()) {
+        throw std::runtime_error("No main() function found");
+    }
+
+    // The table follows the index (main first), then compile in that order
+    function_table = FunctionTable(signatures);
+    for (size_t i = 0; i < signatures.size(); i++) {
+        compile_function(signatures[i].decl, i);
+    }
+
+    return instructions;
+}
+
+void RegisterCompiler::compile_function(const FunctionDecl* func, size_t func_index) {
+    size_t entry_point = instructions.size();
+
+    // Parameters take the first registers, then every let binding and
+    // distinct integer constant in the body. Temporaries are allocated above
+    // all of them.
+    slot_registers.assign(func->num_slots, unassigned);
+    constant_registers.clear();
+    num_locals = 0;
+    for (size_t i = 0; i < func->params.size(); i++) {
+        slot_registers[i] = num_locals++;
+    }
+    collect_registers(func->body);
+    next_temp = num_locals;
+    max_registers = num_locals;
+
+    // Constants are loaded once on entry rather than at every use
+    for (const auto& [value, reg] : constant_registers) {
+        emit(RegOpcode::LOADK_I32, reg, static_cast<uint32_t>(value));
+    }
+
+    compile_statement(func->body);
+
+    // If function has no explicit return, add one
+    if (instructions.size() == entry_point || instructions.back().opcode != RegOpcode::RET_VAL) {
+        emit(RegOpcode::RET);
+    }
+
+    function_table.set_entry_point(func_index, entry_point);
+    function_table.set_num_locals(func_index, max_registers);
+}
+
+void RegisterCompiler::collect_registers(const Stmt* stmt) {
+    if (auto let = node_cast<LetStmt>(stmt)) {
+        collect_registers(let->init);
+        if (slot_registers[let->slot] == unassigned) {
+            slot_registers[let->slot] = num_locals++;
+        }
+    } else if (auto if_stmt = node_cast<IfStmt>(stmt)) {
+        collect_registers(if_stmt->condition);
+        collect_registers(if_stmt->then_branch);
+        if (if_stmt->else_branch) {
+            collect_registers(if_stmt->else_branch);
+        }
+    } else if (auto while_stmt = node_cast<WhileStmt>(stmt)) {
+        collect_registers(while_stmt->condition);
+        collect_registers(while_stmt->body);
+    } else if (auto block = node_cast<BlockStmt>(stmt)) {
+        for (const auto& s : block->statements) {
+            collect_registers(s);
+        }
+    } else if (auto expr = node_cast<ExprStmt>(stmt)) {
+        collect_registers(expr->expr);
+    } else if (auto ret = node_cast<ReturnStmt>(stmt)) {
+        if (ret->value) {
+            collect_registers(ret->value);
+        }
+    }
+}
+
+void RegisterCompiler::collect_registers(const Expr* expr) {
+    if (auto int_lit = node_cast<IntLiteral>(expr)) {
+        if (constant_registers.find(int_lit->value) == constant_registers.end()) {
+            constant_registers[int_lit->value] = num_locals++;
+        }
+    } else if (auto binary = node_cast<BinaryExpr>(expr)) {
+        collect_registers(binary->left);
+        collect_registers(binary->right);
+    } else if (auto unary = node_cast<UnaryExpr>(expr)) {
+        collect_registers(unary->expr);
+    } else if (auto borrow = node_cast<BorrowExpr>(expr)) {
+        collect_registers(borrow->expr);
+    } else if (auto call = node_cast<CallExpr>(expr)) {
+        for (const auto& arg : call->args) {
+            collect_registers(arg);
+        }
+    }
+}
+
+void RegisterCompiler::compile_statement(const Stmt* stmt) {
+    // Temporaries never outlive a statement
+    next_temp = num_locals;
+
+    if (auto let = node_cast<LetStmt>(stmt)) {
+        compile_into(let->init, slot_registers[let->slot]);
+    } else if (auto if_stmt = node_cast<IfStmt>(stmt)) {
+        compile_if(if_stmt);
+    } else if (auto while_stmt = node_cast<WhileStmt>(stmt)) {
+        compile_while(while_stmt);
+    } else if (auto block = node_cast<BlockStmt>(stmt)) {
+        for (const auto& s : block->statements) {
+            compile_statement(s);
+        }
+    } else if (auto expr = node_cast<ExprStmt>(stmt)) {
+        // The result register is simply left unused
+        compile_expression(expr->expr);
+    } else if (auto ret = node_cast<ReturnStmt>(stmt)) {
+        if (ret->value) {
+            uint32_t reg = compile_expression(ret->value);
+            emit(RegOpcode::RET_VAL, 0, reg);
+        } else {
+            emit(RegOpcode::RET);
+        }
+    }
+}
+
+void RegisterCompiler::compile_if(const IfStmt* if_stmt) {
+    uint32_t cond = compile_expression(if_stmt->condition);
+    size_t else_jump = emit(RegOpcode::JMP_IF_NOT, 0, cond, 0);
+
+    compile_statement(if_stmt->then_branch);
+
+    size_t end_jump = 0;
+    if (if_stmt->else_branch) {
+        end_jump = emit(RegOpcode::JMP);
+    }
+
+    instructions[else_jump].b = static_cast<uint32_t>(instructions.size());
+
+    if (if_stmt->else_branch) {
+        compile_statement(if_stmt->else_branch);
+        instructions[end_jump].a = static_cast<uint32_t>(instructions.size());
+    }
+}
+
+void RegisterCompiler::compile_while(const WhileStmt* while_stmt) {
+    size_t loop_start = instructions.size();
+
+    next_temp = num_locals;
+    uint32_t cond = compile_expression(while_stmt->condition);
+    size_t exit_jump = emit(RegOpcode::JMP_IF_NOT, 0, cond, 0);
+
+    compile_statement(while_stmt->body);
+
+    emit(RegOpcode::JMP, 0, static_cast<uint32_t>(loop_start));
+    instructions[exit_jump].b = static_cast<uint32_t>(instructions.size());
+}
+
+uint32_t RegisterCompiler::compile_expression(const Expr* expr, const uint32_t* target) {
+    if (auto binary = node_cast<BinaryExpr>(expr)) {
+        return compile_binary(binary, target);
+    } else if (auto unary = node_cast<UnaryExpr>(expr)) {
+        return compile_unary(unary, target);
+    } else if (auto int_lit = node_cast<IntLiteral>(expr)) {
+        // Loaded into its constant register in the prologue
+        return constant_registers.at(int_lit->value);
+    } else if (auto bool_lit = node_cast<BoolLiteral>(expr)) {
+        uint32_t dst = result_register(target);
+        emit(RegOpcode::LOADK_BOOL, dst, bool_lit->value ? 1 : 0);
+        return dst;
+    } else if (auto str_lit = node_cast<StringLiteral>(expr)) {
+        uint32_t dst = result_register(target);
+        uint32_t index = static_cast<uint32_t>(string_constants.size());
+        string_constants.push_back(str_lit->value);
+        emit(RegOpcode::LOADK_STR, dst, index);
+        return dst;
+    } else if (auto ident = node_cast<Identifier>(expr)) {
+        // Locals already live in a register; no instruction needed
+        return get_local_index(ident);
+    } else if (auto call = node_cast<CallExpr>(expr)) {
+        return compile_call(call, target);
+    } else if (auto borrow = node_cast<BorrowExpr>(expr)) {
+        uint32_t saved = next_temp;
+        uint32_t src = compile_expression(borrow->expr);
+        next_temp = saved;
+        uint32_t dst = result_register(target);
+        emit(borrow->is_mut ? RegOpcode::BORROW_MUT : RegOpcode::BORROW, dst, src);
+        return dst;
+    }
+    throw std::runtime_error("Unsupported expression");
+}
+
+uint32_t RegisterCompiler::compile_binary(const BinaryExpr* expr, const uint32_t* target) {
+    // Handle assignment: evaluate straight into the variable's register
+    if (expr->op == BinaryExpr::Op::Assignment) {
+        auto* lhs = node_cast<Identifier>(expr->left);
+        if (!lhs) {
+            throw std::runtime_error("Assignment target must be an identifier");
+        }
+        uint32_t var = get_local_index(lhs);
+        compile_into(expr->right, var);
+        return var;
+    }
+
+    // Operand temporaries can be reused for the result
+    uint32_t saved = next_temp;
+    uint32_t a = compile_expression(expr->left);
+    // A variable's own register would see an assignment on the right
+    // before the operation reads it; read it now, as the stack VM does
+    if (a < num_locals && contains_assignment(expr->right)) {
+        uint32_t copy = alloc_temp();
+        emit(RegOpcode::MOVE, copy, a);
+        a = copy;
+    }
+    uint32_t b = compile_expression(expr->right);
+    next_temp = saved;
+    uint32_t dst = result_register(target);
+
+    RegOpcode opcode;
+    switch (expr->op) {
+        case BinaryExpr::Op::Add: opcode = RegOpcode::ADD_I32; break;
+        case BinaryExpr::Op::Sub: opcode = RegOpcode::SUB_I32; break;
+        case BinaryExpr::Op::Mul: opcode = RegOpcode::MUL_I32; break;
+        case BinaryExpr::Op::Div: opcode = RegOpcode::DIV_I32; break;
+        case BinaryExpr::Op::Eq:  opcode = RegOpcode::EQ_I32; break;
+        case BinaryExpr::Op::Ne:  opcode = RegOpcode::NE_I32; break;
+        case BinaryExpr::Op::Lt:  opcode = RegOpcode::LT_I32; break;
+        case BinaryExpr::Op::Gt:  opcode = RegOpcode::GT_I32; break;
+        case BinaryExpr::Op::Le:  opcode = RegOpcode::LE_I32; break;
+        case BinaryExpr::Op::Ge:  opcode = RegOpcode::GE_I32; break;
+        case BinaryExpr::Op::And: opcode = RegOpcode::AND; break;
+        case BinaryExpr::Op::Or:  opcode = RegOpcode::OR; break;
+        default:
+            throw std::runtime_error("Unknown binary operator");
+    }
+    emit(opcode, dst, a, b);
+    return dst;
+}
+
+uint32_t RegisterCompiler::compile_unary(const UnaryExpr* expr, const uint32_t* target) {
+    uint32_t saved = next_temp;
+    uint32_t src = compile_expression(expr->expr);
+    next_temp = saved;
+    uint32_t dst = result_register(target);
+    emit(expr->op == UnaryExpr::Op::Neg ? RegOpcode::NEG_I32 : RegOpcode::NOT, dst, src);
+    return dst;
+}
+
+uint32_t RegisterCompiler::compile_call(const CallExpr* expr, const uint32_t* target) {
+    auto* callee = node_cast<Identifier>(expr->callee);
+    if (!callee) {
+        throw std::runtime_error("Function callee must be an identifier");
+    }
+    size_t func_index = function_table.get_function_index(callee->name);
+
+    // Arguments go into consecutive registers at the top of the frame; they
+    // become the callee's parameters in place
+    uint32_t saved = next_temp;
+    uint32_t arg_base = next_temp;
+    next_temp += static_cast<uint32_t>(expr->args.size());
+    max_registers = std::max(max_registers, next_temp);
+    for (size_t i = 0; i < expr->args.size(); ++i) {
+        compile_into(expr->args[i], arg_base + static_cast<uint32_t>(i));
+    }
+    next_temp = saved;
+
+    uint32_t dst = result_register(target);
+    emit(RegOpcode::CALL, dst, static_cast<uint32_t>(func_index), arg_base);
+    return dst;
+}
+
+void RegisterCompiler::compile_into(const Expr* expr, uint32_t dst) {
+    uint32_t reg = compile_expression(expr, &dst);
+    if (reg != dst) {
+        emit(RegOpcode::MOVE, dst, reg);
+    }
+}
+
+size_t RegisterCompiler::emit(RegOpcode opcode, uint32_t dst, uint32_t a, uint32_t b) {
+    size_t index = instructions.size();
+    instructions.emplace_back(opcode, dst, a, b);
+    return index;
+}
+
+uint32_t RegisterCompiler::alloc_temp() {
+    uint32_t reg = next_temp++;
+    max_registers = std::max(max_registers, next_temp);
+    return reg;
+}
+
+uint32_t RegisterCompiler::result_register(const uint32_t* target) {
+    return target ? *target : alloc_temp();
+}
+
+uint32_t RegisterCompiler::get_local_index(const Identifier* ident) {
+    if (ident->resolution != Resolution::Local) {
+        throw std::runtime_error("Undefined variable: " + ident->name.str());
+    }
+    return slot_registers[ident->slot];
+}
+
+} // namespace nust
@@ -0,0 +1,262 @@
+#include "register_vm.h"
+#include <stdexcept>
+#include <algorithm>
+#include <sstream>
+
+namespace nust {
+
+namespace {
+
+// The stack VM's operand checks, with its messages
+
+void require_int(const Value& a) {
+    if (!a.is_int()) {
+        throw std::runtime_error("Expected integer value");
+    }
+}
+
+void require_ints(const Value& a, const Value& b) {
+    if (!a.is_int() || !b.is_int()) {
+        throw std::runtime_error("Expected integer values");
+    }
+}
+
+void require_bool(const Value& a) {
+    if (!a.is_bool()) {
+        throw std::runtime_error("Expected boolean value");
+    }
+}
+
+void require_bools(const Value& a, const Value& b) {
+    if (!a.is_bool() || !b.is_bool()) {
+        throw std::runtime_error("Expected boolean values");
+    }
+}
+
+void require_ref(const Value& a) {
+    if (!a.is_ref()) {
+        throw std::runtime_error("Expected reference value");
+    }
+}
+
+} // namespace
+
+RegisterVM::RegisterVM(const FunctionTable& function_table,
+                       const std::vector<Value>& constants,
+                       const std::vector<RegInstruction>& instructions,
+                       CallStackConfig stack_config)
+    : function_table_(function_table)
+    , constants_(constants)
+    , instructions_(instructions)
+    , config_(stack_config)
+    , base_(0)
+    , pc_(0)
+    , executed_(0)
+{
+    size_t main_index = function_table_.get_function_index("main");
+    const auto& main_func = function_table_.get_function(main_index);
+    if (main_func.num_params != 0) {
+        throw std::runtime_error("main() function must take no parameters");
+    }
+
+    function_ = main_index;
+    if (main_func.num_locals > config_.max_slots) {
+        overflow(main_index, "stack size limit of " + std::to_string(config_.max_slots) + " slots reached");
+    }
+    registers_.resize(std::max(main_func.num_locals, std::min(config_.initial_slots, config_.max_slots)));
+    pc_ = main_func.entry_point;
+}
+
+void RegisterVM::run() {
+    const RegInstruction* code = instructions_.data();
+    const size_t code_size = instructions_.size();
+
+#define R(index) registers_[base_ + (index)]
+#define INT_OP(op) {                                               \
+        const Value& a = R(instr.a);                               \
+        const Value& b = R(instr.b);                               \
+        require_ints(a, b);                                        \
+        R(instr.dst) = Value(a.as_int() op b.as_int());            \
+        break;                                                     \
+    }
+#define ARITH_OP(fn) {                                             \
+        const Value& a = R(instr.a);                               \
+        const Value& b = R(instr.b);                               \
+        require_ints(a, b);                                        \
+        R(instr.dst) = Value(fn(a.as_int(), b.as_int()));          \
+        break;                                                     \
+    }
+#define BOOL_OP(op) {                                              \
+        const Value& a = R(instr.a);                               \
+        const Value& b = R(instr.b);                               \
+        require_bools(a, b);                                       \
+        R(instr.dst) = Value(a.as_bool() op b.as_bool());          \
+        break;                                                     \
+    }
+
+    while (pc_ < code_size) {
+        const RegInstruction& instr = code[pc_++];
+        executed_++;
+
+        switch (instr.opcode) {
+            case RegOpcode::LOADK_I32:
+                R(instr.dst) = Value(static_cast<Value::IntType>(instr.a));
+                break;
+            case RegOpcode::LOADK_BOOL:
+                R(instr.dst) = Value(instr.a != 0);
+                break;
+            case RegOpcode::LOADK_STR:
+                if (instr.a >= constants_.size()) {
+                    throw std::runtime_error("String constant index out of bounds");
+                }
+                R(instr.dst) = constants_[instr.a];
+                break;
+            case RegOpcode::MOVE:
+                R(instr.dst) = R(instr.a);
+                break;
+
+            case RegOpcode::ADD_I32: ARITH_OP(add_i32)
+            case RegOpcode::SUB_I32: ARITH_OP(sub_i32)
+            case RegOpcode::MUL_I32: ARITH_OP(mul_i32)
+            case RegOpcode::DIV_I32: {
+                const Value& a = R(instr.a);
+                const Value& b = R(instr.b);
+                require_ints(a, b);
+                if (b.as_int() == 0) {
+                    throw std::runtime_error("Division by zero");
+                }
+                R(instr.dst) = Value(divide_i32(a.as_int(), b.as_int()));
+                break;
+            }
+            case RegOpcode::NEG_I32:
+                require_int(R(instr.a));
+                R(instr.dst) = Value(neg_i32(R(instr.a).as_int()));
+                break;
+
+            case RegOpcode::EQ_I32: INT_OP(==)
+            case RegOpcode::NE_I32: INT_OP(!=)
+            case RegOpcode::LT_I32: INT_OP(<)
+            case RegOpcode::GT_I32: INT_OP(>)
+            case RegOpcode::LE_I32: INT_OP(<=)
+            case RegOpcode::GE_I32: INT_OP(>=)
+
+            case RegOpcode::AND: BOOL_OP(&&)
+            case RegOpcode::OR: BOOL_OP(||)
+            case RegOpcode::NOT:
+                require_bool(R(instr.a));
+                R(instr.dst) = Value(!R(instr.a).as_bool());
+                break;
+
+            case RegOpcode::JMP:
+                pc_ = instr.a;
+                break;
+            case RegOpcode::JMP_IF:
+                require_bool(R(instr.a));
+                if (R(instr.a).as_bool()) {
+                    pc_ = instr.b;
+                }
+                break;
+            case RegOpcode::JMP_IF_NOT:
+                require_bool(R(instr.a));
+                if (!R(instr.a).as_bool()) {
+                    pc_ = instr.b;
+                }
+                break;
+
+            case RegOpcode::CALL: {
+                if (instr.a >= function_table_.size()) {
+                    throw std::runtime_error("Function index out of bounds");
+                }
+                const auto& func_info = function_table_.get_function(instr.a);
+                // Frames below this call plus the current one
+                if (frames_.size() + 1 >= config_.max_depth) {
+                    overflow(instr.a, "call depth limit of " + std::to_string(config_.max_depth) + " reached");
+                }
+                size_t callee_base = base_ + instr.b;
+                if (callee_base + func_info.num_locals > config_.max_slots) {
+                    overflow(instr.a, "stack size limit of " + std::to_string(config_.max_slots) + " slots reached");
+                }
+                frames_.push_back(Frame{function_, pc_, base_, instr.dst, ref_heap_.size()});
+                base_ = callee_base;
+                function_ = instr.a;
+                ensure_registers(base_ + func_info.num_locals);
+                pc_ = func_info.entry_point;
+                break;
+            }
+            case RegOpcode::RET:
+            case RegOpcode::RET_VAL: {
+                Value ret_val = instr.opcode == RegOpcode::RET_VAL ? R(instr.a) : Value();
+                if (frames_.empty()) {
+                    // Returning from main stops the VM
+                    if (instr.opcode == RegOpcode::RET_VAL) {
+                        result_ = ret_val;
+                    }
+                    return;
+                }
+                Frame frame = frames_.back();
+                frames_.pop_back();
+                // A returned reference may point at one of the frame's
+                // boxes; they are then left to the caller
+                if (!ret_val.is_ref()) {
+                    ref_heap_.resize(frame.boxes);
+                }
+                function_ = frame.function;
+                base_ = frame.base;
+                pc_ = frame.return_pc;
+                R(frame.dst) = ret_val;
+                break;
+            }
+
+            case RegOpcode::BORROW:
+            case RegOpcode::BORROW_MUT:
+                R(instr.dst) = Value(box(R(instr.a)));
+                break;
+            case RegOpcode::DEREF:
+                require_ref(R(instr.a));
+                R(instr.dst) = *R(instr.a).as_ref();
+                break;
+
+            default:
+                throw std::runtime_error("Unknown opcode");
+        }
+    }
+
+#undef BOOL_OP
+#undef ARITH_OP
+#undef INT_OP
+#undef R
+}
+
+Value RegisterVM::get_result() const {
+    return result_;
+}
+
+uint64_t RegisterVM::instructions_executed() const {
+    return executed_;
+}
+
+void RegisterVM::ensure_registers(size_t count) {
+    if (count > registers_.size()) {
+        registers_.resize(std::min(std::max(count, registers_.size() * 2), config_.max_slots));
+    }
+}
+
+void RegisterVM::overflow(size_t function_index, const std::string& reason) const {
+    std::vector<size_t> function_indices;
+    function_indices.reserve(frames_.size() + 1);
+    for (const auto& frame : frames_) {
+        function_indices.push_back(frame.function);
+    }
+    function_indices.push_back(function_);
+    std::stringstream ss;
+    ss << "Stack overflow calling " << function_table_.get_function(function_index).name
+       << ": " << reason << "\nCall chain: " << format_call_chain(function_table_, function_indices);
+    throw StackOverflowError(ss.str());
+}
+
+Value::RefType RegisterVM::box(const Value& value) {
+    ref_heap_.push_back(value);
+    return &ref_heap_.back();
+}
+
+} // namespace nust
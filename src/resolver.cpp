@@ -0,0 +1,195 @@
+#include "resolver.h"
+#include <algorithm>
+
+namespace nust {
+
+void Resolver::resolve(const Program& program) {
+    is_function_.clear();
+    for (const auto& item : program.items) {
+        if (auto func = node_cast<FunctionDecl>(item)) {
+            size_t id = func->name.id();
+            if (id >= is_function_.size()) {
+                is_function_.resize(id + 1, 0);
+            }
+            is_function_[id] = 1;
+        }
+    }
+    for (const auto& item : program.items) {
+        if (auto func = node_cast<FunctionDecl>(item)) {
+            resolve_function(*func);
+        }
+    }
+}
+
+void Resolver::resolve_function(const FunctionDecl& func) {
+    function_ = &func;
+    func.functions_used.clear();
+
+    // Arguments arrive in the first slots, one per parameter
+    next_slot_ = 0;
+    num_slots_ = 0;
+    enter_scope();
+    for (const auto& param : func.params) {
+        declare(param.name, param.is_mut, param.redeclares);
+    }
+    if (func.body) {
+        resolve_statement(func.body);
+    }
+    exit_scope();
+
+    func.num_bindings = static_cast<uint32_t>(bindings_.size());
+    func.num_slots = num_slots_;
+
+    // exit_scope already emptied visible_
+    bindings_.clear();
+}
+
+void Resolver::resolve_statement(const Stmt* stmt) {
+    switch (stmt->kind) {
+        case NodeKind::LetStmt: {
+            auto* let = static_cast<const LetStmt*>(stmt);
+            // The initializer can't see the name it initializes
+            if (let->init) {
+                resolve_expression(let->init);
+            }
+            let->binding = declare(let->name, let->is_mut, let->redeclares);
+            let->slot = bindings_[let->binding].slot;
+            break;
+        }
+        case NodeKind::ExprStmt:
+            resolve_expression(static_cast<const ExprStmt*>(stmt)->expr);
+            break;
+        case NodeKind::ReturnStmt: {
+            auto* ret = static_cast<const ReturnStmt*>(stmt);
+            if (ret->value) {
+                resolve_expression(ret->value);
+            }
+            break;
+        }
+        case NodeKind::IfStmt: {
+            auto* if_stmt = static_cast<const IfStmt*>(stmt);
+            resolve_expression(if_stmt->condition);
+            enter_scope();
+            resolve_statement(if_stmt->then_branch);
+            exit_scope();
+            if (if_stmt->else_branch) {
+                enter_scope();
+                resolve_statement(if_stmt->else_branch);
+                exit_scope();
+            }
+            break;
+        }
+        case NodeKind::WhileStmt: {
+            auto* while_stmt = static_cast<const WhileStmt*>(stmt);
+            resolve_expression(while_stmt->condition);
+            enter_scope();
+            resolve_statement(while_stmt->body);
+            exit_scope();
+            break;
+        }
+        case NodeKind::BlockStmt:
+            enter_scope();
+            for (const auto& inner : static_cast<const BlockStmt*>(stmt)->statements) {
+                resolve_statement(inner);
+            }
+            exit_scope();
+            break;
+        default:
+            break;
+    }
+}
+
+void Resolver::resolve_expression(const Expr* expr) {
+    switch (expr->kind) {
+        case NodeKind::Identifier: {
+            auto* ident = static_cast<const Identifier*>(expr);
+            size_t id = ident->name.id();
+            if (id < is_function_.size() && is_function_[id]) {
+                ident->resolution = Resolution::Function;
+                function_->functions_used.push_back(ident->name);
+            } else {
+                resolve_local(ident);
+            }
+            break;
+        }
+        case NodeKind::BinaryExpr: {
+            auto* binary = static_cast<const BinaryExpr*>(expr);
+            // An assignment target is always a variable, even if a function
+            // shares its name
+            auto* target = binary->op == BinaryExpr::Op::Assignment ? node_cast<Identifier>(binary->left) : nullptr;
+            if (target) {
+                resolve_local(target);
+            } else {
+                resolve_expression(binary->left);
+            }
+            resolve_expression(binary->right);
+            break;
+        }
+        case NodeKind::UnaryExpr:
+            resolve_expression(static_cast<const UnaryExpr*>(expr)->expr);
+            break;
+        case NodeKind::BorrowExpr:
+            resolve_expression(static_cast<const BorrowExpr*>(expr)->expr);
+            break;
+        case NodeKind::CallExpr: {
+            auto* call = static_cast<const CallExpr*>(expr);
+            resolve_expression(call->callee);
+            for (const auto& arg : call->args) {
+                resolve_expression(arg);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void Resolver::resolve_local(const Identifier* ident) {
+    size_t id = ident->name.id();
+    uint32_t binding = id < visible_.size() ? visible_[id] : none;
+    if (binding == none) {
+        ident->resolution = Resolution::Unresolved;
+        return;
+    }
+    ident->resolution = Resolution::Local;
+    ident->binding = binding;
+    ident->slot = bindings_[binding].slot;
+    ident->is_mut_binding = bindings_[binding].is_mut;
+}
+
+uint32_t& Resolver::entry(std::vector<uint32_t>& table, Symbol name) {
+    if (name.id() >= table.size()) {
+        table.resize(name.id() + 1, none);
+    }
+    return table[name.id()];
+}
+
+uint32_t Resolver::declare(Symbol name, bool is_mut, bool& redeclares) {
+    uint32_t binding = static_cast<uint32_t>(bindings_.size());
+    uint32_t depth = static_cast<uint32_t>(scopes_.size());
+    uint32_t slot = next_slot_++;
+    num_slots_ = std::max(num_slots_, next_slot_);
+    bindings_.push_back({slot, is_mut, depth});
+
+    uint32_t& visible = entry(visible_, name);
+    redeclares = visible != none && bindings_[visible].depth == depth;
+    hidden_.push_back({name, visible});
+    visible = binding;
+    return binding;
+}
+
+void Resolver::enter_scope() {
+    scopes_.push_back({hidden_.size(), next_slot_});
+}
+
+void Resolver::exit_scope() {
+    Scope scope = scopes_.back();
+    scopes_.pop_back();
+    next_slot_ = scope.slot_start;
+    while (hidden_.size() > scope.hidden_start) {
+        visible_[hidden_.back().name.id()] = hidden_.back().previous;
+        hidden_.pop_back();
+    }
+}
+
+} // namespace nust
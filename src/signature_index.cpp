@@ -0,0 +1,43 @@
+#include "signature_index.h"
+
+namespace nust {
+
+SignatureIndex::SignatureIndex(const Program& program) {
+    const Symbol main_name("main");
+    const FunctionDecl* main_func = nullptr;
+    std::vector<const FunctionDecl*> others;
+    for (const auto& item : program.items) {
+        if (auto func = node_cast<FunctionDecl>(item)) {
+            if (func->name == main_name && !main_func) {
+                main_func = func;
+            } else {
+                others.push_back(func);
+            }
+        }
+    }
+
+    signatures_.reserve(others.size() + 1);
+    auto add = [this](const FunctionDecl* func) {
+        FunctionSignature signature{func->name, func, {}, func->return_type};
+        signature.param_types.reserve(func->params.size());
+        for (const auto& param : func->params) {
+            signature.param_types.push_back(param.type);
+        }
+        by_name_.try_emplace(func->name, static_cast<uint32_t>(signatures_.size()));
+        signatures_.push_back(std::move(signature));
+    };
+    if (main_func) {
+        has_main_ = true;
+        add(main_func);
+    }
+    for (const auto* func : others) {
+        add(func);
+    }
+}
+
+const FunctionSignature* SignatureIndex::find(Symbol name) const {
+    auto it = by_name_.find(name);
+    return it == by_name_.end() ? nullptr : &signatures_[it->second];
+}
+
+} // namespace nust
@@ -0,0 +1,104 @@
+#include "superinstructions.h"
+#include <limits>
+
+namespace nust {
+
+namespace {
+
+// Operands of fused instructions are packed into 32 bits each
+bool fits(size_t operand) {
+    return operand <= std::numeric_limits<uint32_t>::max();
+}
+
+// PUSH_I32 operands are stored as the sign-extended or zero-extended value;
+// either way the low 32 bits are the integer
+uint32_t int_operand(size_t operand) {
+    return static_cast<uint32_t>(operand);
+}
+
+bool fused_compare(Opcode compare, Opcode& fused) {
+    switch (compare) {
+        case Opcode::EQ_I32: fused = Opcode::CMP_EQ_JMP_IF_NOT; return true;
+        case Opcode::NE_I32: fused = Opcode::CMP_NE_JMP_IF_NOT; return true;
+        case Opcode::LT_I32: fused = Opcode::CMP_LT_JMP_IF_NOT; return true;
+        case Opcode::GT_I32: fused = Opcode::CMP_GT_JMP_IF_NOT; return true;
+        case Opcode::LE_I32: fused = Opcode::CMP_LE_JMP_IF_NOT; return true;
+        case Opcode::GE_I32: fused = Opcode::CMP_GE_JMP_IF_NOT; return true;
+        default: return false;
+    }
+}
+
+} // namespace
+
+SuperinstructionPass::SuperinstructionPass() {
+    engine_.clear_rules();
+
+    // Longest patterns first, so shorter fusions don't split them
+    engine_.add_rule({"inc_local", [](const Instruction* w, size_t size, size_t& consumed,
+                                      std::vector<Instruction>& replacement) {
+        if (size >= 4 && w[0].opcode == Opcode::LOAD && w[1].opcode == Opcode::PUSH_I32 &&
+            w[2].opcode == Opcode::ADD_I32 && w[3].opcode == Opcode::STORE &&
+            w[0].operand == w[3].operand && fits(w[0].operand)) {
+            consumed = 4;
+            replacement = {Instruction{Opcode::INC_LOCAL,
+                pack_operands(static_cast<uint32_t>(w[0].operand), int_operand(w[1].operand))}};
+            return true;
+        }
+        return false;
+    }});
+
+    engine_.add_rule({"load_load_add", [](const Instruction* w, size_t size, size_t& consumed,
+                                          std::vector<Instruction>& replacement) {
+        if (size >= 3 && w[0].opcode == Opcode::LOAD && w[1].opcode == Opcode::LOAD &&
+            w[2].opcode == Opcode::ADD_I32 && fits(w[0].operand) && fits(w[1].operand)) {
+            consumed = 3;
+            replacement = {Instruction{Opcode::LOAD_LOAD_ADD,
+                pack_operands(static_cast<uint32_t>(w[0].operand),
+                              static_cast<uint32_t>(w[1].operand))}};
+            return true;
+        }
+        return false;
+    }});
+
+    engine_.add_rule({"load_load", [](const Instruction* w, size_t size, size_t& consumed,
+                                      std::vector<Instruction>& replacement) {
+        if (size >= 2 && w[0].opcode == Opcode::LOAD && w[1].opcode == Opcode::LOAD &&
+            fits(w[0].operand) && fits(w[1].operand)) {
+            consumed = 2;
+            replacement = {Instruction{Opcode::LOAD_LOAD,
+                pack_operands(static_cast<uint32_t>(w[0].operand),
+                              static_cast<uint32_t>(w[1].operand))}};
+            return true;
+        }
+        return false;
+    }});
+
+    engine_.add_rule({"load_push_i32", [](const Instruction* w, size_t size, size_t& consumed,
+                                          std::vector<Instruction>& replacement) {
+        if (size >= 2 && w[0].opcode == Opcode::LOAD && w[1].opcode == Opcode::PUSH_I32 &&
+            fits(w[0].operand)) {
+            consumed = 2;
+            replacement = {Instruction{Opcode::LOAD_PUSH_I32,
+                pack_operands(static_cast<uint32_t>(w[0].operand), int_operand(w[1].operand))}};
+            return true;
+        }
+        return false;
+    }});
+
+    engine_.add_rule({"cmp_jmp_if_not", [](const Instruction* w, size_t size, size_t& consumed,
+                                           std::vector<Instruction>& replacement) {
+        Opcode fused;
+        if (size >= 2 && fused_compare(w[0].opcode, fused) && w[1].opcode == Opcode::JMP_IF_NOT) {
+            consumed = 2;
+            replacement = {Instruction{fused, w[1].operand}};
+            return true;
+        }
+        return false;
+    }});
+}
+
+void SuperinstructionPass::run(std::vector<Instruction>& instructions, FunctionTable& function_table) {
+    engine_.run(instructions, function_table);
+}
+
+} // namespace nust
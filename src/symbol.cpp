@@ -0,0 +1,44 @@
+#include "symbol.h"
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace nust {
+
+namespace {
+
+// Names live in a deque so the strings (and the views keying the map) never
+// move as the table grows
+struct SymbolTable {
+    std::mutex mutex;
+    std::deque<std::string> names{std::string()};
+    std::unordered_map<std::string_view, uint32_t> ids{{names.front(), 0}};
+};
+
+SymbolTable& table() {
+    static SymbolTable instance;
+    return instance;
+}
+
+} // namespace
+
+Symbol::Symbol(std::string_view name) {
+    SymbolTable& symbols = table();
+    std::lock_guard<std::mutex> lock(symbols.mutex);
+    auto found = symbols.ids.find(name);
+    if (found != symbols.ids.end()) {
+        id_ = found->second;
+        return;
+    }
+    id_ = static_cast<uint32_t>(symbols.names.size());
+    symbols.names.emplace_back(name);
+    symbols.ids.emplace(symbols.names.back(), id_);
+}
+
+const std::string& Symbol::str() const {
+    SymbolTable& symbols = table();
+    std::lock_guard<std::mutex> lock(symbols.mutex);
+    return symbols.names[id_];
+}
+
+} // namespace nust
@@ -0,0 +1,102 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace nust {
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 1; i < threads; i++) {
+        workers_.emplace_back([this] { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> job(job_mutex_);
+
+    // A few chunks per thread, so uneven work still spreads out
+    size_t target_chunks = size() * 4;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        body_ = &body;
+        count_ = count;
+        chunk_size_ = std::max<size_t>(1, (count + target_chunks - 1) / target_chunks);
+        num_chunks_ = (count + chunk_size_ - 1) / chunk_size_;
+        next_chunk_.store(0, std::memory_order_relaxed);
+        error_ = nullptr;
+        active_ = workers_.size();
+        generation_++;
+    }
+    wake_.notify_all();
+
+    run_chunks();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return active_ == 0; });
+        body_ = nullptr;
+        error = error_;
+        error_ = nullptr;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::worker_loop() {
+    size_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+        }
+        run_chunks();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--active_ == 0) {
+                done_.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::run_chunks() {
+    for (;;) {
+        size_t chunk = next_chunk_.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= num_chunks_) {
+            return;
+        }
+        size_t begin = chunk * chunk_size_;
+        size_t end = std::min(count_, begin + chunk_size_);
+        try {
+            (*body_)(begin, end);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+    }
+}
+
+} // namespace nust
@@ -0,0 +1,98 @@
+#include "type.h"
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace nust {
+
+namespace {
+
+// Owns every reference type; base types are static
+struct TypeTable {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<const Type>> references;
+};
+
+TypeTable& table() {
+    static TypeTable instance;
+    return instance;
+}
+
+constexpr uint32_t mask_bits = 64;
+
+} // namespace
+
+Type::Type(Kind kind, const Type* base_type, const Type* shared)
+    : kind(kind), base_type(base_type), shared_(shared ? shared : this) {
+    if (base_type) {
+        depth_ = base_type->depth_ + 1;
+        mut_levels_ = (base_type->mut_levels_ << 1) | (kind == Kind::MutRef ? 1 : 0);
+    }
+}
+
+const Type* Type::get(Kind kind, const Type* base_type) {
+    switch (kind) {
+        case Kind::I32: {
+            static const Type i32(Kind::I32, nullptr, nullptr);
+            return &i32;
+        }
+        case Kind::Bool: {
+            static const Type boolean(Kind::Bool, nullptr, nullptr);
+            return &boolean;
+        }
+        case Kind::Str: {
+            static const Type str(Kind::Str, nullptr, nullptr);
+            return &str;
+        }
+        case Kind::Ref:
+        case Kind::MutRef:
+            break;
+    }
+    if (!base_type) {
+        throw std::runtime_error("Reference type needs a base type");
+    }
+
+    auto& slot = base_type->references_[kind == Kind::MutRef ? 1 : 0];
+    if (const Type* existing = slot.load(std::memory_order_acquire)) {
+        return existing;
+    }
+
+    // Intern the shared form first, outside the lock: `&T` is its own
+    // shared type only when T is
+    const Type* shared = nullptr;
+    if (kind == Kind::MutRef || base_type->shared_ != base_type) {
+        shared = get(Kind::Ref, base_type->shared_);
+    }
+
+    TypeTable& types = table();
+    std::lock_guard<std::mutex> lock(types.mutex);
+    if (const Type* existing = slot.load(std::memory_order_relaxed)) {
+        return existing;
+    }
+    types.references.emplace_back(new Type(kind, base_type, shared));
+    const Type* created = types.references.back().get();
+    slot.store(created, std::memory_order_release);
+    return created;
+}
+
+bool Type::is_assignable_from(const Type* source) const {
+    if (this == source) {
+        return true;
+    }
+    if (shared_ != source->shared_) {
+        return false;
+    }
+    if (depth_ <= mask_bits) {
+        return (mut_levels_ & ~source->mut_levels_) == 0;
+    }
+    // Deeper than the mask covers: compare level by level
+    for (const Type* target = this; target; target = target->base_type, source = source->base_type) {
+        if (target->kind == Kind::MutRef && source->kind != Kind::MutRef) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace nust
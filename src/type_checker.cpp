@@ -1,14 +1,27 @@
 #include "type_checker.h"
 #include <sstream>
-#include <unordered_map>
 #include <iostream>
 
 namespace nust {
 
 bool TypeChecker::check_program(const Program& program) {
-    program_ = &program;
+    signatures_ = SignatureIndex(program);
+    callees_ = &signatures_;
+    if (pool_ && pool_->size() > 1) {
+        std::vector<const FunctionDecl*> functions;
+        for (const auto& item : program.items) {
+            auto func = node_cast<FunctionDecl>(item);
+            if (func && !(cache_ && cache_->find(*func))) {
+                functions.push_back(func);
+            }
+        }
+        return check_functions_in_parallel(functions) && !has_errors();
+    }
     for (const auto& item : program.items) {
-        if (auto func = dynamic_cast<const FunctionDecl*>(item.get())) {
+        if (auto func = node_cast<FunctionDecl>(item)) {
+            if (cache_ && cache_->find(*func)) {
+                continue;
+            }
             if (!check_function(*func)) {
                 return false;
             }
@@ -17,31 +30,61 @@ bool TypeChecker::check_program(const Program& program) {
     return !has_errors();
 }
 
-bool TypeChecker::check_function(const FunctionDecl& func) {
-    enter_scope();
+bool TypeChecker::check_functions_in_parallel(const std::vector<const FunctionDecl*>& functions) {
+    // Functions only share the signature index, so each chunk checks its
+    // functions with a worker of its own and keeps their errors apart
+    struct Result {
+        bool ok = true;
+        std::vector<std::string> errors;
+    };
+    std::vector<Result> results(functions.size());
+    pool_->parallel_for(functions.size(), [&](size_t begin, size_t end) {
+        TypeChecker worker;
+        worker.callees_ = &signatures_;
+        worker.echo_errors_ = false;
+        for (size_t i = begin; i < end; i++) {
+            results[i].ok = worker.check_function(*functions[i]);
+            results[i].errors = std::move(worker.errors_);
+            worker.errors_.clear();
+        }
+    });
     
-    // Add parameters to scope
-    for (const auto& param : func.params) {
-        auto param_type = std::make_unique<Type>(param.type->kind, param.type->span);
-        if (param.type->base_type) {
-            param_type->base_type = std::make_unique<Type>(param.type->base_type->kind, param.type->base_type->span);
+    // Report as the serial loop would: in order, up to the first failure
+    for (auto& result : results) {
+        for (auto& message : result.errors) {
+            std::cerr << "Error: " << message << std::endl;
+            errors_.push_back(std::move(message));
         }
-        if (!declare_variable(param.name, std::move(param_type), param.is_mut)) {
-            error("Duplicate parameter name: " + param.name, param.span);
+        if (!result.ok) {
             return false;
         }
     }
+    return true;
+}
+
+bool TypeChecker::check_function(const FunctionDecl& func) {
+    // Parameters are the function's first bindings
+    variables_.clear();
+    variables_.resize(func.num_bindings);
+    for (size_t i = 0; i < func.params.size(); i++) {
+        const auto& param = func.params[i];
+        if (param.redeclares) {
+            error("Duplicate parameter name: " + param.name.str(), param.span);
+            return false;
+        }
+        variables_[i] = {param.type, param.is_mut};
+    }
     
     // Check function body
     bool success = check_statement(*func.body);
     
     // Check return type
-    if (auto block = dynamic_cast<const BlockStmt*>(func.body.get())) {
+    if (auto block = node_cast<BlockStmt>(func.body)) {
         if (!block->statements.empty()) {
-            if (auto expr_stmt = dynamic_cast<const ExprStmt*>(block->statements.back().get())) {
+            if (auto expr_stmt = node_cast<ExprStmt>(block->statements.back())) {
                 if (!check_expression(*expr_stmt->expr)) {
                     success = false;
-                } else if (!is_assignable(*func.return_type, *expr_stmt->expr->type)) {
+                } else if (!is_assignable(func.return_type, expr_stmt->expr->type)) {
                     error("Function return type mismatch", expr_stmt->span);
                     success = false;
                 }
@@ -49,448 +92,371 @@ bool TypeChecker::check_function(const FunctionDecl& func) {
         }
     }
     
-    exit_scope();
     return success;
 }
 
 bool TypeChecker::check_statement(const Stmt& stmt) {
-    if (auto let = dynamic_cast<const LetStmt*>(&stmt)) {
-        // Check initializer expression
-        if (!check_expression(*let->init)) {
-            return false;
-        }
-        
-        // Check type compatibility
-        if (!is_assignable(*let->type, *let->init->type)) {
-            error("Type mismatch in let binding", let->span);
-            return false;
-        }
-        
-        // Declare variable
-        auto var_type = std::make_unique<Type>(let->type->kind, let->type->span);
-        if (let->type->base_type) {
-            var_type->base_type = std::make_unique<Type>(let->type->base_type->kind, let->type->base_type->span);
-        }
-        if (!declare_variable(let->name, std::move(var_type), let->is_mut)) {
-            error("Duplicate variable name: " + let->name, let->span);
-            return false;
-        }
+    switch (stmt.kind) {
+        case NodeKind::LetStmt:
+            return check_let(static_cast<const LetStmt&>(stmt));
+        case NodeKind::ExprStmt:
+            return check_expression(*static_cast<const ExprStmt&>(stmt).expr);
+        case NodeKind::IfStmt:
+            return check_if(static_cast<const IfStmt&>(stmt));
+        case NodeKind::WhileStmt:
+            return check_while(static_cast<const WhileStmt&>(stmt));
+        case NodeKind::BlockStmt:
+            return check_block(static_cast<const BlockStmt&>(stmt));
+        default:
+            return true;
     }
-    else if (auto expr = dynamic_cast<const ExprStmt*>(&stmt)) {
-        return check_expression(*expr->expr);
+}
+
+bool TypeChecker::check_expression(const Expr& expr) {
+    switch (expr.kind) {
+        case NodeKind::IntLiteral:
+            expr.type = Type::get(Type::Kind::I32);
+            return true;
+        case NodeKind::BoolLiteral:
+            expr.type = Type::get(Type::Kind::Bool);
+            return true;
+        case NodeKind::StringLiteral:
+            expr.type = Type::get(Type::Kind::Str);
+            return true;
+        case NodeKind::Identifier:
+            return check_identifier(static_cast<const Identifier&>(expr));
+        case NodeKind::BinaryExpr:
+            return check_binary(static_cast<const BinaryExpr&>(expr));
+        case NodeKind::UnaryExpr:
+            return check_unary(static_cast<const UnaryExpr&>(expr));
+        case NodeKind::BorrowExpr:
+            return check_borrow(static_cast<const BorrowExpr&>(expr));
+        case NodeKind::CallExpr:
+            return check_call(static_cast<const CallExpr&>(expr));
+        default:
+            return true;
     }
-    else if (auto if_stmt = dynamic_cast<const IfStmt*>(&stmt)) {
-        if (!check_expression(*if_stmt->condition)) {
-            return false;
-        }
-        
-        if (!if_stmt->condition->type || if_stmt->condition->type->kind != Type::Kind::Bool) {
-            error("If condition must be boolean", if_stmt->condition->span);
-            return false;
-        }
-        
-        enter_scope();
-        bool then_success = check_statement(*if_stmt->then_branch);
-        exit_scope();
-        
-        if (if_stmt->else_branch) {
-            enter_scope();
-            bool else_success = check_statement(*if_stmt->else_branch);
-            exit_scope();
-            return then_success && else_success;
-        }
-        
-        return then_success;
+}
+
+bool TypeChecker::check_let(const LetStmt& let) {
+    // Check initializer expression
+    if (!check_expression(*let.init)) {
+        return false;
     }
-    else if (auto while_stmt = dynamic_cast<const WhileStmt*>(&stmt)) {
-        if (!check_expression(*while_stmt->condition)) {
-            return false;
-        }
-        
-        if (!while_stmt->condition->type || while_stmt->condition->type->kind != Type::Kind::Bool) {
-            error("While condition must be boolean", while_stmt->condition->span);
-            return false;
-        }
-        
-        enter_scope();
-        bool success = check_statement(*while_stmt->body);
-        exit_scope();
-        return success;
-    }
-    else if (auto block = dynamic_cast<const BlockStmt*>(&stmt)) {
-        enter_scope();
-        for (const auto& stmt : block->statements) {
-            if (!check_statement(*stmt)) {
-                exit_scope();
-                return false;
-            }
-        }
-        exit_scope();
-        return true;
+    
+    // Check type compatibility
+    if (!is_assignable(let.type, let.init->type)) {
+        error("Type mismatch in let binding", let.span);
+        return false;
     }
     
+    // Declare variable
+    if (let.redeclares) {
+        error("Duplicate variable name: " + let.name.str(), let.span);
+        return false;
+    }
+    variables_[let.binding] = {let.type, let.is_mut};
     return true;
 }
 
-bool TypeChecker::check_expression(const Expr& expr) {
-    if (auto int_lit = dynamic_cast<const IntLiteral*>(&expr)) {
-        expr.type = std::make_unique<Type>(Type::Kind::I32, expr.span);
-        return true;
+bool TypeChecker::check_if(const IfStmt& if_stmt) {
+    if (!check_expression(*if_stmt.condition)) {
+        return false;
     }
-    else if (auto bool_lit = dynamic_cast<const BoolLiteral*>(&expr)) {
-        expr.type = std::make_unique<Type>(Type::Kind::Bool, expr.span);
-        return true;
+    
+    if (!if_stmt.condition->type || if_stmt.condition->type->kind != Type::Kind::Bool) {
+        error("If condition must be boolean", if_stmt.condition->span);
+        return false;
     }
-    else if (auto str_lit = dynamic_cast<const StringLiteral*>(&expr)) {
-        expr.type = std::make_unique<Type>(Type::Kind::Str, expr.span);
-        return true;
+    
+    bool then_success = check_statement(*if_stmt.then_branch);
+    
+    if (if_stmt.else_branch) {
+        bool else_success = check_statement(*if_stmt.else_branch);
+        return then_success && else_success;
     }
-    else if (auto ident = dynamic_cast<const Identifier*>(&expr)) {
-        // First try to find a function with this name
-        for (const auto& item : program_->items) {
-            if (auto func = dynamic_cast<const FunctionDecl*>(item.get())) {
-                if (func->name == ident->name) {
-                    // Found a function, but it can only be used in a call expression
-                    return true;
-                }
-            }
-        }
-        
-        // If not a function, look for a variable
-        auto var_info = lookup_variable(ident->name);
-        if (!var_info) {
-            error("Undefined variable: " + ident->name, ident->span);
+    
+    return then_success;
+}
+
+bool TypeChecker::check_while(const WhileStmt& while_stmt) {
+    if (!check_expression(*while_stmt.condition)) {
+        return false;
+    }
+    
+    if (!while_stmt.condition->type || while_stmt.condition->type->kind != Type::Kind::Bool) {
+        error("While condition must be boolean", while_stmt.condition->span);
+        return false;
+    }
+    
+    return check_statement(*while_stmt.body);
+}
+
+bool TypeChecker::check_block(const BlockStmt& block) {
+    for (const auto& stmt : block.statements) {
+        if (!check_statement(*stmt)) {
             return false;
         }
-        expr.type = std::make_unique<Type>(var_info->type->kind, expr.span);
-        if (var_info->type->base_type) {
-            expr.type->base_type = std::make_unique<Type>(var_info->type->base_type->kind, var_info->type->base_type->span);
-        }
-        ident->is_mut_binding = var_info->is_mut;
+    }
+    return true;
+}
+
+bool TypeChecker::check_identifier(const Identifier& ident) {
+    // A function name can only be used in a call expression
+    if (ident.resolution == Resolution::Function) {
         return true;
     }
-    else if (auto binary = dynamic_cast<const BinaryExpr*>(&expr)) {
-        if (binary->op == BinaryExpr::Op::Assignment) {
-            // Check if left side is an identifier
-            if (auto ident = dynamic_cast<const Identifier*>(binary->left.get())) {
-                // Look up the variable
-                auto var_info = lookup_variable(ident->name);
-                if (!var_info) {
-                    error("Undefined variable: " + ident->name, expr.span);
-                    return false;
-                }
+    
+    const VariableInfo* var_info = lookup_variable(ident);
+    if (!var_info) {
+        error("Undefined variable: " + ident.name.str(), ident.span);
+        return false;
+    }
+    ident.type = var_info->type;
+    return true;
+}
 
-                // Check if the variable is mutably borrowed
-                if (var_info->type && var_info->type->kind == Type::Kind::MutRef) {
-                    error("Cannot use variable while mutably borrowed: " + ident->name, expr.span);
-                    return false;
-                }
+bool TypeChecker::check_binary(const BinaryExpr& binary) {
+    if (binary.op == BinaryExpr::Op::Assignment) {
+        // Check if left side is an identifier
+        if (auto ident = node_cast<Identifier>(binary.left)) {
+            // Look up the variable
+            const VariableInfo* var_info = lookup_variable(*ident);
+            if (!var_info) {
+                error("Undefined variable: " + ident->name.str(), binary.span);
+                return false;
+            }
 
-                // Check if the variable is mutable
-                if (!var_info->is_mut) {
-                    error("Cannot assign to immutable variable: " + ident->name, expr.span);
-                    return false;
-                }
+            // Check if the variable is mutably borrowed
+            if (var_info->type && var_info->type->kind == Type::Kind::MutRef) {
+                error("Cannot use variable while mutably borrowed: " + ident->name.str(), binary.span);
+                return false;
+            }
 
-                // Check right side
-                if (!check_expression(*binary->right)) {
-                    return false;
-                }
+            // Check if the variable is mutable
+            if (!var_info->is_mut) {
+                error("Cannot assign to immutable variable: " + ident->name.str(), binary.span);
+                return false;
+            }
 
-                // Check type compatibility
-                if (!is_assignable(*var_info->type, *binary->right->type)) {
-                    error("Type mismatch in assignment", expr.span);
-                    return false;
-                }
+            // Check right side
+            if (!check_expression(*binary.right)) {
+                return false;
+            }
 
-                expr.type = binary->right->type->clone();
-                return true;
+            // Check type compatibility
+            if (!is_assignable(var_info->type, binary.right->type)) {
+                error("Type mismatch in assignment", binary.span);
+                return false;
             }
-            error("Left side of assignment must be an identifier", expr.span);
-            return false;
-        }
-        if (!check_expression(*binary->left) || !check_expression(*binary->right)) {
-            return false;
-        }
-        
-        // Make sure both operands have types (they might be function identifiers)
-        if (!binary->left->type || !binary->right->type) {
-            error("Invalid operands in binary expression", expr.span);
-            return false;
-        }
-        
-        switch (binary->op) {
-            case BinaryExpr::Op::Add:
-            case BinaryExpr::Op::Sub:
-            case BinaryExpr::Op::Mul:
-            case BinaryExpr::Op::Div:
-                if (binary->left->type->kind != Type::Kind::I32 ||
-                    binary->right->type->kind != Type::Kind::I32) {
-                    error("Arithmetic operations require integer operands", expr.span);
-                    return false;
-                }
-                expr.type = std::make_unique<Type>(Type::Kind::I32, expr.span);
-                break;
-                
-            case BinaryExpr::Op::Eq:
-            case BinaryExpr::Op::Ne:
-            case BinaryExpr::Op::Lt:
-            case BinaryExpr::Op::Gt:
-            case BinaryExpr::Op::Le:
-            case BinaryExpr::Op::Ge:
-                if (!is_compatible(*binary->left->type, *binary->right->type)) {
-                    error("Incompatible types in comparison", expr.span);
-                    return false;
-                }
-                expr.type = std::make_unique<Type>(Type::Kind::Bool, expr.span);
-                break;
-                
-            case BinaryExpr::Op::And:
-            case BinaryExpr::Op::Or:
-                if (binary->left->type->kind != Type::Kind::Bool ||
-                    binary->right->type->kind != Type::Kind::Bool) {
-                    error("Logical operations require boolean operands", expr.span);
-                    return false;
-                }
-                expr.type = std::make_unique<Type>(Type::Kind::Bool, expr.span);
-                break;
+
+            binary.type = binary.right->type;
+            return true;
         }
-        return true;
+        error("Left side of assignment must be an identifier", binary.span);
+        return false;
     }
-    else if (auto unary = dynamic_cast<const UnaryExpr*>(&expr)) {
-        if (!check_expression(*unary->expr)) {
-            return false;
-        }
-        
-        // Make sure the operand has a type (it might be a function identifier)
-        if (!unary->expr->type) {
-            error("Invalid operand in unary expression", expr.span);
-            return false;
-        }
-        
-        switch (unary->op) {
-            case UnaryExpr::Op::Neg:
-                if (unary->expr->type->kind != Type::Kind::I32) {
-                    error("Negation requires integer operand", expr.span);
-                    return false;
-                }
-                expr.type = std::make_unique<Type>(Type::Kind::I32, expr.span);
-                break;
-                
-            case UnaryExpr::Op::Not:
-                if (unary->expr->type->kind != Type::Kind::Bool) {
-                    error("Logical not requires boolean operand", expr.span);
-                    return false;
-                }
-                expr.type = std::make_unique<Type>(Type::Kind::Bool, expr.span);
-                break;
-        }
-        return true;
+    if (!check_expression(*binary.left) || !check_expression(*binary.right)) {
+        return false;
     }
-    else if (auto borrow = dynamic_cast<const BorrowExpr*>(&expr)) {
-        if (!check_expression(*borrow->expr)) {
-            return false;
-        }
-        
-        // Make sure the operand has a type (it might be a function identifier)
-        if (!borrow->expr->type) {
-            error("Invalid operand in borrow expression", expr.span);
-            return false;
-        }
-        
-        // Check if we're borrowing a mutable variable
-        if (borrow->is_mut) {
-            if (auto ident = dynamic_cast<const Identifier*>(borrow->expr.get())) {
-                if (!ident->is_mut_binding) {
-                    error("Cannot borrow immutable variable as mutable", expr.span);
-                    return false;
-                }
-                
-                // Check if the variable is already mutably borrowed
-                auto var_info = lookup_variable(ident->name);
-                if (var_info && var_info->type && var_info->type->kind == Type::Kind::MutRef) {
-                    error("Variable already mutably borrowed: " + ident->name, expr.span);
-                    return false;
-                }
-                
-                // Mark the variable as mutably borrowed
-                if (var_info) {
-                    // Update the variable's type in all scopes where it exists
-                    for (auto& scope : scopes_) {
-                        auto it = scope.find(ident->name);
-                        if (it != scope.end()) {
-                            // Create a new type with the same base type but as a MutRef
-                            auto base_type = std::make_unique<Type>(it->second.type->kind, it->second.type->span);
-                            if (it->second.type->base_type) {
-                                base_type->base_type = std::make_unique<Type>(
-                                    it->second.type->base_type->kind,
-                                    it->second.type->base_type->span
-                                );
-                            }
-                            it->second.type = std::make_unique<Type>(Type::Kind::MutRef, std::move(base_type), expr.span);
-                        }
-                    }
-                }
-            }
-        }
-        
-        auto base_type = std::make_unique<Type>(borrow->expr->type->kind, borrow->expr->type->span);
-        if (borrow->expr->type->base_type) {
-            base_type->base_type = std::make_unique<Type>(borrow->expr->type->base_type->kind, borrow->expr->type->base_type->span);
-        }
-        
-        expr.type = std::make_unique<Type>(
-            borrow->is_mut ? Type::Kind::MutRef : Type::Kind::Ref,
-            std::move(base_type),
-            expr.span
-        );
-        return true;
+    
+    // Make sure both operands have types (they might be function identifiers)
+    if (!binary.left->type || !binary.right->type) {
+        error("Invalid operands in binary expression", binary.span);
+        return false;
     }
-    else if (auto call = dynamic_cast<const CallExpr*>(&expr)) {
-        if (!check_expression(*call->callee)) {
-            return false;
-        }
-        
-        // Check if the callee is a function identifier
-        auto callee_ident = dynamic_cast<const Identifier*>(call->callee.get());
-        if (!callee_ident) {
-            error("Function call requires a function name", expr.span);
-            return false;
-        }
-        
-        // Find the function declaration
-        const FunctionDecl* func_decl = nullptr;
-        for (const auto& item : program_->items) {
-            if (auto func = dynamic_cast<const FunctionDecl*>(item.get())) {
-                if (func->name == callee_ident->name) {
-                    func_decl = func;
-                    break;
-                }
-            }
-        }
-        
-        if (!func_decl) {
-            error("Undefined function: " + callee_ident->name, expr.span);
-            return false;
-        }
-        
-        // Check argument count
-        if (call->args.size() != func_decl->params.size()) {
-            error("Wrong number of arguments for function " + callee_ident->name, expr.span);
-            return false;
-        }
-        
-        // Check argument types
-        for (size_t i = 0; i < call->args.size(); ++i) {
-            if (!check_expression(*call->args[i])) {
+    
+    switch (binary.op) {
+        case BinaryExpr::Op::Add:
+        case BinaryExpr::Op::Sub:
+        case BinaryExpr::Op::Mul:
+        case BinaryExpr::Op::Div:
+            if (binary.left->type->kind != Type::Kind::I32 ||
+                binary.right->type->kind != Type::Kind::I32) {
+                error("Arithmetic operations require integer operands", binary.span);
                 return false;
             }
+            binary.type = Type::get(Type::Kind::I32);
+            break;
             
-            // Make sure the argument has a type (it might be a function identifier)
-            if (!call->args[i]->type) {
-                error("Invalid argument in function call", expr.span);
+        case BinaryExpr::Op::Eq:
+        case BinaryExpr::Op::Ne:
+        case BinaryExpr::Op::Lt:
+        case BinaryExpr::Op::Gt:
+        case BinaryExpr::Op::Le:
+        case BinaryExpr::Op::Ge:
+            if (!is_compatible(binary.left->type, binary.right->type)) {
+                error("Incompatible types in comparison", binary.span);
                 return false;
             }
+            binary.type = Type::get(Type::Kind::Bool);
+            break;
             
-            if (!is_assignable(*func_decl->params[i].type, *call->args[i]->type)) {
-                error("Type mismatch in argument " + std::to_string(i + 1) + " of function " + callee_ident->name, call->args[i]->span);
+        case BinaryExpr::Op::And:
+        case BinaryExpr::Op::Or:
+            if (binary.left->type->kind != Type::Kind::Bool ||
+                binary.right->type->kind != Type::Kind::Bool) {
+                error("Logical operations require boolean operands", binary.span);
                 return false;
             }
-        }
-        
-        // Set the return type
-        expr.type = std::make_unique<Type>(func_decl->return_type->kind, expr.span);
-        if (func_decl->return_type->base_type) {
-            expr.type->base_type = std::make_unique<Type>(func_decl->return_type->base_type->kind, func_decl->return_type->base_type->span);
-        }
-        return true;
+            binary.type = Type::get(Type::Kind::Bool);
+            break;
+        case BinaryExpr::Op::Assignment:
+            // Handled above
+            break;
     }
-    
     return true;
 }
 
-bool TypeChecker::is_assignable(const Type& target, const Type& source) {
-    if (target.kind == source.kind) {
-        if (target.kind == Type::Kind::Ref || target.kind == Type::Kind::MutRef) {
-            return is_assignable(*target.base_type, *source.base_type);
-        }
-        return true;
+bool TypeChecker::check_unary(const UnaryExpr& unary) {
+    if (!check_expression(*unary.expr)) {
+        return false;
     }
     
-    // Allow implicit conversion from &mut T to &T
-    if (target.kind == Type::Kind::Ref && source.kind == Type::Kind::MutRef) {
-        return is_assignable(*target.base_type, *source.base_type);
+    // Make sure the operand has a type (it might be a function identifier)
+    if (!unary.expr->type) {
+        error("Invalid operand in unary expression", unary.span);
+        return false;
     }
     
-    return false;
+    switch (unary.op) {
+        case UnaryExpr::Op::Neg:
+            if (unary.expr->type->kind != Type::Kind::I32) {
+                error("Negation requires integer operand", unary.span);
+                return false;
+            }
+            unary.type = Type::get(Type::Kind::I32);
+            break;
+            
+        case UnaryExpr::Op::Not:
+            if (unary.expr->type->kind != Type::Kind::Bool) {
+                error("Logical not requires boolean operand", unary.span);
+                return false;
+            }
+            unary.type = Type::get(Type::Kind::Bool);
+            break;
+    }
+    return true;
 }
 
-bool TypeChecker::is_compatible(const Type& lhs, const Type& rhs) {
-    if (lhs.kind == rhs.kind) {
-        if (lhs.kind == Type::Kind::Ref || lhs.kind == Type::Kind::MutRef) {
-            return is_compatible(*lhs.base_type, *rhs.base_type);
-        }
-        return true;
+bool TypeChecker::check_borrow(const BorrowExpr& borrow) {
+    if (!check_expression(*borrow.expr)) {
+        return false;
     }
     
-    // Allow comparison between &T and &mut T
-    if ((lhs.kind == Type::Kind::Ref && rhs.kind == Type::Kind::MutRef) ||
-        (lhs.kind == Type::Kind::MutRef && rhs.kind == Type::Kind::Ref)) {
-        return is_compatible(*lhs.base_type, *rhs.base_type);
+    // Make sure the operand has a type (it might be a function identifier)
+    if (!borrow.expr->type) {
+        error("Invalid operand in borrow expression", borrow.span);
+        return false;
     }
     
-    return false;
+    // Check if we're borrowing a mutable variable
+    if (borrow.is_mut) {
+        if (auto ident = node_cast<Identifier>(borrow.expr)) {
+            if (!ident->is_mut_binding) {
+                error("Cannot borrow immutable variable as mutable", borrow.span);
+                return false;
+            }
+            
+            // Check if the variable is already mutably borrowed
+            VariableInfo* var_info = lookup_variable(*ident);
+            if (var_info && var_info->type && var_info->type->kind == Type::Kind::MutRef) {
+                error("Variable already mutably borrowed: " + ident->name.str(), borrow.span);
+                return false;
+            }
+            
+            // Mark the variable as mutably borrowed: it now reads as a
+            // `&mut` of its own type
+            if (var_info) {
+                var_info->type = Type::reference(var_info->type, true);
+            }
+        }
+    }
+    
+    borrow.type = Type::reference(borrow.expr->type, borrow.is_mut);
+    return true;
 }
 
-bool TypeChecker::is_mutable_reference(const Type& type) const {
-    return type.kind == Type::Kind::MutRef;
+bool TypeChecker::check_call(const CallExpr& call) {
+    if (!check_expression(*call.callee)) {
+        return false;
+    }
+    
+    // Check if the callee is a function identifier
+    auto callee_ident = node_cast<Identifier>(call.callee);
+    if (!callee_ident) {
+        error("Function call requires a function name", call.span);
+        return false;
+    }
+    
+    // Find the function's signature
+    const FunctionSignature* signature = callees_->find(callee_ident->name);
+    if (!signature) {
+        error("Undefined function: " + callee_ident->name.str(), call.span);
+        return false;
+    }
+    
+    // Check argument count
+    if (call.args.size() != signature->param_types.size()) {
+        error("Wrong number of arguments for function " + callee_ident->name.str(), call.span);
+        return false;
+    }
+    
+    // Check argument types
+    for (size_t i = 0; i < call.args.size(); ++i) {
+        if (!check_expression(*call.args[i])) {
+            return false;
+        }
+        
+        // Make sure the argument has a type (it might be a function identifier)
+        if (!call.args[i]->type) {
+            error("Invalid argument in function call", call.span);
+            return false;
+        }
+        
+        if (!is_assignable(signature->param_types[i], call.args[i]->type)) {
+            error("Type mismatch in argument " + std::to_string(i + 1) + " of function " + callee_ident->name.str(), call.args[i]->span);
+            return false;
+        }
+    }
+    
+    // Set the return type
+    call.type = signature->return_type;
+    return true;
 }
 
-bool TypeChecker::is_reference(const Type& type) const {
-    return type.kind == Type::Kind::Ref || type.kind == Type::Kind::MutRef;
+bool TypeChecker::is_assignable(const Type* target, const Type* source) {
+    return target->is_assignable_from(source);
 }
 
-void TypeChecker::enter_scope() {
-    scopes_.emplace_back();
+bool TypeChecker::is_compatible(const Type* lhs, const Type* rhs) {
+    // Comparison ignores mutability at every reference level
+    return lhs->shared() == rhs->shared();
 }
 
-void TypeChecker::exit_scope() {
-    scopes_.pop_back();
+bool TypeChecker::is_mutable_reference(const Type& type) const {
+    return type.kind == Type::Kind::MutRef;
 }
 
-bool TypeChecker::declare_variable(const std::string& name, std::unique_ptr<Type> type, bool is_mut) {
-    if (scopes_.empty()) {
-        scopes_.emplace_back();
-    }
-    
-    auto& current_scope = scopes_.back();
-    if (current_scope.find(name) != current_scope.end()) {
-        return false;
-    }
-    
-    current_scope[name] = {std::move(type), is_mut};
-    return true;
+bool TypeChecker::is_reference(const Type& type) const {
+    return type.kind == Type::Kind::Ref || type.kind == Type::Kind::MutRef;
 }
 
-std::optional<TypeChecker::VariableInfo> TypeChecker::lookup_variable(const std::string& name) {
-    for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it) {
-        auto found = it->find(name);
-        if (found != it->end()) {
-            auto type = std::make_unique<Type>(found->second.type->kind, found->second.type->span);
-            if (found->second.type->base_type) {
-                type->base_type = std::make_unique<Type>(found->second.type->base_type->kind, found->second.type->base_type->span);
-            }
-            return VariableInfo{std::move(type), found->second.is_mut};
-        }
+TypeChecker::VariableInfo* TypeChecker::lookup_variable(const Identifier& ident) {
+    // Only locals that have been declared by now have a type
+    if (ident.resolution != Resolution::Local || !variables_[ident.binding].type) {
+        return nullptr;
     }
-    return std::nullopt;
+    return &variables_[ident.binding];
 }
 
 void TypeChecker::error(const std::string& message, const Span& span) {
     std::stringstream ss;
     ss << "Type error at " << span.start << ":" << span.end << ": " << message;
     errors_.push_back(ss.str());
-    std::cerr << "Error: " << ss.str() << std::endl;
+    if (echo_errors_) {
+        std::cerr << "Error: " << ss.str() << std::endl;
+    }
 }
 
 } // namespace nust 
\ No newline at end of file
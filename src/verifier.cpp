@@ -0,0 +1,476 @@
+#include "verifier.h"
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace nust {
+
+namespace {
+
+// What the verifier knows about a local slot or operand. Any is the join of
+// two different types; it may be moved around but not operated on.
+enum class SlotType : uint8_t { Int, Bool, Str, Ref, Any };
+
+const char* type_name(SlotType type) {
+    switch (type) {
+        case SlotType::Int: return "i32";
+        case SlotType::Bool: return "bool";
+        case SlotType::Str: return "str";
+        case SlotType::Ref: return "ref";
+        case SlotType::Any: break;
+    }
+    return "any";
+}
+
+SlotType slot_type(const Type* type) {
+    if (!type) {
+        return SlotType::Any;
+    }
+    switch (type->kind) {
+        case Type::Kind::I32: return SlotType::Int;
+        case Type::Kind::Bool: return SlotType::Bool;
+        case Type::Kind::Str: return SlotType::Str;
+        case Type::Kind::Ref:
+        case Type::Kind::MutRef: return SlotType::Ref;
+    }
+    return SlotType::Any;
+}
+
+// Types of the frame's locals and operands on entry to a basic block
+struct State {
+    std::vector<SlotType> locals;
+    std::vector<SlotType> stack;
+};
+
+// Join `from` into `into` slot by slot; returns whether `into` changed
+bool join(std::vector<SlotType>& into, const std::vector<SlotType>& from) {
+    bool changed = false;
+    for (size_t i = 0; i < into.size(); ++i) {
+        if (into[i] != from[i] && into[i] != SlotType::Any) {
+            into[i] = SlotType::Any;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// What a call leaves on the caller's operand stack. Never means no RET or
+// RET_VAL has been found reachable (yet), so code after the call isn't
+// either.
+struct Summary {
+    enum class Returns : uint8_t { Never, Nothing, Value };
+    Returns returns = Returns::Never;
+    SlotType type = SlotType::Any;
+
+    bool operator!=(const Summary& other) const {
+        return returns != other.returns || type != other.type;
+    }
+};
+
+// A function's instructions, decoded once. Jump operands stay byte offsets.
+struct DecodedFunction {
+    size_t begin = 0;
+    size_t end = 0;
+    std::vector<Instruction> instructions;
+    std::vector<size_t> offsets;
+    std::unordered_map<size_t, size_t> index_of;  // Byte offset -> instruction
+};
+
+std::string describe(const FunctionInfo& func, size_t offset) {
+    return "function '" + func.name + "' at offset " + std::to_string(offset);
+}
+
+DecodedFunction decode_function(const PackedCode& code, const FunctionInfo& func,
+                                size_t begin, size_t end) {
+    DecodedFunction decoded;
+    decoded.begin = begin;
+    decoded.end = end;
+    const uint8_t* bytes = code.data();
+    size_t pc = begin;
+    while (pc < end) {
+        size_t offset = pc;
+        if (bytes[pc] >= opcode_count) {
+            throw VerifyError(describe(func, offset) + ": unknown opcode");
+        }
+        Instruction instr = read_instruction(bytes, pc);
+        if (pc > end) {
+            throw VerifyError(describe(func, offset) + ": instruction runs past the end of the function");
+        }
+        decoded.index_of[offset] = decoded.instructions.size();
+        decoded.instructions.push_back(instr);
+        decoded.offsets.push_back(offset);
+    }
+    return decoded;
+}
+
+// Abstract interpretation of one function, given the current summaries of
+// every function it may call
+class FunctionVerifier {
+public:
+    FunctionVerifier(const FunctionTable& function_table, size_t constant_count,
+                     const std::vector<Summary>& summaries, size_t index,
+                     const DecodedFunction& code)
+        : function_table_(function_table)
+        , constant_count_(constant_count)
+        , summaries_(summaries)
+        , func_(function_table.get_function(index))
+        , code_(code)
+    {
+    }
+
+    Summary run() {
+        const size_t count = code_.instructions.size();
+        if (count == 0) {
+            throw VerifyError("function '" + func_.name + "' has no code");
+        }
+
+        // Only jump targets can be reached by more than one path; they start
+        // basic blocks, and the entry point starts the first. Bad targets are
+        // reported only if their jump turns out to be reachable.
+        leaders_.assign(count, false);
+        leaders_[0] = true;
+        for (const auto& instr : code_.instructions) {
+            if (is_jump(instr.opcode)) {
+                auto it = code_.index_of.find(instr.operand);
+                if (it != code_.index_of.end()) {
+                    leaders_[it->second] = true;
+                }
+            }
+        }
+
+        State entry;
+        entry.locals.assign(std::max(func_.num_locals, func_.num_params), SlotType::Int);
+        for (size_t i = 0; i < func_.num_params; ++i) {
+            entry.locals[i] = i < func_.param_types.size()
+                ? slot_type(func_.param_types[i]) : SlotType::Any;
+        }
+        states_.assign(count, std::nullopt);
+        merge(0, entry);
+
+        while (!worklist_.empty()) {
+            size_t leader = worklist_.back();
+            worklist_.pop_back();
+            run_block(leader, *states_[leader]);
+        }
+        return summary_;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& message) const {
+        throw VerifyError(describe(func_, at_) + ": " + message);
+    }
+
+    size_t target_index(size_t target) const {
+        auto it = code_.index_of.find(target);
+        if (it == code_.index_of.end()) {
+            if (target >= code_.begin && target < code_.end) {
+                fail("jump into the middle of an instruction");
+            }
+            fail("jump out of the function");
+        }
+        return it->second;
+    }
+
+    void merge(size_t index, const State& state) {
+        auto& existing = states_[index];
+        if (!existing) {
+            existing = state;
+            worklist_.push_back(index);
+            return;
+        }
+        if (existing->stack.size() != state.stack.size()) {
+            at_ = code_.offsets[index];
+            fail("stack depth " + std::to_string(state.stack.size()) + " on one path and " +
+                 std::to_string(existing->stack.size()) + " on another");
+        }
+        bool changed = join(existing->locals, state.locals);
+        changed |= join(existing->stack, state.stack);
+        if (changed) {
+            worklist_.push_back(index);
+        }
+    }
+
+    // Walk a block from its leader, carrying the state forward until control
+    // leaves it
+    void run_block(size_t index, State state) {
+        const size_t count = code_.instructions.size();
+        while (true) {
+            at_ = code_.offsets[index];
+            const Instruction& instr = code_.instructions[index];
+            if (!step(instr, state)) {
+                return;
+            }
+            if (is_jump(instr.opcode)) {
+                merge(target_index(instr.operand), state);
+                if (instr.opcode == Opcode::JMP) {
+                    return;
+                }
+            }
+            if (++index == count) {
+                fail("control runs off the end of the function");
+            }
+            if (leaders_[index]) {
+                merge(index, state);
+                return;
+            }
+        }
+    }
+
+    SlotType pop(State& state, SlotType expected = SlotType::Any) {
+        if (state.stack.empty()) {
+            fail("stack underflow");
+        }
+        SlotType type = state.stack.back();
+        state.stack.pop_back();
+        if (expected != SlotType::Any && type != expected) {
+            fail(std::string("expected ") + type_name(expected) + ", found " + type_name(type));
+        }
+        return type;
+    }
+
+    SlotType& local(State& state, size_t slot) {
+        if (slot >= state.locals.size()) {
+            fail("local slot " + std::to_string(slot) + " out of range");
+        }
+        return state.locals[slot];
+    }
+
+    void expect_local(State& state, size_t slot, SlotType expected) {
+        SlotType type = local(state, slot);
+        if (type != expected) {
+            fail("expected " + std::string(type_name(expected)) + " in local " +
+                 std::to_string(slot) + ", found " + type_name(type));
+        }
+    }
+
+    void record_return(Summary::Returns returns, SlotType type) {
+        if (summary_.returns == Summary::Returns::Never) {
+            summary_.returns = returns;
+            summary_.type = type;
+        } else if (summary_.returns != returns) {
+            fail("function returns both with and without a value");
+        } else if (summary_.type != type) {
+            summary_.type = SlotType::Any;
+        }
+    }
+
+    // Apply one instruction to `state`; returns false if control doesn't
+    // continue past it (returns, and calls that never return). Jump targets
+    // are merged by the caller.
+    bool step(const Instruction& instr, State& state) {
+        auto& stack = state.stack;
+        switch (instr.opcode) {
+            case Opcode::PUSH_I32:
+                stack.push_back(SlotType::Int);
+                break;
+            case Opcode::PUSH_BOOL:
+                stack.push_back(SlotType::Bool);
+                break;
+            case Opcode::PUSH_STR:
+                if (instr.operand >= constant_count_) {
+                    fail("string constant " + std::to_string(instr.operand) + " out of range");
+                }
+                stack.push_back(SlotType::Str);
+                break;
+            case Opcode::POP:
+                pop(state);
+                break;
+            case Opcode::DUP: {
+                SlotType type = pop(state);
+                stack.push_back(type);
+                stack.push_back(type);
+                break;
+            }
+            case Opcode::SWAP: {
+                SlotType b = pop(state);
+                SlotType a = pop(state);
+                stack.push_back(b);
+                stack.push_back(a);
+                break;
+            }
+            case Opcode::LOAD:
+                stack.push_back(local(state, instr.operand));
+                break;
+            case Opcode::STORE: {
+                SlotType type = pop(state);
+                local(state, instr.operand) = type;
+                break;
+            }
+            case Opcode::LOAD_REF:
+                local(state, instr.operand);
+                stack.push_back(SlotType::Ref);
+                break;
+            case Opcode::STORE_REF:
+                pop(state, SlotType::Ref);
+                pop(state);
+                break;
+            case Opcode::ADD_I32:
+            case Opcode::SUB_I32:
+            case Opcode::MUL_I32:
+            case Opcode::DIV_I32:
+                pop(state, SlotType::Int);
+                pop(state, SlotType::Int);
+                stack.push_back(SlotType::Int);
+                break;
+            case Opcode::NEG_I32:
+                pop(state, SlotType::Int);
+                stack.push_back(SlotType::Int);
+                break;
+            case Opcode::EQ_I32:
+            case Opcode::NE_I32:
+            case Opcode::LT_I32:
+            case Opcode::GT_I32:
+            case Opcode::LE_I32:
+            case Opcode::GE_I32:
+                pop(state, SlotType::Int);
+                pop(state, SlotType::Int);
+                stack.push_back(SlotType::Bool);
+                break;
+            case Opcode::AND:
+            case Opcode::OR:
+                pop(state, SlotType::Bool);
+                pop(state, SlotType::Bool);
+                stack.push_back(SlotType::Bool);
+                break;
+            case Opcode::NOT:
+                pop(state, SlotType::Bool);
+                stack.push_back(SlotType::Bool);
+                break;
+            case Opcode::JMP:
+                break;
+            case Opcode::JMP_IF:
+            case Opcode::JMP_IF_NOT:
+                pop(state, SlotType::Bool);
+                break;
+            case Opcode::CALL: {
+                if (instr.operand >= function_table_.size()) {
+                    fail("function index " + std::to_string(instr.operand) + " out of range");
+                }
+                const auto& callee = function_table_.get_function(instr.operand);
+                if (stack.size() < callee.num_params) {
+                    fail("not enough arguments for '" + callee.name + "'");
+                }
+                // The last argument is on top
+                for (size_t i = callee.num_params; i-- > 0;) {
+                    pop(state, i < callee.param_types.size()
+                        ? slot_type(callee.param_types[i]) : SlotType::Any);
+                }
+                const Summary& summary = summaries_[instr.operand];
+                if (summary.returns == Summary::Returns::Never) {
+                    return false;
+                }
+                if (summary.returns == Summary::Returns::Value) {
+                    stack.push_back(summary.type);
+                }
+                break;
+            }
+            case Opcode::RET:
+                record_return(Summary::Returns::Nothing, SlotType::Any);
+                return false;
+            case Opcode::RET_VAL:
+                record_return(Summary::Returns::Value, pop(state));
+                return false;
+            case Opcode::BORROW:
+            case Opcode::BORROW_MUT:
+                pop(state);
+                stack.push_back(SlotType::Ref);
+                break;
+            case Opcode::DEREF:
+            case Opcode::DEREF_MUT:
+                pop(state, SlotType::Ref);
+                stack.push_back(SlotType::Any);
+                break;
+            case Opcode::LOAD_LOAD: {
+                SlotType a = local(state, operand_a(instr.operand));
+                SlotType b = local(state, operand_b(instr.operand));
+                stack.push_back(a);
+                stack.push_back(b);
+                break;
+            }
+            case Opcode::LOAD_LOAD_ADD:
+                expect_local(state, operand_a(instr.operand), SlotType::Int);
+                expect_local(state, operand_b(instr.operand), SlotType::Int);
+                stack.push_back(SlotType::Int);
+                break;
+            case Opcode::LOAD_PUSH_I32:
+                stack.push_back(local(state, operand_a(instr.operand)));
+                stack.push_back(SlotType::Int);
+                break;
+            case Opcode::INC_LOCAL:
+                expect_local(state, operand_a(instr.operand), SlotType::Int);
+                break;
+            case Opcode::CMP_EQ_JMP_IF_NOT:
+            case Opcode::CMP_NE_JMP_IF_NOT:
+            case Opcode::CMP_LT_JMP_IF_NOT:
+            case Opcode::CMP_GT_JMP_IF_NOT:
+            case Opcode::CMP_LE_JMP_IF_NOT:
+            case Opcode::CMP_GE_JMP_IF_NOT:
+                pop(state, SlotType::Int);
+                pop(state, SlotType::Int);
+                break;
+        }
+        return true;
+    }
+
+    const FunctionTable& function_table_;
+    size_t constant_count_;
+    const std::vector<Summary>& summaries_;
+    const FunctionInfo& func_;
+    const DecodedFunction& code_;
+
+    std::vector<bool> leaders_;
+    std::vector<std::optional<State>> states_;  // Entry state of each reached leader
+    std::vector<size_t> worklist_;
+    Summary summary_;
+    size_t at_ = 0;                             // Offset of the instruction being checked
+};
+
+} // namespace
+
+BytecodeVerifier::BytecodeVerifier(const FunctionTable& function_table, size_t constant_count)
+    : function_table_(function_table)
+    , constant_count_(constant_count)
+{
+}
+
+void BytecodeVerifier::verify(const PackedCode& code) const {
+    const auto& entries = code.entry_offsets();
+    if (entries.size() != function_table_.size()) {
+        throw VerifyError("code has " + std::to_string(entries.size()) + " entry points for " +
+                          std::to_string(function_table_.size()) + " functions");
+    }
+
+    // Each function owns the bytes from its entry point up to the next one
+    std::vector<size_t> starts(entries);
+    std::sort(starts.begin(), starts.end());
+    std::vector<DecodedFunction> functions;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const auto& func = function_table_.get_function(i);
+        if (entries[i] >= code.size()) {
+            throw VerifyError("function '" + func.name + "' has its entry point past the end of the code");
+        }
+        auto next = std::upper_bound(starts.begin(), starts.end(), entries[i]);
+        size_t end = next == starts.end() ? code.size() : *next;
+        functions.push_back(decode_function(code, func, entries[i], end));
+    }
+
+    // Summaries only grow (Never -> a return kind -> its type widened to
+    // Any), so this settles after a few rounds. Errors found in an early
+    // round hold for the final summaries too.
+    std::vector<Summary> summaries(functions.size());
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < functions.size(); ++i) {
+            Summary summary = FunctionVerifier(function_table_, constant_count_, summaries,
+                                               i, functions[i]).run();
+            if (summary != summaries[i]) {
+                summaries[i] = summary;
+                changed = true;
+            }
+        }
+    }
+}
+
+} // namespace nust
@@ -1,25 +1,45 @@
 #include "vm.h"
+#include "verifier.h"
 #include <stdexcept>
 #include <cassert>
+#include <algorithm>
+#include <functional>
 #include <iostream>
 
+// GCC and Clang support labels-as-values, which run() uses for a
+// direct-threaded dispatch loop. Define NUST_SWITCH_DISPATCH to force the
+// portable switch-based loop instead.
+#if !defined(NUST_SWITCH_DISPATCH) && defined(__GNUC__)
+#define NUST_THREADED_DISPATCH
+#endif
+
 namespace nust {
 
 VirtualMachine::VirtualMachine(const FunctionTable& function_table,
                              const std::vector<Value>& constants,
-                             const std::vector<Instruction>& instructions)
+                             const std::vector<Instruction>& instructions,
+                             CallStackConfig stack_config)
+    : VirtualMachine(function_table, constants, PackedCode::encode(instructions, function_table),
+                     stack_config)
+{
+}
+
+VirtualMachine::VirtualMachine(const FunctionTable& function_table,
+                             const std::vector<Value>& constants,
+                             PackedCode code,
+                             CallStackConfig stack_config)
     : function_table_(function_table)
     , constants_(constants)
-    , instructions_(instructions)
-    , memory_(1024)  // Start with 1KB of memory
+    , code_(std::move(code))
+    , call_stack_(function_table, stack_config)
     , pc_(0)
     , fp_(0)
     , running_(true)
     , returned_from_main_(false)
+    , verified_(false)
+    , executed_(0)
+    , jit_threshold_(0)
 {
-    // Initialize memory with a reasonable size
-    memory_.resize(1024);  // Can be adjusted based on needs
-    
     // Find main function and set up initial call
     size_t main_index = function_table_.get_function_index("main");
     if (main_index == function_table_.size()) {
@@ -31,26 +51,229 @@ VirtualMachine::VirtualMachine(const FunctionTable& function_table,
         throw std::runtime_error("main() function must take no parameters");
     }
     
+    // main's frame is the bottom of the call stack
+    fp_ = call_stack_.push_frame(main_index, 0, 0, frame_size(main_func));
     
     // Jump to main's entry point
-    pc_ = main_func.entry_point;  // -1 because pc_ will be incremented in run()
+    pc_ = code_.entry_offsets().at(main_index);
+}
+
+VirtualMachine::VirtualMachine(std::shared_ptr<const Module> module, CallStackConfig stack_config)
+    : function_table_(module->function_table())
+    , constants_(module->constants())
+    , code_(PackedCode::view(module->code().data(), module->code().size(), module->code().entry_offsets()))
+    , call_stack_(module->function_table(), stack_config)
+    , pc_(0)
+    , fp_(0)
+    , running_(true)
+    , returned_from_main_(false)
+    , verified_(module->is_verified())
+    , executed_(0)
+    , jit_threshold_(0)
+    , module_(std::move(module))
+{
+}
+
+void VirtualMachine::verify() {
+    BytecodeVerifier verifier(function_table_, constants_.size());
+    verifier.verify(code_);
+    verified_ = true;
+}
+
+void VirtualMachine::enable_jit(uint32_t threshold) {
+    jit_ = std::make_unique<JitCompiler>(function_table_, code_);
+    jit_threshold_ = threshold;
+    call_counts_.assign(function_table_.size(), 0);
+}
+
+size_t VirtualMachine::jit_compiled_functions() const {
+    return jit_ ? jit_->compiled_count() : 0;
 }
 
 void VirtualMachine::run() {
-    while (running_ && pc_ < instructions_.size()) {
-        execute_instruction(instructions_[pc_]);
-        pc_++;
+    if (call_stack_.depth() == 0) {
+        throw std::runtime_error("No function to run");
+    }
+#ifdef NUST_THREADED_DISPATCH
+    if (verified_) {
+        run_threaded<true>();
+    } else {
+        run_threaded<false>();
     }
+#else
+    if (verified_) {
+        run_switch<true>();
+    } else {
+        run_switch<false>();
+    }
+#endif
 
-    if (!returned_from_main_) {
-        result_ = stack_.back();
+    if (!returned_from_main_ && call_stack_.operand_count() > 0) {
+        result_ = call_stack_.top();
     }
 }
 
+Value VirtualMachine::call(size_t index, const std::vector<Value>& args) {
+    const auto& func_info = function_table_.get_function(index);
+    if (args.size() != func_info.num_params) {
+        throw std::runtime_error(func_info.name + " takes " + std::to_string(func_info.num_params) +
+                                 " arguments, got " + std::to_string(args.size()));
+    }
+    reset();
+    for (const auto& arg : args) {
+        push(arg);
+    }
+
+    // A hot function runs natively without entering the interpreter at all
+    if (verified_ && jit_ && call_native(index)) {
+        result_ = call_stack_.pop();
+        return result_;
+    }
+    fp_ = call_stack_.push_frame(index, 0, func_info.num_params, frame_size(func_info));
+    pc_ = code_.entry_offsets()[index];
+    run();
+    return result_;
+}
+
+void VirtualMachine::reset() {
+    call_stack_.clear();
+    ref_heap_.clear();
+    box_marks_.clear();
+    pc_ = 0;
+    fp_ = 0;
+    result_ = Value();
+    running_ = true;
+    returned_from_main_ = false;
+    executed_ = 0;
+}
+
+template <bool Verified>
+void VirtualMachine::run_switch() {
+    const uint8_t* code = code_.data();
+    const size_t code_size = code_.size();
+    // Verified code never runs off the end of a function
+    while (running_ && (Verified || pc_ < code_size)) {
+        executed_++;
+        // Decoding leaves pc_ at the next instruction; jumps overwrite it
+        execute_instruction<Verified>(read_instruction(code, pc_));
+    }
+}
+
+#ifdef NUST_THREADED_DISPATCH
+// Direct-threaded dispatch: every handler ends with its own indirect jump to
+// the next handler, so the branch predictor sees one jump site per opcode
+// instead of the single shared jump at the top of a switch.
+template <bool Verified>
+void VirtualMachine::run_threaded() {
+    // Must stay in the same order as the Opcode enum
+    static void* const dispatch_table[] = {
+        &&op_push_i32, &&op_push_bool, &&op_push_str, &&op_pop, &&op_dup, &&op_swap,
+        &&op_load, &&op_store, &&op_load_ref, &&op_store_ref,
+        &&op_add_i32, &&op_sub_i32, &&op_mul_i32, &&op_div_i32, &&op_neg_i32,
+        &&op_eq_i32, &&op_ne_i32, &&op_lt_i32, &&op_gt_i32, &&op_le_i32, &&op_ge_i32,
+        &&op_and, &&op_or, &&op_not,
+        &&op_jmp, &&op_jmp_if, &&op_jmp_if_not, &&op_call, &&op_ret, &&op_ret_val,
+        &&op_borrow, &&op_borrow_mut, &&op_deref, &&op_deref_mut,
+        &&op_load_load, &&op_load_load_add, &&op_load_push_i32, &&op_inc_local,
+        &&op_cmp_eq_jmp_if_not, &&op_cmp_ne_jmp_if_not, &&op_cmp_lt_jmp_if_not,
+        &&op_cmp_gt_jmp_if_not, &&op_cmp_le_jmp_if_not, &&op_cmp_ge_jmp_if_not
+    };
+    constexpr size_t table_size = sizeof(dispatch_table) / sizeof(dispatch_table[0]);
+    static_assert(table_size == opcode_count,
+                  "dispatch table out of sync with Opcode");
+
+    const uint8_t* code = code_.data();
+    const size_t code_size = code_.size();
+
+    // DISPATCH consumes the opcode byte; each handler decodes its own
+    // operand, which leaves pc_ at the next instruction
+#define DISPATCH()                                                          \
+    do {                                                                    \
+        if (!Verified && pc_ >= code_size) return;                          \
+        size_t op = code[pc_++];                                            \
+        if (!Verified && op >= table_size) {                                \
+            throw std::runtime_error("Unknown opcode");                     \
+        }                                                                   \
+        executed_++;                                                        \
+        goto *dispatch_table[op];                                           \
+    } while (0)
+#define NEXT() DISPATCH()
+#define UNSIGNED() read_unsigned(code, pc_)
+#define SIGNED() static_cast<size_t>(read_signed(code, pc_))
+#define TARGET() read_target(code, pc_)
+#define PAIR() read_pair(code, pc_)
+
+    DISPATCH();
+
+op_push_i32:   handle_push_i32(SIGNED()); NEXT();
+op_push_bool:  handle_push_bool(UNSIGNED()); NEXT();
+op_push_str:   handle_push_str<Verified>(UNSIGNED()); NEXT();
+op_pop:        handle_pop<Verified>(); NEXT();
+op_dup:        handle_dup<Verified>(); NEXT();
+op_swap:       handle_swap<Verified>(); NEXT();
+op_load:       handle_load<Verified>(UNSIGNED()); NEXT();
+op_store:      handle_store<Verified>(UNSIGNED()); NEXT();
+op_load_ref:   handle_load_ref<Verified>(UNSIGNED()); NEXT();
+op_store_ref:  handle_store_ref<Verified>(); NEXT();
+op_add_i32:    handle_add_i32<Verified>(); NEXT();
+op_sub_i32:    handle_sub_i32<Verified>(); NEXT();
+op_mul_i32:    handle_mul_i32<Verified>(); NEXT();
+op_div_i32:    handle_div_i32<Verified>(); NEXT();
+op_neg_i32:    handle_neg_i32<Verified>(); NEXT();
+op_eq_i32:     handle_eq_i32<Verified>(); NEXT();
+op_ne_i32:     handle_ne_i32<Verified>(); NEXT();
+op_lt_i32:     handle_lt_i32<Verified>(); NEXT();
+op_gt_i32:     handle_gt_i32<Verified>(); NEXT();
+op_le_i32:     handle_le_i32<Verified>(); NEXT();
+op_ge_i32:     handle_ge_i32<Verified>(); NEXT();
+op_and:        handle_and<Verified>(); NEXT();
+op_or:         handle_or<Verified>(); NEXT();
+op_not:        handle_not<Verified>(); NEXT();
+op_jmp:        handle_jmp(TARGET()); NEXT();
+op_jmp_if:     handle_jmp_if<Verified>(TARGET()); NEXT();
+op_jmp_if_not: handle_jmp_if_not<Verified>(TARGET()); NEXT();
+op_call:       handle_call<Verified>(UNSIGNED()); NEXT();
+op_ret:
+    handle_ret();
+    if (!running_) return;
+    NEXT();
+op_ret_val:
+    handle_ret_val<Verified>();
+    if (!running_) return;
+    NEXT();
+op_borrow:     handle_borrow<Verified>(); NEXT();
+op_borrow_mut: handle_borrow_mut<Verified>(); NEXT();
+op_deref:      handle_deref<Verified>(); NEXT();
+op_deref_mut:  handle_deref_mut<Verified>(); NEXT();
+op_load_load:      handle_load_load<Verified>(PAIR()); NEXT();
+op_load_load_add:  handle_load_load_add<Verified>(PAIR()); NEXT();
+op_load_push_i32:  handle_load_push_i32<Verified>(PAIR()); NEXT();
+op_inc_local:      handle_inc_local<Verified>(PAIR()); NEXT();
+op_cmp_eq_jmp_if_not: handle_cmp_jmp_if_not<Verified>(TARGET(), std::equal_to<Value::IntType>()); NEXT();
+op_cmp_ne_jmp_if_not: handle_cmp_jmp_if_not<Verified>(TARGET(), std::not_equal_to<Value::IntType>()); NEXT();
+op_cmp_lt_jmp_if_not: handle_cmp_jmp_if_not<Verified>(TARGET(), std::less<Value::IntType>()); NEXT();
+op_cmp_gt_jmp_if_not: handle_cmp_jmp_if_not<Verified>(TARGET(), std::greater<Value::IntType>()); NEXT();
+op_cmp_le_jmp_if_not: handle_cmp_jmp_if_not<Verified>(TARGET(), std::less_equal<Value::IntType>()); NEXT();
+op_cmp_ge_jmp_if_not: handle_cmp_jmp_if_not<Verified>(TARGET(), std::greater_equal<Value::IntType>()); NEXT();
+
+#undef PAIR
+#undef TARGET
+#undef SIGNED
+#undef UNSIGNED
+#undef NEXT
+#undef DISPATCH
+}
+#endif
+
+uint64_t VirtualMachine::instructions_executed() const {
+    return executed_;
+}
+
 Value VirtualMachine::get_result() const {
     return result_;
 }
 
+template <bool Verified>
 void VirtualMachine::execute_instruction(const Instruction& instr) {
     switch (instr.opcode) {
         case Opcode::PUSH_I32:
@@ -60,138 +283,222 @@ void VirtualMachine::execute_instruction(const Instruction& instr) {
             handle_push_bool(instr.operand);
             break;
         case Opcode::PUSH_STR:
-            handle_push_str(instr.operand);
+            handle_push_str<Verified>(instr.operand);
             break;
         case Opcode::POP:
-            handle_pop();
+            handle_pop<Verified>();
             break;
         case Opcode::DUP:
-            handle_dup();
+            handle_dup<Verified>();
             break;
         case Opcode::SWAP:
-            handle_swap();
+            handle_swap<Verified>();
             break;
         case Opcode::LOAD:
-            handle_load(instr.operand);
+            handle_load<Verified>(instr.operand);
             break;
         case Opcode::STORE:
-            handle_store(instr.operand);
+            handle_store<Verified>(instr.operand);
             break;
         case Opcode::LOAD_REF:
-            handle_load_ref(instr.operand);
+            handle_load_ref<Verified>(instr.operand);
             break;
         case Opcode::STORE_REF:
-            handle_store_ref();
+            handle_store_ref<Verified>();
             break;
         case Opcode::ADD_I32:
-            handle_add_i32();
+            handle_add_i32<Verified>();
             break;
         case Opcode::SUB_I32:
-            handle_sub_i32();
+            handle_sub_i32<Verified>();
             break;
         case Opcode::MUL_I32:
-            handle_mul_i32();
+            handle_mul_i32<Verified>();
             break;
         case Opcode::DIV_I32:
-            handle_div_i32();
+            handle_div_i32<Verified>();
             break;
         case Opcode::NEG_I32:
-            handle_neg_i32();
+            handle_neg_i32<Verified>();
             break;
         case Opcode::EQ_I32:
-            handle_eq_i32();
+            handle_eq_i32<Verified>();
             break;
         case Opcode::NE_I32:
-            handle_ne_i32();
+            handle_ne_i32<Verified>();
             break;
         case Opcode::LT_I32:
-            handle_lt_i32();
+            handle_lt_i32<Verified>();
             break;
         case Opcode::GT_I32:
-            handle_gt_i32();
+            handle_gt_i32<Verified>();
             break;
         case Opcode::LE_I32:
-            handle_le_i32();
+            handle_le_i32<Verified>();
             break;
         case Opcode::GE_I32:
-            handle_ge_i32();
+            handle_ge_i32<Verified>();
             break;
         case Opcode::AND:
-            handle_and();
+            handle_and<Verified>();
             break;
         case Opcode::OR:
-            handle_or();
+            handle_or<Verified>();
             break;
         case Opcode::NOT:
-            handle_not();
+            handle_not<Verified>();
             break;
         case Opcode::JMP:
             handle_jmp(instr.operand);
             break;
         case Opcode::JMP_IF:
-            handle_jmp_if(instr.operand);
+            handle_jmp_if<Verified>(instr.operand);
             break;
         case Opcode::JMP_IF_NOT:
-            handle_jmp_if_not(instr.operand);
+            handle_jmp_if_not<Verified>(instr.operand);
             break;
         case Opcode::CALL:
-            handle_call(instr.operand);
+            handle_call<Verified>(instr.operand);
             break;
         case Opcode::RET:
             handle_ret();
             break;
         case Opcode::RET_VAL:
-            handle_ret_val();
+            handle_ret_val<Verified>();
             break;
         case Opcode::BORROW:
-            handle_borrow();
+            handle_borrow<Verified>();
             break;
         case Opcode::BORROW_MUT:
-            handle_borrow_mut();
+            handle_borrow_mut<Verified>();
             break;
         case Opcode::DEREF:
-            handle_deref();
+            handle_deref<Verified>();
             break;
         case Opcode::DEREF_MUT:
-            handle_deref_mut();
+            handle_deref_mut<Verified>();
+            break;
+        case Opcode::LOAD_LOAD:
+            handle_load_load<Verified>(instr.operand);
+            break;
+        case Opcode::LOAD_LOAD_ADD:
+            handle_load_load_add<Verified>(instr.operand);
+            break;
+        case Opcode::LOAD_PUSH_I32:
+            handle_load_push_i32<Verified>(instr.operand);
+            break;
+        case Opcode::INC_LOCAL:
+            handle_inc_local<Verified>(instr.operand);
+            break;
+        case Opcode::CMP_EQ_JMP_IF_NOT:
+            handle_cmp_jmp_if_not<Verified>(instr.operand, std::equal_to<Value::IntType>());
+            break;
+        case Opcode::CMP_NE_JMP_IF_NOT:
+            handle_cmp_jmp_if_not<Verified>(instr.operand, std::not_equal_to<Value::IntType>());
+            break;
+        case Opcode::CMP_LT_JMP_IF_NOT:
+            handle_cmp_jmp_if_not<Verified>(instr.operand, std::less<Value::IntType>());
+            break;
+        case Opcode::CMP_GT_JMP_IF_NOT:
+            handle_cmp_jmp_if_not<Verified>(instr.operand, std::greater<Value::IntType>());
+            break;
+        case Opcode::CMP_LE_JMP_IF_NOT:
+            handle_cmp_jmp_if_not<Verified>(instr.operand, std::less_equal<Value::IntType>());
+            break;
+        case Opcode::CMP_GE_JMP_IF_NOT:
+            handle_cmp_jmp_if_not<Verified>(instr.operand, std::greater_equal<Value::IntType>());
             break;
         default:
             throw std::runtime_error("Unknown opcode");
     }
 }
 
-void VirtualMachine::push(const Value& value) {
-    stack_.push_back(value);
+void VirtualMachine::push(Value value) {
+    call_stack_.push(value);
 }
 
-Value VirtualMachine::pop() {
-    if (stack_.empty()) {
+void VirtualMachine::check_stack_size(size_t required) const {
+    if (call_stack_.operand_count() < required) {
         throw std::runtime_error("Stack underflow");
     }
-    Value value = stack_.back();;
-    stack_.pop_back();
-    return value;
 }
 
-Value& VirtualMachine::top() {
-    if (stack_.empty()) {
-        throw std::runtime_error("Stack underflow");
-    }
-    return stack_.back();;
+size_t VirtualMachine::frame_size(const FunctionInfo& func_info) {
+    return std::max(func_info.num_locals, func_info.num_params);
 }
 
-void VirtualMachine::check_stack_size(size_t required) const {
-    if (stack_.size() < required) {
-        throw std::runtime_error("Stack underflow");
+Value::RefType VirtualMachine::box(const Value& value) {
+    ref_heap_.push_back(value);
+    return &ref_heap_.back();
+}
+
+// Free the boxes a returning frame borrowed into, so loops that call
+// functions which borrow run in constant memory. A returned reference
+// may point at one of them; they are then left to the caller's frame.
+void VirtualMachine::release_boxes(const Value& ret_val) {
+    size_t mark = box_marks_.back();
+    box_marks_.pop_back();
+    if (!ret_val.is_ref()) {
+        ref_heap_.resize(mark);
     }
 }
 
 void VirtualMachine::check_memory_bounds(size_t index) const {
-    if (index >= memory_.size()) {
+    if (index >= call_stack_.current().stack_base) {
         throw std::runtime_error("Memory access out of bounds");
     }
 }
 
+template <bool Verified>
+void VirtualMachine::require_operands(size_t count) const {
+    if (!Verified) {
+        check_stack_size(count);
+    }
+}
+
+template <bool Verified>
+Value& VirtualMachine::local(size_t index) {
+    if (!Verified) {
+        check_memory_bounds(fp_ + index);
+    }
+    return call_stack_[fp_ + index];
+}
+
+template <bool Verified>
+void VirtualMachine::require_int(const Value& a) {
+    if (!Verified && !a.is_int()) {
+        throw std::runtime_error("Expected integer value");
+    }
+}
+
+template <bool Verified>
+void VirtualMachine::require_ints(const Value& a, const Value& b) {
+    if (!Verified && (!a.is_int() || !b.is_int())) {
+        throw std::runtime_error("Expected integer values");
+    }
+}
+
+template <bool Verified>
+void VirtualMachine::require_bool(const Value& a) {
+    if (!Verified && !a.is_bool()) {
+        throw std::runtime_error("Expected boolean value");
+    }
+}
+
+template <bool Verified>
+void VirtualMachine::require_bools(const Value& a, const Value& b) {
+    if (!Verified && (!a.is_bool() || !b.is_bool())) {
+        throw std::runtime_error("Expected boolean values");
+    }
+}
+
+template <bool Verified>
+void VirtualMachine::require_ref(const Value& a) {
+    if (!Verified && !a.is_ref()) {
+        throw std::runtime_error("Expected reference value");
+    }
+}
+
 // Stack operations
 void VirtualMachine::handle_push_i32(size_t operand) {
     push(Value(static_cast<Value::IntType>(operand)));
@@ -201,322 +508,377 @@ void VirtualMachine::handle_push_bool(size_t operand) {
     push(Value(static_cast<Value::BoolType>(operand != 0)));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_push_str(size_t operand) {
-    if (operand >= constants_.size()) {
+    if (!Verified && operand >= constants_.size()) {
         throw std::runtime_error("String constant index out of bounds");
     }
     push(constants_[operand]);
 }
 
+template <bool Verified>
 void VirtualMachine::handle_pop() {
-    pop();
+    require_operands<Verified>(1);
+    call_stack_.pop();
 }
 
+template <bool Verified>
 void VirtualMachine::handle_dup() {
-    check_stack_size(1);
-    push(top());
+    require_operands<Verified>(1);
+    Value value = call_stack_.top();  // push may grow the stack and move top()
+    push(value);
 }
 
+template <bool Verified>
 void VirtualMachine::handle_swap() {
-    check_stack_size(2);
-    Value a = pop();
-    Value b = pop();
+    require_operands<Verified>(2);
+    Value a = call_stack_.pop();
+    Value b = call_stack_.pop();
     push(a);
     push(b);
 }
 
 // Variable operations
+template <bool Verified>
 void VirtualMachine::handle_load(size_t operand) {
-    check_memory_bounds(fp_ + operand);
-    push(memory_[fp_ + operand]);
+    push(local<Verified>(operand));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_store(size_t operand) {
-    check_stack_size(1);
-    check_memory_bounds(fp_ + operand);
-    memory_[fp_ + operand] = pop();
+    require_operands<Verified>(1);
+    Value value = call_stack_.pop();
+    local<Verified>(operand) = value;
 }
 
+template <bool Verified>
 void VirtualMachine::handle_load_ref(size_t operand) {
-    check_memory_bounds(fp_ + operand);
-    push(Value(std::make_shared<Value>(memory_[fp_ + operand])));
+    push(Value(box(local<Verified>(operand))));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_store_ref() {
-    check_stack_size(2);
-    Value ref = pop();
-    Value value = pop();
-    if (!ref.is_ref()) {
-        throw std::runtime_error("Expected reference value");
-    }
+    require_operands<Verified>(2);
+    Value ref = call_stack_.pop();
+    Value value = call_stack_.pop();
+    require_ref<Verified>(ref);
     *ref.as_ref() = value;
+    // A reference stored into an older box outlives its frame; keep every
+    // box made so far until reset()
+    if (value.is_ref()) {
+        std::fill(box_marks_.begin(), box_marks_.end(), ref_heap_.size());
+    }
 }
 
 // Arithmetic operations
+template <bool Verified>
 void VirtualMachine::handle_add_i32() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_int() || !b.is_int()) {
-        throw std::runtime_error("Expected integer values");
-    }
-    push(Value(a.as_int() + b.as_int()));
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_ints<Verified>(a, b);
+    push(Value(add_i32(a.as_int(), b.as_int())));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_sub_i32() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_int() || !b.is_int()) {
-        throw std::runtime_error("Expected integer values");
-    }
-    push(Value(a.as_int() - b.as_int()));
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_ints<Verified>(a, b);
+    push(Value(sub_i32(a.as_int(), b.as_int())));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_mul_i32() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_int() || !b.is_int()) {
-        throw std::runtime_error("Expected integer values");
-    }
-    push(Value(a.as_int() * b.as_int()));
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_ints<Verified>(a, b);
+    push(Value(mul_i32(a.as_int(), b.as_int())));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_div_i32() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_int() || !b.is_int()) {
-        throw std::runtime_error("Expected integer values");
-    }
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_ints<Verified>(a, b);
+    // Verification says nothing about values, so this check always stays
     if (b.as_int() == 0) {
         throw std::runtime_error("Division by zero");
     }
-    push(Value(a.as_int() / b.as_int()));
+    push(Value(divide_i32(a.as_int(), b.as_int())));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_neg_i32() {
-    check_stack_size(1);
-    Value a = pop();
-    if (!a.is_int()) {
-        throw std::runtime_error("Expected integer value");
-    }
-    push(Value(-a.as_int()));
+    require_operands<Verified>(1);
+    Value a = call_stack_.pop();
+    require_int<Verified>(a);
+    push(Value(neg_i32(a.as_int())));
 }
 
 // Comparison operations
+template <bool Verified>
 void VirtualMachine::handle_eq_i32() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_int() || !b.is_int()) {
-        throw std::runtime_error("Expected integer values");
-    }
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_ints<Verified>(a, b);
     push(Value(a.as_int() == b.as_int()));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_ne_i32() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_int() || !b.is_int()) {
-        throw std::runtime_error("Expected integer values");
-    }
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_ints<Verified>(a, b);
     push(Value(a.as_int() != b.as_int()));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_lt_i32() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_int() || !b.is_int()) {
-        throw std::runtime_error("Expected integer values");
-    }
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_ints<Verified>(a, b);
     push(Value(a.as_int() < b.as_int()));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_gt_i32() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_int() || !b.is_int()) {
-        throw std::runtime_error("Expected integer values");
-    }
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_ints<Verified>(a, b);
     push(Value(a.as_int() > b.as_int()));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_le_i32() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_int() || !b.is_int()) {
-        throw std::runtime_error("Expected integer values");
-    }
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_ints<Verified>(a, b);
     push(Value(a.as_int() <= b.as_int()));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_ge_i32() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_int() || !b.is_int()) {
-        throw std::runtime_error("Expected integer values");
-    }
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_ints<Verified>(a, b);
     push(Value(a.as_int() >= b.as_int()));
 }
 
 // Logical operations
+template <bool Verified>
 void VirtualMachine::handle_and() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_bool() || !b.is_bool()) {
-        throw std::runtime_error("Expected boolean values");
-    }
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_bools<Verified>(a, b);
     push(Value(a.as_bool() && b.as_bool()));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_or() {
-    check_stack_size(2);
-    Value b = pop();
-    Value a = pop();
-    if (!a.is_bool() || !b.is_bool()) {
-        throw std::runtime_error("Expected boolean values");
-    }
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_bools<Verified>(a, b);
     push(Value(a.as_bool() || b.as_bool()));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_not() {
-    check_stack_size(1);
-    Value a = pop();
-    if (!a.is_bool()) {
-        throw std::runtime_error("Expected boolean value");
-    }
+    require_operands<Verified>(1);
+    Value a = call_stack_.pop();
+    require_bool<Verified>(a);
     push(Value(!a.as_bool()));
 }
 
 // Control flow
 void VirtualMachine::handle_jmp(size_t operand) {
-    pc_ = operand - 1;  // -1 because pc_ will be incremented after this instruction
+    pc_ = operand;
 }
 
+template <bool Verified>
 void VirtualMachine::handle_jmp_if(size_t operand) {
-    check_stack_size(1);
-    Value cond = pop();
-    if (!cond.is_bool()) {
-        throw std::runtime_error("Expected boolean value");
-    }
+    require_operands<Verified>(1);
+    Value cond = call_stack_.pop();
+    require_bool<Verified>(cond);
     if (cond.as_bool()) {
-        pc_ = operand - 1;
+        pc_ = operand;
     }
 }
 
+template <bool Verified>
 void VirtualMachine::handle_jmp_if_not(size_t operand) {
-    check_stack_size(1);
-    Value cond = pop();
-    if (!cond.is_bool()) {
-        throw std::runtime_error("Expected boolean value");
-    }
+    require_operands<Verified>(1);
+    Value cond = call_stack_.pop();
+    require_bool<Verified>(cond);
     if (!cond.as_bool()) {
-        pc_ = operand - 1;
+        pc_ = operand;
+    }
+}
+
+// Run a call natively if the callee is hot and compiles; false if the
+// interpreter should make the call instead
+bool VirtualMachine::call_native(size_t index) {
+    if (call_counts_[index] < jit_threshold_) {
+        ++call_counts_[index];
+        return false;
+    }
+    const auto& func_info = function_table_.get_function(index);
+    if (!jit_->compile(index)) {
+        return false;
+    }
+    size_t num_params = func_info.num_params;
+    const Value* args = num_params > 0 ? &call_stack_[call_stack_.size() - num_params] : nullptr;
+    Value result;
+    if (!jit_->call(index, args, result)) {
+        return false;
     }
+    for (size_t i = 0; i < num_params; ++i) {
+        call_stack_.pop();
+    }
+    push(result);
+    return true;
 }
 
+template <bool Verified>
 void VirtualMachine::handle_call(size_t operand) {
-    const auto& func_info = function_table_.get_function(operand);
-    if (operand >= function_table_.size()) {
+    // Native code relies on the verifier's guarantees
+    if (Verified && jit_ && call_native(operand)) {
+        return;
+    }
+    if (!Verified && operand >= function_table_.size()) {
         throw std::runtime_error("Function index out of bounds");
     }
+    const auto& func_info = function_table_.get_function(operand);
     
-    if (stack_.size() < func_info.num_params) {
+    if (!Verified && call_stack_.operand_count() < func_info.num_params) {
         throw std::runtime_error("Not enough arguments for function call");
     }
     
-    // Save return address and frame pointer
-    memory_[fp_] = Value(static_cast<Value::IntType>(pc_ + 1));
-    memory_[fp_ + 1] = Value(static_cast<Value::IntType>(fp_));
-    
-    // Set up new frame
-    size_t old_fp = fp_;
-    fp_ += 2 + func_info.num_locals;  // Skip return address and frame pointer
-    
-    // Copy arguments to new frame in correct order
-    std::vector<Value> args;
-    for (size_t i = 0; i < func_info.num_params; ++i) {
-        args.push_back(pop());
-    }
-    for (size_t i = 0; i < func_info.num_params; ++i) {
-        memory_[fp_ + i] = args[func_info.num_params - 1 - i];
-    }
+    // The arguments on top of the operand stack become the callee's
+    // parameter slots in place; the call stack records the return address
+    fp_ = call_stack_.push_frame(operand, pc_, func_info.num_params, frame_size(func_info));
     
+    box_marks_.push_back(ref_heap_.size());
+
     // Jump to function
-    pc_ = func_info.entry_point - 1;
+    pc_ = code_.entry_offsets()[operand];
 }
 
 void VirtualMachine::handle_ret() {
-    // If we're returning from main (fp_ is 0), stop the VM
-    if (fp_ == 0) {
+    // If we're returning from main (the bottom frame), stop the VM
+    if (call_stack_.depth() == 1) {
         running_ = false;
         returned_from_main_ = true;
         return;
     }
 
-    // Restore frame pointer
-    fp_ = static_cast<size_t>(memory_[fp_ + 1].as_int());
-
-    // Restore program counter
-    pc_ = static_cast<size_t>(memory_[fp_].as_int()) - 1;
+    // Restore the caller's frame and program counter
+    CallStack::Frame frame = call_stack_.pop_frame();
+    fp_ = call_stack_.current().base;
+    pc_ = frame.return_pc;
+    release_boxes(Value());
 }
 
+template <bool Verified>
 void VirtualMachine::handle_ret_val() {
-    check_stack_size(1);
-    Value ret_val = pop();
+    require_operands<Verified>(1);
+    Value ret_val = call_stack_.pop();
 
-    // If we're returning from main (fp_ is 0), stop the VM
-    if (fp_ == 0) {
+    // If we're returning from main (the bottom frame), stop the VM
+    if (call_stack_.depth() == 1) {
         result_ = ret_val;
         running_ = false;
         returned_from_main_ = true;
         return;
     }
-    // Restore frame pointer
-    fp_ = static_cast<size_t>(memory_[fp_ + 1].as_int());
-    // Restore program counter
-    pc_ = static_cast<size_t>(memory_[fp_].as_int()) - 1;
+    // Restore the caller's frame and program counter
+    CallStack::Frame frame = call_stack_.pop_frame();
+    fp_ = call_stack_.current().base;
+    pc_ = frame.return_pc;
+    release_boxes(ret_val);
     // Push return value for caller
     push(ret_val);
 }
 
 // Reference operations
+template <bool Verified>
 void VirtualMachine::handle_borrow() {
-    check_stack_size(1);
-    Value value = pop();
-    push(Value(std::make_shared<Value>(value)));
+    require_operands<Verified>(1);
+    Value value = call_stack_.pop();
+    push(Value(box(value)));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_borrow_mut() {
-    check_stack_size(1);
-    Value value = pop();
-    push(Value(std::make_shared<Value>(value)));
+    require_operands<Verified>(1);
+    Value value = call_stack_.pop();
+    push(Value(box(value)));
 }
 
+template <bool Verified>
 void VirtualMachine::handle_deref() {
-    check_stack_size(1);
-    Value ref = pop();
-    if (!ref.is_ref()) {
-        throw std::runtime_error("Expected reference value");
-    }
+    require_operands<Verified>(1);
+    Value ref = call_stack_.pop();
+    require_ref<Verified>(ref);
     push(*ref.as_ref());
 }
 
+template <bool Verified>
 void VirtualMachine::handle_deref_mut() {
-    check_stack_size(1);
-    Value ref = pop();
-    if (!ref.is_ref()) {
-        throw std::runtime_error("Expected reference value");
-    }
+    require_operands<Verified>(1);
+    Value ref = call_stack_.pop();
+    require_ref<Verified>(ref);
     push(*ref.as_ref());
 }
 
-} // namespace nust 
\ No newline at end of file
+// Superinstructions
+template <bool Verified>
+void VirtualMachine::handle_load_load(size_t operand) {
+    handle_load<Verified>(operand_a(operand));
+    handle_load<Verified>(operand_b(operand));
+}
+
+template <bool Verified>
+void VirtualMachine::handle_load_load_add(size_t operand) {
+    Value a = local<Verified>(operand_a(operand));
+    Value b = local<Verified>(operand_b(operand));
+    require_ints<Verified>(a, b);
+    push(Value(add_i32(a.as_int(), b.as_int())));
+}
+
+template <bool Verified>
+void VirtualMachine::handle_load_push_i32(size_t operand) {
+    handle_load<Verified>(operand_a(operand));
+    push(Value(static_cast<Value::IntType>(operand_b(operand))));
+}
+
+template <bool Verified>
+void VirtualMachine::handle_inc_local(size_t operand) {
+    Value& slot = local<Verified>(operand_a(operand));
+    require_int<Verified>(slot);
+    slot = Value(add_i32(slot.as_int(), static_cast<Value::IntType>(operand_b(operand))));
+}
+
+template <bool Verified, typename Compare>
+void VirtualMachine::handle_cmp_jmp_if_not(size_t operand, Compare compare) {
+    require_operands<Verified>(2);
+    Value b = call_stack_.pop();
+    Value a = call_stack_.pop();
+    require_ints<Verified>(a, b);
+    if (!compare(a.as_int(), b.as_int())) {
+        pc_ = operand;
+    }
+}
+
+} // namespace nust
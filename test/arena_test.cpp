@@ -0,0 +1,82 @@
+#include "arena.h"
+#include "parser.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nust {
+
+TEST(ArenaTest, AllocationsAreAlignedAndDistinct) {
+    Arena arena;
+    char* a = static_cast<char*>(arena.allocate(1, 1));
+    auto* b = static_cast<uint64_t*>(arena.allocate(sizeof(uint64_t), alignof(uint64_t)));
+    char* c = static_cast<char*>(arena.allocate(3, 1));
+
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % alignof(uint64_t), 0u);
+    EXPECT_NE(a, c);
+    EXPECT_GE(arena.bytes_reserved(), arena.bytes_used());
+}
+
+TEST(ArenaTest, GrowsPastOneBlock) {
+    Arena arena;
+    std::vector<int*> values;
+    for (int i = 0; i < 100000; i++) {
+        values.push_back(arena.make<int>(i));
+    }
+    for (int i = 0; i < 100000; i++) {
+        ASSERT_EQ(*values[i], i);
+    }
+    // Larger than any block on its own
+    void* big = arena.allocate(32 * 1024 * 1024, 16);
+    EXPECT_NE(big, nullptr);
+}
+
+TEST(ArenaTest, RunsDestructorsInReverseOrder) {
+    struct Tracker {
+        Tracker(std::vector<std::string>* log, std::string name) : log(log), name(std::move(name)) {}
+        ~Tracker() { log->push_back(name); }
+        std::vector<std::string>* log;
+        std::string name;
+    };
+
+    std::vector<std::string> log;
+    {
+        Arena arena;
+        arena.make<Tracker>(&log, "first");
+        arena.make<Tracker>(&log, "second");
+        EXPECT_TRUE(log.empty());
+    }
+    EXPECT_EQ(log, (std::vector<std::string>{"second", "first"}));
+}
+
+TEST(ArenaTest, CopyArray) {
+    Arena arena;
+    std::vector<int> source = {1, 2, 3};
+    auto array = arena.copy_array(source.data(), source.size());
+    source[0] = 9;
+
+    ASSERT_EQ(array.size(), 3u);
+    EXPECT_EQ(array[0], 1);
+    EXPECT_EQ(array.back(), 3);
+    EXPECT_TRUE(arena.copy_array(source.data(), 0).empty());
+}
+
+TEST(ArenaTest, LiteralTreeNeedsNoFinalizers) {
+    Arena arena;
+    Span span(0, 0);
+    Expr* sum = arena.make<BinaryExpr>(span, BinaryExpr::Op::Add, arena.make<IntLiteral>(span, 1),
+                                       arena.make<UnaryExpr>(span, UnaryExpr::Op::Neg,
+                                                             arena.make<IntLiteral>(span, 2)));
+    Stmt* body = arena.make<ReturnStmt>(span, arena.make<BinaryExpr>(span, BinaryExpr::Op::Eq, sum,
+                                                                      arena.make<BoolLiteral>(span, true)));
+    ASSERT_NE(body, nullptr);
+    EXPECT_EQ(arena.finalizer_count(), 0u);
+
+    // Only nodes that own a string or vector are destroyed one by one
+    arena.make<StringLiteral>(span, "text");
+    EXPECT_EQ(arena.finalizer_count(), 1u);
+}
+
+} // namespace nust
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include "bytecode_module.h"
+#include "parser.h"
+#include "type_checker.h"
+#include "compiler.h"
+#include "vm.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace nust;
+
+class BytecodeModuleTest : public ::testing::Test {
+protected:
+    // Compile a program and serialize it
+    std::string compile_to_module(const std::string& source) {
+        Parser parser(source);
+        program_ = parser.parse();
+        TypeChecker type_checker;
+        EXPECT_TRUE(type_checker.check_program(*program_));
+        instructions_ = compiler_.compile(*program_);
+
+        std::ostringstream out;
+        write_module(out, compiler_.get_function_table(), compiler_.string_constants, instructions_);
+        return out.str();
+    }
+
+    Value run(const BytecodeModule& module) {
+        VirtualMachine vm(module.function_table(), module.constants(), module.code());
+        vm.run();
+        return vm.get_result();
+    }
+
+    std::unique_ptr<Program> program_;
+    Compiler compiler_;
+    std::vector<Instruction> instructions_;
+
+    const char* program_source_ = R"(
+        fn greet(name: &str, times: i32) -> i32 {
+            return times * 2;
+        }
+
+        fn main() -> i32 {
+            let a: str = "hello";
+            let b: str = "hello";
+            let c: str = "world";
+            return greet(&a, 21);
+        }
+    )";
+};
+
+TEST_F(BytecodeModuleTest, RoundTrip) {
+    std::string bytes = compile_to_module(program_source_);
+    auto module = BytecodeModule::from_bytes(bytes.data(), bytes.size());
+
+    auto decoded = module.code().decode();
+    ASSERT_EQ(decoded.size(), instructions_.size());
+    for (size_t i = 0; i < instructions_.size(); ++i) {
+        EXPECT_EQ(decoded[i].opcode, instructions_[i].opcode);
+        EXPECT_EQ(decoded[i].operand, instructions_[i].operand);
+    }
+
+    const auto& original = compiler_.get_function_table();
+    const auto& loaded = module.function_table();
+    ASSERT_EQ(loaded.size(), original.size());
+    for (size_t i = 0; i < original.size(); ++i) {
+        EXPECT_EQ(loaded.get_function(i).name, original.get_function(i).name);
+        EXPECT_EQ(loaded.get_function(i).entry_point, original.get_function(i).entry_point);
+        EXPECT_EQ(loaded.get_function(i).num_params, original.get_function(i).num_params);
+        EXPECT_EQ(loaded.get_function(i).num_locals, original.get_function(i).num_locals);
+    }
+    const auto& greet = loaded.get_function(loaded.get_function_index("greet"));
+    ASSERT_EQ(greet.param_types.size(), 2);
+    EXPECT_EQ(greet.param_types[0]->kind, Type::Kind::Ref);
+    EXPECT_EQ(greet.param_types[0]->base_type->kind, Type::Kind::Str);
+    EXPECT_EQ(greet.return_type->kind, Type::Kind::I32);
+
+    EXPECT_EQ(run(module).as_int(), 42);
+}
+
+TEST_F(BytecodeModuleTest, DeduplicatesStrings) {
+    std::string bytes = compile_to_module(program_source_);
+    auto module = BytecodeModule::from_bytes(bytes.data(), bytes.size());
+
+    ASSERT_EQ(module.constants().size(), 3);
+    EXPECT_EQ(module.constants()[0].as_string(), "hello");
+    EXPECT_EQ(module.constants()[2].as_string(), "world");
+    // Both "hello" constants share one record
+    EXPECT_EQ(module.constants()[0].bits(), module.constants()[1].bits());
+}
+
+TEST_F(BytecodeModuleTest, LoadFromFile) {
+    std::string bytes = compile_to_module(program_source_);
+    std::string path = ::testing::TempDir() + "bytecode_module_test.no";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(bytes.data(), bytes.size());
+    }
+    auto module = BytecodeModule::load(path);
+    std::remove(path.c_str());
+    EXPECT_EQ(run(module).as_int(), 42);
+}
+
+TEST_F(BytecodeModuleTest, MapFile) {
+    std::string bytes = compile_to_module(program_source_);
+    std::string path = ::testing::TempDir() + "bytecode_module_map_test.no";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(bytes.data(), bytes.size());
+    }
+    auto module = BytecodeModule::map(path);
+    std::remove(path.c_str());  // The mapping keeps the contents alive
+
+    auto decoded = module.code().decode();
+    ASSERT_EQ(decoded.size(), instructions_.size());
+    for (size_t i = 0; i < instructions_.size(); ++i) {
+        EXPECT_EQ(decoded[i].opcode, instructions_[i].opcode);
+        EXPECT_EQ(decoded[i].operand, instructions_[i].operand);
+    }
+    EXPECT_EQ(module.constants()[2].as_string(), "world");
+    EXPECT_EQ(run(module).as_int(), 42);
+
+#if defined(__linux__) && defined(__x86_64__)
+    // Code and strings are read straight out of the mapping
+    EXPECT_TRUE(module.is_mapped());
+    auto in_file = [&](const void* p) {
+        auto address = reinterpret_cast<uintptr_t>(p);
+        auto code = reinterpret_cast<uintptr_t>(module.code().data());
+        return address >= code - bytes.size() && address < code + bytes.size();
+    };
+    EXPECT_TRUE(in_file(module.constants()[0].as_string().data()));
+#endif
+}
+
+TEST_F(BytecodeModuleTest, MappedModuleSurvivesMove) {
+    std::string bytes = compile_to_module(program_source_);
+    std::string path = ::testing::TempDir() + "bytecode_module_move_test.no";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(bytes.data(), bytes.size());
+    }
+    auto mapped = BytecodeModule::map(path);
+    std::remove(path.c_str());
+    BytecodeModule moved = std::move(mapped);
+    EXPECT_EQ(run(moved).as_int(), 42);
+}
+
+TEST_F(BytecodeModuleTest, RejectsBadMagic) {
+    std::string bytes = compile_to_module(program_source_);
+    bytes[0] = 'X';
+    EXPECT_THROW(BytecodeModule::from_bytes(bytes.data(), bytes.size()), BytecodeError);
+}
+
+TEST_F(BytecodeModuleTest, RejectsOtherVersions) {
+    std::string bytes = compile_to_module(program_source_);
+    bytes[4] = static_cast<char>(module_version + 1);
+    EXPECT_THROW(BytecodeModule::from_bytes(bytes.data(), bytes.size()), BytecodeError);
+}
+
+TEST_F(BytecodeModuleTest, RejectsTruncatedFile) {
+    std::string bytes = compile_to_module(program_source_);
+    EXPECT_THROW(BytecodeModule::from_bytes(bytes.data(), bytes.size() - 16), BytecodeError);
+    EXPECT_THROW(BytecodeModule::from_bytes(bytes.data(), 10), BytecodeError);
+}
+
+TEST_F(BytecodeModuleTest, RejectsInvalidOpcode) {
+    std::string bytes = compile_to_module(program_source_);
+    // Corrupt the first opcode of the code section
+    size_t code_offset = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        code_offset |= static_cast<size_t>(static_cast<uint8_t>(bytes[48 + i])) << (i * 8);
+    }
+    bytes[code_offset] = static_cast<char>(0xFF);
+    EXPECT_THROW(BytecodeModule::from_bytes(bytes.data(), bytes.size()), BytecodeError);
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "c_emitter.h"
+#include "parser.h"
+#include "type_checker.h"
+#include <string>
+
+using namespace nust;
+
+class CEmitterTest : public ::testing::Test {
+protected:
+    std::string emit(const std::string& source) {
+        Parser parser(source);
+        auto program = parser.parse();
+        TypeChecker type_checker;
+        EXPECT_TRUE(type_checker.check_program(*program));
+        CEmitter emitter;
+        return emitter.emit(*program);
+    }
+
+    static size_t count(const std::string& haystack, const std::string& needle) {
+        size_t n = 0;
+        for (size_t pos = haystack.find(needle); pos != std::string::npos;
+             pos = haystack.find(needle, pos + 1)) {
+            n++;
+        }
+        return n;
+    }
+};
+
+TEST_F(CEmitterTest, EmitsOneCFunctionPerDecl) {
+    std::string c = emit(R"(
+        fn pick(flag: bool, a: i32, b: i32) -> i32 {
+            if (flag) {
+                return a;
+            }
+            return b;
+        }
+
+        fn main() -> i32 {
+            return pick(true, 1, 2);
+        }
+    )");
+    // Prototype plus definition
+    EXPECT_EQ(count(c, "static int32_t fn_pick(bool v_flag, int32_t v_a, int32_t v_b)"), 2);
+    EXPECT_EQ(count(c, "static int32_t fn_main(void)"), 2);
+    EXPECT_NE(c.find("return fn_pick(true, 1, 2);"), std::string::npos);
+    EXPECT_NE(c.find("printf(\"%d\", (int)fn_main());"), std::string::npos);
+}
+
+TEST_F(CEmitterTest, WrapsArithmeticAndChecksDivision) {
+    std::string c = emit(R"(
+        fn main() -> i32 {
+            let x: i32 = 7;
+            return -(x * x + 1) / (x - 7);
+        }
+    )");
+    EXPECT_NE(c.find("return nust_div(nust_neg(nust_add(nust_mul(v_x_0, v_x_0), 1)), nust_sub(v_x_0, 7));"),
+              std::string::npos);
+}
+
+TEST_F(CEmitterTest, ShadowingLetsAreSeparateVariables) {
+    // Lets are numbered by binding; a shadowing let may change the type
+    std::string c = emit(R"(
+        fn shadow(n: i32) -> i32 {
+            let mut x: i32 = n;
+            while (x < 10) {
+                let x: i32 = 20;
+                let n: bool = true;
+            }
+            return x;
+        }
+
+        fn main() -> i32 {
+            return shadow(10);
+        }
+    )");
+    EXPECT_EQ(count(c, "int32_t v_x_1 = 0;"), 1);
+    EXPECT_EQ(count(c, "int32_t v_x_2 = 0;"), 1);
+    EXPECT_EQ(count(c, "bool v_n_3 = false;"), 1);
+    EXPECT_NE(c.find("v_x_1 = v_n;"), std::string::npos);
+    EXPECT_NE(c.find("v_x_2 = 20;"), std::string::npos);
+    EXPECT_NE(c.find("return v_x_1;"), std::string::npos);
+}
+
+TEST_F(CEmitterTest, EvaluatesOperandsInOrder) {
+    std::string c = emit(R"(
+        fn g(a: i32, b: i32) -> i32 {
+            return a * 10 + b;
+        }
+
+        fn main() -> i32 {
+            let mut x: i32 = 1;
+            let mut n: i32 = 0;
+            while (x + (x = x + 1) < 9) {
+                n = n + 1;
+            }
+            return g(x, x = 5) + (x = 7) * 0 + x;
+        }
+    )");
+    // Everything up to the last operand with side effects is read into a
+    // temporary first, left to right
+    EXPECT_NE(c.find("    int32_t t_3 = v_x_0;\n"
+                     "    int32_t t_4 = (v_x_0 = 5);\n"
+                     "    int32_t t_5 = fn_g(t_3, t_4);\n"
+                     "    int32_t t_6 = (v_x_0 = 7);\n"
+                     "    int32_t t_7 = nust_mul(t_6, 0);\n"
+                     "    int32_t t_8 = nust_add(t_5, t_7);\n"
+                     "    return nust_add(t_8, v_x_0);\n"),
+              std::string::npos) << c;
+    // A loop condition's temporaries are recomputed on every iteration
+    EXPECT_NE(c.find("    while (1) {\n"
+                     "        int32_t t_0 = v_x_0;\n"
+                     "        int32_t t_1 = (v_x_0 = nust_add(v_x_0, 1));\n"
+                     "        int32_t t_2 = nust_add(t_0, t_1);\n"
+                     "        if (!((t_2 < 9))) break;\n"),
+              std::string::npos) << c;
+}
+
+TEST_F(CEmitterTest, EscapesStringLiterals) {
+    std::string c = emit(R"(
+        fn main() -> str {
+            return "say \"hi\"";
+        }
+    )");
+    // The VM keeps escapes as written, so the backslashes survive too
+    EXPECT_NE(c.find(R"(return "say \\\"hi\\\"";)"), std::string::npos);
+    EXPECT_NE(c.find("fputs(fn_main(), stdout);"), std::string::npos);
+}
+
+TEST_F(CEmitterTest, RejectsWhatCCannotExpress) {
+    EXPECT_THROW(emit(R"(
+        fn get(r: &i32) -> i32 {
+            return 0;
+        }
+
+        fn main() -> i32 {
+            let x: i32 = 1;
+            return get(&x);
+        }
+    )"), CEmitError);
+}
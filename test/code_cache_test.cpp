@@ -0,0 +1,164 @@
+#include "code_cache.h"
+#include "compiler.h"
+#include "type_checker.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+
+namespace nust {
+
+class CodeCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = (std::filesystem::temp_directory_path() /
+                 (std::string("nust_cache_test_") +
+                  ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".nfc")).string();
+        std::filesystem::remove(path_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(path_);
+    }
+
+    struct Result {
+        std::vector<Instruction> instructions;
+        std::vector<std::string> strings;
+        std::vector<size_t> entry_points;
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    // Check and compile `source`, through the cache unless `cached` is false
+    Result build(const std::string& source, bool cached = true) {
+        auto program = Parser(source).parse();
+        std::optional<CodeCache> cache;
+        if (cached) {
+            cache.emplace(path_, source, SignatureIndex(*program));
+        }
+        TypeChecker checker;
+        checker.set_code_cache(cache ? &*cache : nullptr);
+        EXPECT_TRUE(checker.check_program(*program));
+        Compiler compiler;
+        compiler.set_code_cache(cache ? &*cache : nullptr);
+        Result result;
+        result.instructions = compiler.compile(*program, checker.signatures());
+        result.strings = compiler.string_constants;
+        for (size_t i = 0; i < compiler.get_function_table().size(); i++) {
+            result.entry_points.push_back(compiler.get_function_table().get_function(i).entry_point);
+        }
+        if (cache) {
+            EXPECT_TRUE(cache->save());
+            result.hits = cache->hits();
+            result.misses = cache->misses();
+        }
+        return result;
+    }
+
+    void expect_same(const Result& actual, const Result& expected) {
+        ASSERT_EQ(actual.instructions.size(), expected.instructions.size());
+        for (size_t i = 0; i < expected.instructions.size(); i++) {
+            EXPECT_EQ(actual.instructions[i].opcode, expected.instructions[i].opcode) << "at " << i;
+            EXPECT_EQ(actual.instructions[i].operand, expected.instructions[i].operand) << "at " << i;
+        }
+        EXPECT_EQ(actual.strings, expected.strings);
+        EXPECT_EQ(actual.entry_points, expected.entry_points);
+    }
+
+    std::string path_;
+};
+
+const char* program_source = R"(
+    fn helper(n: i32) -> i32 {
+        let label: str = "helper";
+        if (n > 1) { return n - 1; }
+        return n;
+    }
+
+    fn other(flag: bool) -> i32 {
+        let s: str = "other";
+        let mut i: i32 = 0;
+        while (i < 3) { i = i + 1; }
+        return i;
+    }
+
+    fn main() -> i32 {
+        return helper(other(true));
+    }
+)";
+
+TEST_F(CodeCacheTest, SecondRunHitsEverything) {
+    Result first = build(program_source);
+    EXPECT_EQ(first.hits, 0u);
+    EXPECT_EQ(first.misses, 3u);
+
+    Result second = build(program_source);
+    EXPECT_EQ(second.hits, 3u);
+    EXPECT_EQ(second.misses, 0u);
+    expect_same(second, build(program_source, false));
+}
+
+TEST_F(CodeCacheTest, OnlyEditedFunctionsRecompile) {
+    build(program_source);
+
+    std::string edited = program_source;
+    edited.replace(edited.find("i < 3"), 5, "i < 7");
+    Result result = build(edited);
+    EXPECT_EQ(result.hits, 2u);
+    EXPECT_EQ(result.misses, 1u);
+    expect_same(result, build(edited, false));
+}
+
+TEST_F(CodeCacheTest, CalleeChangesInvalidateCallers) {
+    build(program_source);
+
+    // Appending a function leaves every existing table index alone
+    std::string appended = std::string(program_source) + "fn extra() -> i32 { return 0; }\n";
+    Result result = build(appended);
+    EXPECT_EQ(result.hits, 3u);
+    EXPECT_EQ(result.misses, 1u);
+
+    // Putting it first renumbers helper and other, so main's calls change
+    std::string prepended = "fn extra() -> i32 { return 0; }\n" + std::string(program_source);
+    result = build(prepended);
+    EXPECT_EQ(result.hits, 3u);
+    EXPECT_EQ(result.misses, 1u);
+    expect_same(result, build(prepended, false));
+}
+
+TEST_F(CodeCacheTest, SignatureChangesInvalidateCallers) {
+    // The caller's text is the same both times; only the callee's
+    // parameter type differs
+    auto source = [](const char* param) {
+        return std::string("fn peek(x: ") + param + ") -> i32 { return 1; }\n"
+               "fn main() -> i32 { let mut y: i32 = 2; return peek(&mut y); }\n";
+    };
+    build(source("&mut i32"));
+    Result result = build(source("&i32"));
+    EXPECT_EQ(result.hits, 0u);
+    EXPECT_EQ(result.misses, 2u);
+
+    // Likewise when a variable's name becomes a function's: helper's `n`
+    // would now name the function (and fail to check)
+    std::string shadowed = std::string(program_source) + "fn n() -> i32 { return 0; }\n";
+    auto before = Parser(program_source).parse();
+    auto after = Parser(shadowed).parse();
+    SignatureIndex before_signatures(*before), after_signatures(*after);
+    auto key = [](const Program& program, const SignatureIndex& signatures, const std::string& text, size_t item) {
+        return CodeCache::function_key(*static_cast<const FunctionDecl*>(program.items[item]), text, signatures, 0);
+    };
+    EXPECT_NE(key(*before, before_signatures, program_source, 0), key(*after, after_signatures, shadowed, 0));
+    EXPECT_EQ(key(*before, before_signatures, program_source, 1), key(*after, after_signatures, shadowed, 1));
+}
+
+TEST_F(CodeCacheTest, CorruptEntriesAreMisses) {
+    build(program_source);
+    // Cut the file short in the middle of an entry
+    std::filesystem::resize_file(path_, std::filesystem::file_size(path_) - 5);
+    Result result = build(program_source);
+    EXPECT_EQ(result.hits, 0u);
+    EXPECT_EQ(result.misses, 3u);
+    expect_same(result, build(program_source, false));
+    EXPECT_EQ(build(program_source).hits, 3u);
+}
+
+} // namespace nust
@@ -4,6 +4,7 @@
 #include <gtest/gtest.h>
 #include <sstream>
 #include <iostream>
+#include "thread_pool.h"
 
 namespace nust {
 
@@ -187,8 +188,8 @@ TEST_F(CompilerTest, FunctionCalls) {
     
     // Main function should be first
     ASSERT_GE(instructions.size(), 5);
-    expect_instruction(instructions, 0, Opcode::PUSH_I32, 2);
-    expect_instruction(instructions, 1, Opcode::PUSH_I32, 1);
+    expect_instruction(instructions, 0, Opcode::PUSH_I32, 1);
+    expect_instruction(instructions, 1, Opcode::PUSH_I32, 2);
     expect_instruction(instructions, 2, Opcode::CALL, 1);  // Call add function at index 1
     expect_instruction(instructions, 3, Opcode::STORE, 0);
     expect_instruction(instructions, 4, Opcode::RET);
@@ -300,4 +301,50 @@ TEST_F(CompilerTest, StringLiterals) {
     expect_instruction(instructions, 2, Opcode::RET);
 }
 
+TEST_F(CompilerTest, ParallelMatchesSerial) {
+    // Jumps, strings and calls in every function, so linking has to move
+    // all of them
+    std::string source;
+    for (int i = 0; i < 40; i++) {
+        std::string n = std::to_string(i);
+        source += "fn f" + n + "(a: i32) -> i32 {\n"
+                  "    let mut x: i32 = a;\n"
+                  "    let s: str = \"s" + n + "\";\n"
+                  "    while (x < " + n + ") { x = x + 1; }\n"
+                  "    if (x > 3) { x = x - 1; } else { x = x + 2; }\n";
+        if (i > 0) {
+            source += "    x = x + f" + std::to_string(i - 1) + "(x);\n";
+        }
+        source += "    return x;\n}\n";
+    }
+    source += "fn main() -> i32 { return f39(1); }\n";
+
+    Parser parser(source);
+    auto program = parser.parse();
+    TypeChecker checker;
+    ASSERT_TRUE(checker.check_program(*program));
+
+    Compiler serial;
+    auto expected = serial.compile(*program);
+
+    ThreadPool pool(4);
+    Compiler parallel;
+    parallel.set_thread_pool(&pool);
+    auto actual = parallel.compile(*program, checker.signatures());
+
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(actual[i].opcode, expected[i].opcode) << "at " << i;
+        EXPECT_EQ(actual[i].operand, expected[i].operand) << "at " << i;
+    }
+    EXPECT_EQ(parallel.string_constants, serial.string_constants);
+    const auto& serial_table = serial.get_function_table();
+    const auto& parallel_table = parallel.get_function_table();
+    ASSERT_EQ(parallel_table.size(), serial_table.size());
+    for (size_t i = 0; i < serial_table.size(); i++) {
+        EXPECT_EQ(parallel_table.get_function(i).entry_point, serial_table.get_function(i).entry_point);
+        EXPECT_EQ(parallel_table.get_function(i).num_locals, serial_table.get_function(i).num_locals);
+    }
+}
+
 } // namespace nust 
@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+#include "constant_folder.h"
+#include "parser.h"
+#include "type_checker.h"
+#include "compiler.h"
+#include "vm.h"
+#include <string>
+
+using namespace nust;
+
+class ConstantFolderTest : public ::testing::Test {
+protected:
+    // Parse, type check and fold; returns the instructions compiled from the
+    // folded program
+    std::vector<Instruction> fold_and_compile(const std::string& source) {
+        Parser parser(source);
+        program_ = parser.parse();
+        TypeChecker type_checker;
+        EXPECT_TRUE(type_checker.check_program(*program_));
+        folder_.fold_program(*program_);
+        return compiler_.compile(*program_);
+    }
+
+    Value run(const std::string& source) {
+        auto instructions = fold_and_compile(source);
+        VirtualMachine vm(compiler_.get_function_table(), constants_, instructions);
+        vm.run();
+        return vm.get_result();
+    }
+
+    // What running `source` on the VM gives, folded or not: its result, or
+    // the runtime error
+    static std::string outcome(const std::string& source, bool fold) {
+        Parser parser(source);
+        auto program = parser.parse();
+        TypeChecker type_checker;
+        EXPECT_TRUE(type_checker.check_program(*program));
+        if (fold) {
+            ConstantFolder().fold_program(*program);
+        }
+        Compiler compiler;
+        auto instructions = compiler.compile(*program);
+        std::vector<Value> constants;
+        VirtualMachine vm(compiler.get_function_table(), constants, instructions);
+        try {
+            vm.run();
+        } catch (const std::exception& e) {
+            return std::string("error: ") + e.what();
+        }
+        return vm.get_result().to_string();
+    }
+
+    size_t count(const std::vector<Instruction>& instructions, Opcode opcode) {
+        size_t n = 0;
+        for (const auto& instr : instructions) {
+            n += instr.opcode == opcode;
+        }
+        return n;
+    }
+
+    std::unique_ptr<Program> program_;
+    ConstantFolder folder_;
+    Compiler compiler_;
+    std::vector<Value> constants_;
+};
+
+TEST_F(ConstantFolderTest, FoldsArithmetic) {
+    auto instructions = fold_and_compile(R"(
+        fn main() -> i32 {
+            let x: i32 = 60 * 60 * 24;
+            return x;
+        }
+    )");
+    EXPECT_EQ(count(instructions, Opcode::MUL_I32), 0);
+    ASSERT_GE(instructions.size(), 1);
+    EXPECT_EQ(instructions[0].opcode, Opcode::PUSH_I32);
+    EXPECT_EQ(instructions[0].operand, 86400);
+}
+
+TEST_F(ConstantFolderTest, PropagatesImmutableBindings) {
+    auto instructions = fold_and_compile(R"(
+        fn main() -> i32 {
+            let a: i32 = 6;
+            let b: i32 = a * 7;
+            return b;
+        }
+    )");
+    EXPECT_EQ(count(instructions, Opcode::MUL_I32), 0);
+    EXPECT_EQ(count(instructions, Opcode::LOAD), 0);
+    EXPECT_EQ(instructions[instructions.size() - 2].operand, 42);
+}
+
+TEST_F(ConstantFolderTest, DoesNotPropagateMutableBindings) {
+    Value result = run(R"(
+        fn main() -> i32 {
+            let mut a: i32 = 6;
+            a = a + 1;
+            return a * 6;
+        }
+    )");
+    EXPECT_EQ(result.as_int(), 42);
+    EXPECT_EQ(count(compiler_.compile(*program_), Opcode::MUL_I32), 1);
+}
+
+TEST_F(ConstantFolderTest, ParametersAreNotConstants) {
+    Value result = run(R"(
+        fn f(x: i32) -> i32 {
+            return x + 1;
+        }
+
+        fn main() -> i32 {
+            let x: i32 = 1;
+            return f(41) + x - 1;
+        }
+    )");
+    EXPECT_EQ(result.as_int(), 42);
+}
+
+TEST_F(ConstantFolderTest, InnerBindingsShadowOuterConstants) {
+    auto instructions = fold_and_compile(R"(
+        fn main() -> i32 {
+            let x: i32 = 1;
+            let mut y: i32 = 0;
+            while (y < 1) {
+                let mut x: i32 = 40;
+                x = x + 1;
+                y = y + x;
+            }
+            return y + x;
+        }
+    )");
+    // The inner x is mutable, so `x + 1` stays; the outer x folds into the return
+    EXPECT_EQ(count(instructions, Opcode::ADD_I32), 3);
+    EXPECT_EQ(instructions[instructions.size() - 3].opcode, Opcode::PUSH_I32);
+    EXPECT_EQ(instructions[instructions.size() - 3].operand, 1);
+}
+
+TEST_F(ConstantFolderTest, WrapsAround) {
+    Value result = run(R"(
+        fn main() -> i32 {
+            return 2147483647 + 1;
+        }
+    )");
+    EXPECT_EQ(result.as_int(), -2147483647 - 1);
+}
+
+TEST_F(ConstantFolderTest, KeepsDivisionByZero) {
+    auto instructions = fold_and_compile(R"(
+        fn main() -> i32 {
+            return 1 / 0;
+        }
+    )");
+    EXPECT_EQ(count(instructions, Opcode::DIV_I32), 1);
+    VirtualMachine vm(compiler_.get_function_table(), constants_, instructions);
+    EXPECT_THROW(vm.run(), std::runtime_error);
+}
+
+TEST_F(ConstantFolderTest, FoldsComparisonsAndLogic) {
+    auto instructions = fold_and_compile(R"(
+        fn main() -> i32 {
+            let ok: bool = 3 > 2 && !(1 == 2);
+            if (ok) {
+                return 1;
+            }
+            return 0;
+        }
+    )");
+    EXPECT_EQ(count(instructions, Opcode::GT_I32), 0);
+    EXPECT_EQ(count(instructions, Opcode::AND), 0);
+    EXPECT_EQ(instructions[0].opcode, Opcode::PUSH_BOOL);
+    EXPECT_EQ(instructions[0].operand, 1);
+}
+
+TEST_F(ConstantFolderTest, FoldingNeverChangesTheOutcome) {
+    const char* programs[] = {
+        R"(
+            fn main() -> i32 {
+                let x: i32 = 1;
+                {
+                    let x: i32 = 2;
+                    let y: i32 = x + 10;
+                }
+                let z: i32 = x;
+                if (z == 1) {
+                    let x: i32 = 100;
+                    return x + z;
+                }
+                return x;
+            }
+        )",
+        R"(
+            fn main() -> i32 {
+                return -(-2147483647 - 1) * 3 + 2147483647 / -7;
+            }
+        )",
+        R"(
+            fn main() -> bool {
+                return true == true;
+            }
+        )",
+        R"(
+            fn main() -> bool {
+                let t: bool = true;
+                return t != false || !t;
+            }
+        )",
+        R"(
+            fn main() -> i32 {
+                return (-2147483647 - 1) / -1;
+            }
+        )",
+    };
+    for (const char* source : programs) {
+        EXPECT_EQ(outcome(source, true), outcome(source, false)) << source;
+    }
+    EXPECT_EQ(outcome(programs[0], true), "101");
+    EXPECT_EQ(outcome(programs[2], true), "error: Expected integer values");
+}
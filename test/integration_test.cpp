@@ -1,7 +1,17 @@
 #include <gtest/gtest.h>
 #include "compiler.h"
+#include "c_emitter.h"
+#include "constant_folder.h"
 #include "parser.h"
+#include "peephole.h"
+#include "register_compiler.h"
+#include "register_vm.h"
+#include "superinstructions.h"
+#include "type_checker.h"
 #include "vm.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <sstream>
 #include <string>
 
@@ -30,7 +40,73 @@ protected:
         // Run the program
         VirtualMachine vm(compiler.get_function_table(), constants_, instructions);
         vm.run();
-        return vm.get_result();
+        Value result = vm.get_result();
+
+        check_c_backend(*program, result.to_string());
+        return result;
+    }
+
+    // Run `source` like run_program (stack VM and C), then check that the
+    // optimized and verified stack VM and the register VM, each with and
+    // without constant folding, agree with it
+    Value run_on_every_backend(const std::string& source) {
+        Value result = run_program(source);
+        for (bool fold : {false, true}) {
+            Parser parser(source);
+            auto program = parser.parse();
+            TypeChecker type_checker;
+            EXPECT_TRUE(type_checker.check_program(*program));
+            if (fold) {
+                ConstantFolder().fold_program(*program);
+            }
+
+            Compiler compiler;
+            compiler.add_pass(std::make_unique<PeepholeOptimizer>());
+            compiler.add_pass(std::make_unique<SuperinstructionPass>());
+            auto instructions = compiler.compile(*program);
+            VirtualMachine vm(compiler.get_function_table(), constants_, instructions);
+            vm.verify();
+            vm.run();
+            EXPECT_EQ(vm.get_result().to_string(), result.to_string())
+                << "optimized stack VM disagrees" << (fold ? " with folding" : "");
+
+            RegisterCompiler register_compiler;
+            auto register_instructions = register_compiler.compile(*program);
+            RegisterVM register_vm(register_compiler.get_function_table(), constants_, register_instructions);
+            register_vm.run();
+            EXPECT_EQ(register_vm.get_result().to_string(), result.to_string())
+                << "register VM disagrees" << (fold ? " with folding" : "");
+        }
+        return result;
+    }
+
+    // Emit `program` as C, build it with the system compiler and check that
+    // it prints what the VM returned. Skipped when there's no C compiler.
+    void check_c_backend(const Program& program, const std::string& expected) {
+        static const bool have_cc = std::system("cc --version >/dev/null 2>&1") == 0;
+        if (!have_cc) {
+            return;
+        }
+        TypeChecker type_checker;
+        ASSERT_TRUE(type_checker.check_program(program));
+        CEmitter emitter;
+        std::string base = ::testing::TempDir() + "nust_" +
+                           ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        std::ofstream(base + ".c") << emitter.emit(program);
+        std::string build = "cc -std=c99 -O1 -o " + base + " " + base + ".c";
+        ASSERT_EQ(std::system(build.c_str()), 0) << "failed to build " << base << ".c";
+
+        FILE* pipe = popen(base.c_str(), "r");
+        ASSERT_NE(pipe, nullptr);
+        std::string output;
+        char buffer[256];
+        while (size_t n = fread(buffer, 1, sizeof(buffer), pipe)) {
+            output.append(buffer, n);
+        }
+        EXPECT_EQ(pclose(pipe), 0);
+        EXPECT_EQ(output, expected) << "C backend disagrees with the VM";
+        std::remove((base + ".c").c_str());
+        std::remove(base.c_str());
     }
 
     std::vector<Value> constants_;
@@ -100,3 +176,113 @@ TEST_F(IntegrationTest, WhileLoop) {
     Value result = run_program(source);
     EXPECT_EQ(result.as_int(), 10);
 }
+
+// Test recursion deeper than the call stack's initial size
+TEST_F(IntegrationTest, DeepRecursion) {
+    const char* source = R"(
+        fn sum(n: i32) -> i32 {
+            if (n == 0) {
+                return 0;
+            }
+            return n + sum(n - 1);
+        }
+
+        fn main() -> i32 {
+            return sum(5000);
+        }
+    )";
+    
+    Value result = run_program(source);
+    EXPECT_EQ(result.as_int(), 12502500);
+}
+
+// Test that arguments bind to parameters in order
+TEST_F(IntegrationTest, ArgumentOrder) {
+    const char* source = R"(
+        fn sub(x: i32, y: i32) -> i32 {
+            return x - y;
+        }
+        
+        fn main() -> i32 {
+            return sub(50, 8);
+        }
+    )";
+    
+    Value result = run_program(source);
+    EXPECT_EQ(result.as_int(), 42);
+}
+
+// Test i32 overflow wrapping and non-short-circuit logic, with a bool result
+TEST_F(IntegrationTest, WrappingAndLogic) {
+    const char* source = R"(
+        fn grow(x: i32) -> i32 {
+            return x * 65537 + 2147483647;
+        }
+
+        fn main() -> bool {
+            let mut i: i32 = 0;
+            let mut acc: i32 = 1;
+            while (i < 20) {
+                acc = grow(acc);
+                i = i + 1;
+            }
+            return acc < 0 || !(acc / 7 == -acc / -7) && true;
+        }
+    )";
+
+    Value result = run_program(source);
+    EXPECT_TRUE(result.is_bool());
+}
+
+// Test that a shadowing let gets its own variable, whatever its type, and
+// the variable it hid is intact once its scope closes
+TEST_F(IntegrationTest, ShadowingKeepsOuterVariables) {
+    const char* source = R"(
+        fn retyped() -> i32 {
+            let x: i32 = 1;
+            if (true) {
+                let x: bool = true;
+                let y: bool = x;
+            }
+            return x + 20;
+        }
+
+        fn main() -> i32 {
+            let x: i32 = 1;
+            {
+                let x: i32 = 2;
+                let y: i32 = x + 10;
+            }
+            let z: i32 = x;
+            if (z == 1) {
+                let x: i32 = 100;
+                return x + z + retyped();
+            }
+            return x;
+        }
+    )";
+
+    Value result = run_on_every_backend(source);
+    EXPECT_EQ(result.as_int(), 122);
+}
+
+// Test that operands and arguments run left to right on every backend, C included
+TEST_F(IntegrationTest, SideEffectsRunLeftToRight) {
+    std::string source = R"(
+        fn g(a: i32, b: i32) -> i32 {
+            return a * 10 + b;
+        }
+
+        fn main() -> i32 {
+            let mut x: i32 = 1;
+            let mut n: i32 = 0;
+            while (x + (x = x + 1) < 9) {
+                n = n + 1;
+            }
+            return n * 100 + g(x, x = 5) + (x = 7) * 0 + x;
+        }
+    )";
+
+    Value result = run_on_every_backend(source);
+    EXPECT_EQ(result.as_int(), 362);
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include "isolate.h"
+#include "parser.h"
+#include "type_checker.h"
+#include "compiler.h"
+#include <fstream>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nust;
+
+namespace {
+
+const char* library_source = R"(
+    fn main() -> i32 {
+        return fib(10);
+    }
+
+    fn fib(n: i32) -> i32 {
+        if (n < 2) {
+            return n;
+        }
+        return fib(n - 1) + fib(n - 2);
+    }
+
+    fn add(a: i32, b: i32) -> i32 {
+        return a + b;
+    }
+
+    fn is_positive(n: i32) -> bool {
+        return n > 0;
+    }
+
+    fn divide(a: i32, b: i32) -> i32 {
+        return a / b;
+    }
+
+    fn pick(first: bool, a: str, b: str) -> str {
+        if (first) {
+            return a;
+        }
+        return b;
+    }
+
+    fn greeting() -> str {
+        return "hello";
+    }
+
+    fn bump(x: &mut i32) -> i32 {
+        return 0;
+    }
+)";
+
+int fib(int n) {
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+} // namespace
+
+TEST(IsolateTest, CallsFunctionsByName) {
+    auto module = Module::compile(library_source);
+    EXPECT_TRUE(module->is_verified());
+    Isolate isolate(module);
+
+    EXPECT_EQ(isolate.call("main").as_int(), 55);
+    EXPECT_EQ(isolate.call("add", {Value(2), Value(40)}).as_int(), 42);
+    EXPECT_FALSE(isolate.call("is_positive", {Value(-3)}).as_bool());
+    EXPECT_TRUE(isolate.call(module->function_index("is_positive"), {Value(3)}).as_bool());
+    EXPECT_EQ(isolate.call("greeting").as_string(), "hello");
+}
+
+TEST(IsolateTest, RunsManyCallsOnOneIsolate) {
+    auto module = Module::compile(library_source);
+    size_t fib_index = module->function_index("fib");
+
+    // The low threshold gets fib compiled natively partway through; the
+    // interpreter and native code must agree
+    IsolateConfig config;
+    config.jit_threshold = 50;
+    Isolate jitted(module, config);
+    config.jit = false;
+    Isolate interpreted(module, config);
+    for (int i = 0; i < 300; i++) {
+        int n = i % 15;
+        EXPECT_EQ(jitted.call(fib_index, {Value(n)}).as_int(), fib(n));
+        EXPECT_EQ(interpreted.call(fib_index, {Value(n)}).as_int(), fib(n));
+    }
+    EXPECT_GT(interpreted.instructions_executed(), 0u);
+
+    // A call that fails leaves the isolate usable
+    EXPECT_THROW(interpreted.call("divide", {Value(1), Value(0)}), std::runtime_error);
+    EXPECT_EQ(interpreted.call("divide", {Value(12), Value(4)}).as_int(), 3);
+    interpreted.reset();
+    EXPECT_EQ(interpreted.call("add", {Value(1), Value(1)}).as_int(), 2);
+}
+
+TEST(IsolateTest, ArgumentsAreChecked) {
+    Isolate isolate(Module::compile(library_source));
+
+    EXPECT_THROW(isolate.call("missing"), std::runtime_error);
+    EXPECT_THROW(isolate.call("add", {Value(1)}), std::runtime_error);
+    EXPECT_THROW(isolate.call("add", {Value(1), Value(true)}), std::runtime_error);
+    EXPECT_THROW(isolate.call("pick", {Value(true), Value(1), Value(2)}), std::runtime_error);
+    EXPECT_THROW(isolate.call("bump", {Value(1)}), std::runtime_error);
+    EXPECT_THROW(Module::compile("fn main() -> i32 { let x: i32 = true; return x; }"), std::runtime_error);
+}
+
+TEST(IsolateTest, StringArguments) {
+    Isolate isolate(Module::compile(library_source));
+    Value a = isolate.string("first");
+    Value b = isolate.string("second");
+
+    EXPECT_EQ(isolate.call("pick", {Value(true), a, b}).as_string(), "first");
+    EXPECT_EQ(isolate.call("pick", {Value(false), a, b}).as_string(), "second");
+    isolate.reset();
+    EXPECT_EQ(isolate.call("pick", {Value(false), isolate.string("x"), isolate.string("y")}).as_string(), "y");
+}
+
+TEST(IsolateTest, IsolatesShareAModuleAcrossThreads) {
+    auto module = Module::compile(library_source);
+    constexpr int threads = 4;
+    std::vector<int> failures(threads, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&module, &failures, t] {
+            IsolateConfig config;
+            config.jit_threshold = 20;
+            Isolate isolate(module, config);
+            for (int i = 0; i < 200; i++) {
+                int n = (i + t) % 12;
+                if (isolate.call("fib", {Value(n)}).as_int() != fib(n)) {
+                    failures[t]++;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (int t = 0; t < threads; t++) {
+        EXPECT_EQ(failures[t], 0);
+    }
+}
+
+TEST(IsolateTest, LoadsACompiledModule) {
+    Parser parser(library_source);
+    auto program = parser.parse();
+    TypeChecker type_checker;
+    ASSERT_TRUE(type_checker.check_program(*program));
+    Compiler compiler;
+    auto instructions = compiler.compile(*program);
+
+    std::string path = ::testing::TempDir() + "isolate_test.no";
+    {
+        std::ofstream file(path, std::ios::binary);
+        write_module(file, compiler.get_function_table(), compiler.string_constants, instructions);
+    }
+    auto module = Module::load(path);
+    std::remove(path.c_str());
+
+    Isolate isolate(module);
+    EXPECT_EQ(isolate.call("add", {Value(20), Value(22)}).as_int(), 42);
+    EXPECT_EQ(isolate.call("greeting").as_string(), "hello");
+}
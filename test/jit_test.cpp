@@ -0,0 +1,229 @@
+#include <gtest/gtest.h>
+#include "jit.h"
+#include "parser.h"
+#include "type_checker.h"
+#include "compiler.h"
+#include "peephole.h"
+#include "superinstructions.h"
+#include "vm.h"
+#include <string>
+#include <vector>
+
+using namespace nust;
+
+class JitTest : public ::testing::Test {
+protected:
+    struct Run {
+        Value result;
+        size_t compiled;
+    };
+
+    // Compile and run `source` verified, with the JIT enabled at `threshold`
+    Run run_source(const std::string& source, bool optimize, uint32_t threshold = 2,
+                   bool verify = true) {
+        Parser parser(source);
+        auto program = parser.parse();
+        TypeChecker type_checker;
+        EXPECT_TRUE(type_checker.check_program(*program));
+
+        Compiler compiler;
+        if (optimize) {
+            compiler.add_pass(std::make_unique<PeepholeOptimizer>());
+            compiler.add_pass(std::make_unique<SuperinstructionPass>());
+        }
+        auto instructions = compiler.compile(*program);
+        heap_.emplace_back();
+        constants_.clear();
+        for (const auto& str : compiler.string_constants) {
+            constants_.push_back(Value(heap_.back().allocate(str)));
+        }
+        VirtualMachine vm(compiler.get_function_table(), constants_, instructions);
+        if (verify) {
+            vm.verify();
+        }
+        vm.enable_jit(threshold);
+        vm.run();
+        return {vm.get_result(), vm.jit_compiled_functions()};
+    }
+
+    void SetUp() override {
+        if (!JitCompiler::available()) {
+            GTEST_SKIP() << "JIT not available on this platform";
+        }
+    }
+
+    std::vector<StringHeap> heap_;
+    std::vector<Value> constants_;
+};
+
+TEST_F(JitTest, CompilesHotRecursiveFunction) {
+    const std::string source = R"(
+        fn fib(n: i32) -> i32 {
+            if (n < 2) {
+                return n;
+            }
+            return fib(n - 1) + fib(n - 2);
+        }
+
+        fn main() -> i32 {
+            return fib(20);
+        }
+    )";
+    for (bool optimize : {false, true}) {
+        Run run = run_source(source, optimize);
+        EXPECT_EQ(run.result.as_int(), 6765) << "optimize=" << optimize;
+        EXPECT_EQ(run.compiled, 1) << "optimize=" << optimize;
+    }
+}
+
+TEST_F(JitTest, MatchesInterpreterOnArithmeticAndLogic) {
+    const std::string source = R"(
+        fn mix(a: i32, b: i32, flag: bool) -> i32 {
+            let mut x: i32 = a * b - a / 3;
+            let y: i32 = -x;
+            if (flag && !(a == b) || a > 100) {
+                x = x + y * 2;
+            }
+            if (!(a < b)) {
+                return x - 1;
+            }
+            if (!(a > 2)) {
+                return x + 7;
+            }
+            return x;
+        }
+
+        fn is_even(n: i32) -> bool {
+            return n / 2 * 2 == n;
+        }
+
+        fn main() -> i32 {
+            let mut i: i32 = 0;
+            let mut acc: i32 = 0;
+            while (i < 50) {
+                acc = acc + mix(i, 25 - i, is_even(i));
+                i = i + 1;
+            }
+            return acc;
+        }
+    )";
+    for (bool optimize : {false, true}) {
+        Run interpreted = run_source(source, optimize, 1000000);
+        Run jitted = run_source(source, optimize);
+        EXPECT_EQ(interpreted.compiled, 0);
+        EXPECT_EQ(jitted.compiled, 2) << "optimize=" << optimize;
+        EXPECT_EQ(jitted.result.as_int(), interpreted.result.as_int()) << "optimize=" << optimize;
+    }
+}
+
+TEST_F(JitTest, WrapsLikeTheInterpreter) {
+    const std::string source = R"(
+        fn grow(x: i32) -> i32 {
+            return x * 65537 + 2147483647;
+        }
+
+        fn main() -> i32 {
+            let mut i: i32 = 0;
+            let mut acc: i32 = 1;
+            while (i < 20) {
+                acc = grow(acc);
+                i = i + 1;
+            }
+            return acc;
+        }
+    )";
+    Run interpreted = run_source(source, true, 1000000);
+    Run jitted = run_source(source, true);
+    EXPECT_EQ(jitted.compiled, 1);
+    EXPECT_EQ(jitted.result.as_int(), interpreted.result.as_int());
+}
+
+TEST_F(JitTest, LeavesUnsupportedFunctionsToTheInterpreter) {
+    const std::string source = R"(
+        fn pick(s: str, n: i32) -> str {
+            return s;
+        }
+
+        fn main() -> str {
+            let mut i: i32 = 0;
+            let mut s: str = "a";
+            while (i < 10) {
+                s = pick("nust", i);
+                i = i + 1;
+            }
+            return s;
+        }
+    )";
+    Run run = run_source(source, true);
+    EXPECT_EQ(run.compiled, 0);
+    EXPECT_EQ(run.result.to_string(), "nust");
+}
+
+TEST_F(JitTest, OnlyCompilesScalarReturnTypes) {
+    // Same body, so only the declared return type tells them apart
+    FunctionTable function_table;
+    size_t number = function_table.add_function(FunctionInfo{0, 0, 0, Type::get(Type::Kind::I32), {}, "number"});
+    size_t text = function_table.add_function(FunctionInfo{2, 0, 0, Type::get(Type::Kind::Str), {}, "text"});
+    std::vector<Instruction> instructions = {
+        {Opcode::PUSH_I32, 1},
+        {Opcode::RET_VAL},
+        {Opcode::PUSH_I32, 1},
+        {Opcode::RET_VAL}
+    };
+    auto code = PackedCode::encode(instructions, function_table);
+
+    JitCompiler jit(function_table, code);
+    EXPECT_TRUE(jit.compile(number));
+    EXPECT_FALSE(jit.compile(text));
+    EXPECT_EQ(jit.compiled_count(), 1);
+}
+
+TEST_F(JitTest, RequiresVerifiedCode) {
+    const std::string source = R"(
+        fn twice(n: i32) -> i32 {
+            return n + n;
+        }
+
+        fn main() -> i32 {
+            return twice(twice(twice(1)));
+        }
+    )";
+    Run run = run_source(source, true, 0, false);
+    EXPECT_EQ(run.compiled, 0);
+    EXPECT_EQ(run.result.as_int(), 8);
+}
+
+TEST_F(JitTest, BailsOutToTheInterpreter) {
+    // Division by zero is reported by the interpreter redoing the call
+    const std::string divide = R"(
+        fn quotient(a: i32, b: i32) -> i32 {
+            return a / b;
+        }
+
+        fn main() -> i32 {
+            let mut i: i32 = 3;
+            let mut acc: i32 = 0;
+            while (i > -1) {
+                acc = acc + quotient(12, i);
+                i = i - 1;
+            }
+            return acc;
+        }
+    )";
+    EXPECT_THROW(run_source(divide, true), std::runtime_error);
+
+    // Recursion deeper than the native stack budget finishes interpreted
+    const std::string deep = R"(
+        fn sum(n: i32) -> i32 {
+            if (n == 0) {
+                return 0;
+            }
+            return n + sum(n - 1);
+        }
+
+        fn main() -> i32 {
+            return sum(20000);
+        }
+    )";
+    EXPECT_EQ(run_source(deep, true).result.as_int(), 200010000);
+}
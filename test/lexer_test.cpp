@@ -0,0 +1,122 @@
+#include "lexer.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace nust {
+
+static std::vector<TokenKind> kinds(const TokenBuffer& buffer) {
+    std::vector<TokenKind> result;
+    for (const auto& token : buffer.tokens) {
+        result.push_back(token.kind);
+    }
+    return result;
+}
+
+TEST(LexerTest, OperatorsTakeTheLongestMatch) {
+    std::string source = "<= < >= > == = != ! -> - && & || + * /";
+    auto buffer = Lexer(source).tokenize();
+    EXPECT_EQ(kinds(buffer), (std::vector<TokenKind>{
+        TokenKind::Le, TokenKind::Lt, TokenKind::Ge, TokenKind::Gt,
+        TokenKind::EqEq, TokenKind::Assign, TokenKind::BangEq, TokenKind::Bang,
+        TokenKind::Arrow, TokenKind::Minus, TokenKind::AndAnd, TokenKind::Amp,
+        TokenKind::OrOr, TokenKind::Plus, TokenKind::Star, TokenKind::Slash,
+        TokenKind::End
+    }));
+}
+
+TEST(LexerTest, KeywordsAreWholeWords) {
+    std::string source = "let letter fn fnord mut mutable return returned i32";
+    auto buffer = Lexer(source).tokenize();
+    EXPECT_EQ(kinds(buffer), (std::vector<TokenKind>{
+        TokenKind::Let, TokenKind::Identifier, TokenKind::Fn, TokenKind::Identifier,
+        TokenKind::Mut, TokenKind::Identifier, TokenKind::Return, TokenKind::Identifier,
+        TokenKind::Identifier, TokenKind::End
+    }));
+    EXPECT_EQ(buffer.names[buffer.tokens[1].payload], "letter");
+    EXPECT_EQ(buffer.names[buffer.tokens[8].payload], "i32");
+}
+
+TEST(LexerTest, InternsIdentifiers) {
+    std::string source = "x y x _tmp1 y";
+    auto buffer = Lexer(source).tokenize();
+    ASSERT_EQ(buffer.tokens.size(), 6);
+    EXPECT_EQ(buffer.names.size(), 3);
+    EXPECT_EQ(buffer.tokens[0].payload, buffer.tokens[2].payload);
+    EXPECT_EQ(buffer.tokens[1].payload, buffer.tokens[4].payload);
+    EXPECT_NE(buffer.tokens[0].payload, buffer.tokens[1].payload);
+    EXPECT_EQ(buffer.names[buffer.tokens[3].payload], "_tmp1");
+}
+
+TEST(LexerTest, LiteralsAndSpans) {
+    std::string source = "  // comment\n  2147483647 \"a \\\"b\\\"\" // trailing";
+    auto buffer = Lexer(source).tokenize();
+    ASSERT_EQ(buffer.tokens.size(), 3);
+
+    const Token& number = buffer.tokens[0];
+    EXPECT_EQ(number.kind, TokenKind::Integer);
+    EXPECT_EQ(static_cast<int>(number.payload), 2147483647);
+    EXPECT_EQ(source.substr(number.start, number.end - number.start), "2147483647");
+
+    // String contents keep their escapes as written
+    const Token& string = buffer.tokens[1];
+    EXPECT_EQ(string.kind, TokenKind::String);
+    EXPECT_EQ(buffer.strings[string.payload], "a \\\"b\\\"");
+    EXPECT_EQ(string.end, source.find(" // trailing"));
+
+    EXPECT_EQ(buffer.tokens[2].kind, TokenKind::End);
+    EXPECT_EQ(buffer.tokens[2].start, source.size());
+}
+
+TEST(LexerTest, ReportsErrorsWithLocation) {
+    try {
+        Lexer("fn main() {\n    let x: i32 = 1 @ 2;\n}").tokenize();
+        FAIL() << "expected an error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("line 2, column 20"), std::string::npos) << e.what();
+    }
+    EXPECT_THROW(Lexer("\"unterminated").tokenize(), std::runtime_error);
+    EXPECT_THROW(Lexer("2147483648").tokenize(), std::runtime_error);
+    EXPECT_THROW(Lexer("a | b").tokenize(), std::runtime_error);
+}
+
+// Runs longer than a vector, and ending at every offset within one, must
+// end exactly where the scalar definition says
+TEST(LexerTest, LongRunsEndInTheRightPlace) {
+    for (size_t n = 1; n < 80; n++) {
+        std::string name = "v" + std::string(n - 1, 'a' + n % 26);
+        // Contents with an escaped quote and n escaped backslashes
+        std::string text = std::string(n, 'x') + "\\\"";
+        for (size_t i = 0; i < n; i++) text += "\\\\";
+        std::string source = std::string(n, ' ') + name + std::string(n, '\t') + "// " +
+                             std::string(n, '-') + "\n" + std::string(n % 3, '\n') +
+                             "\"" + text + "\"" + std::string(n, ' ') + "(";
+        auto buffer = Lexer(source).tokenize();
+        ASSERT_EQ(buffer.tokens.size(), 4) << "n=" << n;
+        EXPECT_EQ(buffer.tokens[0].start, n);
+        EXPECT_EQ(buffer.names[buffer.tokens[0].payload], name);
+        EXPECT_EQ(buffer.tokens[1].kind, TokenKind::String);
+        EXPECT_EQ(buffer.strings[buffer.tokens[1].payload], text);
+        EXPECT_EQ(buffer.tokens[2].kind, TokenKind::LeftParen);
+        EXPECT_EQ(buffer.tokens[2].start, source.size() - 1);
+    }
+}
+
+TEST(LexerTest, LineTableMapsOffsets) {
+    std::string source = "fn\n\n  main\r\n" + std::string(100, ' ') + "x\n";
+    LineTable table(source);
+    EXPECT_EQ(table.line_count(), 5);
+
+    auto at = [&](size_t offset) {
+        SourceLocation location = table.locate(offset);
+        return std::make_pair(location.line, location.column);
+    };
+    EXPECT_EQ(at(0), std::make_pair(size_t{1}, size_t{1}));
+    EXPECT_EQ(at(2), std::make_pair(size_t{1}, size_t{3}));
+    EXPECT_EQ(at(3), std::make_pair(size_t{2}, size_t{1}));
+    EXPECT_EQ(at(6), std::make_pair(size_t{3}, size_t{3}));
+    EXPECT_EQ(at(source.find('x')), std::make_pair(size_t{4}, size_t{101}));
+    EXPECT_EQ(at(source.size()), std::make_pair(size_t{5}, size_t{1}));
+}
+
+} // namespace nust
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "packed_code.h"
+#include "parser.h"
+#include "type_checker.h"
+#include "compiler.h"
+#include "peephole.h"
+#include "superinstructions.h"
+#include "vm.h"
+#include <string>
+#include <vector>
+
+using namespace nust;
+
+class PackedCodeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        auto main_decl = std::make_unique<FunctionDecl>(
+            Span(0, 0),
+            "main",
+            std::vector<FunctionDecl::Param>{},
+            Type::get(Type::Kind::I32),
+            nullptr
+        );
+        function_table_.add_function(*main_decl, 0);
+    }
+
+    void expect_round_trip(const std::vector<Instruction>& instructions) {
+        auto decoded = PackedCode::encode(instructions, function_table_).decode();
+        ASSERT_EQ(decoded.size(), instructions.size());
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            EXPECT_EQ(decoded[i].opcode, instructions[i].opcode) << "at " << i;
+            EXPECT_EQ(decoded[i].operand, instructions[i].operand) << "at " << i;
+        }
+    }
+
+    FunctionTable function_table_;
+};
+
+TEST_F(PackedCodeTest, OperandlessInstructionsTakeOneByte) {
+    std::vector<Instruction> instructions = {
+        {Opcode::ADD_I32}, {Opcode::POP}, {Opcode::DUP}, {Opcode::RET}
+    };
+    auto code = PackedCode::encode(instructions, function_table_);
+    EXPECT_EQ(code.size(), 4);
+}
+
+TEST_F(PackedCodeTest, RoundTripsOperands) {
+    expect_round_trip({
+        {Opcode::PUSH_I32, 0},
+        {Opcode::PUSH_I32, 63},
+        {Opcode::PUSH_I32, 64},
+        {Opcode::PUSH_I32, 2147483647},
+        {Opcode::PUSH_I32, static_cast<size_t>(-1)},
+        {Opcode::PUSH_I32, static_cast<size_t>(-2147483647 - 1)},
+        {Opcode::PUSH_BOOL, 1},
+        {Opcode::LOAD, 300},
+        {Opcode::STORE, 127},
+        {Opcode::CALL, 0},
+        {Opcode::INC_LOCAL, pack_operands(3, static_cast<uint32_t>(-5))},
+        {Opcode::LOAD_LOAD_ADD, pack_operands(1, 2)},
+        {Opcode::JMP, 0},
+        {Opcode::CMP_LT_JMP_IF_NOT, 13},
+        {Opcode::RET}
+    });
+}
+
+TEST_F(PackedCodeTest, JumpsBecomeByteOffsets) {
+    std::vector<Instruction> instructions = {
+        {Opcode::PUSH_BOOL, 1},     // bytes 0-1
+        {Opcode::JMP_IF_NOT, 3},    // bytes 2-6
+        {Opcode::POP},              // byte 7
+        {Opcode::RET}               // byte 8
+    };
+    auto code = PackedCode::encode(instructions, function_table_);
+    size_t pc = 2;
+    Instruction jump = read_instruction(code.data(), pc);
+    EXPECT_EQ(jump.opcode, Opcode::JMP_IF_NOT);
+    EXPECT_EQ(jump.operand, 8);
+    EXPECT_EQ(pc, 7);
+}
+
+TEST_F(PackedCodeTest, EntryPointsBecomeByteOffsets) {
+    auto helper_decl = std::make_unique<FunctionDecl>(
+        Span(0, 0),
+        "helper",
+        std::vector<FunctionDecl::Param>{},
+        Type::get(Type::Kind::I32),
+        nullptr
+    );
+    function_table_.add_function(*helper_decl, 2);
+    auto code = PackedCode::encode({
+        {Opcode::CALL, 1},
+        {Opcode::RET_VAL},
+        {Opcode::PUSH_I32, 7},
+        {Opcode::RET_VAL}
+    }, function_table_);
+    ASSERT_EQ(code.entry_offsets().size(), 2);
+    EXPECT_EQ(code.entry_offsets()[0], 0);
+    EXPECT_EQ(code.entry_offsets()[1], 3);
+}
+
+TEST_F(PackedCodeTest, CompiledCodeIsSmaller) {
+    Parser parser(R"(
+        fn fib(n: i32) -> i32 {
+            if (n < 2) {
+                return n;
+            }
+            return fib(n - 1) + fib(n - 2);
+        }
+
+        fn main() -> i32 {
+            let mut i: i32 = 0;
+            let mut acc: i32 = 0;
+            while (i < 10) {
+                acc = acc + fib(i);
+                i = i + 1;
+            }
+            return acc;
+        }
+    )");
+    auto program = parser.parse();
+    TypeChecker type_checker;
+    ASSERT_TRUE(type_checker.check_program(*program));
+    Compiler compiler;
+    compiler.add_pass(std::make_unique<PeepholeOptimizer>());
+    compiler.add_pass(std::make_unique<SuperinstructionPass>());
+    auto instructions = compiler.compile(*program);
+
+    auto code = PackedCode::encode(instructions, compiler.get_function_table());
+    EXPECT_LT(code.size() * 3, instructions.size() * sizeof(Instruction));
+
+    std::vector<Value> constants;
+    VirtualMachine vm(compiler.get_function_table(), constants, instructions);
+    vm.run();
+    EXPECT_EQ(vm.get_result().as_int(), 88);
+}
+
+TEST_F(PackedCodeTest, LongestInstructionEndsInsideThePadding) {
+    // A Pair opcode as the last code byte, followed by padding that never
+    // terminates a LEB128, as a corrupted module could hold
+    std::vector<uint8_t> bytes(1 + packed_code_padding, 0xff);
+    bytes[0] = static_cast<uint8_t>(Opcode::LOAD_LOAD);
+    size_t pc = 0;
+    read_instruction(bytes.data(), pc);
+    EXPECT_EQ(pc, max_instruction_size);
+    EXPECT_LE(pc, bytes.size());
+}
@@ -192,7 +192,7 @@ TEST(ParserTest, ParseTreeStructure) {
     
     // Check program has one function
     ASSERT_EQ(program->items.size(), 1);
-    auto* func = dynamic_cast<FunctionDecl*>(program->items[0].get());
+    auto* func = node_cast<FunctionDecl>(program->items[0]);
     ASSERT_TRUE(func != nullptr);
     
     // Check function declaration
@@ -212,23 +212,23 @@ TEST(ParserTest, ParseTreeStructure) {
     ASSERT_EQ(func->return_type->kind, Type::Kind::I32);
     
     // Check function body
-    auto* body = dynamic_cast<BlockStmt*>(func->body.get());
+    auto* body = node_cast<BlockStmt>(func->body);
     ASSERT_TRUE(body != nullptr);
     ASSERT_EQ(body->statements.size(), 1);
     
     // Check the expression statement (x + y)
-    auto* expr_stmt = dynamic_cast<ExprStmt*>(body->statements[0].get());
+    auto* expr_stmt = node_cast<ExprStmt>(body->statements[0]);
     ASSERT_TRUE(expr_stmt != nullptr);
     
-    auto* binary = dynamic_cast<BinaryExpr*>(expr_stmt->expr.get());
+    auto* binary = node_cast<BinaryExpr>(expr_stmt->expr);
     ASSERT_TRUE(binary != nullptr);
     ASSERT_EQ(binary->op, BinaryExpr::Op::Add);
     
-    auto* left = dynamic_cast<Identifier*>(binary->left.get());
+    auto* left = node_cast<Identifier>(binary->left);
     ASSERT_TRUE(left != nullptr);
     ASSERT_EQ(left->name, "x");
     
-    auto* right = dynamic_cast<Identifier*>(binary->right.get());
+    auto* right = node_cast<Identifier>(binary->right);
     ASSERT_TRUE(right != nullptr);
     ASSERT_EQ(right->name, "y");
 }
@@ -250,7 +250,7 @@ TEST(ParserTest, ComplexParseTree) {
     
     // Check program has one function
     ASSERT_EQ(program->items.size(), 1);
-    auto* func = dynamic_cast<FunctionDecl*>(program->items[0].get());
+    auto* func = node_cast<FunctionDecl>(program->items[0]);
     ASSERT_TRUE(func != nullptr);
     
     // Check function declaration
@@ -258,51 +258,51 @@ TEST(ParserTest, ComplexParseTree) {
     ASSERT_EQ(func->params.size(), 0);
     
     // Check function body
-    auto* body = dynamic_cast<BlockStmt*>(func->body.get());
+    auto* body = node_cast<BlockStmt>(func->body);
     ASSERT_TRUE(body != nullptr);
     ASSERT_EQ(body->statements.size(), 3);  // let x, let y, if statement
     
     // Check first let statement (let mut x: i32 = 42)
-    auto* let_x = dynamic_cast<LetStmt*>(body->statements[0].get());
+    auto* let_x = node_cast<LetStmt>(body->statements[0]);
     ASSERT_TRUE(let_x != nullptr);
     ASSERT_EQ(let_x->name, "x");
     ASSERT_TRUE(let_x->is_mut);
     ASSERT_EQ(let_x->type->kind, Type::Kind::I32);
     
-    auto* x_init = dynamic_cast<IntLiteral*>(let_x->init.get());
+    auto* x_init = node_cast<IntLiteral>(let_x->init);
     ASSERT_TRUE(x_init != nullptr);
     ASSERT_EQ(x_init->value, 42);
     
     // Check second let statement (let y: &mut i32 = &mut x)
-    auto* let_y = dynamic_cast<LetStmt*>(body->statements[1].get());
+    auto* let_y = node_cast<LetStmt>(body->statements[1]);
     ASSERT_TRUE(let_y != nullptr);
     ASSERT_EQ(let_y->name, "y");
     ASSERT_FALSE(let_y->is_mut);
     ASSERT_EQ(let_y->type->kind, Type::Kind::MutRef);
     ASSERT_EQ(let_y->type->base_type->kind, Type::Kind::I32);
     
-    auto* y_init = dynamic_cast<BorrowExpr*>(let_y->init.get());
+    auto* y_init = node_cast<BorrowExpr>(let_y->init);
     ASSERT_TRUE(y_init != nullptr);
     ASSERT_TRUE(y_init->is_mut);
     
-    auto* borrowed_x = dynamic_cast<Identifier*>(y_init->expr.get());
+    auto* borrowed_x = node_cast<Identifier>(y_init->expr);
     ASSERT_TRUE(borrowed_x != nullptr);
     ASSERT_EQ(borrowed_x->name, "x");
     
     // Check if statement
-    auto* if_stmt = dynamic_cast<IfStmt*>(body->statements[2].get());
+    auto* if_stmt = node_cast<IfStmt>(body->statements[2]);
     ASSERT_TRUE(if_stmt != nullptr);
     
     // Check if condition (x > 0)
-    auto* condition = dynamic_cast<BinaryExpr*>(if_stmt->condition.get());
+    auto* condition = node_cast<BinaryExpr>(if_stmt->condition);
     ASSERT_TRUE(condition != nullptr);
     ASSERT_EQ(condition->op, BinaryExpr::Op::Gt);
     
-    auto* cond_left = dynamic_cast<Identifier*>(condition->left.get());
+    auto* cond_left = node_cast<Identifier>(condition->left);
     ASSERT_TRUE(cond_left != nullptr);
     ASSERT_EQ(cond_left->name, "x");
     
-    auto* cond_right = dynamic_cast<IntLiteral*>(condition->right.get());
+    auto* cond_right = node_cast<IntLiteral>(condition->right);
     ASSERT_TRUE(cond_right != nullptr);
     ASSERT_EQ(cond_right->value, 0);
 }
@@ -320,74 +320,74 @@ TEST(ParserTest, ExpressionPrecedence) {
     auto program = parser.parse();
     ASSERT_TRUE(program != nullptr);
     
-    auto* func = dynamic_cast<FunctionDecl*>(program->items[0].get());
+    auto* func = node_cast<FunctionDecl>(program->items[0]);
     ASSERT_TRUE(func != nullptr);
     
-    auto* body = dynamic_cast<BlockStmt*>(func->body.get());
+    auto* body = node_cast<BlockStmt>(func->body);
     ASSERT_TRUE(body != nullptr);
     ASSERT_EQ(body->statements.size(), 3);
     
     // Check first expression: 1 + 2 * 3
-    auto* let_x = dynamic_cast<LetStmt*>(body->statements[0].get());
+    auto* let_x = node_cast<LetStmt>(body->statements[0]);
     ASSERT_TRUE(let_x != nullptr);
     
-    auto* expr1 = dynamic_cast<BinaryExpr*>(let_x->init.get());
+    auto* expr1 = node_cast<BinaryExpr>(let_x->init);
     ASSERT_TRUE(expr1 != nullptr);
     ASSERT_EQ(expr1->op, BinaryExpr::Op::Add);
     
-    auto* left1 = dynamic_cast<IntLiteral*>(expr1->left.get());
+    auto* left1 = node_cast<IntLiteral>(expr1->left);
     ASSERT_TRUE(left1 != nullptr);
     ASSERT_EQ(left1->value, 1);
     
-    auto* right1 = dynamic_cast<BinaryExpr*>(expr1->right.get());
+    auto* right1 = node_cast<BinaryExpr>(expr1->right);
     ASSERT_TRUE(right1 != nullptr);
     ASSERT_EQ(right1->op, BinaryExpr::Op::Mul);
     
     // Check second expression: !true && false || true
-    auto* let_y = dynamic_cast<LetStmt*>(body->statements[1].get());
+    auto* let_y = node_cast<LetStmt>(body->statements[1]);
     ASSERT_TRUE(let_y != nullptr);
     
-    auto* expr2 = dynamic_cast<BinaryExpr*>(let_y->init.get());
+    auto* expr2 = node_cast<BinaryExpr>(let_y->init);
     ASSERT_TRUE(expr2 != nullptr);
     ASSERT_EQ(expr2->op, BinaryExpr::Op::Or);
     
     // Check left side of OR: !true && false
-    auto* left2 = dynamic_cast<BinaryExpr*>(expr2->left.get());
+    auto* left2 = node_cast<BinaryExpr>(expr2->left);
     ASSERT_TRUE(left2 != nullptr);
     ASSERT_EQ(left2->op, BinaryExpr::Op::And);
     
     // Check !true
-    auto* not_expr = dynamic_cast<UnaryExpr*>(left2->left.get());
+    auto* not_expr = node_cast<UnaryExpr>(left2->left);
     ASSERT_TRUE(not_expr != nullptr);
     ASSERT_EQ(not_expr->op, UnaryExpr::Op::Not);
     
-    auto* true_lit = dynamic_cast<BoolLiteral*>(not_expr->expr.get());
+    auto* true_lit = node_cast<BoolLiteral>(not_expr->expr);
     ASSERT_TRUE(true_lit != nullptr);
     ASSERT_TRUE(true_lit->value);
     
     // Check false
-    auto* false_lit = dynamic_cast<BoolLiteral*>(left2->right.get());
+    auto* false_lit = node_cast<BoolLiteral>(left2->right);
     ASSERT_TRUE(false_lit != nullptr);
     ASSERT_FALSE(false_lit->value);
     
     // Check right side of OR: true
-    auto* right2 = dynamic_cast<BoolLiteral*>(expr2->right.get());
+    auto* right2 = node_cast<BoolLiteral>(expr2->right);
     ASSERT_TRUE(right2 != nullptr);
     ASSERT_TRUE(right2->value);
     
     // Check third expression: (1 + 2) * (3 + 4)
-    auto* let_z = dynamic_cast<LetStmt*>(body->statements[2].get());
+    auto* let_z = node_cast<LetStmt>(body->statements[2]);
     ASSERT_TRUE(let_z != nullptr);
     
-    auto* expr3 = dynamic_cast<BinaryExpr*>(let_z->init.get());
+    auto* expr3 = node_cast<BinaryExpr>(let_z->init);
     ASSERT_TRUE(expr3 != nullptr);
     ASSERT_EQ(expr3->op, BinaryExpr::Op::Mul);
     
-    auto* left3 = dynamic_cast<BinaryExpr*>(expr3->left.get());
+    auto* left3 = node_cast<BinaryExpr>(expr3->left);
     ASSERT_TRUE(left3 != nullptr);
     ASSERT_EQ(left3->op, BinaryExpr::Op::Add);
     
-    auto* right3 = dynamic_cast<BinaryExpr*>(expr3->right.get());
+    auto* right3 = node_cast<BinaryExpr>(expr3->right);
     ASSERT_TRUE(right3 != nullptr);
     ASSERT_EQ(right3->op, BinaryExpr::Op::Add);
 }
@@ -409,28 +409,28 @@ TEST(ParserTest, AssignmentExpressions) {
     ASSERT_TRUE(program != nullptr);
     
     // Check the parse tree structure
-    auto* func = dynamic_cast<FunctionDecl*>(program->items[0].get());
+    auto* func = node_cast<FunctionDecl>(program->items[0]);
     ASSERT_TRUE(func != nullptr);
     
-    auto* body = dynamic_cast<BlockStmt*>(func->body.get());
+    auto* body = node_cast<BlockStmt>(func->body);
     ASSERT_TRUE(body != nullptr);
     ASSERT_EQ(body->statements.size(), 5);
     
     // Check the third statement ((x) = 20)
-    auto* expr_stmt = dynamic_cast<ExprStmt*>(body->statements[2].get());
+    auto* expr_stmt = node_cast<ExprStmt>(body->statements[2]);
     ASSERT_TRUE(expr_stmt != nullptr);
     
-    auto* assign = dynamic_cast<BinaryExpr*>(expr_stmt->expr.get());
+    auto* assign = node_cast<BinaryExpr>(expr_stmt->expr);
     ASSERT_TRUE(assign != nullptr);
     ASSERT_EQ(assign->op, BinaryExpr::Op::Assignment);
     
     // Check left side (x)
-    auto* x_ident = dynamic_cast<Identifier*>(assign->left.get());
+    auto* x_ident = node_cast<Identifier>(assign->left);
     ASSERT_TRUE(x_ident != nullptr);
     ASSERT_EQ(x_ident->name, "x");
     
     // Check right side (20)
-    auto* twenty_lit = dynamic_cast<IntLiteral*>(assign->right.get());
+    auto* twenty_lit = node_cast<IntLiteral>(assign->right);
     ASSERT_TRUE(twenty_lit != nullptr);
     ASSERT_EQ(twenty_lit->value, 20);
     
@@ -460,38 +460,38 @@ TEST(ParserTest, AssignmentPrecedence) {
     ASSERT_TRUE(program != nullptr);
     
     // Check the parse tree structure
-    auto* func = dynamic_cast<FunctionDecl*>(program->items[0].get());
+    auto* func = node_cast<FunctionDecl>(program->items[0]);
     ASSERT_TRUE(func != nullptr);
     
-    auto* body = dynamic_cast<BlockStmt*>(func->body.get());
+    auto* body = node_cast<BlockStmt>(func->body);
     ASSERT_TRUE(body != nullptr);
     ASSERT_EQ(body->statements.size(), 3);
     
     // Check the last statement (x = y = 5)
-    auto* expr_stmt = dynamic_cast<ExprStmt*>(body->statements[2].get());
+    auto* expr_stmt = node_cast<ExprStmt>(body->statements[2]);
     ASSERT_TRUE(expr_stmt != nullptr);
     
-    auto* outer_assign = dynamic_cast<BinaryExpr*>(expr_stmt->expr.get());
+    auto* outer_assign = node_cast<BinaryExpr>(expr_stmt->expr);
     ASSERT_TRUE(outer_assign != nullptr);
     ASSERT_EQ(outer_assign->op, BinaryExpr::Op::Assignment);
     
     // Check left side (x)
-    auto* x_ident = dynamic_cast<Identifier*>(outer_assign->left.get());
+    auto* x_ident = node_cast<Identifier>(outer_assign->left);
     ASSERT_TRUE(x_ident != nullptr);
     ASSERT_EQ(x_ident->name, "x");
     
     // Check right side (y = 5)
-    auto* inner_assign = dynamic_cast<BinaryExpr*>(outer_assign->right.get());
+    auto* inner_assign = node_cast<BinaryExpr>(outer_assign->right);
     ASSERT_TRUE(inner_assign != nullptr);
     ASSERT_EQ(inner_assign->op, BinaryExpr::Op::Assignment);
     
     // Check left side of inner assignment (y)
-    auto* y_ident = dynamic_cast<Identifier*>(inner_assign->left.get());
+    auto* y_ident = node_cast<Identifier>(inner_assign->left);
     ASSERT_TRUE(y_ident != nullptr);
     ASSERT_EQ(y_ident->name, "y");
     
     // Check right side of inner assignment (5)
-    auto* five_lit = dynamic_cast<IntLiteral*>(inner_assign->right.get());
+    auto* five_lit = node_cast<IntLiteral>(inner_assign->right);
     ASSERT_TRUE(five_lit != nullptr);
     ASSERT_EQ(five_lit->value, 5);
 }
@@ -510,38 +510,38 @@ TEST(ParserTest, AssignmentWithLogicalOperators) {
     ASSERT_TRUE(program != nullptr);
     
     // Check the parse tree structure
-    auto* func = dynamic_cast<FunctionDecl*>(program->items[0].get());
+    auto* func = node_cast<FunctionDecl>(program->items[0]);
     ASSERT_TRUE(func != nullptr);
     
-    auto* body = dynamic_cast<BlockStmt*>(func->body.get());
+    auto* body = node_cast<BlockStmt>(func->body);
     ASSERT_TRUE(body != nullptr);
     ASSERT_EQ(body->statements.size(), 3);
     
     // Check the last statement (x = y || true)
-    auto* expr_stmt = dynamic_cast<ExprStmt*>(body->statements[2].get());
+    auto* expr_stmt = node_cast<ExprStmt>(body->statements[2]);
     ASSERT_TRUE(expr_stmt != nullptr);
     
-    auto* assign = dynamic_cast<BinaryExpr*>(expr_stmt->expr.get());
+    auto* assign = node_cast<BinaryExpr>(expr_stmt->expr);
     ASSERT_TRUE(assign != nullptr);
     ASSERT_EQ(assign->op, BinaryExpr::Op::Assignment);
     
     // Check left side (x)
-    auto* x_ident = dynamic_cast<Identifier*>(assign->left.get());
+    auto* x_ident = node_cast<Identifier>(assign->left);
     ASSERT_TRUE(x_ident != nullptr);
     ASSERT_EQ(x_ident->name, "x");
     
     // Check right side (y || true)
-    auto* or_expr = dynamic_cast<BinaryExpr*>(assign->right.get());
+    auto* or_expr = node_cast<BinaryExpr>(assign->right);
     ASSERT_TRUE(or_expr != nullptr);
     ASSERT_EQ(or_expr->op, BinaryExpr::Op::Or);
     
     // Check left side of OR (y)
-    auto* y_ident = dynamic_cast<Identifier*>(or_expr->left.get());
+    auto* y_ident = node_cast<Identifier>(or_expr->left);
     ASSERT_TRUE(y_ident != nullptr);
     ASSERT_EQ(y_ident->name, "y");
     
     // Check right side of OR (true)
-    auto* true_lit = dynamic_cast<BoolLiteral*>(or_expr->right.get());
+    auto* true_lit = node_cast<BoolLiteral>(or_expr->right);
     ASSERT_TRUE(true_lit != nullptr);
     ASSERT_TRUE(true_lit->value);
 }
@@ -582,73 +582,73 @@ TEST(ParserTest, ReturnStatements) {
     ASSERT_EQ(program->items.size(), 4);
     
     // Test empty function with void return
-    auto* empty = dynamic_cast<FunctionDecl*>(program->items[0].get());
+    auto* empty = node_cast<FunctionDecl>(program->items[0]);
     ASSERT_TRUE(empty != nullptr);
     ASSERT_EQ(empty->name, "empty");
     
-    auto* empty_body = dynamic_cast<BlockStmt*>(empty->body.get());
+    auto* empty_body = node_cast<BlockStmt>(empty->body);
     ASSERT_TRUE(empty_body != nullptr);
     ASSERT_EQ(empty_body->statements.size(), 1);
     
-    auto* empty_return = dynamic_cast<ReturnStmt*>(empty_body->statements[0].get());
+    auto* empty_return = node_cast<ReturnStmt>(empty_body->statements[0]);
     ASSERT_TRUE(empty_return != nullptr);
     ASSERT_TRUE(empty_return->value == nullptr);
     
     // Test function with constant return
-    auto* answer = dynamic_cast<FunctionDecl*>(program->items[1].get());
+    auto* answer = node_cast<FunctionDecl>(program->items[1]);
     ASSERT_TRUE(answer != nullptr);
     ASSERT_EQ(answer->name, "answer");
     ASSERT_EQ(answer->return_type->kind, Type::Kind::I32);
     
-    auto* answer_body = dynamic_cast<BlockStmt*>(answer->body.get());
+    auto* answer_body = node_cast<BlockStmt>(answer->body);
     ASSERT_TRUE(answer_body != nullptr);
     ASSERT_EQ(answer_body->statements.size(), 1);
     
-    auto* answer_return = dynamic_cast<ReturnStmt*>(answer_body->statements[0].get());
+    auto* answer_return = node_cast<ReturnStmt>(answer_body->statements[0]);
     ASSERT_TRUE(answer_return != nullptr);
     ASSERT_TRUE(answer_return->value != nullptr);
     
-    auto* return_val = dynamic_cast<IntLiteral*>(answer_return->value.get());
+    auto* return_val = node_cast<IntLiteral>(answer_return->value);
     ASSERT_TRUE(return_val != nullptr);
     ASSERT_EQ(return_val->value, 42);
     
     // Test conditional return
-    auto* conditional = dynamic_cast<FunctionDecl*>(program->items[2].get());
+    auto* conditional = node_cast<FunctionDecl>(program->items[2]);
     ASSERT_TRUE(conditional != nullptr);
     ASSERT_EQ(conditional->name, "conditional");
     
-    auto* cond_body = dynamic_cast<BlockStmt*>(conditional->body.get());
+    auto* cond_body = node_cast<BlockStmt>(conditional->body);
     ASSERT_TRUE(cond_body != nullptr);
     ASSERT_EQ(cond_body->statements.size(), 2);  // if statement and return 0
     
-    auto* if_stmt = dynamic_cast<IfStmt*>(cond_body->statements[0].get());
+    auto* if_stmt = node_cast<IfStmt>(cond_body->statements[0]);
     ASSERT_TRUE(if_stmt != nullptr);
     
-    auto* if_body = dynamic_cast<BlockStmt*>(if_stmt->then_branch.get());
+    auto* if_body = node_cast<BlockStmt>(if_stmt->then_branch);
     ASSERT_TRUE(if_body != nullptr);
     ASSERT_EQ(if_body->statements.size(), 1);
     
-    auto* if_return = dynamic_cast<ReturnStmt*>(if_body->statements[0].get());
+    auto* if_return = node_cast<ReturnStmt>(if_body->statements[0]);
     ASSERT_TRUE(if_return != nullptr);
     
-    auto* x_return = dynamic_cast<Identifier*>(if_return->value.get());
+    auto* x_return = node_cast<Identifier>(if_return->value);
     ASSERT_TRUE(x_return != nullptr);
     ASSERT_EQ(x_return->name, "x");
     
     // Test early return function
-    auto* early = dynamic_cast<FunctionDecl*>(program->items[3].get());
+    auto* early = node_cast<FunctionDecl>(program->items[3]);
     ASSERT_TRUE(early != nullptr);
     ASSERT_EQ(early->name, "early_return");
     
-    auto* early_body = dynamic_cast<BlockStmt*>(early->body.get());
+    auto* early_body = node_cast<BlockStmt>(early->body);
     ASSERT_TRUE(early_body != nullptr);
     ASSERT_EQ(early_body->statements.size(), 3);  // two if statements and final return
     
     // Check final return statement
-    auto* final_return = dynamic_cast<ReturnStmt*>(early_body->statements[2].get());
+    auto* final_return = node_cast<ReturnStmt>(early_body->statements[2]);
     ASSERT_TRUE(final_return != nullptr);
     
-    auto* sum = dynamic_cast<BinaryExpr*>(final_return->value.get());
+    auto* sum = node_cast<BinaryExpr>(final_return->value);
     ASSERT_TRUE(sum != nullptr);
     ASSERT_EQ(sum->op, BinaryExpr::Op::Add);
 }
@@ -679,4 +679,70 @@ TEST(ParserTest, InvalidReturnStatements) {
     EXPECT_THROW(parser3.parse(), std::runtime_error);
 }
 
-} // namespace nust 
\ No newline at end of file
+// Two-character comparisons and identifiers that start with a keyword
+TEST(ParserTest, TokenBoundaries) {
+    std::string source = R"(
+        fn main() -> bool {
+            let letter: i32 = 1;
+            let returned: i32 = 2;
+            return letter <= returned && returned >= letter;
+        }
+    )";
+    
+    Parser parser(source);
+    auto program = parser.parse();
+    auto* func = node_cast<FunctionDecl>(program->items[0]);
+    ASSERT_TRUE(func != nullptr);
+    auto* body = node_cast<BlockStmt>(func->body);
+    ASSERT_EQ(body->statements.size(), 3);
+    
+    auto* let = node_cast<LetStmt>(body->statements[0]);
+    ASSERT_TRUE(let != nullptr);
+    EXPECT_EQ(let->name, "letter");
+    
+    auto* ret = node_cast<ReturnStmt>(body->statements[2]);
+    ASSERT_TRUE(ret != nullptr);
+    auto* both = node_cast<BinaryExpr>(ret->value);
+    ASSERT_TRUE(both != nullptr);
+    ASSERT_EQ(both->op, BinaryExpr::Op::And);
+    EXPECT_EQ(node_cast<BinaryExpr>(both->left)->op, BinaryExpr::Op::Le);
+    EXPECT_EQ(node_cast<BinaryExpr>(both->right)->op, BinaryExpr::Op::Ge);
+}
+
+TEST(ParserTest, NodeKinds) {
+    std::string source = R"(
+        fn main() -> i32 {
+            let s: str = "hi";
+            while (true) {
+                f(&s, -1);
+            }
+            return 0;
+        }
+    )";
+    
+    Parser parser(source);
+    auto program = parser.parse();
+    EXPECT_EQ(program->kind, NodeKind::Program);
+    auto* func = node_cast<FunctionDecl>(program->items[0]);
+    ASSERT_TRUE(func != nullptr);
+    auto* body = node_cast<BlockStmt>(func->body);
+    ASSERT_TRUE(body != nullptr);
+    EXPECT_EQ(node_cast<WhileStmt>(body->statements[0]), nullptr);
+    
+    EXPECT_EQ(body->statements[0]->kind, NodeKind::LetStmt);
+    EXPECT_EQ(node_cast<LetStmt>(body->statements[0])->init->kind, NodeKind::StringLiteral);
+    auto* loop = node_cast<WhileStmt>(body->statements[1]);
+    ASSERT_TRUE(loop != nullptr);
+    EXPECT_EQ(loop->condition->kind, NodeKind::BoolLiteral);
+    
+    auto* inner = node_cast<BlockStmt>(loop->body);
+    ASSERT_TRUE(inner != nullptr);
+    auto* call = node_cast<CallExpr>(node_cast<ExprStmt>(inner->statements[0])->expr);
+    ASSERT_TRUE(call != nullptr);
+    EXPECT_EQ(call->callee->kind, NodeKind::Identifier);
+    EXPECT_EQ(call->args[0]->kind, NodeKind::BorrowExpr);
+    EXPECT_EQ(call->args[1]->kind, NodeKind::UnaryExpr);
+    EXPECT_EQ(body->statements[2]->kind, NodeKind::ReturnStmt);
+}
+
+} // namespace nust
@@ -0,0 +1,237 @@
+#include <gtest/gtest.h>
+#include "peephole.h"
+#include "parser.h"
+#include "type_checker.h"
+#include "compiler.h"
+#include "vm.h"
+#include <string>
+#include <vector>
+
+using namespace nust;
+
+class PeepholeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        auto main_decl = std::make_unique<FunctionDecl>(
+            Span(0, 0),
+            "main",
+            std::vector<FunctionDecl::Param>{},
+            Type::get(Type::Kind::I32),
+            nullptr
+        );
+        function_table_.add_function(*main_decl, 0);
+    }
+
+    std::vector<Instruction> optimize(std::vector<Instruction> instructions) {
+        optimizer_.run(instructions, function_table_);
+        return instructions;
+    }
+
+    size_t hits(const std::string& rule) const {
+        for (const auto& [name, count] : optimizer_.stats().rule_hits) {
+            if (name == rule) {
+                return count;
+            }
+        }
+        return 0;
+    }
+
+    // Run a program with and without the pass; returns {plain, optimized}
+    std::pair<Value, Value> run_both(const std::string& source) {
+        Parser parser(source);
+        auto program = parser.parse();
+        TypeChecker type_checker;
+        EXPECT_TRUE(type_checker.check_program(*program));
+
+        Compiler plain;
+        auto plain_code = plain.compile(*program);
+        VirtualMachine plain_vm(plain.get_function_table(), constants_, plain_code);
+        plain_vm.run();
+
+        Compiler optimizing;
+        optimizing.add_pass(std::make_unique<PeepholeOptimizer>());
+        auto optimized_code = optimizing.compile(*program);
+        EXPECT_LT(optimized_code.size(), plain_code.size());
+        VirtualMachine optimized_vm(optimizing.get_function_table(), constants_, optimized_code);
+        optimized_vm.run();
+        EXPECT_LT(optimized_vm.instructions_executed(), plain_vm.instructions_executed());
+
+        return {plain_vm.get_result(), optimized_vm.get_result()};
+    }
+
+    PeepholeOptimizer optimizer_;
+    FunctionTable function_table_;
+    std::vector<Value> constants_;
+};
+
+TEST_F(PeepholeTest, StoreLoadPop) {
+    auto code = optimize({
+        {Opcode::PUSH_I32, 1},
+        {Opcode::STORE, 0},
+        {Opcode::LOAD, 0},
+        {Opcode::POP},
+        {Opcode::LOAD, 0},
+        {Opcode::RET_VAL}
+    });
+    ASSERT_EQ(code.size(), 4);
+    EXPECT_EQ(code[1].opcode, Opcode::STORE);
+    EXPECT_EQ(code[2].opcode, Opcode::LOAD);
+    EXPECT_EQ(hits("store_load_pop"), 1);
+}
+
+TEST_F(PeepholeTest, StoreLoadPopNeedsSameSlot) {
+    auto code = optimize({
+        {Opcode::PUSH_I32, 1},
+        {Opcode::STORE, 0},
+        {Opcode::LOAD, 1},
+        {Opcode::POP},
+        {Opcode::RET}
+    });
+    // LOAD 1; POP is still dead, but the store must stay
+    ASSERT_EQ(code.size(), 3);
+    EXPECT_EQ(code[1].opcode, Opcode::STORE);
+    EXPECT_EQ(hits("store_load_pop"), 0);
+    EXPECT_EQ(hits("push_pop"), 1);
+}
+
+TEST_F(PeepholeTest, NegatedBranch) {
+    auto code = optimize({
+        {Opcode::PUSH_BOOL, 1},
+        {Opcode::NOT},
+        {Opcode::JMP_IF_NOT, 5},
+        {Opcode::PUSH_I32, 1},
+        {Opcode::RET_VAL},
+        {Opcode::PUSH_I32, 2},
+        {Opcode::RET_VAL}
+    });
+    ASSERT_EQ(code.size(), 6);
+    EXPECT_EQ(code[1].opcode, Opcode::JMP_IF);
+    EXPECT_EQ(code[1].operand, 4);
+}
+
+TEST_F(PeepholeTest, JumpThreading) {
+    auto code = optimize({
+        {Opcode::PUSH_BOOL, 1},
+        {Opcode::JMP_IF, 4},
+        {Opcode::PUSH_I32, 1},
+        {Opcode::RET_VAL},
+        {Opcode::JMP, 5},
+        {Opcode::PUSH_I32, 2},
+        {Opcode::RET_VAL}
+    });
+    // The intermediate JMP becomes unreachable once the branch skips it
+    ASSERT_EQ(code.size(), 6);
+    EXPECT_EQ(code[1].opcode, Opcode::JMP_IF);
+    EXPECT_EQ(code[1].operand, 4);
+    EXPECT_EQ(code[4].opcode, Opcode::PUSH_I32);
+    EXPECT_EQ(code[4].operand, 2);
+    EXPECT_GE(hits("jump_threading"), 1);
+}
+
+TEST_F(PeepholeTest, JumpCycleTerminates) {
+    auto code = optimize({
+        {Opcode::JMP, 1},
+        {Opcode::JMP, 2},
+        {Opcode::JMP, 1}
+    });
+    EXPECT_FALSE(code.empty());
+}
+
+TEST_F(PeepholeTest, DeadCodeAfterReturn) {
+    auto code = optimize({
+        {Opcode::PUSH_I32, 1},
+        {Opcode::RET_VAL},
+        {Opcode::PUSH_I32, 2},
+        {Opcode::PUSH_I32, 3},
+        {Opcode::ADD_I32},
+        {Opcode::RET}
+    });
+    ASSERT_EQ(code.size(), 2);
+    EXPECT_EQ(hits("dead_code"), 4);
+}
+
+TEST_F(PeepholeTest, EntryPointsArePatched) {
+    auto helper_decl = std::make_unique<FunctionDecl>(
+        Span(0, 0),
+        "helper",
+        std::vector<FunctionDecl::Param>{},
+        Type::get(Type::Kind::I32),
+        nullptr
+    );
+    function_table_.add_function(*helper_decl, 5);
+
+    auto code = optimize({
+        {Opcode::CALL, 1},
+        {Opcode::RET_VAL},
+        {Opcode::PUSH_I32, 9},   // dead
+        {Opcode::PUSH_I32, 9},   // dead
+        {Opcode::RET},           // dead
+        {Opcode::PUSH_I32, 7},   // helper
+        {Opcode::RET_VAL}
+    });
+    ASSERT_EQ(code.size(), 4);
+    EXPECT_EQ(function_table_.get_function(1).entry_point, 2);
+
+    VirtualMachine vm(function_table_, constants_, code);
+    vm.run();
+    EXPECT_EQ(vm.get_result().as_int(), 7);
+}
+
+TEST_F(PeepholeTest, RulesDoNotCrossJumpTargets) {
+    std::vector<Instruction> original = {
+        {Opcode::PUSH_I32, 1},
+        {Opcode::PUSH_BOOL, 1},
+        {Opcode::JMP_IF, 4},
+        {Opcode::PUSH_I32, 2},
+        {Opcode::POP},           // jump target: pops either 1 or 2
+        {Opcode::RET}
+    };
+    auto code = optimize(original);
+    EXPECT_EQ(code.size(), original.size());
+    EXPECT_EQ(hits("push_pop"), 0);
+}
+
+TEST_F(PeepholeTest, CustomRule) {
+    optimizer_.clear_rules();
+    optimizer_.add_rule({"swap_swap", [](const Instruction* w, size_t size, size_t& consumed,
+                                         std::vector<Instruction>&) {
+        if (size >= 2 && w[0].opcode == Opcode::SWAP && w[1].opcode == Opcode::SWAP) {
+            consumed = 2;
+            return true;
+        }
+        return false;
+    }});
+    auto code = optimize({
+        {Opcode::PUSH_I32, 1},
+        {Opcode::PUSH_I32, 2},
+        {Opcode::SWAP},
+        {Opcode::SWAP},
+        {Opcode::RET_VAL}
+    });
+    ASSERT_EQ(code.size(), 3);
+    EXPECT_EQ(hits("swap_swap"), 1);
+}
+
+TEST_F(PeepholeTest, ProgramsComputeSameResult) {
+    auto [plain, optimized] = run_both(R"(
+        fn sum(n: i32) -> i32 {
+            let mut i: i32 = 0;
+            let mut acc: i32 = 0;
+            while (i < n) {
+                if (i == 3) {
+                    acc = acc + 100;
+                } else {
+                    acc = acc + i;
+                }
+                i = i + 1;
+            }
+            return acc;
+        }
+
+        fn main() -> i32 {
+            return sum(10) + sum(4);
+        }
+    )");
+    EXPECT_EQ(plain.as_int(), 245);
+    EXPECT_EQ(optimized.as_int(), plain.as_int());
+}
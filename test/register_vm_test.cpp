@@ -0,0 +1,290 @@
+#include <gtest/gtest.h>
+#include "parser.h"
+#include "type_checker.h"
+#include "compiler.h"
+#include "register_compiler.h"
+#include "register_vm.h"
+#include "vm.h"
+#include <string>
+
+using namespace nust;
+
+class RegisterVMTest : public ::testing::Test {
+protected:
+    Value run_program(const std::string& source, CallStackConfig config = CallStackConfig()) {
+        Parser parser(source);
+        program_ = parser.parse();
+
+        TypeChecker type_checker;
+        EXPECT_TRUE(type_checker.check_program(*program_));
+
+        instructions_ = compiler_.compile(*program_);
+        constants_.clear();
+        for (const auto& str : compiler_.string_constants) {
+            constants_.push_back(Value(strings_.allocate(str)));
+        }
+
+        RegisterVM vm(compiler_.get_function_table(), constants_, instructions_, config);
+        vm.run();
+        executed_ = vm.instructions_executed();
+        return vm.get_result();
+    }
+
+    struct StackRun {
+        Value result;
+        uint64_t executed;
+    };
+
+    StackRun run_stack_program(const std::string& source) {
+        Parser parser(source);
+        auto program = parser.parse();
+        Compiler compiler;
+        auto instructions = compiler.compile(*program);
+        std::vector<Value> constants;
+        VirtualMachine vm(compiler.get_function_table(), constants, instructions);
+        vm.run();
+        return {vm.get_result(), vm.instructions_executed()};
+    }
+
+    std::unique_ptr<Program> program_;
+    RegisterCompiler compiler_;
+    std::vector<RegInstruction> instructions_;
+    StringHeap strings_;
+    std::vector<Value> constants_;
+    uint64_t executed_ = 0;
+};
+
+TEST_F(RegisterVMTest, Arithmetic) {
+    Value result = run_program(R"(
+        fn main() -> i32 {
+            let x: i32 = 42;
+            let y: i32 = 2;
+            return (x + y) * 3 - x / y;
+        }
+    )");
+    EXPECT_EQ(result.as_int(), 111);
+}
+
+TEST_F(RegisterVMTest, AssignmentWritesVariableRegister) {
+    run_program(R"(
+        fn main() -> i32 {
+            let mut x: i32 = 1;
+            let y: i32 = 2;
+            x = x + y;
+            return x;
+        }
+    )");
+
+    // Registers: constant 1 = 0, x = 1, constant 2 = 2, y = 3. x + y is
+    // computed straight into x's register with no loads or stores.
+    bool found = false;
+    for (const auto& instr : instructions_) {
+        if (instr.opcode == RegOpcode::ADD_I32) {
+            EXPECT_EQ(instr.dst, 1u);
+            EXPECT_EQ(instr.a, 1u);
+            EXPECT_EQ(instr.b, 3u);
+            found = true;
+        }
+    }
+    EXPECT_TRUE(found);
+}
+
+TEST_F(RegisterVMTest, ControlFlowAndLoops) {
+    Value result = run_program(R"(
+        fn main() -> i32 {
+            let mut i: i32 = 0;
+            let mut acc: i32 = 0;
+            while (i < 10) {
+                if (i > 4) {
+                    acc = acc + i;
+                } else {
+                    acc = acc - 1;
+                }
+                i = i + 1;
+            }
+            return acc;
+        }
+    )");
+    EXPECT_EQ(result.as_int(), 30);
+}
+
+TEST_F(RegisterVMTest, FunctionCalls) {
+    Value result = run_program(R"(
+        fn add(x: i32, y: i32) -> i32 {
+            return x + y;
+        }
+
+        fn sub(x: i32, y: i32) -> i32 {
+            return x - y;
+        }
+
+        fn main() -> i32 {
+            let a: i32 = 50;
+            let result: i32 = sub(add(a, 2), 10);
+            return result + a;
+        }
+    )");
+    EXPECT_EQ(result.as_int(), 92);
+}
+
+TEST_F(RegisterVMTest, Recursion) {
+    Value result = run_program(R"(
+        fn fib(n: i32) -> i32 {
+            if (n < 2) {
+                return n;
+            }
+            return fib(n - 1) + fib(n - 2);
+        }
+
+        fn main() -> i32 {
+            return fib(15);
+        }
+    )");
+    EXPECT_EQ(result.as_int(), 610);
+}
+
+TEST_F(RegisterVMTest, Strings) {
+    Value result = run_program(R"(
+        fn main() -> str {
+            return "hello";
+        }
+    )");
+    ASSERT_TRUE(result.is_string());
+    EXPECT_EQ(result.as_string(), "hello");
+}
+
+TEST_F(RegisterVMTest, DivisionByZero) {
+    EXPECT_THROW(run_program(R"(
+        fn main() -> i32 {
+            let x: i32 = 0;
+            return 1 / x;
+        }
+    )"), std::runtime_error);
+}
+
+// Test that an assignment on the right of an operator doesn't change the
+// variable the left operand already read
+TEST_F(RegisterVMTest, OperandsAreReadInOrder) {
+    const char* sources[] = {
+        R"(
+            fn main() -> i32 {
+                let mut x: i32 = 1;
+                return x + (x = 5);
+            }
+        )",
+        R"(
+            fn main() -> i32 {
+                let mut x: i32 = 1;
+                return (x = 3) * 10 + (x = 5) - x * (x = 2);
+            }
+        )",
+        R"(
+            fn main() -> i32 {
+                let mut x: i32 = 4;
+                let b: bool = x < (x = 9);
+                if (b) {
+                    return x;
+                }
+                return 0;
+            }
+        )",
+    };
+    for (const char* source : sources) {
+        Value expected = run_stack_program(source).result;
+        EXPECT_EQ(run_program(source).as_int(), expected.as_int()) << source;
+    }
+    EXPECT_EQ(run_stack_program(sources[0]).result.as_int(), 6);
+}
+
+// Test that unbounded recursion reports a stack overflow with the call chain
+// instead of growing the register file without limit
+TEST_F(RegisterVMTest, StackOverflow) {
+    const char* source = R"(
+        fn recurse(n: i32) -> i32 {
+            return recurse(n + 1);
+        }
+
+        fn main() -> i32 {
+            return recurse(0);
+        }
+    )";
+
+    CallStackConfig config;
+    config.max_depth = 100;
+    try {
+        run_program(source, config);
+        FAIL() << "Expected StackOverflowError";
+    } catch (const StackOverflowError& e) {
+        std::string message = e.what();
+        EXPECT_NE(message.find("call depth limit of 100"), std::string::npos) << message;
+        EXPECT_NE(message.find("main -> recurse (x99)"), std::string::npos) << message;
+    }
+
+    config = CallStackConfig();
+    config.max_slots = 1000;
+    try {
+        run_program(source, config);
+        FAIL() << "Expected StackOverflowError";
+    } catch (const StackOverflowError& e) {
+        std::string message = e.what();
+        EXPECT_NE(message.find("stack size limit of 1000 slots"), std::string::npos) << message;
+    }
+}
+
+// Test that operands of the wrong kind are rejected with the stack VM's
+// messages rather than reinterpreted
+TEST_F(RegisterVMTest, OperandTagsAreChecked) {
+    FunctionTable function_table;
+    function_table.add_function(FunctionInfo{0, 0, 3, Type::get(Type::Kind::I32), {}, "main"});
+    std::vector<Value> constants;
+    auto error = [&](std::vector<RegInstruction> instructions) {
+        RegisterVM vm(function_table, constants, instructions);
+        try {
+            vm.run();
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+
+    EXPECT_EQ(error({
+        {RegOpcode::LOADK_BOOL, 0, 1},
+        {RegOpcode::LOADK_I32, 1, 2},
+        {RegOpcode::ADD_I32, 2, 0, 1},
+        {RegOpcode::RET_VAL, 0, 2},
+    }), "Expected integer values");
+    EXPECT_EQ(error({
+        {RegOpcode::LOADK_BOOL, 0, 1},
+        {RegOpcode::LOADK_BOOL, 1, 1},
+        {RegOpcode::EQ_I32, 2, 0, 1},
+        {RegOpcode::RET_VAL, 0, 2},
+    }), "Expected integer values");
+    EXPECT_EQ(error({
+        {RegOpcode::LOADK_I32, 0, 1},
+        {RegOpcode::JMP_IF, 0, 0, 2},
+        {RegOpcode::RET_VAL, 0, 0},
+    }), "Expected boolean value");
+    EXPECT_EQ(error({
+        {RegOpcode::LOADK_I32, 0, 1},
+        {RegOpcode::DEREF, 1, 0},
+        {RegOpcode::RET_VAL, 0, 1},
+    }), "Expected reference value");
+}
+
+TEST_F(RegisterVMTest, FewerInstructionsThanStackVM) {
+    const char* source = R"(
+        fn main() -> i32 {
+            let mut i: i32 = 0;
+            let mut a: i32 = 0;
+            while (i < 100) {
+                a = a + i * 3 - i / 2;
+                i = i + 1;
+            }
+            return a;
+        }
+    )";
+    uint64_t stack_count = run_stack_program(source).executed;
+    Value result = run_program(source);
+    EXPECT_EQ(result.as_int(), 12400);
+    EXPECT_LE(executed_ * 2, stack_count);
+}
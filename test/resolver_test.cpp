@@ -0,0 +1,157 @@
+#include "parser.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace nust {
+
+// Parser::parse runs the Resolver, so these only parse
+static const FunctionDecl* first_function(const Program& program) {
+    return node_cast<FunctionDecl>(program.items[0]);
+}
+
+static const BlockStmt* body(const FunctionDecl* func) {
+    return node_cast<BlockStmt>(func->body);
+}
+
+TEST(ResolverTest, ParametersThenLocalsGetSlots) {
+    Parser parser(R"(
+        fn f(a: i32, b: i32) -> i32 {
+            let c: i32 = a;
+            let d: i32 = b;
+            return c + d;
+        }
+    )");
+    auto program = parser.parse();
+    auto* func = first_function(*program);
+    EXPECT_EQ(func->num_bindings, 4u);
+    EXPECT_EQ(func->num_slots, 4u);
+
+    auto* c = node_cast<LetStmt>(body(func)->statements[0]);
+    auto* d = node_cast<LetStmt>(body(func)->statements[1]);
+    EXPECT_EQ(c->slot, 2u);
+    EXPECT_EQ(d->slot, 3u);
+
+    auto* a = node_cast<Identifier>(c->init);
+    EXPECT_EQ(a->resolution, Resolution::Local);
+    EXPECT_EQ(a->slot, 0u);
+
+    auto* ret = node_cast<ReturnStmt>(body(func)->statements[2]);
+    auto* sum = node_cast<BinaryExpr>(ret->value);
+    EXPECT_EQ(node_cast<Identifier>(sum->left)->binding, c->binding);
+    EXPECT_EQ(node_cast<Identifier>(sum->right)->binding, d->binding);
+}
+
+TEST(ResolverTest, ShadowingGetsItsOwnSlot) {
+    Parser parser(R"(
+        fn main() -> i32 {
+            let x: i32 = 1;
+            if (true) {
+                let x: bool = false;
+                x;
+            }
+            return x;
+        }
+    )");
+    auto program = parser.parse();
+    auto* func = first_function(*program);
+    auto* outer = node_cast<LetStmt>(body(func)->statements[0]);
+    auto* branch = node_cast<BlockStmt>(node_cast<IfStmt>(body(func)->statements[1])->then_branch);
+    auto* inner = node_cast<LetStmt>(branch->statements[0]);
+    auto* inner_use = node_cast<Identifier>(node_cast<ExprStmt>(branch->statements[1])->expr);
+    auto* outer_use = node_cast<Identifier>(node_cast<ReturnStmt>(body(func)->statements[2])->value);
+
+    EXPECT_FALSE(inner->redeclares);
+    EXPECT_NE(inner->slot, outer->slot);
+    EXPECT_NE(inner->binding, outer->binding);
+    EXPECT_EQ(inner_use->binding, inner->binding);
+    EXPECT_EQ(inner_use->slot, inner->slot);
+    EXPECT_EQ(outer_use->binding, outer->binding);
+    EXPECT_EQ(outer_use->slot, outer->slot);
+    EXPECT_EQ(func->num_slots, 2u);
+    EXPECT_EQ(func->num_bindings, 2u);
+}
+
+TEST(ResolverTest, ClosedScopesGiveTheirSlotsBack) {
+    Parser parser(R"(
+        fn f(a: i32) -> i32 {
+            if (true) {
+                let b: i32 = 1;
+                let c: i32 = 2;
+            }
+            let d: bool = true;
+            while (d) {
+                let e: i32 = 3;
+            }
+            return a;
+        }
+    )");
+    auto program = parser.parse();
+    auto* func = first_function(*program);
+    auto* then_branch = node_cast<BlockStmt>(node_cast<IfStmt>(body(func)->statements[0])->then_branch);
+    auto* d = node_cast<LetStmt>(body(func)->statements[1]);
+    auto* loop_body = node_cast<BlockStmt>(node_cast<WhileStmt>(body(func)->statements[2])->body);
+
+    EXPECT_EQ(node_cast<LetStmt>(then_branch->statements[0])->slot, 1u);
+    EXPECT_EQ(node_cast<LetStmt>(then_branch->statements[1])->slot, 2u);
+    EXPECT_EQ(d->slot, 1u);
+    EXPECT_EQ(node_cast<LetStmt>(loop_body->statements[0])->slot, 2u);
+    EXPECT_EQ(func->num_slots, 3u);
+    EXPECT_EQ(func->num_bindings, 5u);
+}
+
+TEST(ResolverTest, UndeclaredAndOutOfScopeNames) {
+    Parser parser(R"(
+        fn main() -> i32 {
+            let a: i32 = a;
+            if (true) {
+                let inner: i32 = 1;
+            }
+            return inner + missing;
+        }
+    )");
+    auto program = parser.parse();
+    auto* func = first_function(*program);
+    auto* let = node_cast<LetStmt>(body(func)->statements[0]);
+    EXPECT_EQ(node_cast<Identifier>(let->init)->resolution, Resolution::Unresolved);
+
+    auto* ret = node_cast<ReturnStmt>(body(func)->statements[2]);
+    auto* sum = node_cast<BinaryExpr>(ret->value);
+    EXPECT_EQ(node_cast<Identifier>(sum->left)->resolution, Resolution::Unresolved);
+    EXPECT_EQ(node_cast<Identifier>(sum->right)->resolution, Resolution::Unresolved);
+}
+
+TEST(ResolverTest, FunctionsAndRedeclarations) {
+    Parser parser(R"(
+        fn main(x: i32, x: i32) -> i32 {
+            let mut helper: i32 = 1;
+            let y: i32 = 2;
+            let y: i32 = 3;
+            helper = helper(y);
+            return helper;
+        }
+
+        fn helper(n: i32) -> i32 {
+            return n;
+        }
+    )");
+    auto program = parser.parse();
+    auto* func = first_function(*program);
+    EXPECT_FALSE(func->params[0].redeclares);
+    EXPECT_TRUE(func->params[1].redeclares);
+    EXPECT_FALSE(node_cast<LetStmt>(body(func)->statements[1])->redeclares);
+    EXPECT_TRUE(node_cast<LetStmt>(body(func)->statements[2])->redeclares);
+
+    // Function names win, except as an assignment target
+    auto* assign = node_cast<BinaryExpr>(node_cast<ExprStmt>(body(func)->statements[3])->expr);
+    EXPECT_EQ(node_cast<Identifier>(assign->left)->resolution, Resolution::Local);
+    EXPECT_TRUE(node_cast<Identifier>(assign->left)->is_mut_binding);
+    auto* call = node_cast<CallExpr>(assign->right);
+    EXPECT_EQ(node_cast<Identifier>(call->callee)->resolution, Resolution::Function);
+    auto* ret = node_cast<ReturnStmt>(body(func)->statements[4]);
+    EXPECT_EQ(node_cast<Identifier>(ret->value)->resolution, Resolution::Function);
+    EXPECT_EQ(func->functions_used, (std::vector<Symbol>{Symbol("helper"), Symbol("helper")}));
+    EXPECT_TRUE(node_cast<FunctionDecl>(program->items[1])->functions_used.empty());
+}
+
+} // namespace nust
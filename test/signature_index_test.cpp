@@ -0,0 +1,72 @@
+#include "signature_index.h"
+#include "function_table.h"
+#include "type_checker.h"
+#include <gtest/gtest.h>
+
+namespace nust {
+
+TEST(SignatureIndexTest, MainComesFirst) {
+    Parser parser(R"(
+        fn helper(a: i32, b: &bool) -> i32 {
+            return a;
+        }
+
+        fn main() -> i32 {
+            return helper(1, &true);
+        }
+
+        fn other() -> bool {
+            return false;
+        }
+    )");
+    auto program = parser.parse();
+    SignatureIndex signatures(*program);
+
+    ASSERT_EQ(signatures.size(), 3u);
+    EXPECT_TRUE(signatures.has_main());
+    EXPECT_EQ(signatures[0].name, "main");
+    EXPECT_EQ(signatures[1].name, "helper");
+    EXPECT_EQ(signatures[2].name, "other");
+
+    const FunctionSignature* helper = signatures.find(Symbol("helper"));
+    ASSERT_NE(helper, nullptr);
+    EXPECT_EQ(helper, &signatures[1]);
+    ASSERT_EQ(helper->param_types.size(), 2u);
+    EXPECT_EQ(helper->param_types[0]->kind, Type::Kind::I32);
+    EXPECT_EQ(helper->param_types[1]->kind, Type::Kind::Ref);
+    EXPECT_EQ(helper->return_type->kind, Type::Kind::I32);
+    EXPECT_EQ(signatures.find(Symbol("missing")), nullptr);
+}
+
+TEST(SignatureIndexTest, WithoutMain) {
+    Parser parser(R"(
+        fn first() -> i32 { return 1; }
+        fn second() -> i32 { return 2; }
+    )");
+    auto program = parser.parse();
+    SignatureIndex signatures(*program);
+
+    EXPECT_FALSE(signatures.has_main());
+    ASSERT_EQ(signatures.size(), 2u);
+    EXPECT_EQ(signatures[0].name, "first");
+    EXPECT_EQ(signatures[1].name, "second");
+}
+
+TEST(SignatureIndexTest, FunctionTableFollowsTheIndex) {
+    Parser parser(R"(
+        fn add(a: i32, b: i32) -> i32 { return a + b; }
+        fn main() -> i32 { return add(1, 2); }
+    )");
+    auto program = parser.parse();
+    TypeChecker type_checker;
+    ASSERT_TRUE(type_checker.check_program(*program));
+
+    FunctionTable table(type_checker.signatures());
+    ASSERT_EQ(table.size(), 2u);
+    EXPECT_EQ(table.get_function(0).name, "main");
+    EXPECT_EQ(table.get_function(1).name, "add");
+    EXPECT_EQ(table.get_function(1).num_params, 2u);
+    EXPECT_EQ(table.get_function_index(Symbol("add")), 1u);
+}
+
+} // namespace nust
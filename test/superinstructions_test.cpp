@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include "superinstructions.h"
+#include "peephole.h"
+#include "parser.h"
+#include "type_checker.h"
+#include "compiler.h"
+#include "vm.h"
+#include <string>
+#include <vector>
+
+using namespace nust;
+
+class SuperinstructionTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        auto main_decl = std::make_unique<FunctionDecl>(
+            Span(0, 0),
+            "main",
+            std::vector<FunctionDecl::Param>{},
+            Type::get(Type::Kind::I32),
+            nullptr
+        );
+        function_table_.add_function(*main_decl, 0);
+        // Handwritten programs below use two locals
+        const_cast<FunctionInfo&>(function_table_.get_function(0)).num_locals = 2;
+    }
+
+    std::vector<Instruction> fuse(std::vector<Instruction> instructions) {
+        pass_.run(instructions, function_table_);
+        return instructions;
+    }
+
+    Value run(const std::vector<Instruction>& instructions) {
+        VirtualMachine vm(function_table_, constants_, instructions);
+        vm.run();
+        return vm.get_result();
+    }
+
+    struct Run {
+        Value result;
+        uint64_t executed;
+    };
+
+    Run run_source(const std::string& source, bool optimize) {
+        Parser parser(source);
+        auto program = parser.parse();
+        TypeChecker type_checker;
+        EXPECT_TRUE(type_checker.check_program(*program));
+
+        Compiler compiler;
+        if (optimize) {
+            compiler.add_pass(std::make_unique<PeepholeOptimizer>());
+            compiler.add_pass(std::make_unique<SuperinstructionPass>());
+        }
+        auto instructions = compiler.compile(*program);
+        VirtualMachine vm(compiler.get_function_table(), constants_, instructions);
+        vm.run();
+        return {vm.get_result(), vm.instructions_executed()};
+    }
+
+    SuperinstructionPass pass_;
+    FunctionTable function_table_;
+    std::vector<Value> constants_;
+};
+
+TEST_F(SuperinstructionTest, IncLocal) {
+    auto code = fuse({
+        {Opcode::PUSH_I32, 40},
+        {Opcode::STORE, 0},
+        {Opcode::LOAD, 0},
+        {Opcode::PUSH_I32, 2},
+        {Opcode::ADD_I32},
+        {Opcode::STORE, 0},
+        {Opcode::LOAD, 0},
+        {Opcode::RET_VAL}
+    });
+    ASSERT_EQ(code.size(), 5);
+    EXPECT_EQ(code[2].opcode, Opcode::INC_LOCAL);
+    EXPECT_EQ(operand_a(code[2].operand), 0u);
+    EXPECT_EQ(operand_b(code[2].operand), 2u);
+    EXPECT_EQ(run(code).as_int(), 42);
+}
+
+TEST_F(SuperinstructionTest, IncLocalNegativeConstant) {
+    auto code = fuse({
+        {Opcode::PUSH_I32, 44},
+        {Opcode::STORE, 0},
+        {Opcode::LOAD, 0},
+        {Opcode::PUSH_I32, static_cast<size_t>(-2)},
+        {Opcode::ADD_I32},
+        {Opcode::STORE, 0},
+        {Opcode::LOAD, 0},
+        {Opcode::RET_VAL}
+    });
+    EXPECT_EQ(code[2].opcode, Opcode::INC_LOCAL);
+    EXPECT_EQ(run(code).as_int(), 42);
+}
+
+TEST_F(SuperinstructionTest, LoadLoadAdd) {
+    auto code = fuse({
+        {Opcode::PUSH_I32, 40},
+        {Opcode::STORE, 0},
+        {Opcode::PUSH_I32, 2},
+        {Opcode::STORE, 1},
+        {Opcode::LOAD, 0},
+        {Opcode::LOAD, 1},
+        {Opcode::ADD_I32},
+        {Opcode::RET_VAL}
+    });
+    ASSERT_EQ(code.size(), 6);
+    EXPECT_EQ(code[4].opcode, Opcode::LOAD_LOAD_ADD);
+    EXPECT_EQ(run(code).as_int(), 42);
+}
+
+TEST_F(SuperinstructionTest, LoadLoad) {
+    auto code = fuse({
+        {Opcode::PUSH_I32, 50},
+        {Opcode::STORE, 0},
+        {Opcode::PUSH_I32, 8},
+        {Opcode::STORE, 1},
+        {Opcode::LOAD, 0},
+        {Opcode::LOAD, 1},
+        {Opcode::SUB_I32},
+        {Opcode::RET_VAL}
+    });
+    EXPECT_EQ(code[4].opcode, Opcode::LOAD_LOAD);
+    EXPECT_EQ(run(code).as_int(), 42);
+}
+
+TEST_F(SuperinstructionTest, CompareAndBranch) {
+    auto code = fuse({
+        {Opcode::PUSH_I32, 3},
+        {Opcode::STORE, 0},
+        {Opcode::LOAD, 0},
+        {Opcode::PUSH_I32, 5},
+        {Opcode::LT_I32},
+        {Opcode::JMP_IF_NOT, 8},
+        {Opcode::PUSH_I32, 1},
+        {Opcode::RET_VAL},
+        {Opcode::PUSH_I32, 2},
+        {Opcode::RET_VAL}
+    });
+    ASSERT_EQ(code.size(), 8);
+    EXPECT_EQ(code[2].opcode, Opcode::LOAD_PUSH_I32);
+    EXPECT_EQ(code[3].opcode, Opcode::CMP_LT_JMP_IF_NOT);
+    EXPECT_EQ(code[3].operand, 6);
+    EXPECT_EQ(run(code).as_int(), 1);
+}
+
+TEST_F(SuperinstructionTest, NoFusionAcrossJumpTarget) {
+    auto code = fuse({
+        {Opcode::PUSH_BOOL, 1},
+        {Opcode::JMP_IF, 3},
+        {Opcode::LOAD, 0},
+        {Opcode::LOAD, 0},       // jump target
+        {Opcode::RET_VAL}
+    });
+    EXPECT_EQ(code[2].opcode, Opcode::LOAD);
+    EXPECT_EQ(code[3].opcode, Opcode::LOAD);
+}
+
+TEST_F(SuperinstructionTest, LoopDispatchesFewerInstructions) {
+    const char* source = R"(
+        fn main() -> i32 {
+            let mut i: i32 = 0;
+            let mut acc: i32 = 0;
+            while (i < 1000) {
+                acc = acc + i;
+                if (i == 500) {
+                    acc = acc - 1;
+                }
+                i = i + 1;
+            }
+            return acc;
+        }
+    )";
+    Run plain = run_source(source, false);
+    Run fused = run_source(source, true);
+    EXPECT_EQ(plain.result.as_int(), 499499);
+    EXPECT_EQ(fused.result.as_int(), plain.result.as_int());
+    EXPECT_LT(fused.executed * 2, plain.executed);
+}
@@ -0,0 +1,63 @@
+#include "symbol.h"
+#include "lexer.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace nust {
+
+TEST(SymbolTest, SameSpellingSameId) {
+    Symbol a("counter");
+    Symbol b(std::string("count") + "er");
+    Symbol c("counters");
+
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.id(), b.id());
+    EXPECT_NE(a, c);
+    EXPECT_EQ(a.str(), "counter");
+    EXPECT_EQ(c, "counters");
+}
+
+TEST(SymbolTest, DefaultIsTheEmptyName) {
+    Symbol empty;
+    EXPECT_EQ(empty.id(), 0u);
+    EXPECT_EQ(empty, Symbol(""));
+    EXPECT_EQ(empty.str(), "");
+}
+
+TEST(SymbolTest, SharedAcrossSources) {
+    auto first = Lexer("let alpha: i32 = beta;").tokenize();
+    auto second = Lexer("beta(alpha)").tokenize();
+
+    // Local name indices differ, the symbols don't
+    EXPECT_EQ(first.names[first.tokens[1].payload], second.names[second.tokens[2].payload]);
+    EXPECT_EQ(first.names[first.tokens[5].payload], second.names[second.tokens[0].payload]);
+}
+
+TEST(SymbolTest, InterningFromManyThreads) {
+    constexpr int threads = 4;
+    constexpr int names = 500;
+    std::vector<std::vector<Symbol>> results(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&results, t] {
+            for (int i = 0; i < names; i++) {
+                results[t].push_back(Symbol("threaded_" + std::to_string(i)));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::unordered_set<Symbol> distinct(results[0].begin(), results[0].end());
+    EXPECT_EQ(distinct.size(), static_cast<size_t>(names));
+    for (int t = 1; t < threads; t++) {
+        EXPECT_EQ(results[t], results[0]);
+    }
+    EXPECT_EQ(results[0][7].str(), "threaded_7");
+}
+
+} // namespace nust
@@ -0,0 +1,51 @@
+#include "thread_pool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace nust {
+
+TEST(ThreadPoolTest, CoversEveryIndexOnce) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4u);
+    for (size_t count : {0u, 1u, 7u, 1000u}) {
+        std::vector<std::atomic<int>> hits(count);
+        pool.parallel_for(count, [&](size_t begin, size_t end) {
+            EXPECT_LT(begin, end);
+            for (size_t i = begin; i < end; i++) {
+                hits[i]++;
+            }
+        });
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(hits[i].load(), 1) << "index " << i << " of " << count;
+        }
+    }
+}
+
+TEST(ThreadPoolTest, RethrowsAfterAllChunksFinish) {
+    ThreadPool pool(3);
+    std::atomic<size_t> done{0};
+    EXPECT_THROW(pool.parallel_for(100, [&](size_t begin, size_t end) {
+        if (begin == 0) {
+            throw std::runtime_error("first chunk failed");
+        }
+        done += end - begin;
+    }), std::runtime_error);
+    EXPECT_GT(done.load(), 0u);
+
+    // The pool is still usable afterwards
+    std::atomic<size_t> total{0};
+    pool.parallel_for(10, [&](size_t begin, size_t end) { total += end - begin; });
+    EXPECT_EQ(total.load(), 10u);
+}
+
+TEST(ThreadPoolTest, SingleThreadRunsInline) {
+    ThreadPool pool(1);
+    EXPECT_EQ(pool.size(), 1u);
+    size_t total = 0;
+    pool.parallel_for(50, [&](size_t begin, size_t end) { total += end - begin; });
+    EXPECT_EQ(total, 50u);
+}
+
+} // namespace nust
@@ -1,5 +1,6 @@
 #include "parser.h"
 #include "type_checker.h"
+#include "thread_pool.h"
 #include <gtest/gtest.h>
 
 namespace nust {
@@ -252,4 +253,39 @@ TEST(TypeCheckerTest, UseWhileBorrowed) {
     ASSERT_FALSE(checker.errors().empty());
 }
 
+TEST(TypeCheckerTest, ParallelReportsLikeSerial) {
+    // Functions 5 and 12 are wrong; the serial checker stops at 5
+    std::string source;
+    for (int i = 0; i < 20; i++) {
+        std::string init = (i == 5 || i == 12) ? "true" : std::to_string(i);
+        source += "fn f" + std::to_string(i) + "() -> i32 { let x: i32 = " + init + "; return x; }\n";
+    }
+    source += "fn main() -> i32 { return f0(); }\n";
+
+    auto serial_program = Parser(source).parse();
+    TypeChecker serial;
+    ASSERT_FALSE(serial.check_program(*serial_program));
+
+    auto parallel_program = Parser(source).parse();
+    ThreadPool pool(4);
+    TypeChecker parallel;
+    parallel.set_thread_pool(&pool);
+    ASSERT_FALSE(parallel.check_program(*parallel_program));
+    EXPECT_EQ(parallel.errors(), serial.errors());
+    EXPECT_EQ(parallel.errors().size(), 1u);
+
+    // A correct program checks the same and gets the same types
+    auto fixed = source;
+    for (auto pos = fixed.find("= true"); pos != std::string::npos; pos = fixed.find("= true")) {
+        fixed.replace(pos, 6, "= 1");
+    }
+    auto program = Parser(fixed).parse();
+    TypeChecker checker;
+    checker.set_thread_pool(&pool);
+    ASSERT_TRUE(checker.check_program(*program));
+    auto* last = static_cast<const FunctionDecl*>(program->items[19]);
+    auto* let = static_cast<const LetStmt*>(static_cast<const BlockStmt*>(last->body)->statements[0]);
+    EXPECT_EQ(let->init->type, Type::get(Type::Kind::I32));
+}
+
 } // namespace nust 
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "type.h"
+#include "parser.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+namespace nust {
+
+TEST(TypeTest, SameTypeSameObject) {
+    const Type* i32 = Type::get(Type::Kind::I32);
+    EXPECT_EQ(i32, Type::get(Type::Kind::I32));
+    EXPECT_NE(i32, Type::get(Type::Kind::Bool));
+
+    const Type* ref = Type::reference(i32, false);
+    EXPECT_EQ(ref, Type::get(Type::Kind::Ref, i32));
+    EXPECT_EQ(ref->kind, Type::Kind::Ref);
+    EXPECT_EQ(ref->base_type, i32);
+    EXPECT_NE(ref, Type::reference(i32, true));
+
+    // Types written in separate programs are the same objects
+    auto first = Parser("fn f(a: &mut &i32) -> bool { return true; }").parse();
+    auto second = Parser("fn g() -> i32 { let x: &mut &i32 = 0; return 0; }").parse();
+    auto* f = static_cast<const FunctionDecl*>(first->items[0]);
+    auto* let = static_cast<const LetStmt*>(static_cast<const BlockStmt*>(
+        static_cast<const FunctionDecl*>(second->items[0])->body)->statements[0]);
+    EXPECT_EQ(f->params[0].type, let->type);
+    EXPECT_EQ(f->params[0].type, Type::reference(ref, true));
+}
+
+TEST(TypeTest, SharedFormAndAssignability) {
+    const Type* i32 = Type::get(Type::Kind::I32);
+    const Type* ref = Type::reference(i32, false);
+    const Type* mut_ref = Type::reference(i32, true);
+    const Type* ref_mut_ref = Type::reference(mut_ref, false);
+    const Type* ref_ref = Type::reference(ref, false);
+
+    EXPECT_EQ(i32->shared(), i32);
+    EXPECT_EQ(ref->shared(), ref);
+    EXPECT_EQ(mut_ref->shared(), ref);
+    EXPECT_EQ(ref_mut_ref->shared(), ref_ref);
+
+    EXPECT_TRUE(ref->is_assignable_from(mut_ref));
+    EXPECT_FALSE(mut_ref->is_assignable_from(ref));
+    EXPECT_TRUE(ref_ref->is_assignable_from(ref_mut_ref));
+    EXPECT_FALSE(ref_mut_ref->is_assignable_from(ref_ref));
+    EXPECT_FALSE(ref->is_assignable_from(i32));
+    EXPECT_FALSE(ref->is_assignable_from(Type::reference(Type::get(Type::Kind::Bool), true)));
+}
+
+TEST(TypeTest, DeepReferencesAndThreads) {
+    // Deeper than the mutability bit mask, so the slow path is used
+    const Type* shared = Type::get(Type::Kind::Str);
+    const Type* with_mut = shared;
+    for (int i = 0; i < 70; i++) {
+        shared = Type::reference(shared, false);
+        with_mut = Type::reference(with_mut, i == 2);
+    }
+    EXPECT_EQ(with_mut->shared(), shared);
+    EXPECT_TRUE(shared->is_assignable_from(with_mut));
+    EXPECT_FALSE(with_mut->is_assignable_from(shared));
+
+    std::vector<const Type*> results(4);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < results.size(); t++) {
+        workers.emplace_back([&results, t] {
+            const Type* type = Type::get(Type::Kind::Bool);
+            for (int i = 0; i < 200; i++) {
+                type = Type::reference(type, i % 3 == 0);
+            }
+            results[t] = type;
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (const Type* type : results) {
+        EXPECT_EQ(type, results[0]);
+    }
+}
+
+} // namespace nust
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+#include "verifier.h"
+#include "parser.h"
+#include "type_checker.h"
+#include "compiler.h"
+#include "peephole.h"
+#include "superinstructions.h"
+#include "vm.h"
+#include <string>
+#include <vector>
+
+using namespace nust;
+
+class VerifierTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        auto main_decl = std::make_unique<FunctionDecl>(
+            Span(0, 0),
+            "main",
+            std::vector<FunctionDecl::Param>{},
+            Type::get(Type::Kind::I32),
+            nullptr
+        );
+        function_table_.add_function(*main_decl, 0);
+        // Handwritten programs below use two locals
+        const_cast<FunctionInfo&>(function_table_.get_function(0)).num_locals = 2;
+    }
+
+    void verify(const std::vector<Instruction>& instructions) {
+        BytecodeVerifier verifier(function_table_, constants_.size());
+        verifier.verify(PackedCode::encode(instructions, function_table_));
+    }
+
+    struct Run {
+        Value result;
+        uint64_t executed;
+    };
+
+    Run run_source(const std::string& source, bool optimize, bool verified) {
+        Parser parser(source);
+        auto program = parser.parse();
+        TypeChecker type_checker;
+        EXPECT_TRUE(type_checker.check_program(*program));
+
+        Compiler compiler;
+        if (optimize) {
+            compiler.add_pass(std::make_unique<PeepholeOptimizer>());
+            compiler.add_pass(std::make_unique<SuperinstructionPass>());
+        }
+        auto instructions = compiler.compile(*program);
+        VirtualMachine vm(compiler.get_function_table(), constants_, instructions);
+        if (verified) {
+            vm.verify();
+            EXPECT_TRUE(vm.is_verified());
+        }
+        vm.run();
+        return {vm.get_result(), vm.instructions_executed()};
+    }
+
+    FunctionTable function_table_;
+    std::vector<Value> constants_;
+};
+
+TEST_F(VerifierTest, VerifiedModeMatchesCheckedMode) {
+    const std::string source = R"(
+        fn fib(n: i32) -> i32 {
+            if (n < 2) {
+                return n;
+            }
+            return fib(n - 1) + fib(n - 2);
+        }
+
+        fn is_even(n: i32) -> bool {
+            return n / 2 * 2 == n;
+        }
+
+        fn main() -> i32 {
+            let mut i: i32 = 0;
+            let mut acc: i32 = 0;
+            while (i < 12) {
+                if (is_even(i) && !(i == 4)) {
+                    acc = acc + fib(i);
+                } else {
+                    acc = acc - 1;
+                }
+                i = i + 1;
+            }
+            return acc;
+        }
+    )";
+    for (bool optimize : {false, true}) {
+        Run checked = run_source(source, optimize, false);
+        Run verified = run_source(source, optimize, true);
+        EXPECT_EQ(checked.result.as_int(), 78) << "optimize=" << optimize;
+        EXPECT_EQ(verified.result.as_int(), checked.result.as_int()) << "optimize=" << optimize;
+        EXPECT_EQ(verified.executed, checked.executed) << "optimize=" << optimize;
+    }
+}
+
+TEST_F(VerifierTest, RejectsStackUnderflow) {
+    EXPECT_THROW(verify({
+        {Opcode::PUSH_I32, 1},
+        {Opcode::ADD_I32},
+        {Opcode::RET_VAL}
+    }), VerifyError);
+}
+
+TEST_F(VerifierTest, RejectsOperandTypeMismatch) {
+    EXPECT_THROW(verify({
+        {Opcode::PUSH_BOOL, 1},
+        {Opcode::PUSH_I32, 1},
+        {Opcode::ADD_I32},
+        {Opcode::RET_VAL}
+    }), VerifyError);
+    EXPECT_THROW(verify({
+        {Opcode::PUSH_I32, 1},
+        {Opcode::JMP_IF, 2},
+        {Opcode::RET}
+    }), VerifyError);
+}
+
+TEST_F(VerifierTest, RejectsStackDepthMismatchAtJoin) {
+    EXPECT_THROW(verify({
+        {Opcode::PUSH_BOOL, 1},
+        {Opcode::JMP_IF_NOT, 3},
+        {Opcode::PUSH_I32, 1},
+        {Opcode::PUSH_I32, 2},   // Reached with one operand or none
+        {Opcode::RET_VAL}
+    }), VerifyError);
+}
+
+TEST_F(VerifierTest, TracksLocalTypesAcrossBlocks) {
+    // Local 0 holds a bool on one path into the join and an i32 on the other
+    std::vector<Instruction> instructions = {
+        {Opcode::PUSH_BOOL, 1},
+        {Opcode::JMP_IF_NOT, 5},
+        {Opcode::PUSH_BOOL, 0},
+        {Opcode::STORE, 0},
+        {Opcode::JMP, 5},
+        {Opcode::LOAD, 0},
+        {Opcode::PUSH_I32, 1},
+        {Opcode::ADD_I32},
+        {Opcode::RET_VAL}
+    };
+    EXPECT_THROW(verify(instructions), VerifyError);
+
+    // Moving the value around without using it as an integer is fine
+    instructions[6] = {Opcode::STORE, 1};
+    instructions[7] = {Opcode::PUSH_I32, 0};
+    EXPECT_NO_THROW(verify(instructions));
+}
+
+TEST_F(VerifierTest, RejectsBadIndicesAndTargets) {
+    // Local slot past the frame
+    EXPECT_THROW(verify({{Opcode::LOAD, 2}, {Opcode::RET_VAL}}), VerifyError);
+    // Missing string constant
+    EXPECT_THROW(verify({{Opcode::PUSH_STR, 0}, {Opcode::RET_VAL}}), VerifyError);
+    // Unknown function
+    EXPECT_THROW(verify({{Opcode::CALL, 1}, {Opcode::RET}}), VerifyError);
+    // Jump past the end of the function
+    EXPECT_THROW(verify({{Opcode::JMP, 5}, {Opcode::RET}}), VerifyError);
+    // Control falls off the end
+    EXPECT_THROW(verify({{Opcode::PUSH_I32, 1}, {Opcode::POP}}), VerifyError);
+}
+
+TEST_F(VerifierTest, RejectsJumpIntoAnInstruction) {
+    // PUSH_I32 300 (three bytes), then a jump to its operand byte
+    std::vector<uint8_t> bytes = {
+        static_cast<uint8_t>(Opcode::PUSH_I32), 0xac, 0x02,
+        static_cast<uint8_t>(Opcode::JMP), 1, 0, 0, 0
+    };
+    bytes.resize(bytes.size() + packed_code_padding, 0);
+    auto code = PackedCode::view(bytes.data(), bytes.size() - packed_code_padding, {0});
+    BytecodeVerifier verifier(function_table_, 0);
+    EXPECT_THROW(verifier.verify(code), VerifyError);
+}
+
+TEST_F(VerifierTest, IgnoresUnreachableCode) {
+    EXPECT_NO_THROW(verify({
+        {Opcode::PUSH_I32, 1},
+        {Opcode::RET_VAL},
+        {Opcode::ADD_I32},
+        {Opcode::JMP, 10}
+    }));
+}
+
+TEST_F(VerifierTest, FailedVerificationKeepsCheckedMode) {
+    std::vector<Instruction> instructions = {
+        {Opcode::PUSH_I32, 1},
+        {Opcode::ADD_I32},
+        {Opcode::RET_VAL}
+    };
+    VirtualMachine vm(function_table_, constants_, instructions);
+    EXPECT_THROW(vm.verify(), VerifyError);
+    EXPECT_FALSE(vm.is_verified());
+    EXPECT_THROW(vm.run(), std::runtime_error);
+}
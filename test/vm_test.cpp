@@ -24,7 +24,7 @@ protected:
             Span(0, 0),
             "main",
             std::vector<FunctionDecl::Param>{},
-            std::make_unique<Type>(Type::Kind::I32, Span(0, 0)),
+            Type::get(Type::Kind::I32),
             nullptr
         );
         function_table_.add_function(*main_decl, 0);
@@ -135,13 +135,13 @@ TEST_F(VMTest, ControlFlow) {
 TEST_F(VMTest, FunctionCalls) {
     // Add a test function to the function table
     std::vector<FunctionDecl::Param> params;
-    params.emplace_back(false, "x", std::make_unique<Type>(Type::Kind::I32, Span(0, 0)), Span(0, 0));
+    params.emplace_back(false, "x", Type::get(Type::Kind::I32), Span(0, 0));
     
     auto test_decl = std::make_unique<FunctionDecl>(
         Span(0, 0),
         "test",
         std::move(params),
-        std::make_unique<Type>(Type::Kind::I32, Span(0, 0)),
+        Type::get(Type::Kind::I32),
         nullptr
     );
     size_t test_func_idx = function_table_.add_function(*test_decl, 3);
@@ -185,6 +185,42 @@ TEST_F(VMTest, ReferenceOperations) {
     EXPECT_EQ(vm.get_result().as_int(), 42);
 }
 
+// Test that a frame's borrow boxes are freed when it returns, unless it
+// returns a reference
+TEST_F(VMTest, BoxesAreFreedOnReturn) {
+    auto i32 = Type::get(Type::Kind::I32);
+    size_t peek_idx = function_table_.add_function(FunctionInfo{8, 0, 0, i32, {}, "peek"});
+    size_t keep_idx = function_table_.add_function(FunctionInfo{12, 0, 0, Type::reference(i32, false), {}, "keep"});
+
+    std::vector<Instruction> instructions = {
+        // Main function: peek() + peek() + *keep()
+        {Opcode::CALL, peek_idx},
+        {Opcode::CALL, peek_idx},
+        {Opcode::ADD_I32},
+        {Opcode::CALL, keep_idx},
+        {Opcode::DEREF},
+        {Opcode::ADD_I32},
+        {Opcode::RET_VAL},
+        {Opcode::RET},
+
+        // peek borrows a value and reads it back
+        {Opcode::PUSH_I32, 1},
+        {Opcode::BORROW},
+        {Opcode::DEREF},
+        {Opcode::RET_VAL},
+
+        // keep returns its borrow
+        {Opcode::PUSH_I32, 7},
+        {Opcode::BORROW},
+        {Opcode::RET_VAL}
+    };
+
+    VirtualMachine vm(function_table_, constants_, instructions);
+    vm.run();
+    EXPECT_EQ(vm.get_result().as_int(), 9);
+    EXPECT_EQ(vm.live_boxes(), 1u);
+}
+
 // Test error handling
 TEST_F(VMTest, ErrorHandling) {
     // Test stack underflow
@@ -208,6 +244,58 @@ TEST_F(VMTest, ErrorHandling) {
     EXPECT_THROW(vm2.run(), std::runtime_error);
 }
 
+// Test that unbounded recursion reports a stack overflow with the call chain
+TEST_F(VMTest, StackOverflow) {
+    auto recurse_decl = std::make_unique<FunctionDecl>(
+        Span(0, 0),
+        "recurse",
+        std::vector<FunctionDecl::Param>{},
+        Type::get(Type::Kind::I32),
+        nullptr
+    );
+    size_t recurse_idx = function_table_.add_function(*recurse_decl, 2);
+
+    std::vector<Instruction> instructions = {
+        // Main function
+        {Opcode::CALL, recurse_idx},
+        {Opcode::RET_VAL},
+
+        // recurse calls itself forever
+        {Opcode::CALL, recurse_idx},
+        {Opcode::RET_VAL}
+    };
+
+    CallStackConfig config;
+    config.max_depth = 100;
+    VirtualMachine vm(function_table_, constants_, instructions, config);
+    try {
+        vm.run();
+        FAIL() << "Expected StackOverflowError";
+    } catch (const StackOverflowError& e) {
+        std::string message = e.what();
+        EXPECT_NE(message.find("main -> recurse (x99)"), std::string::npos) << message;
+    }
+}
+
+// Test the compact value encoding
+TEST_F(VMTest, ValueRepresentation) {
+    EXPECT_EQ(sizeof(Value), 8u);
+
+    EXPECT_EQ(Value(-7).as_int(), -7);
+    EXPECT_TRUE(Value(true).is_bool());
+    EXPECT_FALSE(Value(false).as_bool());
+
+    StringHeap heap;
+    Value str(heap.allocate("hello"));
+    ASSERT_TRUE(str.is_string());
+    EXPECT_EQ(str.as_string(), "hello");
+
+    Value boxed(123);
+    Value ref(&boxed);
+    ASSERT_TRUE(ref.is_ref());
+    EXPECT_EQ(ref.to_string(), "ref(123)");
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();